@@ -0,0 +1,94 @@
+/** @file degreeElevation_example.cpp
+
+    @brief Compares direct degree elevation of tensor B-splines and
+    NURBS with degree elevation by interpolation.
+
+    This file is part of the G+Smo library.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include <gismo.h>
+
+using namespace gismo;
+
+int main(int argc, char *argv[])
+{
+    index_t refinements = 1;
+    index_t minDegree   = 2;
+    index_t maxDegree   = 8;
+    index_t numPoints   = 1000;
+    bool nurbs          = false;
+    bool noInterp       = false;
+
+    gsCmdLine cmd("Benchmarks direct degree elevation of a trivariate spline against elevation by interpolation.");
+    cmd.addInt   ("r", "refine",   "Number of uniform h-refinement steps of the initial (trilinear) volume", refinements);
+    cmd.addInt   ("",  "minDeg",   "Smallest target degree", minDegree);
+    cmd.addInt   ("",  "maxDeg",   "Largest target degree", maxDegree);
+    cmd.addInt   ("n", "points",   "Number of random points for checking the result", numPoints);
+    cmd.addSwitch("nurbs",         "Use a NURBS volume with random weights", nurbs);
+    cmd.addSwitch("nointerp",      "Skip the elevation by interpolation", noInterp);
+    try { cmd.getValues(argc,argv); } catch (int rv) { return rv; }
+
+    GISMO_ENSURE(1 < minDegree && minDegree <= maxDegree, "Invalid degree range");
+
+    // Trilinear volume with perturbed control points
+    gsTensorBSpline<3> cube = *gsNurbsCreator<>::BSplineCube(1);
+    cube.uniformRefine( (1<<refinements) - 1 );
+    gsMatrix<> perturb(cube.coefs().rows(), cube.coefs().cols());
+    perturb.setRandom();
+    cube.coefs() += 0.1 * perturb / (1<<refinements);
+
+    gsGeometry<>::uPtr geo;
+    if (nurbs)
+    {
+        gsMatrix<> weights(cube.coefs().rows(), 1);
+        weights.setRandom();
+        weights.array() += 2;
+        gsTensorNurbsBasis<3> nbasis(cube.basis().clone().release(), give(weights));
+        geo.reset( new gsTensorNurbs<3>(nbasis, cube.coefs()) );
+    }
+    else
+        geo = cube.clone();
+
+    gsMatrix<> pts(3, numPoints), ref, val;
+    pts.setRandom();
+    pts = (pts.array() + 1) / 2;
+    geo->eval_into(pts, ref);
+
+    gsInfo << (nurbs ? "NURBS" : "B-spline") << " volume with "
+           << geo->coefs().rows() << " coefficients\n";
+    gsInfo << "degree    #coefs      direct[s]   interp.[s]  error\n";
+
+    gsStopwatch time;
+    for (index_t p = minDegree; p <= maxDegree; ++p)
+    {
+        gsGeometry<>::uPtr g1 = geo->clone();
+        time.restart();
+        g1->degreeElevate(p - 1);
+        const real_t tDirect = time.stop();
+        g1->eval_into(pts, val);
+        real_t err = (val - ref).cwiseAbs().maxCoeff();
+
+        real_t tInterp = 0;
+        if (!noInterp)
+        {
+            gsGeometry<>::uPtr g2 = geo->clone();
+            time.restart();
+            g2->gsGeometry<real_t>::degreeElevate(p - 1);
+            tInterp = time.stop();
+            g2->eval_into(pts, val);
+            err = math::max(err, (val - ref).cwiseAbs().maxCoeff());
+        }
+
+        gsInfo << std::setw(6)  << p
+               << std::setw(10) << g1->coefs().rows()
+               << std::setw(15) << tDirect
+               << std::setw(13) << tInterp
+               << std::setw(13) << err << "\n";
+    }
+
+    return EXIT_SUCCESS;
+}
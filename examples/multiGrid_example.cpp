@@ -215,6 +215,10 @@ int main(int argc, char *argv[])
             smootherOp = makeJacobiOp(mg->matrix(i));
         else if ( smoother == "GaussSeidel" || smoother == "gs" )
             smootherOp = makeGaussSeidelOp(mg->matrix(i));
+        else if ( smoother == "MultiColorGaussSeidel" || smoother == "mgs" )
+            smootherOp = makeMultiColorGaussSeidelOp(mg->matrix(i));
+        else if ( smoother == "Chebyshev" || smoother == "c" )
+            smootherOp = makeChebyshevOp(mg->matrix(i));
         else if ( smoother == "SubspaceCorrectedMassSmoother" || smoother == "scms" || smoother == "Hybrid" || smoother == "hyb" )
         {
             if (multiBases[i].nBases() == 1)
@@ -237,7 +241,7 @@ int main(int argc, char *argv[])
         }
         else
         {
-            gsInfo << "\n\nThe chosen smoother is unknown.\n\nKnown are:\n  Richardson (r)\n  Jacobi (j)\n  GaussSeidel (gs)"
+            gsInfo << "\n\nThe chosen smoother is unknown.\n\nKnown are:\n  Richardson (r)\n  Jacobi (j)\n  GaussSeidel (gs)\n  MultiColorGaussSeidel (mgs)\n  Chebyshev (c)"
                       "\n  SubspaceCorrectedMassSmoother (scms)\n  Hybrid (hyb)\n\n";
             return EXIT_FAILURE;
         }
@@ -284,6 +288,10 @@ int main(int argc, char *argv[])
     else
         gsInfo << errorHistory.topRows(5).transpose() << " ... " << errorHistory.bottomRows(5).transpose()  << "\n\n";
 
+    gsInfo << "Time spent on the levels of the multigrid solver (in seconds):\n";
+    mg->printTimings(gsInfo);
+    gsInfo << "\n";
+
     if (plot)
     {
         // Construct the solution as a scalar field
@@ -0,0 +1,89 @@
+/** @file sparseMatVec_example.cpp
+
+    @brief Measures the memory bandwidth reached by the sparse
+    matrix-vector product of gsMatrixOp.
+
+    This file is part of the G+Smo library.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include <gismo.h>
+
+using namespace gismo;
+
+// Applies the operator and the serial Eigen product repeatedly and
+// reports the time per product and the reached bandwidth
+template <class MatrixType>
+void benchmark(const MatrixType & mat, index_t numRhs, index_t numRuns,
+               const std::string & name)
+{
+    gsMatrix<> x(mat.cols(), numRhs), y, ref;
+    x.setRandom();
+
+    // Bytes moved by one product: values, indices, input and output
+    const real_t bytes = mat.nonZeros() * (sizeof(real_t) + sizeof(index_t))
+        + (mat.outerSize() + 1) * sizeof(index_t)
+        + (mat.rows() + mat.cols()) * numRhs * sizeof(real_t);
+
+    gsLinearOperator<>::Ptr op = makeMatrixOp(mat);
+    gsStopwatch time;
+
+    op->apply(x, y);
+    time.restart();
+    for (index_t i = 0; i < numRuns; ++i)
+        op->apply(x, y);
+    const real_t tOp = time.stop() / numRuns;
+
+    ref.noalias() = mat * x;
+    time.restart();
+    for (index_t i = 0; i < numRuns; ++i)
+        ref.noalias() = mat * x;
+    const real_t tEigen = time.stop() / numRuns;
+
+    gsInfo << std::setw(10) << name
+           << std::setw(14) << tOp
+           << std::setw(12) << bytes / tOp / 1e9
+           << std::setw(14) << tEigen
+           << std::setw(12) << bytes / tEigen / 1e9
+           << std::setw(13) << (y - ref).cwiseAbs().maxCoeff() << "\n";
+}
+
+int main(int argc, char *argv[])
+{
+    index_t refinements = 3;
+    index_t degree      = 2;
+    index_t numRhs      = 1;
+    index_t numRuns     = 10;
+
+    gsCmdLine cmd("Benchmarks the sparse matrix-vector product of gsMatrixOp.");
+    cmd.addInt("r", "refine", "Number of uniform h-refinement steps of the trivariate basis", refinements);
+    cmd.addInt("p", "degree", "Spline degree", degree);
+    cmd.addInt("m", "rhs",    "Number of right-hand sides", numRhs);
+    cmd.addInt("n", "runs",   "Number of products to average over", numRuns);
+    try { cmd.getValues(argc,argv); } catch (int rv) { return rv; }
+
+    GISMO_ENSURE(0 < numRhs && 0 < numRuns, "Invalid arguments");
+
+    // The stiffness matrix of a trivariate tensor B-spline basis
+    gsKnotVector<> kv(0, 1, (1<<refinements) - 1, degree + 1);
+    gsTensorBSplineBasis<3> basis(kv, kv, kv);
+    const gsSparseMatrix<> colMat =
+        gsPatchPreconditionersCreator<>::stiffnessMatrix(basis);
+    const gsSparseMatrix<real_t, RowMajor> rowMat = colMat;
+
+    gsInfo << "Matrix of size " << colMat.rows() << " with "
+           << colMat.nonZeros() << " non-zeros, " << numRhs << " right-hand side(s)";
+#ifdef _OPENMP
+    gsInfo << ", " << omp_get_max_threads() << " thread(s)";
+#endif
+    gsInfo << "\n";
+    gsInfo << "storage    gsMatrixOp[s]  [GB/s]      Eigen[s]      [GB/s]      difference\n";
+
+    benchmark(colMat, numRhs, numRuns, "ColMajor");
+    benchmark(rowMat, numRhs, numRuns, "RowMajor");
+
+    return EXIT_SUCCESS;
+}
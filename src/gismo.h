@@ -154,15 +154,22 @@ namespace internal
 #include <gsSolver/gsGMRes.h>
 #include <gsSolver/gsGradientMethod.h>
 #include <gsSolver/gsConjugateGradient.h>
+#include <gsSolver/gsBlockConjugateGradient.h>
+#include <gsSolver/gsBlockGMRes.h>
+#include <gsSolver/gsPipelinedConjugateGradient.h>
 #include <gsSolver/gsPreconditioner.h>
 #include <gsSolver/gsAdditiveOp.h>
 #include <gsSolver/gsBlockOp.h>
 #include <gsSolver/gsCompositePrecOp.h>
 #include <gsSolver/gsProductOp.h>
 #include <gsSolver/gsSimplePreconditioners.h>
+#include <gsSolver/gsIncompleteFactorizations.h>
+#include <gsSolver/gsAlgebraicMultiGrid.h>
 #include <gsSolver/gsSumOp.h>
 #include <gsSolver/gsKroneckerOp.h>
 #include <gsSolver/gsPatchPreconditionersCreator.h>
+#include <gsSolver/gsMultiPatchPreconditioners.h>
+#include <gsSolver/gsIetiDpSolver.h>
 #include <gsSolver/gsLanczosMatrix.h>
 
 /* ----------- IO ----------- */
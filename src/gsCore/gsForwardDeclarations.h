@@ -267,6 +267,8 @@ template <class T=real_t>                class gsCompositePrecOp;
 template <class T=real_t>                class gsKroneckerOp;
 template <class T=real_t>                class gsBlockOp;
 template <class T=real_t>                class gsPatchPreconditionersCreator;
+template <class T=real_t>                class gsMultiPatchPreconditionersCreator;
+template <class T=real_t>                class gsIetiDpSolver;
 
 // gsMultiGrid
 
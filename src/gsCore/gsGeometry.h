@@ -597,6 +597,37 @@ public:
                               const T accuracy = 1e-6,
                               const bool useInitialPoint = false) const;
 
+    /// @brief Batched inversion of the physical \a points.
+    ///
+    /// The starting point of every Newton iteration is the nearest
+    /// point of a sampled parameter grid of the geometry with about
+    /// \a numSamples points (0: chosen from the number of
+    /// coefficients), unless \a useInitialPoint is set. The points
+    /// are processed in blocks, in parallel if OpenMP is enabled.
+    ///
+    /// On return, \a flags(i) is the number of Newton iterations
+    /// for the i-th point, or -1 if the point could not be inverted
+    /// up to \a accuracy. In the latter case \a result.col(i) holds
+    /// the last iterate.
+    void invertPoints(const gsMatrix<T> & points, gsMatrix<T> & result,
+                      gsVector<index_t> & flags,
+                      const T accuracy = 1e-6,
+                      const bool useInitialPoint = false,
+                      const index_t numSamples = 0) const;
+
+    /// @brief Batched closest point projection of the physical \a
+    /// points onto the geometry.
+    ///
+    /// Same as the batched invertPoints(), but the iteration
+    /// (Gauss-Newton with the parameters clamped to the domain)
+    /// stops once the update is below \a accuracy, so that points
+    /// off the geometry are projected to their foot point.
+    void closestPointsTo(const gsMatrix<T> & points, gsMatrix<T> & result,
+                         gsVector<index_t> & flags,
+                         const T accuracy = 1e-6,
+                         const bool useInitialPoint = false,
+                         const index_t numSamples = 0) const;
+
     /// Returns the parameters of closest point to \a pt
     void closestPointTo(const gsVector<T> & pt,
                         gsVector<T> & result,
@@ -610,6 +641,13 @@ public:
     size_t id() const { return m_id; }
 
 
+private:
+    // Common implementation of the batched invertPoints() and closestPointsTo()
+    void invertPoints_impl(const gsMatrix<T> & points, gsMatrix<T> & result,
+                           gsVector<index_t> & flags, const T accuracy,
+                           const bool useInitialPoint, const index_t numSamples,
+                           const bool closest) const;
+
 protected:
     void swap(gsGeometry & other)
     {
@@ -18,6 +18,7 @@
 #include <gsCore/gsFuncData.h>
 
 #include <gsCore/gsGeometrySlice.h>
+#include <gsUtils/gsPointGrid.h>
 
 //#include <gsCore/gsMinimizer.h>
 
@@ -77,6 +78,77 @@ private:
     mutable gsMatrix<T> tmp, value, jac;
 };
 
+/// Balanced kd-tree on the columns of a point matrix, used for
+/// finding starting points in gsGeometry::invertPoints
+template<class T>
+class gsSampleKdTree
+{
+public:
+    explicit gsSampleKdTree(const gsMatrix<T> & pts)
+    : m_pts(pts), m_idx(pts.cols())
+    {
+        for (size_t i = 0; i != m_idx.size(); ++i)
+            m_idx[i] = static_cast<index_t>(i);
+        build(0, m_idx.size(), 0);
+    }
+
+    /// Returns the column index of the point nearest to \a x
+    template<class Vec>
+    index_t nearest(const Vec & x) const
+    {
+        index_t best = 0;
+        T bestDist = std::numeric_limits<T>::max();
+        nearest(x, 0, m_idx.size(), 0, best, bestDist);
+        return best;
+    }
+
+private:
+    struct axisLess
+    {
+        axisLess(const gsMatrix<T> & pts, const index_t ax) : m_p(pts), m_a(ax) { }
+        bool operator()(const index_t i, const index_t j) const
+        { return m_p(m_a,i) < m_p(m_a,j); }
+        const gsMatrix<T> & m_p;
+        const index_t m_a;
+    };
+
+    void build(const size_t lo, const size_t hi, const index_t depth)
+    {
+        if (hi - lo < 2) return;
+        const size_t mid = lo + (hi - lo) / 2;
+        std::nth_element(m_idx.begin() + lo, m_idx.begin() + mid,
+                         m_idx.begin() + hi, axisLess(m_pts, depth % m_pts.rows()));
+        build(lo, mid, depth + 1);
+        build(mid + 1, hi, depth + 1);
+    }
+
+    template<class Vec>
+    void nearest(const Vec & x, const size_t lo, const size_t hi,
+                 const index_t depth, index_t & best, T & bestDist) const
+    {
+        if (lo >= hi) return;
+        const size_t mid = lo + (hi - lo) / 2;
+        const index_t j  = m_idx[mid], ax = depth % m_pts.rows();
+        const T dist = (m_pts.col(j) - x).squaredNorm();
+        if (dist < bestDist)
+        {
+            bestDist = dist;
+            best     = j;
+        }
+
+        // visit the side of the splitting plane containing x first
+        const T diff = x[ax] - m_pts(ax,j);
+        const bool left = (diff < 0);
+        nearest(x, left ? lo : mid + 1, left ? mid : hi, depth + 1, best, bestDist);
+        if (diff * diff < bestDist)
+            nearest(x, left ? mid + 1 : lo, left ? hi : mid, depth + 1, best, bestDist);
+    }
+
+private:
+    const gsMatrix<T> & m_pts;
+    std::vector<index_t> m_idx;
+};
+
 template<class T>
 gsMatrix<T> gsGeometry<T>::parameterCenter( const boxCorner& bc )
 {
@@ -250,30 +322,163 @@ void gsGeometry<T>::invertPoints(const gsMatrix<T> & points,
                                  gsMatrix<T> & result,
                                  const T accuracy, const bool useInitialPoint) const
 {
-    result.resize(parDim(), points.cols() );
-    gsVector<T> arg;
+    gsVector<index_t> flags;
+    invertPoints_impl(points, result, flags, accuracy, useInitialPoint, 0, false);
     for ( index_t i = 0; i!= points.cols(); ++i)
+        if (-1==flags[i])
+            result.col(i).setConstant( std::numeric_limits<T>::infinity() );
+}
+
+template<class T>
+void gsGeometry<T>::invertPoints(const gsMatrix<T> & points,
+                                 gsMatrix<T> & result,
+                                 gsVector<index_t> & flags,
+                                 const T accuracy, const bool useInitialPoint,
+                                 const index_t numSamples) const
+{
+    invertPoints_impl(points, result, flags, accuracy, useInitialPoint,
+                      numSamples, false);
+}
+
+template<class T>
+void gsGeometry<T>::closestPointsTo(const gsMatrix<T> & points,
+                                    gsMatrix<T> & result,
+                                    gsVector<index_t> & flags,
+                                    const T accuracy, const bool useInitialPoint,
+                                    const index_t numSamples) const
+{
+    invertPoints_impl(points, result, flags, accuracy, useInitialPoint,
+                      numSamples, true);
+}
+
+template<class T>
+void gsGeometry<T>::invertPoints_impl(const gsMatrix<T> & points,
+                                      gsMatrix<T> & result,
+                                      gsVector<index_t> & flags,
+                                      const T accuracy,
+                                      const bool useInitialPoint,
+                                      const index_t numSamples,
+                                      const bool closest) const
+{
+    const index_t pd = parDim(), gd = geoDim(), npts = points.cols();
+    GISMO_ASSERT( points.rows() == gd, "Invalid input points: "
+                  << points.rows() <<"!="<< gd );
+    GISMO_ASSERT( !useInitialPoint || (result.rows()==pd && result.cols()==npts),
+                  "Invalid initial points." );
+    const gsMatrix<T> supp = support();
+    result.resize(pd, npts);
+    flags.resize(npts);
+
+    // Sample the geometry on a parameter grid, the starting point of
+    // every iteration is the sample closest to the input point
+    gsMatrix<T> samples, sampleVals;
+    if (!useInitialPoint)
     {
-        if (useInitialPoint)
-            arg = result.col(i);
-        else
-            arg = parameterCenter();
-
-        //const int iter =
-        this->newtonRaphson(points.col(i), arg, true, accuracy, 100);
-        //gsInfo<< "Iterations: "<< iter <<"\n";
-        //  if (-1==iter)
-        //    gsWarn<< "Inversion failed for: "<< points.col(i).transpose() <<" (result="<< arg.transpose()<< ")\n";
-        result.col(i) = arg;
-        if ( (this->eval(arg)-points.col(i)).norm()<=accuracy )
-            result.col(i) = arg;
-        else
+        index_t ns = numSamples;
+        if (0==ns)
+            ns = math::min( math::min( math::max<index_t>(8*coefsSize(), 1000),
+                                       math::max<index_t>(16*npts, 64) ),
+                            (index_t)65536 );
+        samples = gsPointGrid(supp, ns);
+        this->eval_into(samples, sampleVals);
+    }
+    const gsSampleKdTree<T> tree(sampleVals);
+
+    const index_t maxIter = 100, blockSize = 256;
+    const index_t nBlocks = (npts + blockSize - 1) / blockSize;
+
+#   pragma omp parallel
+    {
+        gsMatrix<T> u, val, delta, jtj;
+        std::vector<gsMatrix<T> > vd; // values and derivatives
+        gsVector<T> r, jtr;
+        std::vector<index_t> act, stall; // active and stalled points
+
+#       pragma omp for schedule(dynamic)
+        for (index_t b = 0; b < nBlocks; ++b)
         {
-            //gsDebugVar((this->eval(arg)-points.col(i)).norm());
-            result.col(i).setConstant( std::numeric_limits<T>::infinity() );
+            const index_t first = b * blockSize;
+            const index_t last  = math::min(first + blockSize, npts);
+            act.clear();
+            stall.clear();
+            for (index_t i = first; i != last; ++i)
+            {
+                if (!useInitialPoint)
+                    result.col(i) = samples.col( tree.nearest(points.col(i)) );
+                flags[i] = -1;
+                act.push_back(i);
+            }
+
+            // Newton (resp. Gauss-Newton) iteration on all active
+            // points of the block at once
+            for (index_t iter = 0; !act.empty() && iter <= maxIter; ++iter)
+            {
+                const index_t na = act.size();
+                u.resize(pd, na);
+                for (index_t k = 0; k != na; ++k)
+                    u.col(k) = result.col(act[k]);
+                this->basis().evalAllDersFunc_into(u, m_coefs, 1, vd);
+
+                index_t nk = 0; // number of points that stay active
+                for (index_t k = 0; k != na; ++k)
+                {
+                    const index_t i = act[k];
+                    r = points.col(i) - vd[0].col(k);
+                    if (!closest && r.norm() <= accuracy)
+                    {
+                        flags[i] = iter;
+                        continue;
+                    }
+
+                    // transposed Jacobian at the current point
+                    const gsAsConstMatrix<T> jt = vd[1].reshapeCol(k, pd, gd);
+                    if (pd == gd)
+                        delta.noalias() = jt.transpose().partialPivLu().solve(r);
+                    else
+                    {
+                        jtj.noalias() = jt * jt.transpose();
+                        jtr.noalias() = jt * r;
+                        delta.noalias() = jtj.ldlt().solve(jtr);
+                    }
+
+                    // update, clamped to the parameter domain
+                    u.col(k) = ( result.col(i) + delta ).cwiseMax( supp.col(0) )
+                        .cwiseMin( supp.col(1) );
+                    const T step = ( u.col(k) - result.col(i) ).norm();
+                    result.col(i) = u.col(k);
+                    if ( step < accuracy ) // update below threshold
+                    {
+                        flags[i] = iter;
+                        if (!closest) stall.push_back(i);
+                        continue;
+                    }
+                    act[nk++] = i;
+                }
+                act.resize(nk);
+            }
+
+            // Points that stalled (or ran out of iterations) count as
+            // inverted only if the residual is below the threshold
+            if (!closest)
+            {
+                for (size_t k = 0; k != act.size(); ++k)
+                    flags[act[k]] = maxIter;
+                stall.insert(stall.end(), act.begin(), act.end());
+                if (!stall.empty())
+                {
+                    u.resize(pd, stall.size());
+                    for (size_t k = 0; k != stall.size(); ++k)
+                        u.col(k) = result.col(stall[k]);
+                    this->eval_into(u, val);
+                    for (size_t k = 0; k != stall.size(); ++k)
+                        if ( (val.col(k) - points.col(stall[k])).norm() > accuracy )
+                            flags[stall[k]] = -1;
+                }
+            }
         }
     }
 }
+
 /* // alternative impl using closestPointTo
 {
     result.resize(parDim(), points.cols() );
@@ -296,6 +296,11 @@ public:
     void repairInterfaces();
 
     /// @brief For each point in \a points, locates the parametric coordinates of the point
+    ///
+    /// Only the patches of the elements whose bounding boxes contain
+    /// the point are tried, the points are processed in parallel. A
+    /// point that lies on several patches is assigned to the one with
+    /// the lowest index.
     /// \param points
     /// \param pids vector containing for each point the patch id where it belongs (or -1 if not found)
     /// \param preim in each column,  the parametric coordinates of the corresponding point in the patch
@@ -336,6 +341,10 @@ private:
            gsVector<index_t> &dirMap, gsVector<bool>    &dirO,
            T tol, index_t reference=0);
 
+    // Implementation of locatePoints, patch \a skip is not considered
+    void locatePoints_impl(const gsMatrix<T> & points, index_t skip,
+                           gsVector<index_t> & pids, gsMatrix<T> & preim) const;
+
 }; // class gsMultiPatch
 
 
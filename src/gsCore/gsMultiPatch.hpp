@@ -17,6 +17,7 @@
 #include <gsCore/gsGeometry.h>
 #include <gsCore/gsDofMapper.h>
 #include <gsCore/gsAffineFunction.h>
+#include <gsCore/gsDomainIterator.h>
 
 #include <gsUtils/gsCombinatorics.h>
 
@@ -308,6 +309,29 @@ gsMultiPatch<T> gsMultiPatch<T>::uniformSplit() const
 }
 
 
+/// Lexicographic order of the columns of a matrix, the index -1
+/// refers to the vector \a query (for searching)
+template<class T>
+struct gsColumnLexLess
+{
+    gsColumnLexLess(const gsMatrix<T> & m, const gsVector<T> & query)
+    : m_m(m), m_q(query) { }
+
+    bool operator()(const index_t i, const index_t j) const
+    {
+        for (index_t k = 0; k != m_m.rows(); ++k)
+        {
+            const T a = (-1 == i ? m_q[k] : m_m(k,i));
+            const T b = (-1 == j ? m_q[k] : m_m(k,j));
+            if (a != b) return a < b;
+        }
+        return false;
+    }
+
+    const gsMatrix<T> & m_m;
+    const gsVector<T> & m_q;
+};
+
 /*
   This is based on comparing a set of reference points of the patch
   side and thus it implicitly assumes that the patch faces match
@@ -315,7 +339,10 @@ gsMultiPatch<T> gsMultiPatch<T>::uniformSplit() const
 template<class T>
 bool gsMultiPatch<T>::computeTopology( T tol, bool cornersOnly )
 {
+    GISMO_ENSURE( tol > 0, "computeTopology: The tolerance has to be positive." );
     BaseA::clearTopology();
+    if ( m_patches.empty() )
+        return true;
 
     const size_t   np    = m_patches.size();
     const index_t  nCorP = 1 << m_dim;     // corners per patch
@@ -381,13 +408,75 @@ bool gsMultiPatch<T>::computeTopology( T tol, bool cornersOnly )
     cId1.reserve(nCorS);
     cId2.reserve(nCorS);
 
+    // Index the sides by the cell of a grid with spacing tol which
+    // contains their center (resp. the mean of their corners). Matching
+    // sides have centers closer than tol, hence they lie in neighbouring
+    // cells. The index is the list of sides sorted by their cells.
+    const index_t gd     = pCorners.front().rows();
+    const index_t nSides = pSide.size();
+    const index_t nSps   = 2 * m_dim; // sides per patch
+    gsMatrix<T> sideCell(gd, nSides);
+    gsVector<T> cell(gd);
+    for (index_t i = 0; i != nSides; ++i)
+    {
+        const patchSide & ps = pSide[i];
+        if (cornersOnly)
+        {
+            ps.getContainedCorners(m_dim,cId1);
+            cell.setZero();
+            for (size_t k = 0; k != cId1.size(); ++k)
+                cell += pCorners[ps.patch].col(cId1[k]-1);
+            cell /= static_cast<T>(nCorS);
+        }
+        else
+            cell = pCorners[ps.patch].col(nCorP+ps-1);
+        sideCell.col(i) = (cell.array() / tol).floor();
+    }
+    const gsColumnLexLess<T> cellLess(sideCell, cell);
+    std::vector<index_t> sorted(nSides);
+    for (index_t i = 0; i != nSides; ++i)
+        sorted[i] = i;
+    std::sort(sorted.begin(), sorted.end(), cellLess);
+
+    // position of every side in pSide, -1 if it was already treated
+    std::vector<index_t> pos(nSides);
+    for (index_t i = 0; i != nSides; ++i)
+        pos[i] = i;
+
+    index_t nOffsets = 1; // number of neighbouring cells, 3^gd
+    for (index_t k = 0; k != gd; ++k)
+        nOffsets *= 3;
+
+    std::vector<std::pair<index_t,index_t> > cand; // (position, side)
+    std::pair<std::vector<index_t>::const_iterator,
+              std::vector<index_t>::const_iterator> range;
+
     while ( pSide.size() != 0 )
     {
         bool done = false;
         const patchSide side = pSide.back();
         pSide.pop_back();
-        for (size_t other=0; other<pSide.size(); ++other)
+        const index_t sId = side.patch * nSps + side - 1;
+        pos[sId] = -1;
+
+        // Collect the remaining sides in the neighbouring cells, in
+        // the order of pSide
+        cand.clear();
+        for (index_t o = 0; o != nOffsets; ++o)
+        {
+            cell = sideCell.col(sId);
+            for (index_t k = 0, r = o; k != gd; ++k, r /= 3)
+                cell[k] += static_cast<T>(r % 3 - 1);
+            range = std::equal_range(sorted.begin(), sorted.end(), -1, cellLess);
+            for (; range.first != range.second; ++range.first)
+                if (-1 != pos[*range.first])
+                    cand.push_back( std::make_pair(pos[*range.first], *range.first) );
+        }
+        std::sort(cand.begin(), cand.end());
+
+        for (size_t c = 0; c != cand.size(); ++c)
         {
+            const index_t other = cand[c].first;
             side        .getContainedCorners(m_dim,cId1);
             pSide[other].getContainedCorners(m_dim,cId2);
             matched.setConstant(false);
@@ -409,9 +498,11 @@ bool gsMultiPatch<T>::computeTopology( T tol, bool cornersOnly )
                 BaseA::addInterface( boundaryInterface(side, pSide[other], dirMap, dirOr));
                 // done with pSide[other], remove it from candidate list
                 std::swap( pSide[other], pSide.back() );
+                pos[pSide[other].patch * nSps + pSide[other] - 1] = other;
                 pSide.pop_back();
+                pos[cand[c].second] = -1;
                 done=true;
-                break;//for (size_t other=0..)
+                break;//for (size_t c=0..)
             }
         }
         if (!done) // not an interface ?
@@ -643,33 +734,178 @@ void gsMultiPatch<T>::repairInterfaces()
 
 
 
+/// Bounding volume hierarchy over the elements of the patches of a
+/// gsMultiPatch, used by gsMultiPatch::locatePoints.
+///
+/// The box of an element is the bounding box of the control points
+/// that are active on it. By the convex hull property it contains the
+/// image of the element.
 template<class T>
-void gsMultiPatch<T>::locatePoints(const gsMatrix<T> & points,
-                                   gsVector<index_t> & pids,
-                                   gsMatrix<T> & preim) const
+class gsPatchElementTree
 {
-    pids.resize(points.cols());
-    pids.setConstant(-1); // -1 implies not in the domain
-    preim.resize(parDim(), points.cols());//uninitialized by default
-    gsMatrix<T> pt, pr, tmp;
-
-    for (index_t i = 0; i!=pids.size(); ++i)
+public:
+    explicit gsPatchElementTree(const gsMultiPatch<T> & mp)
     {
-        pt = points.col(i);
+        const index_t gd = mp.geoDim();
+        std::vector<gsMatrix<T> > boxes;
+        std::vector<gsVector<T> > centers;
+        gsMatrix<index_t> act;
+        for (size_t k = 0; k != mp.nPatches(); ++k)
+        {
+            const gsGeometry<T> & patch = mp.patch(k);
+            typename gsBasis<T>::domainIter domIt = patch.basis().makeDomainIterator();
+            for (; domIt->good(); domIt->next())
+            {
+                patch.basis().active_into(domIt->centerPoint(), act);
+                gsMatrix<T> box(gd, 2);
+                box.col(0) = patch.coef(act.at(0)).transpose();
+                box.col(1) = box.col(0);
+                for (index_t j = 1; j < act.rows(); ++j)
+                {
+                    box.col(0) = box.col(0).cwiseMin( patch.coef(act.at(j)).transpose() );
+                    box.col(1) = box.col(1).cwiseMax( patch.coef(act.at(j)).transpose() );
+                }
+                boxes.push_back(give(box));
+                centers.push_back(domIt->centerPoint());
+                m_patch.push_back(k);
+            }
+        }
 
-        for (size_t k = 0; k!= m_patches.size(); ++k)
+        const index_t nLeaves = m_patch.size();
+        m_leafBox.resize(2*gd, nLeaves);
+        m_center.resize(mp.parDim(), nLeaves);
+        for (index_t i = 0; i != nLeaves; ++i)
         {
-            pr = m_patches[k]->parameterRange();
-            m_patches[k]->invertPoints(pt, tmp);
-            if ( (tmp.array() >= pr.col(0).array()).all()
-                 && (tmp.array() <= pr.col(1).array()).all() )
+            m_leafBox.col(i) << boxes[i].col(0), boxes[i].col(1);
+            m_center.col(i) = centers[i];
+        }
+
+        m_leaf.resize(nLeaves);
+        for (index_t i = 0; i != nLeaves; ++i)
+            m_leaf[i] = i;
+        if (0 != nLeaves)
+        {
+            // a binary tree with nLeaves leaves has less than 2*nLeaves nodes
+            m_nodeBox.resize(2*gd, 2*nLeaves);
+            m_nodes.reserve(2*nLeaves);
+            m_nodes.resize(1);
+            build(0, 0, nLeaves);
+            m_nodeBox.conservativeResize(Eigen::NoChange, m_nodes.size());
+        }
+    }
+
+    /// Returns the elements whose boxes contain \a x, enlarged by \a tol
+    template<class Vec>
+    void candidates(const Vec & x, const T tol, std::vector<index_t> & result) const
+    {
+        result.clear();
+        if (m_nodes.empty()) return;
+        const index_t gd = x.size();
+        index_t stack[64];
+        index_t top = 0;
+        stack[top++] = 0;
+        while (top)
+        {
+            const index_t id = stack[--top];
+            const node & nd = m_nodes[id];
+            if ( !inBox(m_nodeBox.col(id), x, gd, tol) )
+                continue;
+            if (-1 == nd.left)
             {
-                pids[i] = k;
-                preim.col(i) = tmp;
-                break;
+                for (index_t i = nd.first; i != nd.last; ++i)
+                    if ( inBox(m_leafBox.col(m_leaf[i]), x, gd, tol) )
+                        result.push_back(m_leaf[i]);
+            }
+            else
+            {
+                stack[top++] = nd.left;
+                stack[top++] = nd.left + 1;
             }
         }
     }
+
+    /// Patch index of element \a i
+    index_t patch(const index_t i) const { return m_patch[i]; }
+
+    /// Parametric center of element \a i
+    typename gsMatrix<T>::constColumn center(const index_t i) const
+    { return m_center.col(i); }
+
+private:
+    struct node
+    {
+        index_t first, last; // range of leaves in m_leaf
+        index_t left;        // index of the left child (right is left+1), -1 for leaves
+    };
+
+    struct axisLess
+    {
+        axisLess(const gsMatrix<T> & boxes, const index_t ax, const index_t gd)
+        : m_b(boxes), m_a(ax), m_d(gd) { }
+        bool operator()(const index_t i, const index_t j) const
+        { return m_b(m_a,i) + m_b(m_a+m_d,i) < m_b(m_a,j) + m_b(m_a+m_d,j); }
+        const gsMatrix<T> & m_b;
+        const index_t m_a, m_d;
+    };
+
+    template<class Box, class Vec>
+    static bool inBox(const Box & box, const Vec & x, const index_t gd, const T tol)
+    {
+        for (index_t j = 0; j != gd; ++j)
+            if ( x[j] < box[j] - tol || x[j] > box[j+gd] + tol )
+                return false;
+        return true;
+    }
+
+    // Builds the subtree of node \a id, containing the leaves [first,last)
+    void build(const index_t id, const index_t first, const index_t last)
+    {
+        const index_t gd = m_leafBox.rows() / 2;
+        m_nodes[id].first = first;
+        m_nodes[id].last  = last;
+        m_nodes[id].left  = -1;
+
+        gsVector<T> box = m_leafBox.col(m_leaf[first]);
+        for (index_t i = first + 1; i != last; ++i)
+        {
+            box.head(gd) = box.head(gd).cwiseMin( m_leafBox.col(m_leaf[i]).head(gd) );
+            box.tail(gd) = box.tail(gd).cwiseMax( m_leafBox.col(m_leaf[i]).tail(gd) );
+        }
+        m_nodeBox.col(id) = box;
+
+        if (last - first <= 4)
+            return;
+
+        // split at the median along the longest side
+        index_t ax;
+        (box.tail(gd) - box.head(gd)).maxCoeff(&ax);
+        const index_t mid = first + (last - first) / 2;
+        std::nth_element(m_leaf.begin() + first, m_leaf.begin() + mid,
+                         m_leaf.begin() + last, axisLess(m_leafBox, ax, gd));
+
+        // the two children are stored next to each other
+        const index_t left = m_nodes.size();
+        m_nodes.resize(left + 2);
+        m_nodes[id].left = left;
+        build(left    , first, mid );
+        build(left + 1, mid  , last);
+    }
+
+private:
+    std::vector<node>    m_nodes;
+    gsMatrix<T>          m_nodeBox; // [lower;upper] corners of the nodes
+    gsMatrix<T>          m_leafBox; // [lower;upper] corners of the elements
+    gsMatrix<T>          m_center;  // parametric centers of the elements
+    std::vector<index_t> m_leaf;    // element indices, ordered by the tree
+    std::vector<index_t> m_patch;   // patch of each element
+};
+
+template<class T>
+void gsMultiPatch<T>::locatePoints(const gsMatrix<T> & points,
+                                   gsVector<index_t> & pids,
+                                   gsMatrix<T> & preim) const
+{
+    locatePoints_impl(points, -1, pids, preim);
 }
 
 template<class T>
@@ -677,31 +913,56 @@ void gsMultiPatch<T>::locatePoints(const gsMatrix<T> & points, index_t pid1,
                                    gsVector<index_t> & pid2, gsMatrix<T> & preim) const
 {
     // Assumes points are found on pid1 and possibly on one more patch
-    pid2.resize(points.cols());
-    pid2.setConstant(-1); // -1 implies not in the domain
-    preim.resize(parDim(), points.cols());//uninitialized by default
-    gsMatrix<T> pt, pr, tmp;
+    locatePoints_impl(points, pid1, pid2, preim);
+}
+
+template<class T>
+void gsMultiPatch<T>::locatePoints_impl(const gsMatrix<T> & points, index_t skip,
+                                        gsVector<index_t> & pids,
+                                        gsMatrix<T> & preim) const
+{
+    const T accuracy = 1e-6;
+    const index_t npts = points.cols();
+    pids.resize(npts);
+    pids.setConstant(-1); // -1 implies not in the domain
+    preim.resize(parDim(), npts);//uninitialized by default
 
-    for (index_t i = 0; i!=pid2.size(); ++i)
+    const gsPatchElementTree<T> tree(*this);
+
+#   pragma omp parallel
     {
-        pt = points.col(i);
+        std::vector<index_t> cand;
+        gsVector<T> pt, arg;
+        gsMatrix<T> val;
 
-        for (size_t k = 0; k!= m_patches.size(); ++k)
+#       pragma omp for schedule(dynamic, 64)
+        for (index_t i = 0; i < npts; ++i)
         {
-            if (pid1==(index_t)k) continue; // skip pid1
-
-            pr = m_patches[k]->parameterRange();
-            m_patches[k]->invertPoints(pt, tmp);
-            if ( (tmp.array() >= pr.col(0).array()).all()
-                 && (tmp.array() <= pr.col(1).array()).all() )
+            pt = points.col(i);
+            tree.candidates(pt, accuracy, cand);
+            // The elements are numbered patch by patch, so points on
+            // interfaces go to the lowest patch index, independently
+            // of the shape of the tree
+            std::sort(cand.begin(), cand.end());
+
+            // Newton iteration on the patch of every candidate
+            // element, starting from the element's center
+            for (size_t c = 0; c != cand.size(); ++c)
             {
-                pid2[i] = k;
-                preim.col(i) = tmp;
-                break;
+                const index_t k = tree.patch(cand[c]);
+                if (skip == k) continue;
+                arg = tree.center(cand[c]);
+                m_patches[k]->newtonRaphson(pt, arg, true, accuracy, 100);
+                m_patches[k]->eval_into(arg, val);
+                if ( (val - pt).norm() <= accuracy )
+                {
+                    pids[i] = k;
+                    preim.col(i) = arg;
+                    break;
+                }
             }
         }
     }
 }
 
-
 } // namespace gismo
@@ -74,6 +74,8 @@ public:
 
     typedef typename node::kdBox box; // it's a gsAabb<d,unsigned>
 
+    typedef typename node::pool pool; // it's a gsKdNodePool<d,T>
+
     typedef gsHDomainLeafIter<node,false> literator;
 
     typedef gsHDomainLeafIter<node,true> const_literator;
@@ -88,6 +90,9 @@ private:
 
 private:
 
+    /// Storage of the nodes of the tree
+    pool m_pool;
+
     /// Pointer to the root node of the tree
     node * m_root;
 
@@ -103,16 +108,43 @@ private:
 
     unsigned m_maxPath;
 
+    /// Node of the flattened copy of the tree. The right child of a
+    /// split-node is stored right after it, so that the nodes are in
+    /// the order in which the leaves are iterated.
+    struct flatNode
+    {
+        int     axis;  ///< split axis, -1 for a leaf
+        T       pos;   ///< split coordinate (split-node) or leaf index
+        int     level; ///< level of the leaf
+        index_t left;  ///< position of the left child (split-node)
+    };
+
+    /// Flattened, array-based copy of the tree, used by the queries
+    /// and the leaf iteration. It is rebuilt lazily after the tree
+    /// has been modified.
+    mutable std::vector<flatNode> m_flatNodes;
+
+    /// Leaves of the flattened tree, one per column: lower corner,
+    /// upper corner (in global indices) and level of the leaf
+    mutable gsMatrix<T> m_leafBoxes;
+
+    /// Maximum depth of the flattened tree
+    mutable index_t m_flatDepth;
+
+    /// True if the flattened tree is up to date. Accessed atomically
+    /// by const members, see updateFlat()
+    mutable bool m_flatValid;
+
 public:
 
-    gsHDomain() : m_indexLevel(0)
+    gsHDomain() : m_indexLevel(0), m_flatDepth(0), m_flatValid(false)
     {
         m_root = nullptr;
         m_maxInsLevel = 0;
         m_maxPath = 0;
     }
     
-    gsHDomain(point const & upp)
+    gsHDomain(point const & upp) : m_root(nullptr)
     {
         init(upp);
     }
@@ -133,9 +165,12 @@ public:
         m_upperIndex(o.m_upperIndex),
         m_indexLevel(o.m_indexLevel),
         m_maxInsLevel(o.m_maxInsLevel),
-        m_maxPath(o.m_maxPath)
+        m_maxPath(o.m_maxPath),
+        m_flatDepth(0),
+        m_flatValid(false)
     {
-        m_root = new node(*o.m_root);
+        m_pool.reserve(o.m_pool.size());
+        m_root = o.m_root ? m_pool.copyTree(o.m_root) : nullptr;
     }
 
     /// Assignment operator (makes a deep copy)
@@ -144,12 +179,15 @@ public:
         if ( this == &o )
             return *this;
         
-        m_root = new node(*o.m_root);
+        m_pool.reset();
+        m_pool.reserve(o.m_pool.size());
+        m_root = o.m_root ? m_pool.copyTree(o.m_root) : nullptr;
 
         m_upperIndex  = o.m_upperIndex;
         m_indexLevel  = o.m_indexLevel;
         m_maxInsLevel = o.m_maxInsLevel;
         m_maxPath    = o.m_maxPath;
+        m_flatValid  = false;
 
         return *this;
     }
@@ -160,18 +198,30 @@ public:
     m_upperIndex(std::move(o.m_upperIndex)),
     m_indexLevel(o.m_indexLevel),
     m_maxInsLevel(o.m_maxInsLevel),
-    m_maxPath(o.m_maxPath)
+    m_maxPath(o.m_maxPath),
+    m_flatNodes(give(o.m_flatNodes)),
+    m_leafBoxes(give(o.m_leafBoxes)),
+    m_flatDepth(o.m_flatDepth),
+    m_flatValid(o.m_flatValid)
     {
+        m_pool.swap(o.m_pool);
         o.m_root = nullptr;
+        o.m_flatValid = false;
     }
 
     gsHDomain & operator=(gsHDomain&& o)
     {
-        delete m_root; m_root = o.m_root; o.m_root = nullptr;
+        m_pool.swap(o.m_pool);
+        m_root = o.m_root; o.m_root = nullptr;
         m_upperIndex  = std::move(o.m_upperIndex);
         m_indexLevel  = o.m_indexLevel;
         m_maxInsLevel = o.m_maxInsLevel;
         m_maxPath     = o.m_maxPath;
+        m_flatNodes   = give(o.m_flatNodes);
+        m_leafBoxes   = give(o.m_leafBoxes);
+        m_flatDepth   = o.m_flatDepth;
+        m_flatValid   = o.m_flatValid;
+        o.m_flatValid = false;
         return *this;
     }
 #endif
@@ -182,18 +232,19 @@ public:
         m_indexLevel = index_level;
         m_maxInsLevel = 0;
 
-        if ( m_root )
-            delete m_root;
+        m_pool.clear();
 
         for (short_t i=0; i<d; ++i)
             m_upperIndex[i] = (upp[i]<< m_indexLevel);
 
-        m_root = new node(m_upperIndex);
+        m_root = m_pool.create();
+        m_root->makeRoot(m_upperIndex);
         m_maxPath = 1;
+        m_flatValid = false;
     }
 
-    /// Destructor deletes the whole tree
-    ~gsHDomain() { delete m_root; }
+    /// Destructor (the nodes are deleted by the pool)
+    ~gsHDomain() { }
 
     /// Clones the object
     gsHDomain * clone() const;
@@ -413,8 +464,7 @@ public:
                int level) const;
 
     /// Returns the level of the point \a p
-    int levelOf(point const & p, int level) const
-    { return pointSearch(p,level,m_root)->level;}
+    int levelOf(point const & p, int level) const;
 
     // to do: move to the hpp file do avoid need for instantization
     void incrementLevel()
@@ -425,6 +475,7 @@ public:
         "Problem with indices, increase number of levels (to do).");
 
         leafSearch< levelUp_visitor >(); 
+        m_flatValid = false;
     }
 
     /// Multiply all coordinates by two
@@ -432,6 +483,7 @@ public:
     {
         m_upperIndex *= 2;
         nodeSearch< liftCoordsOneLevel_visitor >();
+        m_flatValid = false;
     }
 
     // to do: move to the hpp file do avoid need for instantization
@@ -439,10 +491,13 @@ public:
     {
         m_maxInsLevel--;
         leafSearch< levelDown_visitor >(); 
+        m_flatValid = false;
     }
 
     literator beginLeafIterator()
     {
+        // the leaves might be modified through the iterator
+        m_flatValid = false;
         return literator(m_root, m_indexLevel);
     }
 
@@ -452,6 +507,26 @@ public:
     }
 
     void makeCompressed();
+
+    /// \brief Returns the number of leaves of the tree.
+    ///
+    /// The leaves are numbered in the order of the leaf iteration
+    /// and can be accessed by leafLevel() and leafBox().
+    index_t numLeafBoxes() const
+    {
+        updateFlat();
+        return m_leafBoxes.cols();
+    }
+
+    /// Returns the level of leaf \a i
+    int leafLevel(index_t i) const
+    {
+        updateFlat();
+        return static_cast<int>(m_leafBoxes(2*d, i));
+    }
+
+    /// Returns the corners of leaf \a i in the indices of its level
+    void leafBox(index_t i, point & lower, point & upper) const;
     
     /// Returns the number of nodes in the tree
     int size() const
@@ -659,6 +734,30 @@ private:
     /// considered half-open, i.e. in 2D they are of the form
     /// [a_1,b_1) x [a_2,b_2)
     node * pointSearch(const point & p, int level, node  *_node) const;
+
+    /// Rebuilds the flattened tree if the tree has been modified
+    ///
+    /// The flag is read atomically, and the flush orders the read
+    /// before the reads of the flattened tree, which flatten()
+    /// publishes before setting the flag.
+    void updateFlat() const
+    {
+        bool valid;
+#       pragma omp atomic read
+        valid = m_flatValid;
+#       pragma omp flush
+        if ( !valid )
+            flatten();
+    }
+
+    /// Builds the flattened copy of the tree (gsHDomain::m_flatNodes
+    /// and gsHDomain::m_leafBoxes)
+    void flatten() const;
+
+    /// Same as boxSearch(), starting from the root of the flattened tree
+    template<typename visitor>
+    typename visitor::return_type
+    flatBoxSearch(point const & k1, point const & k2, int level) const;
     
     // Increases the level by 1 for all leaves
     struct levelUp_visitor
@@ -50,10 +50,11 @@ namespace {
 
         template<short_t d, class T >
         static void visitLeaf(gismo::kdnode<d,T> * leafNode , int level, return_type & res)
+        { visitLevel(leafNode->level, level, res); }
+
+        static void visitLevel(int leafLevel, int level, return_type & res)
         {
-            //if ( (!isDegenerate(*leafNode->box)) && leafNode->level != level )
-            if ( leafNode->level != level )
-                // if (leafNode->level != level )
+            if ( leafLevel != level )
                 res = false;
         }
     };
@@ -68,9 +69,11 @@ namespace {
 
         template<short_t d, class T >
         static void visitLeaf(gismo::kdnode<d,T> * leafNode , int level, return_type & res)
+        { visitLevel(leafNode->level, level, res); }
+
+        static void visitLevel(int leafLevel, int level, return_type & res)
         {
-            //if ( (!isDegenerate(*leafNode->box)) && leafNode->level <= level )
-            if ( leafNode->level <= level )
+            if ( leafLevel <= level )
                 res = false;
         }
     };
@@ -85,11 +88,13 @@ namespace {
         static const return_type init = 1000000;
 
         template<short_t d, class T >
-        static void visitLeaf(gismo::kdnode<d,T> * leafNode , int , return_type & res)
+        static void visitLeaf(gismo::kdnode<d,T> * leafNode , int level, return_type & res)
+        { visitLevel(leafNode->level, level, res); }
+
+        static void visitLevel(int leafLevel, int, return_type & res)
         {
-            //if ( (!isDegenerate(*leafNode->box)) && leafNode->level < res )
-            if ( leafNode->level < res )
-                res = leafNode->level;
+            if ( leafLevel < res )
+                res = leafLevel;
         }
     };
     
@@ -103,11 +108,13 @@ namespace {
         static const return_type init = -1;
 
         template<short_t d, class T >
-        static void visitLeaf(gismo::kdnode<d,T> * leafNode , int , return_type & res)
+        static void visitLeaf(gismo::kdnode<d,T> * leafNode , int level, return_type & res)
+        { visitLevel(leafNode->level, level, res); }
+
+        static void visitLevel(int leafLevel, int, return_type & res)
         {
-            //if ( (!isDegenerate(*leafNode->box)) && leafNode->level > res )
-            if ( leafNode->level > res )
-                res = leafNode->level;
+            if ( leafLevel > res )
+                res = leafLevel;
         }
     };
 
@@ -203,6 +210,7 @@ gsHDomain<d,T>::insertBox ( point const & k1, point const & k2,
     box iBox(k1,k2);
     if( isDegenerate(iBox) )
         return;
+    m_flatValid = false;
 
     // Represent box in the index level
     // iBox.first .unaryExpr(toGlobalIndex(lvl, m_index_level) );
@@ -231,15 +239,15 @@ gsHDomain<d,T>::insertBox ( point const & k1, point const & k2,
 /*
         if ( curNode->is_Node() ) // reached a leaf
         {
-            if ( isDegenerate(*curNode->box) )
+            if ( isDegenerate(curNode->box) )
                 continue;
             
-            if ( isContained(*curNode->box, iBox) )
+            if ( isContained(curNode->box, iBox) )
             {
                 if ( lvl > curNode->level )
                     curNode->level = lvl;
             }
-            else if ( haveOverlap(*curNode->box, iBox) )
+            else if ( haveOverlap(curNode->box, iBox) )
             {
                 curNode->nextMidSplit();
                 stack.push_back(curNode);
@@ -257,7 +265,7 @@ gsHDomain<d,T>::insertBox ( point const & k1, point const & k2,
 
             // Split the leaf (if possible)
             //node * newLeaf = curNode->adaptiveSplit(iBox);
-            node * newLeaf = curNode->adaptiveAlignedSplit(iBox, m_indexLevel);
+            node * newLeaf = curNode->adaptiveAlignedSplit(iBox, m_indexLevel, m_pool);
             
             // If curNode is still a leaf, its domain is almost
             // contained in iBox
@@ -316,6 +324,7 @@ gsHDomain<d,T>::sinkBox ( point const & k1,
         //gsWarn<<" Invalid box coordinate "<<  k1.transpose() <<" at level" <<lvl<<".\n";
         return;
     }
+    m_flatValid = false;
     
     // Initialize stack
     std::stack<node*, std::vector<node*> > stack;
@@ -332,7 +341,7 @@ gsHDomain<d,T>::sinkBox ( point const & k1,
         {
             // Since we reached a leaf, it should overlap with iBox.
             // Split the leaf (if possible)
-            node * newLeaf = curNode->adaptiveAlignedSplit(iBox, m_indexLevel);
+            node * newLeaf = curNode->adaptiveAlignedSplit(iBox, m_indexLevel, m_pool);
             
             // If curNode is still a leaf, its domain is almost
             // contained in iBox
@@ -368,6 +377,7 @@ gsHDomain<d,T>::sinkBox ( point const & k1,
 template<short_t d, class T > void
 gsHDomain<d,T>::makeCompressed()
 {
+    m_flatValid = false;
     std::stack<node*, std::vector<node*> > tstack;
     node * curNode;
 
@@ -400,13 +410,16 @@ gsHDomain<d,T>::makeCompressed()
         if (curNode->left->level == curNode->right->level) 
         {
             // Merge left and right
-            curNode->merge();
+            curNode->merge(m_pool);
             if ( !curNode->isRoot() &&
                   curNode->parent->isTerminal() )
                 tstack.push(curNode->parent );
         }
     }
     
+    // Store the nodes contiguously, in pre-order
+    m_root = m_pool.compactTree(m_root);
+
     // Store the max path length
     m_maxPath = minMaxPath().second;
 }
@@ -419,7 +432,7 @@ bool gsHDomain<d,T>::query1(point const & lower, point const & upper,
 template<short_t d, class T >
 bool gsHDomain<d,T>::query1(point const & lower, point const & upper,
                int level) const
-{ return boxSearch< query1_visitor >(upper,lower,level,m_root); }
+{ return flatBoxSearch< query1_visitor >(upper,lower,level); }
 
 template<short_t d, class T >
 bool gsHDomain<d,T>::query2(point const & lower, point const & upper,
@@ -429,7 +442,7 @@ bool gsHDomain<d,T>::query2(point const & lower, point const & upper,
 template<short_t d, class T >
 bool gsHDomain<d,T>::query2 (point const & lower, point const & upper,
                  int level) const
-{ return boxSearch< query2_visitor >(lower,upper,level,m_root); }
+{ return flatBoxSearch< query2_visitor >(lower,upper,level); }
 
 template<short_t d, class T >
 int gsHDomain<d,T>::query3(point const & lower, point const & upper,
@@ -439,7 +452,7 @@ int gsHDomain<d,T>::query3(point const & lower, point const & upper,
 template<short_t d, class T >
 int gsHDomain<d,T>::query3(point const & lower, point const & upper,
                int level) const
-{ return boxSearch< query3_visitor >(lower,upper,level,m_root); }
+{ return flatBoxSearch< query3_visitor >(lower,upper,level); }
 
 template<short_t d, class T >
 int gsHDomain<d,T>::query4(point const & lower, point const & upper,
@@ -449,7 +462,7 @@ int gsHDomain<d,T>::query4(point const & lower, point const & upper,
 template<short_t d, class T >
 int gsHDomain<d,T>::query4(point const & lower, point const & upper,
                int level) const
-{ return boxSearch< query4_visitor >(lower,upper,level,m_root); }
+{ return flatBoxSearch< query4_visitor >(lower,upper,level); }
 
 template<short_t d, class T >
 std::pair<typename gsHDomain<d,T>::point, typename gsHDomain<d,T>::point>
@@ -580,7 +593,7 @@ gsHDomain<d,T>::boxSearch(point const & k1, point const & k2,
         if ( curNode->isLeaf() )
         {
             // Visit the leaf
-            GISMO_ASSERT( !isDegenerate(*curNode->box), "Encountered an empty leaf");
+            GISMO_ASSERT( !isDegenerate(curNode->box), "Encountered an empty leaf");
             visitor::visitLeaf(curNode, level, res );
         }
         else // this is a split-node
@@ -641,6 +654,164 @@ gsHDomain<d,T>::pointSearch(const point & p, int level, node  *_node ) const
     GISMO_ERROR("pointSearch: Error ("<< p.transpose()<<").\n" );
 }
 
+template<short_t d, class T> void
+gsHDomain<d,T>::flatten() const
+{
+#   pragma omp critical (gsHDomain_flatten)
+    if ( !m_flatValid )
+    {
+        const index_t nLeaves = leafSize();
+        m_flatNodes.clear();
+        m_flatNodes.reserve(2*nLeaves-1);
+        m_leafBoxes.resize(2*d+1, nLeaves);
+        m_flatDepth = 0;
+
+        // Pre-order traversal, right child first (as in the leaf
+        // iteration). The second entry of the stack is the position
+        // of the parent, whose left child is the node.
+        std::vector<std::pair<node*,index_t> > stack;
+        stack.reserve( 2 * m_maxPath + 2 );
+        stack.push_back( std::make_pair(m_root, index_t(-1)) );
+        std::vector<index_t> depth(1, 0);
+        depth.reserve( 2 * m_maxPath + 2 );
+
+        flatNode fn;
+        index_t leaf = 0;
+        while ( ! stack.empty() )
+        {
+            node * curNode = stack.back().first;
+            const index_t parent = stack.back().second;
+            const index_t dep = depth.back();
+            stack.pop_back();
+            depth.pop_back();
+
+            const index_t cur = m_flatNodes.size();
+            if ( -1 != parent )
+                m_flatNodes[parent].left = cur;
+            m_flatDepth = math::max(m_flatDepth, dep);
+
+            fn.axis  = curNode->axis;
+            fn.level = curNode->level;
+            fn.left  = -1;
+            if ( curNode->isLeaf() )
+            {
+                fn.pos = leaf;
+                m_leafBoxes.col(leaf).head(d)   = curNode->box.first;
+                m_leafBoxes.col(leaf).segment(d,d) = curNode->box.second;
+                m_leafBoxes(2*d,leaf++) = curNode->level;
+            }
+            else
+            {
+                fn.pos = curNode->pos;
+                stack.push_back( std::make_pair(curNode->left , cur) );
+                stack.push_back( std::make_pair(curNode->right, index_t(-1)) );
+                depth.push_back(dep+1);
+                depth.push_back(dep+1);
+            }
+            m_flatNodes.push_back(fn);
+        }
+
+        // Publish the flattened tree before the flag, see updateFlat()
+#       pragma omp flush
+#       pragma omp atomic write
+        m_flatValid = true;
+    }
+}
+
+template<short_t d, class T>
+template<typename visitor>
+typename visitor::return_type
+gsHDomain<d,T>::flatBoxSearch(point const & k1, point const & k2,
+                              int level) const
+{
+    updateFlat();
+
+    // Make a box
+    point lower, upper;
+    local2globalIndex( k1, static_cast<unsigned>(level), lower);
+    local2globalIndex( k2, static_cast<unsigned>(level), upper);
+
+    GISMO_ASSERT( (lower.array() < upper.array()).all(),
+                  "boxSearch: Wrong order of points defining the box (or empty box): "
+                  << lower.transpose() <<", "<< upper.transpose() <<".\n" );
+
+    typename visitor::return_type res = visitor::init;
+
+    // At most one pending node per level of the tree, plus the
+    // current one
+    index_t buf[64];
+    std::vector<index_t> heapBuf;
+    index_t * stack = buf;
+    if ( m_flatDepth >= 63 )
+    {
+        heapBuf.resize(m_flatDepth + 2);
+        stack = &heapBuf[0];
+    }
+
+    index_t top = 0;
+    stack[top++] = 0;
+    while ( top )
+    {
+        index_t cur = stack[--top];
+        // Walk down the tree, remembering the left children that
+        // also overlap
+        for (;;)
+        {
+            const flatNode & fn = m_flatNodes[cur];
+            if ( -1 == fn.axis )
+            {
+                visitor::visitLevel(fn.level, level, res);
+                break;
+            }
+
+            if ( upper[fn.axis] <= fn.pos )  // only left child
+                cur = fn.left;
+            else if ( lower[fn.axis] >= fn.pos ) // only right child
+                ++cur;
+            else                                 // both children
+            {
+                stack[top++] = fn.left;
+                ++cur;
+            }
+        }
+    }
+
+    return res;
+}
+
+template<short_t d, class T> int
+gsHDomain<d,T>::levelOf(point const & p, int level) const
+{
+    updateFlat();
+
+    point pp;
+    local2globalIndex(p, static_cast<unsigned>(level), pp);
+
+    GISMO_ASSERT( ( pp.array() <= m_upperIndex.array() ).all(),
+        "levelOf: Wrong input: "<< p.transpose()<<", level "<<level<<".\n" );
+
+    // The cells are half-open, i.e. of the form [a_1,b_1) x [a_2,b_2)
+    index_t cur = 0;
+    while ( -1 != m_flatNodes[cur].axis )
+    {
+        const flatNode & fn = m_flatNodes[cur];
+        cur = ( pp[fn.axis] < fn.pos ? fn.left : cur + 1 );
+    }
+    return m_flatNodes[cur].level;
+}
+
+template<short_t d, class T> void
+gsHDomain<d,T>::leafBox(index_t i, point & lower, point & upper) const
+{
+    updateFlat();
+    const index_t shift = m_indexLevel - m_leafBoxes(2*d, i);
+    for ( short_t k = 0; k != d; ++k )
+    {
+        lower[k] = m_leafBoxes(k  , i) >> shift;
+        upper[k] = m_leafBoxes(d+k, i) >> shift;
+    }
+}
+
 
 
 /* 
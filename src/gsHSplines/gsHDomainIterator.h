@@ -66,7 +66,8 @@ public:
         // Allocate breaks
         m_breaks = std::vector<std::vector<T> >(d, std::vector<T>());
 
-        m_leaf = hbs.tree().beginLeafIterator();
+        m_tree = &hbs.tree();
+        m_leaf = 0;
         updateLeaf();
         updateElement();
     }
@@ -108,8 +109,7 @@ public:
     /// iteration through all boundary elements.
     void reset()
     {
-        const gsHTensorBasis<d, T>* hbs =  dynamic_cast<const gsHTensorBasis<d, T> *>(m_basis);
-        m_leaf = hbs->tree().beginLeafIterator();
+        m_leaf = 0;
         updateLeaf();
         updateElement();
     }
@@ -120,7 +120,7 @@ public:
 
     int getLevel() const
     {
-        return m_leaf.level();
+        return m_level;
     }
 
 private:
@@ -130,9 +130,9 @@ private:
     /// returns true if there is a another leaf with a boundary element
     bool nextLeaf()
     {
-        this->m_isGood = m_leaf.next();
+        this->m_isGood = ( ++m_leaf < m_tree->numLeafBoxes() );
 
-        if ( m_leaf.good() )
+        if ( this->m_isGood )
             updateLeaf();
 
         return this->m_isGood;
@@ -143,12 +143,12 @@ private:
     /// active functions.
     void updateLeaf()
     {
-        const point & lower = m_leaf.lowerCorner();
-        const point & upper = m_leaf.upperCorner();
+        point lower, upper;
+        m_tree->leafBox(m_leaf, lower, upper);
         // gsDebug<<"leaf "<<  lower.transpose() <<", "
         //        << upper.transpose() <<"\n";
 
-        const int level2 = m_leaf.level();
+        const int level2 = m_level = m_tree->leafLevel(m_leaf);
 
         // Update leaf box
         for (unsigned dim = 0; dim < d; ++dim)
@@ -201,8 +201,12 @@ public:
 
 private:
 
-    // The current leaf node of the tree
-    leafIterator m_leaf;
+    // The tree of the hierarchical domain
+    const hDomain * m_tree;
+
+    // The current leaf of the tree and its level
+    index_t m_leaf;
+    int m_level;
 
     // Coordinates of the grid cell boundaries
     // \todo remove this member
@@ -91,7 +91,7 @@ public:
 
     point lowerCorner() const
     { 
-        point result = curNode->box->first;
+        point result = curNode->box.first;
         const int lvl = curNode->level;
 
         //result = result.array() / (1>> (m_index_level-lvl)) ;
@@ -103,7 +103,7 @@ public:
 
     point upperCorner() const
     { 
-        point result = curNode->box->second;
+        point result = curNode->box.second;
         const int lvl = curNode->level;
 
         for ( index_t i = 0; i!=result.size(); ++i )
@@ -125,8 +125,8 @@ public:
     point lowerCorner() const
     { 
         point result;
-        result.topRows   (m_dir  ) = curNode->box->first.topRows(m_dir     );
-        result.bottomRows(d-m_dir) = curNode->box->first.bottomRows(d-m_dir);
+        result.topRows   (m_dir  ) = curNode->box.first.topRows(m_dir     );
+        result.bottomRows(d-m_dir) = curNode->box.first.bottomRows(d-m_dir);
 
         const int lvl = curNode->level;
 
@@ -140,9 +140,9 @@ public:
     /// Note that \a m_dir is skipped
     point upperCorner() const
     { 
-        point result = curNode->box->second;
-        result.topRows   (m_dir  ) = curNode->box->second.topRows(m_dir     );
-        result.bottomRows(d-m_dir) = curNode->box->second.bottomRows(d-m_dir);
+        point result = curNode->box.second;
+        result.topRows   (m_dir  ) = curNode->box.second.topRows(m_dir     );
+        result.bottomRows(d-m_dir) = curNode->box.second.bottomRows(d-m_dir);
 
         const int lvl = curNode->level;
 
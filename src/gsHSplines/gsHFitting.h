@@ -153,7 +153,29 @@ public:
     void setConstraints(const std::vector<boxSide>& fixedSides,
 			const std::vector<gsBSpline<T> >& fixedCurves);
 
+    /// Assembles the system for the least squares fit. After a
+    /// refinement step of nextIteration(), only the terms of the
+    /// basis functions affected by the refinement are recomputed,
+    /// using only the points in their supports.
+    void assembleSystem(gsSparseMatrix<T>& A_mat, gsMatrix<T>& B);
+
 protected:
+    /// Updates the stored normal equations (m_lsqMat, m_lsqRhs) after
+    /// the insertion of the boxes m_lsqBoxes into the basis
+    void updateSystem();
+
+    /// Returns the element indices (of the level of the function) of
+    /// a box containing the support of the basis function \a i,
+    /// taking truncation into account
+    void supportOf(index_t i, gsMatrix<index_t,d,2> & supp) const
+    {
+        if ( const gsTHBSplineBasis<d,T> * thb =
+             dynamic_cast<const gsTHBSplineBasis<d,T>*>(m_basis) )
+            thb->truncatedSupport_into(i, supp);
+        else
+            static_cast<const gsHTensorBasis<d,T>*>(m_basis)->elementSupport_into(i, supp);
+    }
+
     /// Appends a box around parameter to the boxes only if the box is not
     /// already in boxes
     virtual void appendBox(std::vector<index_t>& boxes,
@@ -186,6 +208,17 @@ protected:
     /// Size of the extension
     std::vector<unsigned> m_ext;
 
+    /// Normal equations of the last fit, without smoothing and
+    /// constraints
+    gsSparseMatrix<T> m_lsqMat;
+    gsMatrix<T>       m_lsqRhs;
+
+    /// Active functions of the basis that m_lsqMat refers to
+    std::vector<gsSortedVector<index_t> > m_lsqXmat;
+
+    /// Boxes inserted in the basis since m_lsqMat was assembled
+    std::vector<index_t> m_lsqBoxes;
+
     using gsFitting<T>::m_param_values;
     using gsFitting<T>::m_points;
     using gsFitting<T>::m_basis;
@@ -285,13 +318,17 @@ bool gsHFitting<d, T>::nextIteration(T tolerance, T err_threshold,
 
             gsHTensorBasis<d, T>* basis = static_cast<gsHTensorBasis<d,T> *> (this->m_basis);
             basis->refineElements(boxes);
+            m_lsqBoxes.insert(m_lsqBoxes.end(), boxes.begin(), boxes.end());
 
-	    // If there are any fixed sides, prescribe the coefs in the finer basis.
-	    if(m_result != NULL && fixedSides.size() > 0)
-	    {
-		m_result->refineElements(boxes);
-		setConstraints(fixedSides);
-	    }
+            // The refined result is the initial guess of the next fit
+            if(m_result != NULL)
+            {
+                m_result->refineElements(boxes);
+
+                // If there are any fixed sides, prescribe the coefs in the finer basis.
+                if(fixedSides.size() > 0)
+                    setConstraints(fixedSides);
+            }
 
             gsDebug << "inserted " << boxes.size() / (2 * d + 1) << " boxes.\n";
         }
@@ -339,6 +376,178 @@ void gsHFitting<d, T>::iterativeRefine(int numIterations, T tolerance, T err_thr
     }
 }
 
+template<short_t d, class T>
+void gsHFitting<d, T>::assembleSystem(gsSparseMatrix<T>& A_mat, gsMatrix<T>& B)
+{
+    const gsHTensorBasis<d,T> & basis = static_cast<const gsHTensorBasis<d,T>&>(*m_basis);
+    const index_t num_basis = basis.size();
+
+    if ( !m_lsqBoxes.empty() && 0 != m_lsqMat.rows() )
+        updateSystem();
+    else if ( 0 == m_lsqMat.rows() || m_lsqXmat != basis.getXmatrix() )
+    {
+        // The basis was set or modified directly: assemble from scratch
+        m_lsqMat.resize(num_basis, num_basis);
+        m_lsqRhs.setZero(num_basis, m_points.cols());
+        gsFitting<T>::assembleSystem(m_lsqMat, m_lsqRhs);
+        m_lsqMat.makeCompressed();
+    }
+    m_lsqXmat = basis.getXmatrix();
+    m_lsqBoxes.clear();
+
+    // A_mat and B may be larger, due to constraints
+    for (index_t c = 0; c != m_lsqMat.outerSize(); ++c)
+        for (typename gsSparseMatrix<T>::InnerIterator it(m_lsqMat, c); it; ++it)
+            A_mat(it.row(), c) += it.value();
+    B.topRows(num_basis) += m_lsqRhs;
+}
+
+template<short_t d, class T>
+void gsHFitting<d, T>::updateSystem()
+{
+    typedef typename gsHTensorBasis<d,T>::CMatrix CMatrix;
+    const gsHTensorBasis<d,T> & basis = static_cast<const gsHTensorBasis<d,T>&>(*m_basis);
+    const std::vector<CMatrix> & xmat = basis.getXmatrix();
+    const index_t num_basis = basis.size();
+    const index_t num_old   = m_lsqMat.rows();
+    const index_t nb = 2 * d + 1;
+
+    // The refined area, given as a domain with the boxes inserted
+    gsVector<index_t,d> low, upp;
+    gsHDomain<d> mask;
+    for (short_t k = 0; k != d; ++k)
+        upp[k] = basis.tree().upperCorner()[k] >> basis.tree().getIndexLevel();
+    mask.init(upp, basis.tree().getIndexLevel());
+    for (size_t i = 0; i < m_lsqBoxes.size(); i += nb)
+    {
+        for (short_t k = 0; k != d; ++k)
+        {
+            low[k] = m_lsqBoxes[i + 1 + k];
+            upp[k] = m_lsqBoxes[i + 1 + d + k];
+        }
+        mask.insertBox(low, upp, m_lsqBoxes[i]);
+    }
+
+    // A function stays unchanged if it was active before and its
+    // support does not overlap the refined area. The truncated
+    // support is not enough: the truncation of a function depends on
+    // the finer levels in its whole (untruncated) support.
+    std::vector<index_t> oldOffset(1, 0);
+    for (size_t l = 0; l != m_lsqXmat.size(); ++l)
+        oldOffset.push_back(oldOffset.back() + m_lsqXmat[l].size());
+
+    std::vector<bool>    changed(num_basis, true);
+    std::vector<index_t> oldToNew(num_old, -1);
+    gsMatrix<index_t,d,2> supp;
+    index_t i = 0;
+    for (size_t l = 0; l != xmat.size(); ++l)
+        for (typename CMatrix::const_iterator it = xmat[l].begin();
+             it != xmat[l].end(); ++it, ++i)
+        {
+            if ( l >= m_lsqXmat.size() )
+                continue;
+            typename CMatrix::const_iterator oit =
+                m_lsqXmat[l].find_it_or_fail(*it);
+            if ( oit == m_lsqXmat[l].end() )
+                continue;
+            const index_t o = oldOffset[l] + (oit - m_lsqXmat[l].begin());
+            basis.elementSupport_into(i, supp);
+            if ( 0 != mask.query4(supp.col(0), supp.col(1), l) )
+                continue;
+            changed[i] = false;
+            oldToNew[o] = i;
+        }
+
+    // Keep the terms among unchanged functions. The numbering of
+    // these functions preserves their order, hence the entries are
+    // appended in every column.
+    gsSparseMatrix<T> A(num_basis, num_basis);
+    gsVector<index_t> nnz;
+    nnz.setZero(num_basis);
+    for (index_t c = 0; c != num_old; ++c)
+        if ( -1 != oldToNew[c] )
+            nnz[oldToNew[c]] = m_lsqMat.col(c).nonZeros();
+    A.reserve(nnz);
+    gsMatrix<T> B;
+    B.setZero(num_basis, m_lsqRhs.cols());
+    for (index_t c = 0; c != num_old; ++c)
+    {
+        const index_t nc = oldToNew[c];
+        if ( -1 == nc )
+            continue;
+        B.row(nc) = m_lsqRhs.row(c);
+        for (typename gsSparseMatrix<T>::InnerIterator it(m_lsqMat, c); it; ++it)
+        {
+            const index_t nr = oldToNew[it.row()];
+            if ( -1 != nr )
+                A.insert(nr, nc) = it.value();
+        }
+    }
+
+    // Mark the cells of a (not too fine) level that lie in the
+    // support of a changed function
+    const index_t num_points = m_points.rows();
+    short_t bl = 0;
+    index_t numCells = 1;
+    for (short_t k = 0; k != d; ++k)
+        numCells *= basis.tensorLevel(0).component(k).knots().numElements();
+    for (; bl < static_cast<short_t>(basis.maxLevel()) && numCells << d <= num_points; ++bl)
+        numCells <<= d;
+    gsVector<index_t,d> cells, str;
+    for (short_t k = 0; k != d; ++k)
+    {
+        cells[k] = basis.tensorLevel(bl).component(k).knots().numElements();
+        str[k] = (0 == k ? 1 : str[k-1] * cells[k-1]);
+    }
+    std::vector<bool> cellMarked(cells.prod(), false);
+    gsVector<index_t,d> cur;
+    i = 0;
+    for (size_t l = 0; l != xmat.size(); ++l)
+        for (typename CMatrix::const_iterator it = xmat[l].begin();
+             it != xmat[l].end(); ++it, ++i)
+        {
+            if ( !changed[i] )
+                continue;
+            supportOf(i, supp);
+            for (short_t k = 0; k != d; ++k)
+            {
+                // the last cell is upp[k]
+                if ( static_cast<short_t>(l) >= bl )
+                {
+                    low[k] =  supp(k,0)      >> (l - bl);
+                    upp[k] = (supp(k,1) - 1) >> (l - bl);
+                }
+                else
+                {
+                    low[k] =  supp(k,0)      << (bl - l);
+                    upp[k] = (supp(k,1) << (bl - l)) - 1;
+                }
+            }
+            cur = low;
+            do { cellMarked[cur.dot(str)] = true; }
+            while ( nextCubePoint(cur, low, upp) );
+        }
+
+    // Recompute the terms of the changed functions from the points
+    // in their supports
+    const tensorBasis & cBasis = basis.tensorLevel(bl);
+    std::vector<index_t> pts;
+    for (index_t p = 0; p != num_points; ++p)
+    {
+        for (short_t k = 0; k != d; ++k)
+            cur[k] = cBasis.component(k).knots().uFind(m_param_values(k,p)).uIndex();
+        if ( cellMarked[cur.dot(str)] )
+            pts.push_back(p);
+    }
+
+    gsDebug << "Reassembling with "<< pts.size() <<" of "<< num_points <<" points.\n";
+    this->assemblePoints(pts.size(), pts.empty() ? NULL : &pts[0], changed, A, B);
+
+    A.makeCompressed();
+    m_lsqMat.swap(A);
+    m_lsqRhs.swap(B);
+}
+
 template <short_t d, class T>
 std::vector<index_t> gsHFitting<d, T>::getBoxes(const std::vector<T>& errors,
                                                  const T threshold)
@@ -242,6 +242,7 @@ public:
             m_deg            = o.m_deg;
             m_tree           = o.m_tree;
             m_xmatrix        = o.m_xmatrix;
+            m_changedBoxes   = o.m_changedBoxes;
 
             freeAll( m_bases );
             m_bases.resize( o.m_bases.size() );
@@ -263,6 +264,7 @@ public:
         m_xmatrix = std::move(other.m_xmatrix);
         m_tree    = std::move(other.m_tree);
         m_xmatrix_offset = std::move(other.m_xmatrix_offset);
+        m_changedBoxes   = std::move(other.m_changedBoxes);
         return *this;
     }
 #endif
@@ -334,6 +336,17 @@ public:
     /// level \em k (i.e., those taken from \f$ B^k \f$) start.
     std::vector<index_t> m_xmatrix_offset;
 
+    /// \brief Boxes inserted in the tree since the last
+    /// update_structure().
+    ///
+    /// Each box is stored as <em>2d+1</em> entries: the highest level
+    /// whose functions may have changed, followed by the lower and the
+    /// upper corner in the index level of the tree. If the list is
+    /// empty, update_structure() recomputes all characteristic
+    /// matrices, otherwise only the functions overlapping these boxes
+    /// are updated.
+    std::vector<index_t> m_changedBoxes;
+
     //------------------------------------
 
 public:
@@ -547,8 +560,9 @@ public:
     //virtual void uniformRefine_withCoefs(gsMatrix<T>& coefs, int numKnots = 1, int mul = 1)
 
     // Refine the basis uniformly and produce a sparse matrix which
-    // maps coarse coefficient vectors to refined ones
-    //virtual void uniformRefine_withTransfer(gsSparseMatrix<T,RowMajor> & transfer, int numKnots = 1, int mul = 1)
+    // maps coarse coefficient vectors to refined ones. Only
+    // numKnots = 1 and mul = 1 are supported
+    void uniformRefine_withTransfer(gsSparseMatrix<T,RowMajor> & transfer, int numKnots = 1, int mul = 1);
 
     // Refine the basis uniformly and adjust the given matrix of coefficients accordingly
     void uniformRefine_withCoefs(gsMatrix<T>& coefs, int numKnots = 1, int mul = 1);
@@ -851,6 +865,10 @@ protected:
     /// @brief Creates \a numLevels extra grids in the hierarchy
     void createMoreLevels(int numLevels) const;
 
+    /// @brief Computes the refinement matrices from level \a i to level
+    /// \a i + 1 of the tensor-product bases, for all \a i < \a nLevels
+    void levelTransfers(size_t nLevels, std::vector<gsSparseMatrix<T,RowMajor> > & transfer) const;
+
     /// gets all the boxes along a slice in direction \a dir at parameter \a par.
     /// the boxes are given back in a std::vector<index_t> and are in the right format
     /// to be given to refineElements().
@@ -871,6 +889,14 @@ private:
     // \brief Sets all functions of \a level to active or passive- one by one
     void set_activ1(int level);
 
+    // \brief Updates the characteristic matrices for the functions
+    // overlapping gsHTensorBasis::m_changedBoxes
+    void update_activ();
+
+    // \brief Remembers that the box [\a k1, \a k2] of level \a lvl is
+    // about to be changed, affecting the functions up to level \a maxLvl
+    void addChangedBox(point const & k1, point const & k2, int lvl, int maxLvl);
+
     // \brief Computes the set of active basis functions in the basis
     void setActive();
 
@@ -879,7 +905,7 @@ private:
 
     ///returns a transfer matrix using the characteristic matrix of the old and new basis
     virtual gsSparseMatrix<T> coarsening(const std::vector<gsSortedVector<index_t> >& old, const std::vector<gsSortedVector<index_t> >& n, const gsSparseMatrix<T,RowMajor> & transfer) const = 0;
-    virtual gsSparseMatrix<T> coarsening_direct(const std::vector<gsSortedVector<index_t> >& old, const std::vector<gsSortedVector<index_t> >& n,  const std::vector<gsSparseMatrix<T,RowMajor> >& transfer) const = 0;
+    virtual gsSparseMatrix<T> coarsening_direct(const std::vector<gsSortedVector<index_t> >& old, const std::vector<gsSortedVector<index_t> >& n) const = 0;
     virtual gsSparseMatrix<T> coarsening_direct2(const std::vector<gsSortedVector<index_t> >& old, const std::vector<gsSortedVector<index_t> >& n,  const std::vector<gsSparseMatrix<T,RowMajor> >& transfer) const = 0;
 
     /// \brief Implementation of the features common to domainBoundariesParams and domainBoundariesIndices. It takes both
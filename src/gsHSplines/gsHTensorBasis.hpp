@@ -230,38 +230,35 @@ void gsHTensorBasis<d,T>::refineElements_withCoefs2(gsMatrix<T> & coefs,std::vec
 template<short_t d, class T>
 void gsHTensorBasis<d,T>::uniformRefine_withCoefs(gsMatrix<T>& coefs, int numKnots, int mul)
 {
-    std::vector<gsSortedVector<index_t> > OX = m_xmatrix;
-    //uniformRefine(numKnots);
-    //gsMatrix<> transf;
-    //CMatrix temp;
-    //this->m_xmatrix.insert(this->m_xmatrix.begin(), temp);
-    //gsVector<index_t> level;
-    //gsMatrix<index_t> p1, p2;
-    //this->m_tree.getBoxes(p1,p2,level);
-    std::vector<index_t> boxes;
-    index_t lvl;
-    
-    for ( typename hdomain_type::literator it = m_tree.beginLeafIterator(); it.good(); it.next() )
-    {
-        //        gsDebug <<" level : "<< it.level() <<"\n";
-        //        gsDebug <<" lower : "<< it.lowerCorner() <<"\n";
-        //        gsDebug <<" upper : "<< it.upperCorner() <<"\n";
-
-        lvl = it.level() + 1;
-        const point & l = it.lowerCorner();
-        const point & u = it.upperCorner();
-
-        boxes.push_back(lvl);
-        for( short_t i = 0; i < d; i++)
-            boxes.push_back( l(i) * 2);
-        for( short_t i = 0; i < d; i++)
-            boxes.push_back( u(i) * 2);
-    }
+    gsSparseMatrix<T,RowMajor> transf;
+    this->uniformRefine_withTransfer(transf, numKnots, mul);
+    coefs = transf * coefs;
+}
+
+template<short_t d, class T>
+void gsHTensorBasis<d,T>::uniformRefine_withTransfer(gsSparseMatrix<T,RowMajor> & transfer,
+                                                     int numKnots, int mul)
+{
+    // The levels of the hierarchy are dyadic refinements, so the
+    // lifted tree below does not describe other refinements
+    GISMO_ENSURE(1 == numKnots && 1 == mul,
+                 "Only implemented for numKnots = 1 and mul = 1");
+
+    // Lifting every leaf of the tree by one level gives the uniformly
+    // refined basis with an empty coarsest level, hence with the same
+    // numbering of the basis functions. Only its characteristic
+    // matrices are needed for computing the transfer.
+    const std::vector<CMatrix> OX = m_xmatrix;
+    uPtr lifted = this->clone();
+    lifted->m_tree.incrementLevel();
+    lifted->gsHTensorBasis<d,T>::update_structure();
+
+    gsSparseMatrix<T> tran;
+    lifted->transfer(OX, tran);
+    transfer = tran;
+    transfer.makeCompressed();
 
-    this->clone()->refineElements_withCoefs(coefs, boxes);
     this->uniformRefine(numKnots, mul);
-    //this->m_xmatrix.erase(this->m_xmatrix.begin(),this->m_xmatrix.begin()+1);
-    //coefs = transf*coefs;
 }
 
 template<short_t d, class T>
@@ -400,6 +397,7 @@ void gsHTensorBasis<d,T>::refine(gsMatrix<T> const & boxes)
         //GISMO_UNUSED(tb);
 
         // Sink box
+        addChangedBox(k1, k2, fLevel, m_tree.getMaxInsLevel() + 1);
         m_tree.sinkBox(k1, k2, fLevel);
         // Make sure we have enough levels
         needLevel( m_tree.getMaxInsLevel() );
@@ -602,6 +600,69 @@ void gsHTensorBasis<d,T>::set_activ1(int level)
 
 }
 
+template<short_t d, class T>
+void gsHTensorBasis<d,T>::update_activ()
+{
+    const int maxLevel = static_cast<int>(m_xmatrix.size()) - 1;
+    const unsigned indexLevel = m_tree.getIndexLevel();
+    const size_t nb = 2*d+1;
+
+    // Gather the functions overlapping the changed boxes, per level
+    std::vector<std::vector<index_t> > cand(m_xmatrix.size());
+    point low, upp, curr, actLow, actUpp;
+    for (size_t b = 0; b < m_changedBoxes.size(); b += nb)
+    {
+        const int lvl = math::min<int>(m_changedBoxes[b], maxLevel);
+        for (int k = 0; k <= lvl; ++k)
+        {
+            // Smallest box of level k containing the changed box
+            const unsigned shift = indexLevel - k;
+            for (short_t i = 0; i != d; ++i)
+            {
+                low[i] = m_changedBoxes[b+1+i] >> shift;
+                upp[i] = (m_changedBoxes[b+1+d+i] + (1<<shift) - 1) >> shift;
+            }
+
+            functionOverlap(low, upp, k, actLow, actUpp);
+            curr = actLow;
+            do
+            {
+                cand[k].push_back( m_bases[k]->index(curr) );
+            }
+            while( nextCubePoint(curr, actLow, actUpp) );
+        }
+    }
+
+    // Re-check the candidates and merge them with the other actives
+    CMatrix keep, active;
+    gsMatrix<index_t,d,2> elSupp;
+    for (int k = 0; k <= maxLevel; ++k)
+    {
+        std::vector<index_t> & ck = cand[k];
+        if ( ck.empty() )
+            continue;
+        std::sort(ck.begin(), ck.end());
+        ck.erase( std::unique(ck.begin(), ck.end()), ck.end() );
+
+        active.clear();
+        for (size_t j = 0; j != ck.size(); ++j)
+        {
+            m_bases[k]->elementSupport_into(ck[j], elSupp);
+            if ( m_tree.query3(elSupp.col(0), elSupp.col(1), k) == k )
+                active.push_back(ck[j]);
+        }
+
+        CMatrix & cmat = m_xmatrix[k];
+        keep.clear();
+        keep.reserve(cmat.size() + active.size());
+        std::set_difference(cmat.begin(), cmat.end(), ck.begin(), ck.end(),
+                            std::back_inserter(keep));
+        cmat.resize(keep.size() + active.size());
+        std::merge(keep.begin(), keep.end(), active.begin(), active.end(),
+                   cmat.begin());
+    }
+}
+
 template<short_t d, class T>
 void gsHTensorBasis<d,T>::functionOverlap(const point & boxLow, const point & boxUpp,
                                           const int level, point & actLow, point & actUpp)
@@ -632,18 +693,19 @@ void gsHTensorBasis<d,T>::setActive()
     //     (equiv: actives on the boundary cells of the box)
     //       query3(supp,box.level) == level (min. is level: no coarser)
     // take care: duplicates from different leaves or adj. cells
-    point curr, actUpp;
+    point curr, actUpp, leafLow, leafUpp;
     gsMatrix<index_t,d,2> elSupp;
 
     // try: iteration per level
-    for ( typename hdomain_type::literator it = m_tree.beginLeafIterator(); 
-          it.good(); it.next() )
+    const index_t nLeaves = m_tree.numLeafBoxes();
+    for ( index_t leaf = 0; leaf != nLeaves; ++leaf )
     {
-        const int lvl = it.level();
+        const int lvl = m_tree.leafLevel(leaf);
+        m_tree.leafBox(leaf, leafLow, leafUpp);
         CMatrix & cmat = m_xmatrix[lvl];
 
         // Get candidate functions
-        functionOverlap(it.lowerCorner(), it.upperCorner(), lvl, curr, actUpp);
+        functionOverlap(leafLow, leafUpp, lvl, curr, actUpp);
 
         do 
         {
@@ -652,8 +714,8 @@ void gsHTensorBasis<d,T>::setActive()
             // Get element support
             m_bases[lvl]->elementSupport_into(gi, elSupp);
 
-            if ( (elSupp.col(0).array() >= it.lowerCorner().array()).all() &&
-                 (elSupp.col(1).array() <= it.upperCorner().array()).all() )
+            if ( (elSupp.col(0).array() >= leafLow.array()).all() &&
+                 (elSupp.col(1).array() <= leafUpp.array()).all() )
             {
                 // to do: all-at-once
                 cmat.push_unsorted( gi );
@@ -739,10 +801,42 @@ void gsHTensorBasis<d,T>::insert_box(typename gsHTensorBasis<d,T>::point const &
     // Remember box in History (for debugging)
     // m_boxHistory.push_back( box(k1,k2,lvl) );
 
+    addChangedBox(k1, k2, lvl, lvl);
     m_tree.insertBox(k1,k2, lvl);
     needLevel( m_tree.getMaxInsLevel() );
 }
 
+template<short_t d, class T>
+void gsHTensorBasis<d,T>::addChangedBox(point const & k1, point const & k2,
+                                        int lvl, int maxLvl)
+{
+    point g1, g2;
+    m_tree.local2globalIndex(k1, static_cast<unsigned>(lvl), g1);
+    m_tree.local2globalIndex(k2, static_cast<unsigned>(lvl), g2);
+    g2 = g2.cwiseMin(m_tree.upperCorner());
+
+    // Boxes which are empty or outside the domain are ignored by the tree
+    if ( (g1.array() >= g2.array()).any() )
+        return;
+
+    // The tree splits the leaves on the grid of their own level, so
+    // the changed region is the box expanded to the grid of the
+    // coarsest level it overlaps
+    const unsigned indexLevel = m_tree.getIndexLevel();
+    const int minLvl = m_tree.query3(g1, g2, indexLevel);
+    const index_t h = index_t(1) << (indexLevel - minLvl);
+    for (short_t i = 0; i != d; ++i)
+    {
+        g1[i] -= g1[i] % h;
+        g2[i] += ( g2[i] % h ? h - g2[i] % h : 0 );
+    }
+    g2 = g2.cwiseMin(m_tree.upperCorner());
+
+    m_changedBoxes.push_back(maxLvl);
+    m_changedBoxes.insert(m_changedBoxes.end(), g1.data(), g1.data() + d);
+    m_changedBoxes.insert(m_changedBoxes.end(), g2.data(), g2.data() + d);
+}
+
 template<short_t d, class T>
 void gsHTensorBasis<d,T>::makeCompressed()
 {
@@ -838,15 +932,25 @@ void gsHTensorBasis<d,T>::update_structure() // to do: rename as updateHook
     // Make sure we have computed enough levels
     needLevel( m_tree.getMaxInsLevel() );
 
-    // Setup the characteristic matrices
-    m_xmatrix.clear();
-    m_xmatrix.resize( m_bases.size() );
-
     // Compress the tree
     m_tree.makeCompressed();
 
-    for(size_t i = 0; i != m_xmatrix.size(); i ++)
-        set_activ1(i);
+    if ( m_changedBoxes.empty() || m_xmatrix.empty() )
+    {
+        // Setup the characteristic matrices
+        m_xmatrix.clear();
+        m_xmatrix.resize( m_bases.size() );
+
+        for(size_t i = 0; i != m_xmatrix.size(); i ++)
+            set_activ1(i);
+    }
+    else
+    {
+        // Only the functions overlapping the inserted boxes can change
+        m_xmatrix.resize( m_bases.size() );
+        update_activ();
+    }
+    m_changedBoxes.clear();
 
     // Store all indices of active basis functions to m_matrix
     //setActive();
@@ -1193,40 +1297,41 @@ std::vector< std::vector< std::vector<index_t > > > gsHTensorBasis<d,T>::domainB
 
 
 template<short_t d, class T>
-void  gsHTensorBasis<d,T>::transfer(const std::vector<gsSortedVector<index_t> >& old, gsSparseMatrix<T>& result)
+void gsHTensorBasis<d,T>::levelTransfers(size_t nLevels,
+                                         std::vector<gsSparseMatrix<T,RowMajor> > & transfer) const
 {
-    // Note: implementation assumes number of old + 1 m_bases exists in this basis
-    needLevel( old.size() );
+    needLevel( nLevels );
 
     tensorBasis T_0_copy = this->tensorLevel(0);
-
-    std::vector< gsSparseMatrix<T,RowMajor> > transfer(m_bases.size()-1);
+    transfer.resize(nLevels);
     std::vector<std::vector<T> > knots(d);
 
-    for(size_t i = 1; i < m_bases.size(); ++i)
+    for(size_t i = 1; i <= nLevels; ++i)
     {
-        //T_0_copy.uniformRefine_withTransfer(transfer[i-1], 1);
-        for(unsigned dim = 0; dim != d; ++dim)
+        for(short_t dim = 0; dim != d; ++dim)
         {
             const gsKnotVector<T> & ckv = m_bases[i-1]->knots(dim);
             const gsKnotVector<T> & fkv = m_bases[i  ]->knots(dim);
             ckv.symDifference(fkv, knots[dim]);
             // equivalent (dyadic ref.):
             // ckv.getUniformRefinementKnots(1, knots[dim]);
-
-            //gsDebug << "level: " << i << "\n"
-            //        << "direction: " << dim << "\n";
-            //gsDebugVar(gsAsMatrix<T>(dirKnots));
         }
 
         T_0_copy.refine_withTransfer(transfer[i-1], knots);
     }
+}
+
+template<short_t d, class T>
+void  gsHTensorBasis<d,T>::transfer(const std::vector<gsSortedVector<index_t> >& old, gsSparseMatrix<T>& result)
+{
+    // Note: implementation assumes number of old + 1 m_bases exists in this basis
+    needLevel( old.size() );
 
     // Add missing empty char. matrices
     while ( old.size() >= m_xmatrix.size() )
         m_xmatrix.push_back( gsSortedVector<index_t>() );
 
-    result = this->coarsening_direct(old, m_xmatrix, transfer);
+    result = this->coarsening_direct(old, m_xmatrix);
 
     // This function automatically adds additional characteristic matrices,
     // even if they are not needed.
@@ -1251,27 +1356,8 @@ void  gsHTensorBasis<d,T>::transfer2(const std::vector<gsSortedVector<index_t> >
     // Note: implementation assumes number of old + 1 m_bases exists in this basis
     needLevel( old.size() );
 
-    tensorBasis T_0_copy = this->tensorLevel(0);
-    std::vector< gsSparseMatrix<T,RowMajor> > transfer( m_bases.size()-1 );
-    std::vector<std::vector<T> > knots(d);
-    
-    for(size_t i = 1; i < m_bases.size(); ++i)
-    {
-        //T_0_copy.uniformRefine_withTransfer(transfer[i], 1);
-        for(short_t dim = 0; dim != d; ++dim)
-        {
-            const gsKnotVector<T> & ckv = m_bases[i-1]->knots(dim);
-            const gsKnotVector<T> & fkv = m_bases[i  ]->knots(dim);
-            ckv.symDifference(fkv, knots[dim]);
-            // equivalent (dyadic ref.):
-            // ckv.getUniformRefinementKnots(1, knots[dim]);
-
-            //gsDebug << "level: " << i << "\n"
-            //        << "direction: " << dim << "\n";
-            //gsDebugVar(gsAsMatrix<T>(dirKnots));
-        }
-        T_0_copy.refine_withTransfer(transfer[i-1], knots);
-    }
+    std::vector< gsSparseMatrix<T,RowMajor> > transfer;
+    this->levelTransfers(m_bases.size()-1, transfer);
 
     // Add missing empty char. matrices
     while ( old.size() >= m_xmatrix.size())
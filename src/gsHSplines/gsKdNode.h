@@ -31,6 +31,8 @@ struct gsAabb
 public:
     typedef gsVector<Z,d> point;
 
+    gsAabb() : level(0) { }
+
     gsAabb(const point & l, const point & u)
     {
         first  = l;
@@ -51,6 +53,8 @@ public:
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
 
+template<short_t d, class Z> class gsKdNodePool;
+
 /**
     @brief Struct representing a kd-tree node
 
@@ -58,6 +62,8 @@ public:
     - Split nodes
     - Leaf nodes
 
+    The nodes are allocated in a gsKdNodePool, which owns them.
+
     Template parameters
     \param d is the dimension
     \param Z is the box-coordinate index type
@@ -71,6 +77,8 @@ struct kdnode
     typedef          gsAabb<d,Z> kdBox;
     typedef typename kdBox::point point;
 
+    typedef gsKdNodePool<d,Z> pool;
+
     /// axis in which the children of this node split the domain
     /// special value -1 denotes a leaf node
     int axis; 
@@ -82,10 +90,10 @@ struct kdnode
     /// special value -1 denotes unknown level (in case of a split node)
     int level ;
 
-    /// The box held in this leaf node (if leaf)
-    /// box->first is the lower left corner of the box
-    /// box->second is the upper right corner of the box
-    kdBox * box;
+    /// The box held in this leaf node (meaningfull only for leaves)
+    /// box.first is the lower left corner of the box
+    /// box.second is the upper right corner of the box
+    kdBox box;
 
     /// Pointer to the parent node
     kdnode * parent; 
@@ -97,83 +105,41 @@ struct kdnode
     kdnode * right; 
 
     /// Constructor (empty node)
-    kdnode() : axis(-2) ,level(0), box(0), 
+    kdnode() : axis(-2), pos(0), level(0),
                parent(0), left(0), right(0)
     { }
 
-    /// Constructor (root node)
-    kdnode(point const & upp) : axis(-1) , level(0),
-                                parent(0), left(0) , right(0)
-    { 
-        // Initial box, upp is expected to be indexed in finest level
-        box = new kdBox( point::Zero(), upp);
-    }
-
-    /// Constructor (leaf node)
-    kdnode(kdBox const & bb) 
-        : axis(-1) , level(0),
-          parent(0), left(0) , right(0)
-    { 
-        // ..
-    }
-    
-    /// Recursively copies the whole subtree under \a o, and sets it's
-    /// parent to \a parentNode
-    kdnode(const kdnode & o, kdnode * parentNode = NULL) : 
-        axis(o.axis), level(o.level)
+    /// Resets the node to an empty node, keeping the storage of the box
+    void reset()
     {
-        parent = parentNode;
-        if ( axis == -1 )
-        {
-            GISMO_ASSERT( (o.left == 0) && (o.right == 0), 
-                          "Problem: leaf with children." );
-            box  = new kdBox(*o.box);
-            left = right = NULL;
-        }
-        else
-        {
-            GISMO_ASSERT( o.box == 0, 
-                          "Problem: split node with box." );
-            pos   = o.pos;
-            left  = new kdnode(*o.left , this);
-            right = new kdnode(*o.right, this);
-            box   = NULL;
-        }
+        axis   = -2;
+        pos    = 0;
+        level  = 0;
+        parent = left = right = NULL;
     }
 
-    /// Recursively deletes the whole subtree under this node
-    ~kdnode()
-    {
-        // to do: non-reccursive
-
-        if ( isLeaf() ) 
-        {
-            // No throw in destructor
-            //GISMO_ASSERT( (left == 0) && (right == 0), 
-            //              "Problem: leaf with children." );
-                delete box;
-        }
-        else
-        {
-            // No throw in destructor
-            //GISMO_ASSERT( box == 0, 
-            //              "Problem: split node with box." );
-            delete left;
-            delete right;
-        }
+    /// Makes this node the root leaf of the box [0, \a upp]
+    void makeRoot(point const & upp)
+    { 
+        axis   = -1;
+        level  = 0;
+        parent = left = right = NULL;
+        // Initial box, upp is expected to be indexed in finest level
+        box.first.setZero();
+        box.second = upp;
     }
 
     // Box Accessors
     const point & lowCorner() const 
     { 
-        GISMO_ASSERT(box, "Asked for lowCorner at node without box data.");
-        return box->first ; 
+        GISMO_ASSERT(isLeaf(), "Asked for lowCorner at node without box data.");
+        return box.first ; 
     }
 
     const point & uppCorner() const 
     { 
-        GISMO_ASSERT(box, "Asked for uppCorner at node without box data.");
-        return box->second; 
+        GISMO_ASSERT(isLeaf(), "Asked for uppCorner at node without box data.");
+        return box.second; 
     }
 
     bool isLeaf() const { return axis == -1; }
@@ -197,8 +163,8 @@ struct kdnode
     {
         if ( isLeaf() )
         {
-            box->first .array() *= 2;
-            box->second.array() *= 2;
+            box.first .array() *= 2;
+            box.second.array() *= 2;
         }
         else
         {
@@ -207,15 +173,15 @@ struct kdnode
     }
 
     // Splits the node (ie. two children are added)
-    inline void split()
+    inline void split(pool & p)
     {
         GISMO_ASSERT( (left == 0) && (right == 0),
                       "Can only split leaf nodes.");
         GISMO_ASSERT( axis > -1, "Split axis not prescribed.");
 
         // Make new left and right children
-        left          = new kdnode;
-        right         = new kdnode;
+        left          = p.create();
+        right         = p.create();
         // Set axis to -1 (since they are leaves)
         left ->axis   =
         right->axis   = -1;
@@ -226,69 +192,66 @@ struct kdnode
         left ->level  = 
         right->level  = level;
         // Set box
-        left ->box    = box;    
-        right->box    = new kdBox(*box);
-        // Detach box from parent (is now at left child)
-        box = NULL;
+        left ->box    = 
+        right->box    = box;
         // Resize properly the box coordinates
-        left ->box->second[axis] = 
-        right->box->first [axis] = pos;
+        left ->box.second[axis] = 
+        right->box.first [axis] = pos;
     }
 
     // Merges terminal node (ie. two children are joined)
-    inline void merge()
+    inline void merge(pool & p)
     {
         GISMO_ASSERT( (left->isLeaf()) && (right->isLeaf()),
                       "Can only merge terminal nodes.");
 
         // Recover box
         box = left->box;
-        left->box = NULL;
-        box->second[axis] = right->box->second[axis];
+        box.second[axis] = right->box.second[axis];
         axis  = - 1;
         level = left->level;
 
         // Delete children
-        delete  left;
+        p.destroy(left);
         left  = NULL;
-        delete right;
+        p.destroy(right);
         right = NULL;
     }
 
 
     // Splits the node (ie. two children are added)
-    void split(int splitAxis, Z splitPos)
+    void split(int splitAxis, Z splitPos, pool & p)
     {
-        GISMO_ASSERT( box->second[splitAxis] != splitPos, "Degenerate split");
-        GISMO_ASSERT( box->first [splitAxis] != splitPos, "Degenerate split");
+        GISMO_ASSERT( box.second[splitAxis] != splitPos, "Degenerate split");
+        GISMO_ASSERT( box.first [splitAxis] != splitPos, "Degenerate split");
         axis = splitAxis;
         pos  = splitPos;
-        split();
+        split(p);
     }
 
     /// Splits the node in the middle (ie. two children are added)
     // to do: remove
-    void nextMidSplit()
+    void nextMidSplit(pool & p)
     {        
         axis = ( parent == 0 ? 0 : (parent->axis+1)%d );        
-        pos  = box->first [axis] + 
-            (box->second[axis] - box->first[axis])/2 ;
-        split(); // Can be degenerate
+        pos  = box.first [axis] + 
+            (box.second[axis] - box.first[axis])/2 ;
+        split(p); // Can be degenerate
     }
 
     /// Splits the node in the middle (ie. two children are added)
     /// If non-degenerate split is impossible, then this is a no-op
-    void anyMidSplit(int index_level)
+    void anyMidSplit(int index_level, pool & p)
     {        
         const unsigned h = 1 << (index_level - level) ;
         const unsigned mask = ~(h - 1);
         for ( unsigned i = 0; i < d; ++i )
         {
             const unsigned c = 
-                (box->first [i] + (box->second[i] - box->first[i])/2) & mask ;
-            if ( c != box->first [i] ) // avoid degenerate split
+                (box.first [i] + (box.second[i] - box.first[i])/2) & mask ;
+            if ( c != box.first [i] ) // avoid degenerate split
             {
-                split(i, c);
+                split(i, c, p);
                 return;
             }
         }
@@ -300,7 +263,8 @@ struct kdnode
     /// then this is a no-op.
     /// Splitting is done on a coordinate of the current \a level (aligned)
     /// returns the child that intersects \a insBox or NULL (if no split)
-    kdnode * adaptiveAlignedSplit(kdBox const & insBox, int index_level)
+    kdnode * adaptiveAlignedSplit(kdBox const & insBox, int index_level,
+                                  pool & p)
     {
         const unsigned h = 1 << (index_level - level) ;
         //const unsigned mask = ~(h - 1);
@@ -314,16 +278,16 @@ struct kdnode
             //const unsigned c1 = (insBox. first[i] & mask)    ;
             //const unsigned c2 = (insBox.second[i] & mask) + ..;
 
-            if ( c1 > box->first[i] )
+            if ( c1 > box.first[i] )
             {
                 // right child intersects insBox
-                split(i, c1 );
+                split(i, c1, p);
                 return right;
             }
-            else if ( c2 < box->second[i]  )
+            else if ( c2 < box.second[i]  )
             {
                 // left child intersects insBox
-                split(i, c2 );
+                split(i, c2, p);
                 return left;
             }
         }
@@ -334,25 +298,25 @@ struct kdnode
     /// according to \a insBox.  If non-degenerate split is impossible,
     /// then this is a no-op
     // to do: remove
-    kdnode * adaptiveSplit(kdBox const & insBox)
+    kdnode * adaptiveSplit(kdBox const & insBox, pool & p)
     {
         // assumption: insBox intersects box
         for ( unsigned i = 0; i < d; ++i )
         {
             // to do: strategy: try to split as close to the middle as
             // possible
-            if ( insBox.first[i] > box->first[i] )
+            if ( insBox.first[i] > box.first[i] )
             {
                 axis = i;
                 pos  = insBox.first[i];
-                split();
+                split(p);
                 return right;
             }
-            else if ( insBox.second[i] < box->second[i] )
+            else if ( insBox.second[i] < box.second[i] )
             {
                 axis = i;
                 pos  = insBox.second[i];
-                split();
+                split(p);
                 return left ;
             }
         }
@@ -360,12 +324,15 @@ struct kdnode
         return NULL;
     }
 
+    // see http://eigen.tuxfamily.org/dox-devel/group__TopicStructHavingEigenMembers.html
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
     friend std::ostream & operator<<(std::ostream & os, const kdnode & n)
     {
         if ( n.isLeaf() ) 
         {
-            os << "Leaf node ("<< n.box->first.transpose() <<"), ("
-               << n.box->second.transpose() <<"). level="<<n.level<<" \n";
+            os << "Leaf node ("<< n.box.first.transpose() <<"), ("
+               << n.box.second.transpose() <<"). level="<<n.level<<" \n";
         }
         else
         {
@@ -379,4 +346,185 @@ struct kdnode
 };
 
 
+/**
+    @brief Storage of the nodes of a kd-tree.
+
+    The nodes are allocated in chunks of contiguous memory instead of
+    one by one. The chunks grow with the number of nodes, so that small
+    trees take little memory. Deleted nodes are recycled, and copyTree() stores a
+    (sub-)tree in pre-order without recursion. Swapping two pools keeps
+    the node addresses.
+
+    Template parameters
+    \param d is the dimension
+    \param Z is the box-coordinate index type
+
+    \ingroup HSplines
+*/
+template<short_t d, class Z = index_t>
+class gsKdNodePool
+{
+public:
+    typedef kdnode<d,Z> node;
+
+    /// Smallest and largest number of nodes in a chunk. The chunks
+    /// grow geometrically between these bounds
+    enum { minChunk = 16, maxChunk = 1024 };
+
+public:
+
+    gsKdNodePool() : m_cur(0), m_pos(0), m_size(0), m_capacity(0) { }
+
+    ~gsKdNodePool() { clear(); }
+
+    void swap(gsKdNodePool & o)
+    {
+        m_chunks.swap(o.m_chunks);
+        m_chunkSizes.swap(o.m_chunkSizes);
+        m_free.swap(o.m_free);
+        std::swap(m_cur, o.m_cur);
+        std::swap(m_pos, o.m_pos);
+        std::swap(m_size, o.m_size);
+        std::swap(m_capacity, o.m_capacity);
+    }
+
+    /// Returns a new (empty) node
+    node * create()
+    {
+        node * result;
+        if ( ! m_free.empty() )
+        {
+            result = m_free.back();
+            m_free.pop_back();
+        }
+        else
+        {
+            while ( m_cur != m_chunks.size() && m_pos == m_chunkSizes[m_cur] )
+            {
+                ++m_cur;
+                m_pos = 0;
+            }
+            if ( m_cur == m_chunks.size() )
+                addChunk( m_capacity < minChunk ? minChunk :
+                          m_capacity > maxChunk ? maxChunk : m_capacity );
+            result = m_chunks[m_cur] + m_pos;
+            ++m_pos;
+            ++m_size;
+        }
+        result->reset();
+        return result;
+    }
+
+    /// Returns node \a n to the pool
+    void destroy(node * n) { m_free.push_back(n); }
+
+    /// Makes sure that \a n nodes can be created without allocating
+    void reserve(index_t n)
+    {
+        const index_t avail = m_capacity - m_size + m_free.size();
+        if ( n > avail )
+            addChunk(n - avail);
+    }
+
+    /// Deletes all nodes
+    void clear()
+    {
+        for (size_t c = 0; c != m_chunks.size(); ++c)
+            delete[] m_chunks[c];
+        m_chunks.clear();
+        m_chunkSizes.clear();
+        m_free.clear();
+        m_cur = m_pos = m_size = m_capacity = 0;
+    }
+
+    /// Releases all nodes, keeping the chunks for new nodes
+    void reset()
+    {
+        m_free.clear();
+        m_cur = m_pos = m_size = 0;
+    }
+
+    /// Copies the tree under \a root (which may live in another pool)
+    /// to this pool, in pre-order, and returns the new root
+    node * copyTree(const node * root)
+    {
+        // Source nodes together with their new parent
+        std::vector<std::pair<const node*, node*> > stack;
+        stack.push_back( std::make_pair(root, (node*)NULL) );
+        node * result = NULL;
+        while ( ! stack.empty() )
+        {
+            const node * src = stack.back().first;
+            node * parent    = stack.back().second;
+            stack.pop_back();
+
+            node * cur = create();
+            *cur = *src;
+            cur->parent = parent;
+            if ( NULL == parent )
+                result = cur;
+            else if ( src == src->parent->left )
+                parent->left  = cur;
+            else
+                parent->right = cur;
+
+            if ( ! src->isLeaf() )
+            {
+                stack.push_back( std::make_pair(src->right, cur) );
+                stack.push_back( std::make_pair(src->left , cur) );
+            }
+        }
+        return result;
+    }
+
+    /// Stores the tree under \a root (which must live in this pool)
+    /// contiguously in pre-order and returns the new root. The chunks
+    /// of the pool are reused, unless they can hold many more nodes
+    /// than the tree has.
+    node * compactTree(const node * root)
+    {
+        const index_t n = size();
+        gsKdNodePool tmp;
+        tmp.reserve(n);
+        const node * tmpRoot = tmp.copyTree(root);
+        if ( m_capacity > 4 * n )
+        {
+            swap(tmp);
+            return const_cast<node*>(tmpRoot);
+        }
+        reset();
+        return copyTree(tmpRoot);
+    }
+
+    /// Returns the number of nodes in use
+    index_t size() const { return m_size - m_free.size(); }
+
+    /// Returns the number of nodes that fit in the allocated chunks
+    index_t capacity() const { return m_capacity; }
+
+private:
+
+    // Nodes are not copied one by one, see copyTree()
+    gsKdNodePool(const gsKdNodePool &);
+    gsKdNodePool & operator=(const gsKdNodePool &);
+
+    // Appends a chunk of \a n nodes
+    void addChunk(index_t n)
+    {
+        m_chunks.push_back( new node[n] );
+        m_chunkSizes.push_back(n);
+        m_capacity += n;
+    }
+
+private:
+
+    std::vector<node*>   m_chunks;     ///< Chunks of nodes
+    std::vector<index_t> m_chunkSizes; ///< Number of nodes of each chunk
+    std::vector<node*>   m_free;       ///< Deleted nodes
+    size_t               m_cur;        ///< Chunk of the next new node
+    index_t              m_pos;        ///< Position of the next new node in its chunk
+    index_t              m_size;       ///< Number of used positions
+    index_t              m_capacity;   ///< Total number of nodes of the chunks
+};
+
 }// namespace gismo
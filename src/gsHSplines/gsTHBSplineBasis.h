@@ -344,6 +344,13 @@ public:
     // Look at gsBasis class for documentation
     void eval_into(const gsMatrix<T> & u, gsMatrix<T>& result) const;
 
+    // Look at gsBasis class for documentation
+    void evalAllDers_into(const gsMatrix<T> & u, int n,
+                          std::vector<gsMatrix<T> >& result) const;
+
+    // Look at gsBasis class for documentation
+    void active_into(const gsMatrix<T> & u, gsMatrix<index_t>& result) const;
+
     // Because of overriding one of the "eval_into" functions, all
     // functions in the base class with this name are hidden from the
     // derived class: Compiler does not search the base class as soon
@@ -389,6 +396,12 @@ public:
                          const gsMatrix<T>& u,
                          gsMatrix<T>& result) const;
 
+    /// @brief Returns the element indices (of the level of the
+    /// function) of a box containing the support of the i-th
+    /// (truncated) basis function, cf. elementSupport_into()
+    void truncatedSupport_into(const index_t i,
+                               gsMatrix<index_t, d, 2>& result) const;
+
 private:
 
     unsigned getPresLevelOfBasisFun(const unsigned index) const
@@ -406,6 +419,33 @@ private:
     /// @brief Computes and saves representation of all basis functions.
     void representBasis(); // rename: precompute coeffs
 
+    /// @brief Computes and saves the active functions and the
+    /// truncation matrix of every element (see m_elements).
+    void representElements() const;
+
+    /// @brief Builds the element data if the basis has changed since
+    /// they were last computed
+    ///
+    /// The element data are computed on the first evaluation, so that
+    /// refinement steps in between evaluations do not pay for them.
+    /// The flag is read atomically, and the flush orders the read
+    /// before the reads of the element data, which
+    /// representElements() publishes before setting the flag.
+    void updateElements() const
+    {
+        bool valid;
+#       pragma omp atomic read
+        valid = m_elementsValid;
+#       pragma omp flush
+        if ( !valid )
+            representElements();
+    }
+
+    /// @brief Returns the level \a lvl and the flat index \a cell
+    /// (among the cells of level \a lvl) of the element containing \a u.
+    template<class Vec>
+    void elementOf(const Vec & u, int & lvl, index_t & cell) const;
+
 
     /// @brief Computes representation of j-th basis function on pres_level and
     /// saves it.
@@ -621,13 +661,59 @@ private:
     void globalRefinement(const gsMatrix<T> & thbCoefs, int level, 
                           gsMatrix<T> & lvlCoefs) const;
 
+    /// @brief Same as globalRefinement(), but computes in one pass
+    /// the coefficients of every level \a l <= \a level with
+    /// \a needed[l] true; \a lvlCoefs[l] is left empty otherwise
+    void globalRefinement(const gsMatrix<T> & thbCoefs, int level,
+                          const std::vector<bool> & needed,
+                          std::vector<gsMatrix<T> > & lvlCoefs) const;
+
+    /// @brief Computes the first (\a low) and last (\a upp) index,
+    /// in each direction, of the B-splines of level \a level acting
+    /// on the box [\a b1, \a b2] (see getBsplinePatchGlobal())
+    void _patchIndexRange(gsVector<index_t> b1, gsVector<index_t> b2,
+                          unsigned level, gsVector<index_t,d> & low,
+                          gsVector<index_t,d> & upp) const;
+
+    /// @brief Copies the control points of the B-spline patch with
+    /// index range [\a low, \a upp] from the coefficients \a lvlCoefs
+    /// of level \a level to the rows of \a cp starting at \a offset
+    /// and returns its knot vectors
+    void _getBsplinePatch(const gsVector<index_t,d> & low,
+                          const gsVector<index_t,d> & upp,
+                          unsigned level, const gsMatrix<T> & lvlCoefs,
+                          gsMatrix<T> & cp, index_t offset,
+                          gsKnotVector<T> & k1, gsKnotVector<T> & k2) const;
+
+    /// @brief Extracts the B-spline patches of the boxes given by
+    /// \a b1, \a b2 and \a level (see getBsplinePatches()), in parallel.
+    /// The control points are stacked in \a cp if \a patches is NULL,
+    /// otherwise the patches are created in \a patches.
+    void _getBsplinePatches(const gsMatrix<T> & geom_coef,
+                            const gsMatrix<index_t> & b1,
+                            const gsMatrix<index_t> & b2,
+                            const gsVector<index_t> & level,
+                            gsMatrix<T> & cp, gsMatrix<index_t> & nvertices,
+                            std::vector<gsGeometry<T>*> * patches) const;
+
     gsSparseMatrix<T> coarsening(const std::vector<gsSortedVector<index_t> >& old,
                            const std::vector<gsSortedVector<index_t> >& n,
                            const gsSparseMatrix<T,RowMajor> & transfer) const;
 
+    /// Returns the matrix expressing the THB basis functions given by
+    /// the characteristic matrices \a old in terms of the ones given
+    /// by \a n. The level-to-level refinement is done direction-wise,
+    /// without forming the tensor-product transfer matrices.
     gsSparseMatrix<T> coarsening_direct( const std::vector<gsSortedVector<index_t> >& old,
-                                   const std::vector<gsSortedVector<index_t> >& n, 
-                                   const std::vector<gsSparseMatrix<T,RowMajor> >& transfer) const;
+                                   const std::vector<gsSortedVector<index_t> >& n) const;
+
+    /// Refines the tensor-product coefficients \a coefs, given on the
+    /// box with lower corner \a low and size \a size, by the
+    /// univariate level transfers \a tr, one per direction. On output
+    /// the box and the coefficients refer to the next level.
+    static void _refineBox(const std::vector<gsSparseMatrix<T> > & tr,
+                           gsVector<index_t,d> & low, gsVector<index_t,d> & size,
+                           std::vector<T> & coefs, std::vector<T> & tmp);
 
     gsSparseMatrix<T> coarsening_direct2( const std::vector<gsSortedVector<index_t> >& old,
                                    const std::vector<gsSortedVector<index_t> >& n,
@@ -718,6 +804,26 @@ private:
     // m_presentation[j]
     std::map<index_t, gsSparseVector<T> > m_presentation;
 
+    // Data of an element of the hierarchical mesh
+    struct elementData
+    {
+        // The active functions on the element, as given by active_into()
+        gsMatrix<index_t> actives;
+
+        // Row i holds the coefficients of active function i restricted
+        // to the element, in terms of the active tensor B-splines of
+        // the element's level
+        gsMatrix<T> trunc;
+    };
+
+    // m_elements[l] maps the flat cell index of every element of
+    // level l to its data. Evaluation on an element is a product of
+    // the truncation matrix with the level-l B-spline values.
+    mutable std::vector<std::map<index_t, elementData> > m_elements;
+
+    // True if m_elements is up to date, see updateElements()
+    mutable bool m_elementsValid;
+
     using gsHTensorBasis<d,T>::m_bases;
     using gsHTensorBasis<d,T>::m_xmatrix;
     using gsHTensorBasis<d,T>::m_xmatrix_offset;
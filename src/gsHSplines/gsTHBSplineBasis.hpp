@@ -22,6 +22,7 @@
 #include <gsIO/gsXmlGenericUtils.hpp>
 
 #include <gsTensor/gsTensorTools.h>
+#include <gsHSplines/gsHDomainIterator.h>
 
 namespace gismo
 {
@@ -85,6 +86,10 @@ void gsTHBSplineBasis<d,T>::representBasis()
             this->m_is_truncated[j] = -1;
         }
     }
+
+    // The element data are rebuilt on the next evaluation
+    m_elements.clear();
+    m_elementsValid = false;
 }
 
 template<short_t d, class T>
@@ -409,102 +414,137 @@ void gsTHBSplineBasis<d,T>::getBsplinePatchGlobal(gsVector<index_t> b1,
                                                   gsKnotVector<T>& k1,
                                                   gsKnotVector<T>& k2) const
 {    
+    gsVector<index_t,d> low, upp;
+    _patchIndexRange(b1, b2, level, low, upp);
+    cp.resize(((upp - low).array() + 1).prod(), geom_coef.cols());
+
+    gsMatrix<T> temp;
+    globalRefinement(geom_coef, level, temp);
+    _getBsplinePatch(low, upp, level, temp, cp, 0, k1, k2);
+}
+
+template<short_t d, class T>
+void gsTHBSplineBasis<d,T>::_patchIndexRange(gsVector<index_t> b1,
+                                             gsVector<index_t> b2,
+                                             unsigned level,
+                                             gsVector<index_t,d> & low,
+                                             gsVector<index_t,d> & upp) const
+{
     // check if the indices in b1, and b2 are correct with respect to the given level    
     const unsigned loc2glob = ( 1<< (this->maxLevel() - level) );
-    if( b1[0]%loc2glob != 0 ) b1[0] -= b1[0]%loc2glob;
-    if( b1[1]%loc2glob != 0 ) b1[1] -= b1[1]%loc2glob;
-    if( b2[0]%loc2glob != 0 ) b2[0] += loc2glob -(b2[0]%loc2glob);
-    if( b2[1]%loc2glob != 0 ) b2[1] += loc2glob -(b2[1]%loc2glob);
+    for (short_t k = 0; k != d; ++k)
+    {
+        if( b1[k]%loc2glob != 0 ) b1[k] -= b1[k]%loc2glob;
+        if( b2[k]%loc2glob != 0 ) b2[k] += loc2glob -(b2[k]%loc2glob);
+    }
 
     // select the indices of all B-splines of the given level acting on the given box
-    gsVector<index_t,d> b1_outputs, b2_outputs;
-    this->m_tree.computeLevelIndex( b1, level, b1_outputs );
-    this->m_tree.computeLevelIndex( b2, level, b2_outputs );
-    int i0 = b1_outputs(0);
-    int i1 = b2_outputs(0);
-    int j0 = b1_outputs(1);
-    int j1 = b2_outputs(1);
-    i0 = m_bases[level]->knots(0).lastKnotIndex(i0) - m_deg[0];
-    i1 = m_bases[level]->knots(0).firstKnotIndex(i1) - 1;
-    j0 = m_bases[level]->knots(1).lastKnotIndex(j0) - m_deg[1];
-    j1 = m_bases[level]->knots(1).firstKnotIndex(j1) - 1;
-
-    const index_t sz0   = m_bases[level]->size(0);
-    const index_t newSz = (i1 - i0 + 1)*(j1 - j0 + 1);
-    cp.resize(newSz, geom_coef.cols());
+    this->m_tree.computeLevelIndex( b1, level, low );
+    this->m_tree.computeLevelIndex( b2, level, upp );
+    for (short_t k = 0; k != d; ++k)
+    {
+        low[k] = m_bases[level]->knots(k).lastKnotIndex(low[k]) - m_deg[k];
+        upp[k] = m_bases[level]->knots(k).firstKnotIndex(upp[k]) - 1;
+    }
+}
 
-    gsMatrix<T> temp;
-    globalRefinement(geom_coef, level, temp);
+template<short_t d, class T>
+void gsTHBSplineBasis<d,T>::_getBsplinePatch(const gsVector<index_t,d> & low,
+                                             const gsVector<index_t,d> & upp,
+                                             unsigned level,
+                                             const gsMatrix<T> & lvlCoefs,
+                                             gsMatrix<T> & cp, index_t offset,
+                                             gsKnotVector<T> & k1,
+                                             gsKnotVector<T> & k2) const
+{
+    const index_t sz0 = m_bases[level]->size(0);
+    const index_t n0  = upp[0] - low[0] + 1;
+    for(index_t j = low[1]; j <= upp[1]; j++, offset += n0)
+        cp.middleRows(offset, n0) = lvlCoefs.middleRows(j*sz0 + low[0], n0);
 
-    index_t cc = 0;
-    for(int j = j0; j <= j1; j++)
-        for(int k = i0; k <= i1; k++)
-            cp.row(cc++) = temp.row(j*sz0+k);
-    
     // compute the new vectors for the B-spline patch
-    k1 = gsKnotVector<T>(m_deg[0], m_bases[level]->knots(0).begin() + i0 , 
-                         m_bases[level]->knots(0).begin() + i1 + m_deg[0] + 2);
-    k2 = gsKnotVector<T>(m_deg[1], m_bases[level]->knots(1).begin() + j0 , 
-                         m_bases[level]->knots(1).begin() + j1 + m_deg[1] + 2);
+    k1 = gsKnotVector<T>(m_deg[0], m_bases[level]->knots(0).begin() + low[0] , 
+                         m_bases[level]->knots(0).begin() + upp[0] + m_deg[0] + 2);
+    k2 = gsKnotVector<T>(m_deg[1], m_bases[level]->knots(1).begin() + low[1] , 
+                         m_bases[level]->knots(1).begin() + upp[1] + m_deg[1] + 2);
 }
 
-// returns the list of B-spline patches to represent a THB-spline geometry
 template<short_t d, class T>
-void gsTHBSplineBasis<d,T>::getBsplinePatches(const gsMatrix<T>& geom_coef, gsMatrix<T>& cp,
-                                              gsMatrix<index_t>& b1, gsMatrix<index_t>& b2,
-                                              gsVector<index_t>& level, gsMatrix<index_t>& nvertices) const
-{ 
-    this->m_tree.getBoxes(b1,b2,level); // splitting based on the quadtree
-    int nboxes = level.size();
-    //------------------------------------------------------------------------------------------------------------------------------
-    // iteration on the boxes to call getBsplinePatchGlobal()
-    //------------------------------------------------------------------------------------------------------------------------------
-    gsVector<index_t> p1, p2;
-    p1.resize(this->dim());
-    p2.resize(this->dim());
-    gsMatrix<T> temp1, temp2;
-    gsKnotVector<T> cku, ckv;
-    nvertices.resize(nboxes,this->dim());
-
-    for (int i = 0; i < nboxes; i++)
+void gsTHBSplineBasis<d,T>::_getBsplinePatches(const gsMatrix<T> & geom_coef,
+                                               const gsMatrix<index_t> & b1,
+                                               const gsMatrix<index_t> & b2,
+                                               const gsVector<index_t> & level,
+                                               gsMatrix<T> & cp,
+                                               gsMatrix<index_t> & nvertices,
+                                               std::vector<gsGeometry<T>*> * patches) const
+{
+    const index_t nboxes = level.size();
+    nvertices.resize(nboxes, d);
+    if ( 0 == nboxes )
     {
-        p1 = b1.row(i).transpose();
-        p2 = b2.row(i).transpose();
+        cp.resize(0, geom_coef.cols());
+        return;
+    }
 
-        this->getBsplinePatchGlobal(p1, p2, level[i], geom_coef, temp1, cku, ckv);        
+    // Index ranges and position of the control points of every patch
+    gsMatrix<index_t> lows(d, nboxes), upps(d, nboxes);
+    std::vector<index_t> offset(nboxes + 1, 0);
+    std::vector<bool> needed(level.maxCoeff() + 1, false);
+    gsVector<index_t,d> low, upp;
+    for (index_t i = 0; i != nboxes; ++i)
+    {
+        _patchIndexRange(b1.row(i).transpose(), b2.row(i).transpose(),
+                         level[i], low, upp);
+        lows.col(i) = low;
+        upps.col(i) = upp;
+        nvertices.row(i) = (upp - low).array() + 1;
+        offset[i+1] = offset[i] + nvertices.row(i).prod();
+        needed[level[i]] = true;
+    }
 
-        if (i == 0)
-        {
-            cp = temp1;
-        }
-        else
-        {
-            int cprows = cp.rows();
-            temp2.resize(cp.rows()+temp1.rows(),cp.cols());
+    // The coefficients of each level are computed once, for all
+    // the patches of that level
+    std::vector<gsMatrix<T> > lvlCoefs;
+    globalRefinement(geom_coef, needed.size() - 1, needed, lvlCoefs);
 
-            for (int j = 0; j < cp.rows(); j++)
-            {
-                for (int k = 0; k < cp.cols(); k++)
-                {
-                    temp2(j,k) = cp(j,k);
-                }
-            }
+    if ( patches )
+        patches->resize(nboxes);
+    else
+        cp.resize(offset.back(), geom_coef.cols());
+
+#   pragma omp parallel
+    {
+        gsVector<index_t,d> lo, up;
+        gsMatrix<T> pcp;
+        gsKnotVector<T> k1, k2;
 
-            for (int j = 0; j < temp1.rows(); j++)
+#       pragma omp for schedule(dynamic, 1)
+        for (index_t i = 0; i < nboxes; ++i)
+        {
+            lo = lows.col(i);
+            up = upps.col(i);
+            if ( patches )
             {
-                for (int k = 0; k < temp1.cols(); k++)
-                {
-                    temp2(cprows+j,k) = temp1(j,k);
-                }
+                pcp.resize(offset[i+1] - offset[i], geom_coef.cols());
+                _getBsplinePatch(lo, up, level[i], lvlCoefs[level[i]], pcp, 0, k1, k2);
+                (*patches)[i] = new gsTensorBSpline<2, T>(k1, k2, give(pcp));
             }
-            cp = temp2;
+            else
+                _getBsplinePatch(lo, up, level[i], lvlCoefs[level[i]], cp, offset[i], k1, k2);
         }
-
-        nvertices(i,0) = cku.size()-cku.degree()-1;
-        nvertices(i,1) = ckv.size()-ckv.degree()-1;
     }
 }
 
+// returns the list of B-spline patches to represent a THB-spline geometry
+template<short_t d, class T>
+void gsTHBSplineBasis<d,T>::getBsplinePatches(const gsMatrix<T>& geom_coef, gsMatrix<T>& cp,
+                                              gsMatrix<index_t>& b1, gsMatrix<index_t>& b2,
+                                              gsVector<index_t>& level, gsMatrix<index_t>& nvertices) const
+{ 
+    this->m_tree.getBoxes(b1,b2,level); // splitting based on the quadtree
+    _getBsplinePatches(geom_coef, b1, b2, level, cp, nvertices, NULL);
+}
+
 // returns the list of B-spline patches to represent a THB-spline geometry
 template<short_t d, class T>
 gsMultiPatch<T> gsTHBSplineBasis<d,T>::getBsplinePatchesToMultiPatch(const gsMatrix<T>& geom_coef) const
@@ -517,19 +557,12 @@ gsMultiPatch<T> gsTHBSplineBasis<d,T>::getBsplinePatchesToMultiPatch(const gsMat
     gsVector<index_t> level;
     this->m_tree.getBoxes(b1,b2,level); // splitting based on the quadtree
 
-    const int nboxes = level.size();
-    gsVector<index_t> p1, p2;
-    gsMatrix<T> temp1;
-    gsKnotVector<T> cku, ckv;
-
-    for (int i = 0; i < nboxes; i++) // for all boxes
-    {
-        p1 = b1.row(i).transpose();
-        p2 = b2.row(i).transpose();
-
-        this->getBsplinePatchGlobal(p1, p2, level[i], geom_coef, temp1, cku, ckv);
-        result.addPatch(typename gsTensorBSpline<2, T>::uPtr(new gsTensorBSpline<2, T>(cku, ckv, give(temp1))));
-    }
+    typename gsMultiPatch<T>::PatchContainer patches;
+    gsMatrix<T> cp;
+    gsMatrix<index_t> nvertices;
+    _getBsplinePatches(geom_coef, b1, b2, level, cp, nvertices, &patches);
+    for (size_t i = 0; i != patches.size(); ++i) // for all boxes
+        result.addPatch(typename gsGeometry<T>::uPtr(patches[i]));
 
     return result;
 }
@@ -713,54 +746,8 @@ void gsTHBSplineBasis<d,T>::getBsplinePatches_trimming(
         level[i] = boxes[i][2*d];
     }
     //use getBsplinePatches
-    int nboxes = level.size();
-    //------------------------------------------------------------------------------------------------------------------------------
-    // iteration on the boxes to call getBsplinePatchGlobal()
-    //------------------------------------------------------------------------------------------------------------------------------
-
-    nvertices.resize(nboxes,this->dim());
-
-    for (int i = 0; i < nboxes; i++)
-    {
-        gsMatrix<T> new_cp;
-        gsVector<index_t> p1, p2;
-        gsKnotVector<T> cku, ckv;
-
-        p1 = b1.row(i).transpose();
-        p2 = b2.row(i).transpose();
+    _getBsplinePatches(geom_coef, b1, b2, level, cp, nvertices, NULL);
 
-        this->getBsplinePatchGlobal(p1, p2, level[i], geom_coef, new_cp, cku, ckv);
-
-        if (i == 0)
-        {
-            cp = new_cp;
-        }
-        else
-        {
-            gsMatrix<T> bigger;
-            int cprows = cp.rows();
-            /*cp.conservativeResize( cp.rows() + temp_cp.rows(), Eigen::NoChange );
-              for( int j=cprows; j < cp.rows(); j++ )
-              cp.row(j) = temp2.row(j-cprows);*/
-            bigger.resize(cp.rows()+new_cp.rows(), cp.cols());
-            for(int j=0; j< bigger.rows(); j++)
-            {
-                if(j<cprows)
-                {
-                    bigger.row(j) = cp.row(j);
-                }
-                else
-                {
-                    bigger.row(j) = new_cp.row(j-cprows);
-                }
-            }
-            cp=bigger;
-        }
-
-        nvertices(i,0) = cku.size()-cku.degree()-1;
-        nvertices(i,1) = ckv.size()-ckv.degree()-1;
-
-    }
     // identify holes
     for(size_t l = 0; l < aabb.size();l++) //level
     {
@@ -885,28 +872,13 @@ gsMultiPatch<T> gsTHBSplineBasis<d,T>::getBsplinePatchesToMultiPatch_trimming(
         level[i] = boxes[i][2*d];
     }
     //use getBsplinePatches
+    typename gsMultiPatch<T>::PatchContainer patches;
+    gsMatrix<T> cp;
+    gsMatrix<index_t> nvertices;
+    _getBsplinePatches(geom_coef, b1, b2, level, cp, nvertices, &patches);
+    for (size_t i = 0; i != patches.size(); ++i)
+        result.addPatch(typename gsGeometry<T>::uPtr(patches[i]));
 
-    int nboxes = level.size();
-    //------------------------------------------------------------------------------------------------------------------------------
-    // iteration on the boxes to call getBsplinePatchGlobal()
-    //------------------------------------------------------------------------------------------------------------------------------
-    gsVector<index_t> p1, p2;
-    p1.resize(this->dim());
-    p2.resize(this->dim());
-    gsMatrix<T> temp1;
-    gsKnotVector<T> cku, ckv;
-
-
-    for (int i = 0; i < nboxes; i++)
-    {
-        p1 = b1.row(i).transpose();
-        p2 = b2.row(i).transpose();
-
-        this->getBsplinePatchGlobal(p1, p2, level[i], geom_coef, temp1, cku, ckv);
-        gsTensorBSplineBasis<2, T> tbasis(cku, ckv);
-        result.addPatch(typename gsTensorBSpline<2, T>::uPtr(new gsTensorBSpline<2, T>(tbasis, give(temp1))));
-
-    }
     // identify holes
     for(size_t l = 0; l < aabb.size();l++) //level
     {
@@ -970,16 +942,34 @@ gsMultiPatch<T> gsTHBSplineBasis<d,T>::getBsplinePatchesToMultiPatch_trimming(
 template<short_t d, class T>
 void gsTHBSplineBasis<d,T>::globalRefinement(const gsMatrix<T> & thbCoefs,
                                              int level, gsMatrix<T> & lvlCoefs) const
+{
+    std::vector<bool> needed(level + 1, false);
+    needed[level] = true;
+    std::vector<gsMatrix<T> > coefs;
+    globalRefinement(thbCoefs, level, needed, coefs);
+    lvlCoefs.swap(coefs[level]);
+}
+
+template<short_t d, class T>
+void gsTHBSplineBasis<d,T>::globalRefinement(const gsMatrix<T> & thbCoefs,
+                                             int level,
+                                             const std::vector<bool> & needed,
+                                             std::vector<gsMatrix<T> > & lvlCoefs) const
 {
     const index_t n = thbCoefs.cols();
+    lvlCoefs.clear();
+    lvlCoefs.resize(level + 1);
 
     // Initialize level 0 coefficients
-    lvlCoefs.setZero(m_bases[0]->size(), n);
+    gsMatrix<T> coefs;
+    coefs.setZero(m_bases[0]->size(), n);
     for(cmatIterator it = m_xmatrix[0].begin(); it != m_xmatrix[0].end(); ++it)
     {
         const int hIndex = m_xmatrix_offset[0] + (it - m_xmatrix[0].begin());
-        lvlCoefs.row(*it) = thbCoefs.row(hIndex);
+        coefs.row(*it) = thbCoefs.row(hIndex);
     }
+    if ( needed[0] )
+        lvlCoefs[0] = coefs;
 
     gsKnotVector<T> k1, k2;// fixme: boehm refine needs non-const kv
     std::vector<T> knots_x, knots_y;
@@ -994,21 +984,24 @@ void gsTHBSplineBasis<d,T>::globalRefinement(const gsMatrix<T> & thbCoefs,
         k2.getUniformRefinementKnots(1,knots_y);
 
         // refine direction 0
-        lvlCoefs.resize(m_bases[l-1]->size(0), n * m_bases[l-1]->size(1));
-        gsBoehmRefine(k1, lvlCoefs, m_deg[0], knots_x.begin(), knots_x.end(), false);
+        coefs.resize(m_bases[l-1]->size(0), n * m_bases[l-1]->size(1));
+        gsBoehmRefine(k1, coefs, m_deg[0], knots_x.begin(), knots_x.end(), false);
         
         // refine direction 1
-        lvlCoefs.blockTransposeInPlace(m_bases[l-1]->size(1));
-        gsBoehmRefine(k2, lvlCoefs, m_deg[1], knots_y.begin(), knots_y.end(), false);
-        lvlCoefs.blockTransposeInPlace(m_bases[l]->size(0));
-        lvlCoefs.resize(m_bases[l]->size(), n); //lvlCoefs: control points at level \a l
+        coefs.blockTransposeInPlace(m_bases[l-1]->size(1));
+        gsBoehmRefine(k2, coefs, m_deg[1], knots_y.begin(), knots_y.end(), false);
+        coefs.blockTransposeInPlace(m_bases[l]->size(0));
+        coefs.resize(m_bases[l]->size(), n); //coefs: control points at level \a l
 
         // overwrite with the THB coefficients of level \a l
         for(cmatIterator it = m_xmatrix[l].begin(); it != m_xmatrix[l].end(); ++it)
         {
             const int hIndex = m_xmatrix_offset[l] + (it - m_xmatrix[l].begin());
-            lvlCoefs.row(*it) = thbCoefs.row(hIndex);
+            coefs.row(*it) = thbCoefs.row(hIndex);
         }
+
+        if ( needed[l] )
+            lvlCoefs[l] = coefs;
     }
 }
 
@@ -1039,6 +1032,37 @@ void gsTHBSplineBasis<d,T>::evalSingle_into(index_t i,
     }
 }
 
+template<short_t d, class T>
+void gsTHBSplineBasis<d,T>::truncatedSupport_into(const index_t i,
+                                                  gsMatrix<index_t, d, 2>& result) const
+{
+    this->elementSupport_into(i, result);
+    if (this->m_is_truncated[i] == -1)
+        return;
+
+    // Bounding box of the B-splines of the presentation level
+    const unsigned level = this->levelOf(i);
+    const unsigned plevel = this->m_is_truncated[i];
+    const unsigned shift = plevel - level;
+    const gsSparseVector<T>& coefs = getCoefs(i);
+    gsMatrix<index_t, d, 2> supp(d, 2);
+    result.col(0).setConstant(std::numeric_limits<index_t>::max());
+    result.col(1).setZero();
+    for (typename gsSparseVector<T>::InnerIterator it(coefs); it; ++it)
+    {
+        this->m_bases[plevel]->elementSupport_into(it.index(), supp);
+        result.col(0) = result.col(0).cwiseMin(supp.col(0));
+        result.col(1) = result.col(1).cwiseMax(supp.col(1));
+    }
+
+    // Back to the elements of the level of the function
+    for (short_t k = 0; k != d; ++k)
+    {
+        result(k,0) =  result(k,0) >> shift;
+        result(k,1) = ((result(k,1) - 1) >> shift) + 1;
+    }
+}
+
 template<short_t d, class T>
 void gsTHBSplineBasis<d,T>::deriv2Single_into(index_t i,
                                               const gsMatrix<T>& u,
@@ -1066,76 +1090,245 @@ void gsTHBSplineBasis<d,T>::deriv2Single_into(index_t i,
 template<short_t d, class T>
 void gsTHBSplineBasis<d,T>::eval_into(const gsMatrix<T> & u, gsMatrix<T>& result) const
 {
-    gsMatrix<index_t> indices;
-    gsMatrix<T> res(1, 1);
-    this->active_into(u, indices);
-
-    result.setZero(indices.rows(), u.cols());
-
-    for (index_t i = 0; i < indices.cols(); i++)
-    {
-        for (index_t j = 0; j < indices.rows(); j++)
-        {
-            const index_t index = indices(j, i);
-            if (j != 0 && index == 0)
-                break;
-            
-            evalSingle_into(index, u.col(i), res);
-            result(j, i) = res.value();
-        }
-    }
+    std::vector<gsMatrix<T> > tmp;
+    evalAllDers_into(u, 0, tmp);
+    result.swap(tmp[0]);
 }
 
 
 template<short_t d, class T>
 void gsTHBSplineBasis<d,T>::deriv2_into(const gsMatrix<T>& u, gsMatrix<T>& result)const
 {
-    gsMatrix<index_t> indices;
-    this->active_into(u, indices);
+    std::vector<gsMatrix<T> > tmp;
+    evalAllDers_into(u, 2, tmp);
+    result.swap(tmp[2]);
+}
 
-    static const short_t numDers = (d * (d + 1)) / 2;
-    gsMatrix<T> res(numDers, 1); // result of deriv2Single_into
 
-    result.setZero(indices.rows() * numDers, u.cols());
+template<short_t d, class T>
+void gsTHBSplineBasis<d,T>::deriv_into(const gsMatrix<T>& u, gsMatrix<T>& result) const
+{
+    std::vector<gsMatrix<T> > tmp;
+    evalAllDers_into(u, 1, tmp);
+    result.swap(tmp[1]);
+}
+
 
-    for (int i = 0; i < indices.cols(); i++)
+template<short_t d, class T>
+void gsTHBSplineBasis<d,T>::evalAllDers_into(const gsMatrix<T> & u, int n,
+                                             std::vector<gsMatrix<T> >& result) const
+{
+    const index_t npts = u.cols();
+    updateElements();
+
+    // Find the element of every point
+    std::vector<const elementData*> el(npts);
+    std::vector<int> lvl(npts);
+    index_t cell, sz = 0;
+    for (index_t p = 0; p != npts; ++p)
     {
-        for (int j = 0; j < indices.rows(); j++)
-        {
-            const index_t index = indices(j, i);
-            if (j != 0 && index == 0)
-                break;
+        elementOf(u.col(p), lvl[p], cell);
+        typename std::map<index_t, elementData>::const_iterator it =
+            m_elements[lvl[p]].find(cell);
+        GISMO_ASSERT(it != m_elements[lvl[p]].end(), "Element not found.");
+        el[p] = &it->second;
+        sz = math::max(sz, it->second.actives.rows());
+    }
+
+    result.resize(n+1);
+    for (int k = 0; k <= n; ++k)
+        result[k].setZero(sz * binomial<index_t>(k+d-1, k), npts);
 
-            this->deriv2Single_into(index, u.col(i), res);
+    // Consecutive points on the same element are evaluated at once,
+    // the level-wise B-spline derivatives are mapped by the
+    // element's truncation matrix
+    std::vector<gsMatrix<T> > bVals;
+    for (index_t p = 0; p != npts; )
+    {
+        index_t q = p + 1;
+        while (q != npts && el[q] == el[p]) ++q;
 
-            result.template block<numDers, 1>(j * numDers, i) = res;
+        m_bases[lvl[p]]->evalAllDers_into(u.middleCols(p, q - p), n, bVals);
+        const gsMatrix<T> & trunc = el[p]->trunc;
+        for (int k = 0; k <= n; ++k)
+        {
+            const index_t nd = bVals[k].rows() / trunc.cols();
+            for (index_t j = p; j != q; ++j)
+                result[k].reshapeCol(j, nd, sz).leftCols(trunc.rows()).noalias() =
+                    bVals[k].reshapeCol(j - p, nd, trunc.cols()) * trunc.transpose();
         }
+        p = q;
     }
 }
 
 
 template<short_t d, class T>
-void gsTHBSplineBasis<d,T>::deriv_into(const gsMatrix<T>& u, gsMatrix<T>& result) const
+void gsTHBSplineBasis<d,T>::active_into(const gsMatrix<T> & u,
+                                        gsMatrix<index_t>& result) const
 {
+    updateElements();
+    std::vector<const gsMatrix<index_t>*> act(u.cols());
+    int lvl;
+    index_t cell, sz = 0;
+    for (index_t p = 0; p != u.cols(); ++p)
+    {
+        elementOf(u.col(p), lvl, cell);
+        typename std::map<index_t, elementData>::const_iterator it =
+            m_elements[lvl].find(cell);
+        GISMO_ASSERT(it != m_elements[lvl].end(), "Element not found.");
+        act[p] = &it->second.actives;
+        sz = math::max(sz, act[p]->rows());
+    }
+
+    result.resize(sz, u.cols());
+    for (index_t p = 0; p != u.cols(); ++p)
+    {
+        result.col(p).topRows(act[p]->rows()) = *act[p];
+        result.col(p).bottomRows(sz - act[p]->rows()).setZero();
+    }
+}
+
 
-    gsMatrix<index_t> indices;
-    this->active_into(u, indices);
-    gsMatrix<T> res(d, 1);
+template<short_t d, class T>
+template<class Vec>
+void gsTHBSplineBasis<d,T>::elementOf(const Vec & u, int & lvl, index_t & cell) const
+{
+    // Identify the level of the point, as in gsHTensorBasis::active_into
+    const int maxLevel = this->m_tree.getMaxInsLevel();
+    typename gsHTensorBasis<d,T>::point low;
+    for (short_t i = 0; i != d; ++i)
+        low[i] = m_bases[maxLevel]->knots(i).uFind(u[i]).uIndex();
+    lvl = this->m_tree.levelOf(low, maxLevel);
+
+    cell = 0;
+    for (short_t i = d - 1; i >= 0; --i)
+    {
+        const gsKnotVector<T> & kv = m_bases[lvl]->knots(i);
+        cell = cell * kv.uSize() + kv.uFind(u[i]).uIndex();
+    }
+}
 
-    result.setZero(indices.rows() * d, u.cols());
 
-    for (int i = 0; i < indices.cols(); i++)
+template<short_t d, class T>
+void gsTHBSplineBasis<d,T>::representElements() const
+{
+#   pragma omp critical (gsTHBSplineBasis_elements)
+    if ( !m_elementsValid )
     {
-        for (int j = 0; j < indices.rows(); j++)
+        const int maxLevel = this->m_tree.getMaxInsLevel();
+        m_elements.clear();
+        m_elements.resize(maxLevel + 1);
+
+        // Knot insertion matrices between consecutive levels, per
+        // direction. The inserted knots are taken from the knot vectors
+        // of the levels, which need not differ by one knot per span
+        // (e.g. after increaseMultiplicity or uniformRefine with mul>1).
+        std::vector<std::vector<gsSparseMatrix<T,RowMajor> > > transfer(maxLevel);
+        std::vector<T> knots;
+        for (int k = 0; k < maxLevel; ++k)
         {
+            transfer[k].resize(d);
+            for (short_t i = 0; i != d; ++i)
+            {
+                gsBSplineBasis<T> b1 = m_bases[k]->component(i);
+                b1.knots().symDifference(m_bases[k+1]->knots(i), knots);
+                b1.refine_withTransfer(transfer[k][i], knots);
+            }
+        }
 
-            const unsigned index = indices(j, i);
-            if (j != 0 && index == 0)
-                break;
+        gsMatrix<index_t> bAct, prevAct;
+        gsMatrix<T> refine;
+        std::vector<gsMatrix<T> > local(d);
+        gsMatrix<index_t,d,2> supp;
+        gsVector<index_t,d> low, upp, first, prevFirst, np, str;
+        prevFirst.setZero();
+        int lvl;
+        index_t cell;
+
+        gsHDomainIterator<T,d> domIt(*this);
+        for (; domIt.good(); domIt.next())
+        {
+            const gsVector<T> & center = domIt.centerPoint();
+            elementOf(center, lvl, cell);
+            elementData & el = m_elements[lvl][cell];
+            gsHTensorBasis<d,T>::active_into(center, el.actives);
+            const index_t nAct = el.actives.rows();
+
+            // Going through the levels, every active function is refined
+            // and truncated (its coefficients of the B-splines with
+            // support in the subdomain of the level are set to zero),
+            // until it is represented by the B-splines of the element's
+            // level. Only the B-splines active on the element are needed.
+            for (int k = 0; k <= lvl; ++k)
+            {
+                m_bases[k]->active_into(center, bAct);
+                const index_t nb = bAct.rows();
+                for (short_t i = 0; i != d; ++i)
+                {
+                    first[i] = m_bases[k]->component(i).firstActive(center[i]);
+                    np[i]    = m_bases[k]->degree(i) + 1;
+                    str[i]   = (0 == i ? 1 : str[i-1] * np[i-1]);
+                }
 
-            this->derivSingle_into(index, u.col(i), res);
-            result.template block<d,1>(j * d, i) = res;
+                if (0 == k)
+                    el.trunc.setZero(nAct, nb);
+                else
+                {
+                    // Local refinement matrix, tensor product of the
+                    // rows and columns of the knot insertion matrices
+                    // that belong to the active B-splines
+                    for (short_t i = 0; i != d; ++i)
+                    {
+                        local[i].resize(np[i], np[i]);
+                        for (index_t r = 0; r != np[i]; ++r)
+                            for (index_t c = 0; c != np[i]; ++c)
+                                local[i](r,c) = transfer[k-1][i].coeff(first[i] + r,
+                                                                       prevFirst[i] + c);
+                    }
+                    refine.resize(nb, nb);
+                    for (index_t r = 0; r != nb; ++r)
+                        for (index_t c = 0; c != nb; ++c)
+                        {
+                            T val = 1;
+                            for (short_t i = 0; i != d; ++i)
+                                val *= local[i]( (r / str[i]) % np[i], (c / str[i]) % np[i] );
+                            refine(r,c) = val;
+                        }
+                    el.trunc = el.trunc * refine.transpose();
+
+                    for (index_t i = 0; i != nb; ++i)
+                    {
+                        m_bases[k]->elementSupport_into(bAct.at(i), supp);
+                        low = supp.col(0);
+                        upp = supp.col(1);
+                        if ( this->m_tree.query3(low, upp, k) >= k )
+                            el.trunc.col(i).setZero();
+                    }
+                }
+
+                // functions of level k start with a unit coefficient
+                for (index_t j = 0; j != nAct; ++j)
+                {
+                    if ( static_cast<int>(this->levelOf(el.actives.at(j))) != k )
+                        continue;
+                    const index_t ti = this->flatTensorIndexOf(el.actives.at(j), k);
+                    for (index_t i = 0; i != nb; ++i)
+                        if ( bAct.at(i) == ti )
+                        {
+                            el.trunc(j,i) = 1;
+                            break;
+                        }
+                }
+
+                bAct.swap(prevAct);
+                prevFirst = first;
+            }
         }
+
+        // Publish the element data before the flag, see updateElements()
+#       pragma omp flush
+#       pragma omp atomic write
+        m_elementsValid = true;
     }
 }
 
@@ -1505,42 +1698,13 @@ template<short_t d, class T>
 void gsTHBSplineBasis<d,T>::transferbyLvl (std::vector<gsSparseMatrix<T> >& result)
 {
     result.clear();
-    gsVector<index_t> level;
-    gsMatrix<index_t> b1, b2;//boxes in highes level numbering
-    this->m_tree.getBoxesInLevelIndex(b1,b2,level);//return boxes in level indices
-    tensorBasis T_0_copy = this->tensorLevel(0);
-    std::vector< gsSparseMatrix<T,RowMajor> > transfer;
-    transfer.resize(this->maxLevel() );
-    std::vector<std::vector<T> > knots(d);
-
-    for(unsigned i = 0; i < this->maxLevel(); ++i)
-    {
-        //T_0_copy.uniformRefine_withTransfer(transfer[i], 1);
-        for(short_t dim = 0; dim < d; dim++)
-        {
-            const gsKnotVector<T> & ckv = m_bases[i]->knots(dim);
-            const gsKnotVector<T> & fkv = m_bases[i + 1]->knots(dim);
-            ckv.symDifference(fkv, knots[dim]);
-
-            //gsDebug << "level: " << i << "\n"
-            //        << "direction: " << dim << "\n"
-            //        << "dirknots:\n"<<gsAsMatrix<T>(dirKnots)<<std::endl;
-        }
-        T_0_copy.refine_withTransfer(transfer[i], knots);
-
-        // Must use refine_withTransfer(gsSparseMatrix<T,RowMajor> & transfer, const std::vector<T>& knots)
-        // must correctly find the knots to insert
-        // T_0_copy.uniformRefine_withTransfer(transfer[i], 1);
-    }
-    std::vector< gsSparseMatrix<T,RowMajor> > temp_transf;
     for(unsigned j = 0; j < this->maxLevel(); ++j)
     {
         std::vector<CMatrix> x_mat_old_0, x_matrix_lvl;
         this->setActiveToLvl(j,x_mat_old_0);
         this->setActiveToLvl(j+1,x_matrix_lvl);
-        temp_transf.push_back(transfer[j]);
 
-        gsSparseMatrix<T> crs = this->coarsening_direct(x_mat_old_0, x_matrix_lvl, temp_transf);
+        gsSparseMatrix<T> crs = this->coarsening_direct(x_mat_old_0, x_matrix_lvl);
         result.push_back(crs);
     }
 }
@@ -1792,221 +1956,179 @@ gsSparseMatrix<T> gsTHBSplineBasis<d,T>::coarsening_direct2( const std::vector<g
 
 template<short_t d, class T>
 gsSparseMatrix<T> gsTHBSplineBasis<d,T>::coarsening_direct( const std::vector<gsSortedVector<index_t> >& old,
-                                                      const std::vector<gsSortedVector<index_t> >& n,
-                                                      const std::vector<gsSparseMatrix<T,RowMajor> >& transfer) const
+                                                      const std::vector<gsSortedVector<index_t> >& n) const
 {
     GISMO_ASSERT(old.size() < n.size(), "old,n problem in coarsening.");
 
-    int size1= 0;int size2 = 0;
-    int glob_numb = 0;//continous numbering of hierarchical basis
-    for(unsigned int i =0; i< old.size();i++)
-    {//count the number of basis functions in old basis
-        size1 += old[i].size();
-    }
-    for(unsigned int i =0; i< n.size();i++)
-    {//count the number of basis functions in new basis
-        size2 += n[i].size();
-    }
-    gsSparseMatrix<T> result(size2,size1);
+    // Offsets of the levels in the continuous numbering of the old
+    // and the new hierarchical basis
+    std::vector<index_t> oldOffset(old.size()+1, 0), nOffset(n.size()+1, 0);
+    for (size_t i = 0; i != old.size(); ++i)
+        oldOffset[i+1] = oldOffset[i] + old[i].size();
+    for (size_t i = 0; i != n.size(); ++i)
+        nOffset[i+1] = nOffset[i] + n[i].size();
+
+    // Univariate level-to-level refinement matrices, the level
+    // transfers are their Kronecker products
+    const size_t nLevels = n.size() - 1;
+    std::vector<std::vector<gsSparseMatrix<T> > > tr1d(nLevels,
+                                                       std::vector<gsSparseMatrix<T> >(d));
+    std::vector<T> knots;
+    gsSparseMatrix<T,RowMajor> tmp;
+    for (size_t l = 0; l != nLevels; ++l)
+        for (short_t k = 0; k != d; ++k)
+        {
+            gsBSplineBasis<T> b1 = m_bases[l]->component(k);
+            b1.knots().symDifference(m_bases[l+1]->knots(k), knots);
+            b1.refine_withTransfer(tmp, knots);
+            tr1d[l][k] = tmp;
+        }
 
+    gsSparseEntries<T> entries;
 
-//    std::vector<gsMatrix<T> > transferDense;// = transfer;
-//    transferDense.resize(transfer.size());
-//    for (unsigned int i = 0; i < transfer.size();i++)
-//    {
-//        transferDense[i] = transfer[i];
-//    }
-    std::vector<gsSparseMatrix<T,ColMajor> > temptransfer;// = transfer;
-    temptransfer.resize(transfer.size());
-    for (unsigned int i = 0; i < transfer.size();i++)
+#   pragma omp parallel
     {
-        temptransfer[i] = transfer[i];
-    }
-    //gsDebug<<"temp:\n"<< temptransfer[0]<<std::endl;
+        gsSparseEntries<T> myEntries;
+        std::vector<T> coefs, buf;
+        gsVector<index_t,d> low, size, stride, a, lo, hi;
+        gsMatrix<index_t, d, 2> supp(d, 2);
+        typename CMatrix::const_iterator it;
 
-    for (unsigned int i = 0; i < old.size(); i++)//iteration through the levels of the old basis
-    {
-        // find starting index of level i in new basis
-        int start_lv_i = 0;
-        for(unsigned int l =0; l < i; l++)
+        for (size_t i = 0; i != old.size(); ++i)//iteration through the levels of the old basis
         {
-            start_lv_i += n[l].size();
-        }
-
-        for (unsigned int j = 0; j < old[i].size();j++)//iteration through the basis functions in the given level
-        {
-            //gsDebug<<"j...."<<j<<endl;
-            //gsDebug<<"i = "<< i<< " j= "<<j<<std::endl;
-            start_lv_i = 0;
-            for(unsigned int l =0; l < i; l++)
+            const index_t nOld = old[i].size();
+#           pragma omp for schedule(dynamic, 64)
+            for (index_t j = 0; j < nOld; ++j)
             {
-                start_lv_i += n[l].size();
-            }
-            const unsigned old_ij = old[i][j];  // tensor product index
-            //gsDebug<<"oldij = "<< old_ij<<std::endl;
-            if( n[i].bContains(old_ij) )//it he basis function was not refined
-            {
-                result(start_lv_i + std::distance(n[i].begin(), n[i].find_it_or_fail(old_ij) ),glob_numb ) = 1;//settign the coefficient of the not refined basis function to 1
-                std::vector<lvl_coef> coeffs;
-                gsMatrix<index_t, d, 2> supp(d, 2);
-                this->m_bases[i]->elementSupport_into(old_ij, supp);//this->support(start_lv_i+old_ij);
-                unsigned max_lvl = math::min<index_t>( this->m_tree.query4(supp.col(0),supp.col(1), i), transfer.size()) ;//transfer.size();//
-                //gsDebug<<"transfer size "<< transfer.size()<<" max lvl"<< this->m_tree.query4(supp.col(0),supp.col(1), this->levelOf(start_lv_i+j))<<"   lvl of"<< this->levelOf(start_lv_i+j)<<" support\n"<<supp<<std::endl;
-                lvl_coef temp;
-                temp.pos = old_ij;
-                temp.coef = 1;
-                temp.lvl = i;
-                if(temp.lvl<n.size()-1)//in case of no refinement
+                const index_t old_ij = old[i][j];  // tensor product index
+                const index_t col    = oldOffset[i] + j;
+
+                it = std::lower_bound(n[i].begin(), n[i].end(), old_ij);
+                if ( it != n[i].end() && *it == old_ij )//the basis function was not refined
+                    myEntries.add(nOffset[i] + (it - n[i].begin()), col, 1);
+
+                // Finer levels do not contribute beyond the finest
+                // level present in the support of the function
+                m_bases[i]->elementSupport_into(old_ij, supp);
+                const size_t max_lvl = math::min<size_t>(
+                    this->m_tree.query4(supp.col(0),supp.col(1), i), nLevels );
+
+                // Refine the (truncated) function level by level. The
+                // coefficients of the new basis functions are the
+                // B-spline coefficients at their level, the parts which
+                // were truncated in the old basis are discarded
+                low = m_bases[i]->tensorIndex(old_ij);
+                size.setOnes();
+                coefs.assign(1, (T)1);
+                for (size_t lvl = i; lvl < max_lvl; ++lvl)
                 {
-                    coeffs.push_back(temp);
-                }
-                for (size_t coeff_index = 0; coeff_index < coeffs.size(); ++coeff_index)
-                {
-                    const lvl_coef coeff = coeffs[coeff_index];
-
-                    start_lv_i = 0;
-                    for(unsigned int l =0; l < coeff.lvl; l++)
-                    {
-                        start_lv_i += n[l].size();
-                    }
-
-                    for(typename gsSparseMatrix<T,ColMajor>::InnerIterator k(temptransfer[coeff.lvl],coeff.pos); k; ++k)//basis function was refined->looking for the coeficinets from the global transfer matrix
+                    _refineBox(tr1d[lvl], low, size, coefs, buf);
+
+                    const tensorBasis & fine = *m_bases[lvl+1];
+                    stride[0] = 1;
+                    for (short_t k = 1; k != d; ++k)
+                        stride[k] = stride[k-1] * fine.size(k-1);
+
+                    const CMatrix & nLvl = n[lvl+1];
+                    const bool truncated = lvl+1 < old.size();
+                    lo = size;
+                    hi.setConstant(-1);
+                    a.setZero();
+                    for (size_t f = 0; f != coefs.size(); ++f)
                     {
-//                        if(transferDense[coeff.lvl](k, coeff.pos) != 0)
-//                        {
-                        //gsDebug<<"first while "<< coeffs.size()<<std::endl;
-                        bool p = true;
-                        if( (coeff.lvl+1) < old.size())
+                        if ( 0 != coefs[f] )
                         {
-                            if(old[coeff.lvl+1].bContains(k.row()))
+                            const index_t gi = (low + a).dot(stride);
+                            if ( truncated && old[lvl+1].bContains(gi) )
+                                coefs[f] = 0;
+                            else
                             {
-                                p = false;
+                                it = std::lower_bound(nLvl.begin(), nLvl.end(), gi);
+                                if ( it != nLvl.end() && *it == gi )
+                                    myEntries.add(nOffset[lvl+1] + (it - nLvl.begin()), col, coefs[f]);
+                                lo = lo.cwiseMin(a);
+                                hi = hi.cwiseMax(a);
                             }
                         }
-                        if(n[coeff.lvl+1].bContains(k.row()))
-                        {
-                            if(p)
-                            {
-                                const int pos = start_lv_i + n[coeff.lvl].size() + std::distance(n[coeff.lvl+1].begin(), n[coeff.lvl+1].find_it_or_fail(k.row()));
-
-                                result(pos,glob_numb) += coeff.coef * temptransfer[coeff.lvl](k.row(), coeff.pos);//transferDense[coeff.lvl](k, coeff.pos);
-                                if(coeff.lvl + 1 < max_lvl)//transfer.size()
-                                {
-                                    temp.pos = k.row();
-                                    temp.coef = temptransfer[coeff.lvl](k.row(), coeff.pos) * coeff.coef;
-                                    temp.lvl = coeff.lvl+1;
-                                    coeffs.push_back(temp);
-                                }
-                            }
-                        }else
-                        {
-                            //TODO test if level would not be higher than the q4 for this function- or max inserted level
-                            if(p)
-                            {
-                                if( coeff.lvl + 1< max_lvl)
-                                {
-                                    temp.pos = k.row();
-                                    temp.coef = temptransfer[coeff.lvl](k.row(), coeff.pos) * coeff.coef;
-                                    temp.lvl = coeff.lvl+1;
-                                    coeffs.push_back(temp);
-                                }
-                            }
-                        }
-                        //}
-                    }
-
-//                        for(unsigned int ii = 0; ii < coeffs.size();ii++){
-//                            gsDebug<<"( "<< coeffs[ii].pos<<" , "<<coeffs[ii].coef<<" , "<<coeffs[ii].lvl<<" )"<<std::endl;
-//                        }
-//                        gsDebug<<"j ="<<j<<std::endl;
-                }
-            }
-            else
-            {
-                gsMatrix<index_t, d, 2> supp(d, 2);
-                this->m_bases[i]->elementSupport_into(old_ij, supp);//this->support(start_lv_i+old_ij);
-                //gsDebug<<"supp "<< supp<<std::endl;
-                unsigned max_lvl =
-                    math::min<index_t>( this->m_tree.query4(supp.col(0),supp.col(1), i), transfer.size() ) ;
-                std::vector<lvl_coef> coeffs;
-                lvl_coef temp;
-                temp.pos = old_ij;
-                temp.coef = 1;
-                temp.lvl = i;
-                //gsDebug<<"temp.pos: "<<temp.pos<<" temp.coef: "<<temp.coef<<" temp.lvl "<< temp.lvl<<std::endl;
-                coeffs.push_back(temp);
-                for (size_t coeff_index = 0; coeff_index < coeffs.size(); ++coeff_index)
-                {
-                    const lvl_coef coeff = coeffs[coeff_index];
 
-                    start_lv_i = 0;
-                    for(unsigned int l =0; l < coeff.lvl; l++)
-                    {
-                        start_lv_i += n[l].size();
+                        for (short_t k = 0; k != d && ++a[k] == size[k]; ++k)
+                            a[k] = 0;
                     }
 
-                    for(typename gsSparseMatrix<T,ColMajor>::InnerIterator k(temptransfer[coeff.lvl],coeff.pos); k; ++k)//basis function was refined->looking for the coeficinets from the global transfer matrix
+                    if ( (hi.array() < 0).any() ) break; // nothing left
+
+                    // Shrink the box to the remaining coefficients
+                    if ( lo != gsVector<index_t,d>::Zero(d) || hi + gsVector<index_t,d>::Ones(d) != size )
                     {
-                        //if(transferDense[coeff.lvl](k, coeff.pos) != 0)
-                        //{
-                        //gsDebug<<"second while "<< coeffs.size()<<std::endl;
-                        bool p = true;
-                        if( (coeff.lvl+1) < (old.size()))
-                        {
-                            if(old[coeff.lvl+1].bContains(k.row()))
-                            {
-                                p = false;
-                            }
-                        }
-                        //gsDebug<<"k.row "<<k.row()<<std::endl;
-                        if(n[coeff.lvl+1].bContains(k.row()))
+                        const gsVector<index_t,d> nsize = hi - lo + gsVector<index_t,d>::Ones(d);
+                        buf.resize( nsize.prod() );
+                        a.setZero();
+                        for (size_t f = 0; f != buf.size(); ++f)
                         {
-                            if(p)
-                            {
-                                const int pos = start_lv_i + n[coeff.lvl].size() + std::distance(n[coeff.lvl+1].begin(), n[coeff.lvl+1].find_it_or_fail(k.row()));
-                                //T ppp =  transferDense[coeff.lvl](k, coeff.pos);
-                                //gsDebug<<"pos "<<pos<<" oldij "<<old_ij<<" "<< "coeflvl "<<coeff.lvl<<" ";
-                                //gsDebug<<"inserted coef "<< coeff.coef<<"*"<< temptransfer[coeff.lvl](k.row(), coeff.pos)<<std::endl;
-                                result(pos,glob_numb) += coeff.coef * temptransfer[coeff.lvl](k.row(), coeff.pos);//transferDense[coeff.lvl](k, coeff.pos);
-                                if(coeff.lvl < max_lvl-1)
-                                {
-                                    temp.pos = k.row();
-                                    temp.coef = temptransfer[coeff.lvl](k.row(), coeff.pos) * coeff.coef;
-                                    temp.lvl = coeff.lvl+1;
-                                    //gsDebug<<"temp.pos: "<<temp.pos<<" temp.coef: "<<temp.coef<<" temp.lvl "<< temp.lvl<<std::endl;
-                                    coeffs.push_back(temp);
-                                }
-                            }
-                        }
-                        else
-                        {
-                            if(p)
-                            {
-                                if(coeff.lvl < max_lvl-1)
-                                {
-                                    temp.pos = k.row();
-                                    temp.coef = temptransfer[coeff.lvl](k.row(), coeff.pos) * coeff.coef;
-                                    temp.lvl = coeff.lvl+1;
-                                    //gsDebug<<"temp.pos: "<<temp.pos<<" temp.coef: "<<temp.coef<<" temp.lvl "<< temp.lvl<<std::endl;
-                                    coeffs.push_back(temp);
-                                }
-                            }
+                            index_t src = 0;
+                            for (short_t k = d-1; k >= 0; --k)
+                                src = src * size[k] + lo[k] + a[k];
+                            buf[f] = coefs[src];
+                            for (short_t k = 0; k != d && ++a[k] == nsize[k]; ++k)
+                                a[k] = 0;
                         }
-                        //}
+                        coefs.swap(buf);
+                        low += lo;
+                        size = nsize;
                     }
-
-//                        for(unsigned int ii = 0; ii < coeffs.size();ii++){
-//                            gsDebug<<"( "<< coeffs[ii].pos<<" , "<<coeffs[ii].coef<<" , "<<coeffs[ii].lvl<<" )"<<std::endl;
-//                        }
                 }
             }
-            glob_numb++;
-
         }
+
+#       pragma omp critical (gsTHBSplineBasis_coarsening)
+        entries.insert(entries.end(), myEntries.begin(), myEntries.end());
     }
+
+    gsSparseMatrix<T> result(nOffset.back(), oldOffset.back());
+    result.setFrom(entries);
+    result.makeCompressed();
     return result;
 }
 
+template<short_t d, class T>
+void gsTHBSplineBasis<d,T>::_refineBox(const std::vector<gsSparseMatrix<T> > & tr,
+                                       gsVector<index_t,d> & low, gsVector<index_t,d> & size,
+                                       std::vector<T> & coefs, std::vector<T> & tmp)
+{
+    typedef typename gsSparseMatrix<T>::InnerIterator iter;
+    index_t pre = 1, post = size.prod();
+    for (short_t k = 0; k != d; ++k)
+    {
+        post /= size[k];
+
+        // The univariate transfer is banded, so the refined box is
+        // spanned by the first and the last column of the box
+        const index_t nlow  = iter(tr[k], low[k]).row();
+        index_t nupp = nlow;
+        for (iter t(tr[k], low[k] + size[k] - 1); t; ++t)
+            nupp = t.row();
+        const index_t nsize = nupp - nlow + 1;
+
+        tmp.assign(pre * nsize * post, (T)0);
+        for (index_t p = 0; p != post; ++p)
+            for (index_t c = 0; c != size[k]; ++c)
+            {
+                const T * src = &coefs[pre * (c + size[k] * p)];
+                for (iter t(tr[k], low[k] + c); t; ++t)
+                {
+                    T * dst = &tmp[pre * (t.row() - nlow + nsize * p)];
+                    const T v = t.value();
+                    for (index_t q = 0; q != pre; ++q)
+                        dst[q] += v * src[q];
+                }
+            }
+
+        coefs.swap(tmp);
+        low [k] = nlow;
+        size[k] = nsize;
+        pre *= nsize;
+    }
+}
 
 namespace internal
 {
@@ -91,7 +91,7 @@ public:
     void applySmoothing(T lambda, gsSparseMatrix<T> & A_mat);
     
     /// Assembles system for the least square fit.
-    void assembleSystem(gsSparseMatrix<T>& A_mat, gsMatrix<T>& B);
+    virtual void assembleSystem(gsSparseMatrix<T>& A_mat, gsMatrix<T>& B);
 
 
 public:
@@ -133,6 +133,26 @@ private:
 
 protected:
 
+    /// Adds to \a A_mat and \a B the least squares terms of the
+    /// \a numPoints points with indices \a points, or of the first
+    /// \a numPoints points if \a points is NULL. If \a marked is not
+    /// empty, only the terms that involve at least one marked basis
+    /// function are added. The points are processed in parallel. Each
+    /// thread sums up the terms of consecutive points with the same
+    /// active functions and stores them as triplets, which are added to
+    /// \a A_mat at once. Hence, the memory used is small if
+    /// neighbouring points are stored next to each other.
+    void assemblePoints(index_t numPoints, const index_t * points,
+                        const std::vector<bool> & marked,
+                        gsSparseMatrix<T>& A_mat, gsMatrix<T>& B) const;
+
+    /// Appends to \a entries the terms \a elA among the functions
+    /// \a actives, skipping the pairs without a marked function
+    static void addEntries(const gsMatrix<index_t> & actives,
+                           const gsMatrix<T> & elA,
+                           const std::vector<bool> & marked,
+                           gsSparseEntries<T> & entries);
+
     /// the parameter values of the point cloud
     gsMatrix<T> m_param_values;
 
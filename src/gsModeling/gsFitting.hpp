@@ -44,25 +44,28 @@ gsFitting<T>::  gsFitting(gsMatrix<T> const & param_values,
 template<class T>
 void gsFitting<T>::compute(T lambda)
 {
-    // Wipe out previous result
-    if ( m_result )
-        delete m_result;
-
     const int num_basis=m_basis->size();
     const short_t dimension=m_points.cols();
 
+    // The previous result is used as initial guess, provided that it
+    // is expressed in the current basis (e.g. after refinement)
+    gsMatrix<T> x0;
+    if ( m_result )
+    {
+        if ( m_result->coefs().rows() == num_basis &&
+             m_result->coefs().cols() == dimension )
+            x0.swap( m_result->coefs() );
+
+        // Wipe out previous result
+        delete m_result;
+        m_result = NULL;
+    }
+
     //left side matrix
     //gsMatrix<T> A_mat(num_basis,num_basis);
     gsSparseMatrix<T> A_mat(num_basis + m_constraintsLHS.rows(), num_basis + m_constraintsLHS.rows());
     //gsMatrix<T>A_mat(num_basis,num_basis);
-    //To optimize sparse matrix an estimation of nonzero elements per
-    //column can be given here
-    int nonZerosPerCol = 1;
-    for (int i = 0; i < m_basis->dim(); ++i) // to do: improve
-        // nonZerosPerCol *= m_basis->degree(i) + 1;
-        nonZerosPerCol *= ( 2 * m_basis->degree(i) + 1 ) * 4;
-    // TODO: improve by taking constraints nonzeros into account.
-    A_mat.reservePerColumn( nonZerosPerCol );
+    // The entries are collected as triplets, see assemblePoints()
 
     //right side vector (more dimensional!)
     gsMatrix<T> m_B(num_basis + m_constraintsRHS.rows(), dimension);
@@ -97,7 +100,15 @@ void gsFitting<T>::compute(T lambda)
     }
     // Solves for many right hand side  columns
     gsMatrix<T> x;
-    x = solver.solve(m_B); //toDense()
+    if ( 0 != x0.size() )
+    {
+        // The Lagrange multipliers of the constraints start from zero
+        x0.conservativeResize(m_B.rows(), Eigen::NoChange);
+        x0.bottomRows(m_B.rows() - num_basis).setZero();
+        x = solver.solveWithGuess(m_B, x0);
+    }
+    else
+        x = solver.solve(m_B); //toDense()
 
     // If there were constraints, we obtained too many coefficients.
     x.conservativeResize(num_basis, Eigen::NoChange);
@@ -114,32 +125,96 @@ template <class T>
 void gsFitting<T>::assembleSystem(gsSparseMatrix<T>& A_mat,
                                   gsMatrix<T>& m_B)
 {
-    const int num_points = m_points.rows();
-
-    //for computing the value of the basis function
-    gsMatrix<T> value, curr_point;
-    gsMatrix<index_t> actives;
-
-    for(index_t k = 0; k != num_points; ++k)
-    {
-        curr_point = m_param_values.col(k);
+    assemblePoints(m_points.rows(), NULL, std::vector<bool>(), A_mat, m_B);
+}
 
-        //computing the values of the basis functions at the current point
-        m_basis->eval_into(curr_point, value);
+template <class T>
+void gsFitting<T>::assemblePoints(const index_t numPoints,
+                                  const index_t * points,
+                                  const std::vector<bool> & marked,
+                                  gsSparseMatrix<T>& A_mat,
+                                  gsMatrix<T>& m_B) const
+{
+    if ( 0 == numPoints )
+        return;
 
-        // which functions have been computed i.e. which are active
-        m_basis->active_into(curr_point, actives);
+    const bool all = marked.empty();
+    gsSparseEntries<T> entries;
 
-        const index_t numActive = actives.rows();
+#   pragma omp parallel
+    {
+        // Thread-local terms, merged at the end
+        gsSparseEntries<T> localEntries;
+        gsMatrix<T> localB;
+        localB.setZero(m_B.rows(), m_B.cols());
+
+        //for computing the value of the basis function
+        gsMatrix<T> value, curr_point, elA;
+        gsMatrix<index_t> actives, elActives;
+
+        // Consecutive points with the same active functions are summed
+        // up in elA, which is stored as entries when the active
+        // functions change
+#       pragma omp for schedule(static)
+        for(index_t p = 0; p < numPoints; ++p)
+        {
+            const index_t k = points ? points[p] : p;
+            curr_point = m_param_values.col(k);
+
+            //computing the values of the basis functions at the current point
+            m_basis->eval_into(curr_point, value);
+
+            // which functions have been computed i.e. which are active
+            m_basis->active_into(curr_point, actives);
+
+            const index_t numActive = actives.rows();
+            if ( elActives.rows() != numActive || elActives != actives )
+            {
+                addEntries(elActives, elA, marked, localEntries);
+                elActives = actives;
+                elA.setZero(numActive, numActive);
+            }
+            elA.noalias() += value * value.transpose();
+
+            for (index_t i = 0; i != numActive; ++i)
+            {
+                const index_t ii = actives.at(i);
+                if ( all || marked[ii] )
+                    localB.row(ii) += value.at(i) * m_points.row(k);
+            }
+        }
+        addEntries(elActives, elA, marked, localEntries);
 
-        for (index_t i = 0; i != numActive; ++i)
+#       pragma omp critical (gsFitting_assemblePoints)
         {
-            const index_t ii = actives.at(i);
-            m_B.row(ii) += value.at(i) * m_points.row(k);
-            for (index_t j = 0; j != numActive; ++j)
-                A_mat(ii, actives.at(j)) += value.at(i) * value.at(j);
+            entries.insert(entries.end(), localEntries.begin(), localEntries.end());
+            m_B += localB;
         }
     }
+
+    gsSparseMatrix<T> terms(A_mat.rows(), A_mat.cols());
+    terms.setFrom(entries);
+    if ( 0 == A_mat.nonZeros() )
+        A_mat.swap(terms);
+    else
+        A_mat += terms;
+}
+
+template <class T>
+void gsFitting<T>::addEntries(const gsMatrix<index_t> & actives,
+                              const gsMatrix<T> & elA,
+                              const std::vector<bool> & marked,
+                              gsSparseEntries<T> & entries)
+{
+    const bool all = marked.empty();
+    const index_t numActive = actives.rows();
+    for (index_t i = 0; i != numActive; ++i)
+    {
+        const bool mi = all || marked[actives.at(i)];
+        for (index_t j = 0; j != numActive; ++j)
+            if ( mi || marked[actives.at(j)] )
+                entries.add(actives.at(i), actives.at(j), elA(i,j));
+    }
 }
 
 template <class T>
@@ -237,6 +237,15 @@ public:
         return gsSerialStatus();
     }
 
+    /**
+       @brief Returns a pointer to the internal request object
+    */
+    MPI_Request* operator& ()
+    {
+        static MPI_Request req(0);
+        return &req;
+    }
+
     /**
        @brief Returns a constant pointer to the internal request object
     */
@@ -351,6 +360,16 @@ public:
         return 0;
     }
 
+    /** @brief Compute the sum over all processes for each component
+        of an array and return the result in every process
+        (non-blocking). The request is completed on return.
+    */
+    template<typename T>
+    static int isum (T* inout, int len, MPI_Request* req)
+    {
+        return 0;
+    }
+
     /** @brief Compute the product of the argument over all processes
         and return the result in every process. Assumes that T has an
         operator*
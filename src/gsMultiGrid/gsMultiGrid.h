@@ -41,6 +41,27 @@ namespace gismo
     extremely efficient. It should however be considered
     experimental since the theory is not well understood at this point.
 
+    \par Performance
+
+    The vectors needed for the cycles (residuals and corrections on
+    every level) are allocated once and reused by all cycles. Thus,
+    apply() and step() are not reentrant: a gsMultiGridOp must not be
+    applied by several threads at once, and in particular it must not
+    be used as a local operator of a gsAdditiveOp that computes the
+    subspace corrections concurrently.
+
+    If the multigrid solver computes the coarse matrices from the fine
+    matrix, it keeps the product of the restriction and the stiffness
+    matrix for every coarse level, which is obtained anyway when
+    computing the Galerkin product. Then the residual is never formed on the fine grid: the
+    restricted residual is computed in one (multi-threaded) sweep over
+    the rows of the coarse grid. Likewise, the prolongation of the
+    correction and its addition to the iterate are done in one sweep.
+    The transfer operators themselves are applied as row-major sparse
+    matrices, see gsMatrixOp.
+
+    The time spent on every level is accumulated, see timings().
+
     \ingroup Solver
 */
 
@@ -93,6 +114,14 @@ public:
     ///                                  defaulted to a direct solver (PartialPivLUSolver)
     gsMultiGridOp( SpMatrixPtr fineMatrix, std::vector< SpMatrixRowMajorPtr > transferMatrices, OpPtr coarseSolver = OpPtr() );
 
+    /// @brief Constructor for a given hierarchy of matrices
+    ///
+    /// @param matrices                  Stiffness matrices (as smart pointers) on all levels, starting with the coarsest one
+    /// @param transferMatrices          Intergrid transfer matrices representing restriction and prolongation operators
+    /// @param coarseSolver              Linear operator representing the exact solver on the coarsest grid level,
+    ///                                  defaulted to a direct solver (PartialPivLUSolver)
+    gsMultiGridOp( const std::vector< SpMatrixPtr >& matrices, std::vector< SpMatrixRowMajorPtr > transferMatrices, OpPtr coarseSolver = OpPtr() );
+
     /// @brief Constructor for a matix-free variant
     ///
     /// @param ops                       Linear operators representing the stiffness matrix on all levels
@@ -120,6 +149,15 @@ public:
     static uPtr make( SpMatrixPtr fineMatrix, std::vector< SpMatrixRowMajorPtr > transferMatrices, OpPtr coarseSolver = OpPtr() )
         { return uPtr( new gsMultiGridOp( give(fineMatrix), give(transferMatrices), give(coarseSolver) ) ); }
 
+    /// Make function returning smart pointer for a given hierarchy of matrices
+    ///
+    /// @param matrices                  Stiffness matrices (as smart pointers) on all levels, starting with the coarsest one
+    /// @param transferMatrices          Intergrid transfer matrices representing restriction and prolongation operators
+    /// @param coarseSolver              Linear operator representing the exact solver on the coarsest grid level,
+    ///                                  defaulted to a direct solver (PartialPivLUSolver)
+    static uPtr make( const std::vector< SpMatrixPtr >& matrices, std::vector< SpMatrixRowMajorPtr > transferMatrices, OpPtr coarseSolver = OpPtr() )
+        { return uPtr( new gsMultiGridOp( matrices, give(transferMatrices), give(coarseSolver) ) ); }
+
     /// Make function returning a shared pointer for a matix-free variant
     ///
     /// @param ops                       Linear operators representing the stiffness matrix on all levels
@@ -134,6 +172,16 @@ private:
     // Init function that is used by matrix based constructors
     void init( SpMatrixPtr fineMatrix, std::vector< SpMatrixRowMajorPtr > transferMatrices, OpPtr coarseSolver );
     void initCoarseSolver();
+    // Sets up the transfer operators from the prolongation matrices
+    void initTransfer( std::vector< SpMatrixRowMajorPtr > transferMatrices );
+    // Allocates the vectors used by the cycles
+    void initWorkspace();
+
+    // Computes the residual on level lf and restricts it to the next coarser level
+    void restrictResidual(index_t lf, const gsMatrix<T>& rhs, const gsMatrix<T>& x, gsMatrix<T>& coarse) const;
+
+    // Prolongs the correction from level lc to the next finer level and subtracts it from x
+    void applyCorrection(index_t lc, const gsMatrix<T>& coarse, gsMatrix<T>& x) const;
 public:
 
     /// Apply smoothing step
@@ -188,6 +236,9 @@ public:
     {
         GISMO_ASSERT ( lvl >= 0 && lvl < n_levels, "The given level is not feasible." );
         m_ops[lvl] = op;
+        // The product with the restriction is outdated now
+        if ( lvl > 0 && m_restrictedOps.size() >= (size_t)lvl )
+            m_restrictedOps[lvl-1].reset();
     }
 
     const SpMatrix& matrix(index_t lvl) const;                                  ///< Stiffness matrix for given level.
@@ -215,6 +266,22 @@ public:
     static gsOptionList defaultOptions();                                       ///< Returns a list of default options
     virtual void setOptions(const gsOptionList & opt);                          ///< Set the options based on a gsOptionList
 
+    /// @brief Time spent on every level by multiGridStep, in seconds
+    ///
+    /// Row \a l holds the times for level \a l, accumulated since the
+    /// construction or the last call of resetTimings(). The columns are
+    /// the times for smoothing, for computing and restricting the
+    /// residual, for prolonging and applying the correction, and for
+    /// the coarse solver (only on level 0). The time of a level does not
+    /// include the time spent on the coarser levels.
+    const gsMatrix<double>& timings() const         { return m_timings;       }
+
+    /// Resets the times returned by timings() to zero
+    void resetTimings()                             { m_timings.setZero();    }
+
+    /// Prints the times returned by timings() as a table
+    std::ostream& printTimings(std::ostream& os) const;
+
 protected:
 
     gsMultiGridOp() {}
@@ -234,9 +301,25 @@ private:
     std::vector< OpPtr > m_prolong;
     std::vector< OpPtr > m_restrict;
 
+    // Transfer matrices and the products of the restriction with the
+    // stiffness matrix of the finer level (only if constructed from
+    // matrices)
+    std::vector< SpMatrixRowMajorPtr > m_prolongMatrices;
+    std::vector< SpMatrixRowMajorPtr > m_restrictMatrices;
+    std::vector< SpMatrixRowMajorPtr > m_restrictedOps;
+
     // solver for the coarsest-grid problem
     OpPtr m_coarseSolver;
 
+    // Right-hand sides and iterates of the coarse-grid problems and
+    // residuals on each level, reused by all cycles
+    mutable std::vector< gsMatrix<T> > m_coarseRes;
+    mutable std::vector< gsMatrix<T> > m_coarseCorr;
+    mutable std::vector< gsMatrix<T> > m_fineRes;
+
+    // Accumulated times for each level, see timings()
+    mutable gsMatrix<double> m_timings;
+
     mutable index_t m_numPreSmooth;
     mutable index_t m_numPostSmooth;
     index_t m_numCycles;
@@ -13,6 +13,7 @@
 
 #include <gsMultiGrid/gsMultiGrid.h>
 #include <gsSolver/gsMatrixOp.h>
+#include <gsUtils/gsStopwatch.h>
 
 namespace gismo
 {
@@ -34,6 +35,29 @@ gsMultiGridOp<T>::gsMultiGridOp(SpMatrixPtr fineMatrix, std::vector< SpMatrixRow
     init(give(fineMatrix),give(transferMatrices),give(coarseSolver));
 }
 
+template<class T>
+gsMultiGridOp<T>::gsMultiGridOp(const std::vector<SpMatrixPtr>& matrices, std::vector< SpMatrixRowMajorPtr > transferMatrices, OpPtr coarseSolver )
+    : n_levels( matrices.size() ), m_ops(n_levels), m_smoother(n_levels), m_prolong(n_levels-1), m_restrict(n_levels-1),
+      m_numPreSmooth(1), m_numPostSmooth(1), m_numCycles(1), m_damping(1)
+{
+    GISMO_ASSERT ( matrices.size() == transferMatrices.size()+1, "The number of transfer matrices does not fit to the number of matrices." );
+
+    initTransfer(give(transferMatrices));
+
+    for ( index_t i = 0; i < n_levels; ++i )
+    {
+        GISMO_ASSERT ( matrices[i]->rows() == matrices[i]->cols(), "gsMultiGridOp need quadratic matrices." );
+        m_ops[i] = makeMatrixOp(matrices[i]);
+    }
+
+    if (coarseSolver)
+        m_coarseSolver = coarseSolver;
+    else
+        initCoarseSolver();
+
+    initWorkspace();
+}
+
 template<class T>
 gsMultiGridOp<T>::gsMultiGridOp( const std::vector<OpPtr>& ops, const std::vector<OpPtr>& prolong,
                                           const std::vector<OpPtr>& restrict, OpPtr coarseSolver)
@@ -47,6 +71,8 @@ gsMultiGridOp<T>::gsMultiGridOp( const std::vector<OpPtr>& ops, const std::vecto
         m_coarseSolver = coarseSolver;
     else
         initCoarseSolver();
+
+    initWorkspace();
 }
 
 template<class T>
@@ -66,32 +92,79 @@ void gsMultiGridOp<T>::init(SpMatrixPtr fineMatrix, std::vector<SpMatrixRowMajor
     m_numCycles = 1;
     m_damping = 1;
 
+    initTransfer(give(transferMatrices));
+
     SpMatrixPtr mat = fineMatrix;
     m_ops[n_levels-1] = makeMatrixOp(mat);
 
     for ( index_t i = n_levels - 2; i >= 0; --i )
     {
+        // The product of the restriction and the stiffness matrix is
+        // kept for computing the restricted residual
+        m_restrictedOps[i] = SpMatrixRowMajorPtr(new SpMatrixRowMajor(
+            *(m_restrictMatrices[i]) * *mat
+        ));
         SpMatrixPtr newMat = SpMatrixPtr(new SpMatrix(
-            transferMatrices[i]->transpose() * *mat * *(transferMatrices[i])
+            *(m_restrictedOps[i]) * *(m_prolongMatrices[i])
         ));
         m_ops[i] = makeMatrixOp(newMat);
         mat = newMat; // copies just the smart pointers
     }
 
-    for ( index_t i=0; i<sz; ++i )
-    {
-        m_prolong[i] = makeMatrixOp(transferMatrices[i]);
-        m_restrict[i] = makeMatrixOp(transferMatrices[i]->transpose()); // note that this works as we know that
-                                                           // m_prolong does not get destroyed before
-                                                           // m_restrict, so the shared pointer stored in m_prolong
-                                                           // will make sure that the matrix will not get destroyed
-    }
-
     if (coarseSolver)
         m_coarseSolver = coarseSolver;
     else
         gsMultiGridOp<T>::initCoarseSolver();
 
+    initWorkspace();
+}
+
+template<class T>
+void gsMultiGridOp<T>::initTransfer(std::vector<SpMatrixRowMajorPtr> transferMatrices)
+{
+    const index_t sz = transferMatrices.size();
+
+    m_prolongMatrices = give(transferMatrices);
+    m_restrictMatrices.resize(sz);
+    m_restrictedOps.resize(sz);
+
+    for ( index_t i=0; i<sz; ++i )
+    {
+        // The restriction is stored explicitly as a row-major matrix,
+        // such that its product can be computed row by row
+        m_restrictMatrices[i] = SpMatrixRowMajorPtr(new SpMatrixRowMajor(
+            m_prolongMatrices[i]->transpose()
+        ));
+        m_prolong[i] = makeMatrixOp(m_prolongMatrices[i]);
+        m_restrict[i] = makeMatrixOp(m_restrictMatrices[i]);
+    }
+}
+
+template<class T>
+void gsMultiGridOp<T>::initWorkspace()
+{
+    // The matrices are null pointers for matrix-free multigrid
+    m_prolongMatrices.resize(n_levels-1);
+    m_restrictMatrices.resize(n_levels-1);
+    m_restrictedOps.resize(n_levels-1);
+
+    m_coarseRes.resize(n_levels);
+    m_coarseCorr.resize(n_levels);
+    m_fineRes.resize(n_levels);
+    for ( index_t i = 0; i < n_levels; ++i )
+    {
+        if ( i < n_levels - 1 )
+        {
+            m_coarseRes[i].setZero(nDofs(i), 1);
+            m_coarseCorr[i].setZero(nDofs(i), 1);
+        }
+        // The residual on the finer level is only formed if there is no
+        // product of the restriction with the stiffness matrix
+        if ( i > 0 && !m_restrictedOps[i-1] )
+            m_fineRes[i].setZero(nDofs(i), 1);
+    }
+
+    m_timings.setZero(n_levels, 4);
 }
 
 template<class T>
@@ -145,9 +218,12 @@ void gsMultiGridOp<T>::multiGridStep(index_t level, const gsMatrix<T>& rhs, gsMa
     GISMO_ASSERT ( 0 <= level && level < n_levels, "The given level is not feasible." );
     GISMO_ASSERT ( n_levels > 1, "Multigrid is only available if at least two grids are present. Use smoothingStep for running the smoother only." );
 
+    gsStopwatch time;
+
     if (level == 0)
     {
         solveCoarse(rhs, x);
+        m_timings(0,3) += time.stop();
     }
     else
     {
@@ -156,20 +232,20 @@ void gsMultiGridOp<T>::multiGridStep(index_t level, const gsMatrix<T>& rhs, gsMa
 
         GISMO_ASSERT (m_smoother[lf], "Smoother is not defined. Define it using setSmoother." );
 
-        gsMatrix<T> fineRes, fineCorr, coarseRes, coarseCorr;
+        gsMatrix<T> & coarseRes  = m_coarseRes[lc];
+        gsMatrix<T> & coarseCorr = m_coarseCorr[lc];
 
         // pre-smooth
         for (index_t i = 0; i < m_numPreSmooth; ++i)
         {
             m_smoother[lf]->step( rhs, x );
         }
+        m_timings(lf,0) += time.stop();
 
-        // compute fine residual
-        m_ops[lf]->apply( x, fineRes );
-        fineRes -= rhs;
-
-        // restrict residual to coarse grid
-        restrictVector( lf, fineRes, coarseRes );
+        // compute fine residual and restrict it to coarse grid
+        time.restart();
+        restrictResidual( lf, rhs, x, coarseRes );
+        m_timings(lf,1) += time.stop();
 
         // obtain coarse-grid correction by recursing
         coarseCorr.setZero( nDofs(lc), coarseRes.cols() );
@@ -178,17 +254,85 @@ void gsMultiGridOp<T>::multiGridStep(index_t level, const gsMatrix<T>& rhs, gsMa
             multiGridStep( lc, coarseRes, coarseCorr );
         }
 
-        // prolong correction
-        prolongVector( lc, coarseCorr, fineCorr );
-
-        // apply correction
-        x -= m_damping * fineCorr;
+        // prolong and apply correction
+        time.restart();
+        applyCorrection( lc, coarseCorr, x );
+        m_timings(lf,2) += time.stop();
 
         // post-smooth
+        time.restart();
         for (index_t i = 0; i < m_numPostSmooth; ++i)
         {
             m_smoother[lf]->stepT( rhs, x );
         }
+        m_timings(lf,0) += time.stop();
+    }
+}
+
+template<class T>
+void gsMultiGridOp<T>::restrictResidual(index_t lf, const gsMatrix<T>& rhs, const gsMatrix<T>& x, gsMatrix<T>& coarse) const
+{
+    const index_t lc = lf - 1;
+
+    if (!m_restrictedOps[lc])
+    {
+        gsMatrix<T> & fineRes = m_fineRes[lf];
+        m_ops[lf]->apply( x, fineRes );
+        fineRes -= rhs;
+        restrictVector( lf, fineRes, coarse );
+        return;
+    }
+
+    // coarse = R * (A * x - rhs) = (R * A) * x - R * rhs, row by row
+    const SpMatrixRowMajor & RA = *m_restrictedOps[lc];
+    const SpMatrixRowMajor & R  = *m_restrictMatrices[lc];
+    const index_t nr = RA.rows();
+    const index_t nc = x.cols();
+    coarse.resize(nr, nc);
+
+#   pragma omp parallel for schedule(static) if (RA.nonZeros() > 20000)
+    for (index_t k = 0; k < nr; ++k)
+    {
+        for (index_t c = 0; c < nc; ++c)
+        {
+            T sum = 0;
+            for (typename SpMatrixRowMajor::InnerIterator it(RA,k); it; ++it)
+                sum += it.value() * x(it.index(),c);
+            for (typename SpMatrixRowMajor::InnerIterator it(R,k); it; ++it)
+                sum -= it.value() * rhs(it.index(),c);
+            coarse(k,c) = sum;
+        }
+    }
+}
+
+template<class T>
+void gsMultiGridOp<T>::applyCorrection(index_t lc, const gsMatrix<T>& coarse, gsMatrix<T>& x) const
+{
+    const index_t lf = lc + 1;
+
+    if (!m_prolongMatrices[lc])
+    {
+        gsMatrix<T> & fineCorr = m_fineRes[lf];
+        prolongVector( lc, coarse, fineCorr );
+        x -= m_damping * fineCorr;
+        return;
+    }
+
+    // x -= damping * P * coarse, row by row
+    const SpMatrixRowMajor & P = *m_prolongMatrices[lc];
+    const index_t nr = P.rows();
+    const index_t nc = x.cols();
+
+#   pragma omp parallel for schedule(static) if (P.nonZeros() > 20000)
+    for (index_t i = 0; i < nr; ++i)
+    {
+        for (index_t c = 0; c < nc; ++c)
+        {
+            T sum = 0;
+            for (typename SpMatrixRowMajor::InnerIterator it(P,i); it; ++it)
+                sum += it.value() * coarse(it.index(),c);
+            x(i,c) -= m_damping * sum;
+        }
     }
 }
 
@@ -276,6 +420,24 @@ const typename gsMultiGridOp<T>::SpMatrix& gsMultiGridOp<T>::matrix(index_t lvl)
     return *(matrOp->matrixPtr());
 }
 
+template<class T>
+std::ostream& gsMultiGridOp<T>::printTimings(std::ostream& os) const
+{
+    os << "Level    Smoothing  Restriction Prolongation Coarse solve\n";
+    for (index_t i = finestLevel(); i >= 0; --i)
+    {
+        os << std::setw(5) << i;
+        for (index_t j = 0; j < 4; ++j)
+            os << std::setw(13) << m_timings(i,j);
+        os << "\n";
+    }
+    os << "Total" << std::setw(13) << m_timings.col(0).sum()
+       << std::setw(13) << m_timings.col(1).sum()
+       << std::setw(13) << m_timings.col(2).sum()
+       << std::setw(13) << m_timings.col(3).sum() << "\n";
+    return os;
+}
+
 template<class T>
 gsOptionList gsMultiGridOp<T>::defaultOptions()
 {
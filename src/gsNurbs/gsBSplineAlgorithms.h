@@ -219,23 +219,21 @@ namespace bspline
 
 
 
-/// Increase the degree of a 1D B-spline from degree p to degree p + m.
-template<class Basis_t>
-void degreeElevateBSpline(Basis_t &basis, 
-                          gsMatrix<typename Basis_t::Scalar_t> & coefs,
-                          short_t m)
+/// Computes the coefficients \a coefs of a 1D B-spline with knot
+/// vector \a knots after increasing its degree by \a m (Huang's
+/// algorithm). \a eknots is the knot vector of the elevated basis.
+/// Every column of \a coefs is treated as an independent B-spline.
+template<class T>
+void degreeElevateCoefs(const gsKnotVector<T> & knots,
+                        const gsKnotVector<T> & eknots,
+                        gsMatrix<T> & coefs,
+                        short_t m)
 {
-    typedef typename Basis_t::Scalar_t T;
-
-    GISMO_ASSERT(m >= 0 && m<512, "Can only elevate degree by a positive (not enormous) amount.");
-    GISMO_ASSERT(basis.size() == coefs.rows(), "Invalid coefficients");
-
-    if (m==0) return;
-
-    const short_t p      = basis.degree();
+    const short_t p      = knots.degree();
     const index_t ncoefs = coefs.rows();
     const index_t n      = coefs.cols();
-    const gsKnotVector<T> & knots = basis.knots();
+
+    GISMO_ASSERT(eknots.degree() == p + m, "Invalid elevated knot vector");
 
     // compute original derivative coefficients P (recurrence)
     // original derivative coefficients
@@ -262,10 +260,8 @@ void degreeElevateBSpline(Basis_t &basis,
     const typename gsKnotVector<T>::multContainer &
         mult = knots.multiplicities(); // vector of mulitplicities
 
-    // degree elevate basis
-    basis.degreeElevate(m);
-    const index_t ncoefs_new = basis.size();
-    const short_t p_new      = basis.degree();
+    const index_t ncoefs_new = eknots.size() - p - m - 1;
+    const short_t p_new      = p + m;
 
     // new (elevated) derivative coefficients
 // #   if defined(__GNUC__)
@@ -303,9 +299,9 @@ void degreeElevateBSpline(Basis_t &basis,
             for(short_t i=1; i<=p_new-j; i++)
             {
                 const int ik= i+betak+k*m; // update index i for the considered knot value
-                if(knots[ik+p_new]>knots[ik+j])
+                if(eknots[ik+p_new]>eknots[ik+j])
                     Q[j].row(ik).noalias() = 
-                        Q[j].row(ik-1) + Q[j+1].row(ik-1) * (knots[ik-1+p_new+1]-knots[ik-1+j+1]);
+                        Q[j].row(ik-1) + Q[j+1].row(ik-1) * (eknots[ik-1+p_new+1]-eknots[ik-1+j+1]);
 
             }
         }
@@ -317,6 +313,27 @@ void degreeElevateBSpline(Basis_t &basis,
     coefs.swap( Q[0] );
 }
 
+/// Increase the degree of a 1D B-spline from degree p to degree p + m.
+template<class Basis_t>
+void degreeElevateBSpline(Basis_t &basis, 
+                          gsMatrix<typename Basis_t::Scalar_t> & coefs,
+                          short_t m)
+{
+    typedef typename Basis_t::Scalar_t T;
+
+    GISMO_ASSERT(m >= 0 && m<512, "Can only elevate degree by a positive (not enormous) amount.");
+    GISMO_ASSERT(basis.size() == coefs.rows(), "Invalid coefficients");
+
+    if (m==0) return;
+
+    const gsKnotVector<T> knots = basis.knots();
+
+    // degree elevate basis
+    basis.degreeElevate(m);
+
+    degreeElevateCoefs(knots, basis.knots(), coefs, m);
+}
+
 
 } // namespace bspline
 
@@ -125,8 +125,9 @@ void gsTensorBoehm(
 //
 // Some tests (for 2D and 3D) are written in gsTensorBoehm_test
 //
-// Possible improvement: function builds new matrix for coefficients (!!), so it
-// uses at least [2 * memory(coefs) + epsilon] memory.
+// Note: function builds new matrix for coefficients, so it uses at least
+// [2 * memory(coefs) + epsilon] memory. See gsTensorBoehmRefineInto for
+// a version writing into a given matrix.
 template <typename KnotVectorType, typename Mat, typename ValIt>
 void gsTensorBoehmRefine(
         KnotVectorType& knots,
@@ -137,6 +138,33 @@ void gsTensorBoehmRefine(
         ValIt valEnd,
         bool update_knots = true);
 
+/// @brief Performs a knot refinement in direction \a direction and
+/// writes the new coefficients into (the top rows of) \a new_coefs.
+///
+/// The first \a npts rows of \a coefs are refined; \a new_coefs must
+/// have at least as many rows as the refined coefficients and may not
+/// be the same matrix as \a coefs. The refined knot values are
+/// written into \a nknots.
+///
+/// The fibers in direction \a direction are traversed in blocks of
+/// consecutive fibers (which are stored in consecutive rows), so that
+/// every step of the algorithm updates a contiguous block of rows.
+/// The blocks are distributed among the threads (if OpenMP is
+/// enabled).
+///
+/// \ingroup Nurbs
+template <typename KnotVectorType, typename Mat, typename ValIt>
+void gsTensorBoehmRefineInto(
+        const KnotVectorType& knots,
+        const Mat& coefs,
+        const index_t npts,
+        Mat& new_coefs,
+        int direction,
+        const gsVector<unsigned> & str,
+        ValIt valBegin,
+        ValIt valEnd,
+        std::vector<typename std::iterator_traits<ValIt>::value_type> & nknots);
+
 
 /// @brief Local refinement algorithm.
 ///
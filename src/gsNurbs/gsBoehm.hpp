@@ -378,10 +378,42 @@ void gsTensorBoehmRefine(
         ValIt valEnd,
         bool update_knots)
 {
+    typedef typename std::iterator_traits<ValIt>::value_type T;
+
+    if ( valBegin == valEnd ) return;
+
+    const index_t npts = coefs.rows(); // number of points
+    const index_t nik = std::distance(valBegin, valEnd); // number of inserted knots
+    const index_t npts_in_dir = knots.size() - knots.degree() - 1;
+
+    // we compute new coefficients and put them into new_coefs
+    Mat new_coefs(npts + (npts / npts_in_dir) * nik, coefs.cols());
+    std::vector<T> nknots;
+
+    gsTensorBoehmRefineInto(knots, coefs, npts, new_coefs, direction, str,
+                            valBegin, valEnd, nknots);
+
+    coefs = give(new_coefs);
+
+    if (update_knots)
+        knots = KnotVectorType(knots.degree(), nknots.begin(), nknots.end());
+}
 
+
+template <typename KnotVectorType, typename Mat, typename ValIt>
+void gsTensorBoehmRefineInto(
+        const KnotVectorType& knots,
+        const Mat& coefs,
+        const index_t npts,
+        Mat& new_coefs,
+        int direction,
+        const gsVector<unsigned> & str,
+        ValIt valBegin,
+        ValIt valEnd,
+        std::vector<typename std::iterator_traits<ValIt>::value_type> & nknots)
+{
     typedef typename std::iterator_traits<ValIt>::value_type T;
 
-    const int npts = coefs.rows(); // number of points
     const int nik = std::distance(valBegin, valEnd); // number of inserted knots
     const int nk = knots.size(); // number of knots
     const int p = knots.degree(); // degree
@@ -391,64 +423,46 @@ void gsTensorBoehmRefine(
                  "Can not insert knots, they are out of the knot range");
     GISMO_ASSERT(direction < d,
                  "We can not insert a knot in a given direction");
+    GISMO_ASSERT(&coefs != &new_coefs, "Refinement can not be done in place");
+    GISMO_UNUSED(d);
 
     const int a =  knots.iFind(*valBegin)     - knots.begin();
     const int b = (knots.iFind(*(valEnd - 1)) - knots.begin()) + 1;
 
-    // we compute new coefficients and put them into new_coef
-    int npts_in_dir = nk - p - 1; // number of points in direction d
-    int pts_to_add = (npts / npts_in_dir) * nik; // number of point we must add
-    Mat new_coefs = Mat(npts + pts_to_add, coefs.cols());
-
-    // allocate a memory for new knots and new control points
-    std::vector<T> nknots(nk + nik);
-
-    // compute stride for new coefficients
-    gsVector<unsigned> new_str(str);
-    correctNewStride(new_str, str, direction, nik);
+    // the coefficient tensor is viewed as [step x npts_in_dir x nouter],
+    // where step is the number of (consecutive) fibers in direction
+    const index_t npts_in_dir = nk - p - 1; // number of points in direction
+    const index_t step = str[direction];
+    const index_t nouter = npts / (step * npts_in_dir);
+    GISMO_ASSERT(new_coefs.rows() >= nouter * step * (npts_in_dir + nik),
+                 "Matrix for the new coefficients is too small");
 
-    gsVector<int> position(d); // position old points
-    for (int i = 0; i < d; ++i)
-        position[i] = 0;
+    // blocks of consecutive fibers which are processed together
+    const index_t bs = math::min(step, static_cast<index_t>(64));
+    const index_t nblocks = (step + bs - 1) / bs;
 
-    gsVector<int> new_position(position); // position new points
-    gsVector<int> first_point(position); // first point of a cube
-    gsVector<int> last_point(d); // last point of a cube (old points)
-    gsVector<int> new_last_point(d); // last point of a cube (new points)
-
-    getLastIndex(str, npts, last_point);
-    getLastIndex(new_str, npts + pts_to_add, new_last_point);
-
-    last_point[direction] = 0;
-    new_last_point[direction] = 0;
-
-    int ind, new_ind;
-    const int step = str[direction];
-    const int new_step = new_str[direction];
-    bool flag = true;
-
-    // precompute alpha
+    // precompute alpha and the new knots
+    nknots.resize(nk + nik);
     std::vector< std::vector<T> > alpha(nik, std::vector<T> (p));
     computeTensorAlpha<T, KnotVectorType, ValIt, std::vector<T> >
             (alpha, nknots, knots, valBegin, valEnd);
 
-    do
+#   pragma omp parallel for schedule(static)
+    for (index_t t = 0; t < nouter * nblocks; ++t)
     {
+        const index_t b0 = (t % nblocks) * bs;
+        const index_t B = math::min(bs, step - b0); // fibers in this block
+        const index_t ind     = (t / nblocks) * step * npts_in_dir + b0;
+        const index_t new_ind = (t / nblocks) * step * (npts_in_dir + nik) + b0;
         ValIt valEndCopy = valEnd;
 
-        if (!flag)
-            GISMO_ERROR("This should not happened! "
-                        "We do not have an index for the new matrix.");
-
-        ind = getIndex(str, position);
-        new_ind = getIndex(new_str, new_position);
-
         // copy control points that are not affected
         for (int j = 0; j <= a - p; ++j)
-            new_coefs.row(new_ind + j * new_step) = coefs.row(ind + j * step);
+            new_coefs.middleRows(new_ind + j * step, B) =
+                    coefs.middleRows(ind + j * step, B);
         for (int j = npts_in_dir; b - 1 < j; --j)
-            new_coefs.row(new_ind + (j + nik - 1) * new_step) =
-                    coefs.row(ind + (j - 1) * step);
+            new_coefs.middleRows(new_ind + (j + nik - 1) * step, B) =
+                    coefs.middleRows(ind + (j - 1) * step, B);
 
         // algorithm
         int i = b + p - 1;
@@ -459,41 +473,31 @@ void gsTensorBoehmRefine(
             const T newKnot = *(--valEndCopy);
             while ((newKnot <= knots[i]) && (a < i))
             {
-                new_coefs.row(new_ind + (k - p - 1) * new_step) =
-                        coefs.row(ind + (i - p - 1) * step);
+                new_coefs.middleRows(new_ind + (k - p - 1) * step, B) =
+                        coefs.middleRows(ind + (i - p - 1) * step, B);
                 k--;
                 i--;
             }
 
-            new_coefs.row(new_ind + (k - p - 1) * new_step) =
-                    new_coefs.row(new_ind + (k - p) * new_step);
+            new_coefs.middleRows(new_ind + (k - p - 1) * step, B) =
+                    new_coefs.middleRows(new_ind + (k - p) * step, B);
 
             for (int ell = 1; ell <= p; ell++)
             {
                 const T alfa = alpha[j][ell - 1];
-                const int index = k - p + ell;
+                const index_t row = new_ind + (k - p + ell - 1) * step;
 
                 if (math::abs(alfa) == 0.0)
-                    new_coefs.row(new_ind + (index - 1) * new_step) =
-                            new_coefs.row(new_ind + index * new_step);
+                    new_coefs.middleRows(row, B) =
+                            new_coefs.middleRows(row + step, B);
                 else
-                    new_coefs.row(new_ind + (index - 1) * new_step) =
-                            alfa * new_coefs.row(new_ind + (index - 1) * new_step) +
-                            (1.0 - alfa) * new_coefs.row(new_ind + index * new_step);
+                    new_coefs.middleRows(row, B) =
+                            alfa * new_coefs.middleRows(row, B) +
+                            (1.0 - alfa) * new_coefs.middleRows(row + step, B);
             }
             k--;
         }
-
-        flag = nextCubePoint<gsVector<int> >(new_position, first_point,
-                                             last_point);
-
-    } while(nextCubePoint<gsVector<int> >(position, first_point,
-                                          last_point));
-
-    coefs = give(new_coefs);
-
-    if (update_knots)
-        knots = KnotVectorType(p, nknots.begin(), nknots.end());
+    }
 }
 
 
@@ -105,6 +105,20 @@ void gsTensorBoehmRefine<gsKnotVector<T>,
         std::vector<T>::const_iterator valEnd,
         bool update_knots);
 
+TEMPLATE_INST
+void gsTensorBoehmRefineInto<gsKnotVector<T>,
+                             gsMatrix<T>,
+                             std::vector<T>::const_iterator>(
+        const gsKnotVector<T>& knots,
+        const gsMatrix<T>& coefs,
+        const index_t npts,
+        gsMatrix<T>& new_coefs,
+        const int direction,
+        const gsVector<unsigned> & str,
+        std::vector<T>::const_iterator valBegin,
+        std::vector<T>::const_iterator valEnd,
+        std::vector<T> & nknots);
+
 // gsTensorBoehmRefineLocal
 
 TEMPLATE_INST
@@ -23,9 +23,37 @@
 namespace gismo {
 
 
+namespace bspline {
+
+/// Runs the triangle of de Boor's algorithm in-place on the \a deg+1
+/// consecutive columns of \a pts starting at column \a off, for the
+/// parameter \a u. The columns hold the control points of the
+/// functions active at \a u, the first of which has index \a first
+/// in \a knots. The value is left in column \a off + \a deg.
+template<class T, class KnotVectorType> inline
+void deboorTriangle(const T u, const KnotVectorType & knots,
+                    const index_t first, const int deg,
+                    gsMatrix<T> & pts, const index_t off = 0)
+{
+    index_t k;
+    T tmp;
+    for ( int r=0; r< deg; r++ ) // triangle step
+        for ( int i=deg; i>r; i-- ) // recursive computation
+        {
+            k= first + i;
+            tmp= ( u -  knots[k] ) / (knots[k+deg-r]-knots[k]);
+            pts.col(off+i) = (T(1)-tmp)*pts.col(off+i-1) + tmp* pts.col(off+i) ;
+        }
+}
+
+} // namespace bspline
+
 /// Executes deBoor's algorithm on the absissae (row vector) u, knot vector \a knots,
 /// degree \a deg and coefficients matrix \a coefs
-// to do: make local version with knot iterators as arguments
+///
+/// The points are processed in parallel (if OpenMP is enabled), each
+/// thread working on a single local workspace, hence no memory is
+/// allocated per point.
 template<class T, class KnotVectorType> inline
 void gsDeboor( 
     const gsMatrix<T> &u,
@@ -39,12 +67,17 @@ void gsDeboor(
   GISMO_ASSERT( coefs.rows() == index_t(knots.size() - deg-1) ,
                 "coefs.rows(): " << coefs.rows() << ", knots.size(): " << knots.size() << ", deg: " << deg ) ;
   
-  result.resize( coefs.cols(), u.cols() ) ;
-  int ind, k;
-  gsMatrix<T> points;
-  T tmp;
-  
-  for ( index_t j=0; j< u.cols(); j++ ) // for all points (entries of u)
+  const index_t npts = u.cols();
+  result.resize( coefs.cols(), npts ) ;
+
+#pragma omp parallel if (npts > 512)
+{
+  // Thread-local workspace, one control point per column
+  gsMatrix<T> points(coefs.cols(), deg+1);
+  index_t ind;
+
+#pragma omp for schedule(static)
+  for ( index_t j=0; j< npts; j++ ) // for all points (entries of u)
   {
     //De Boor's algorithm for parameter u(0,j)
     GISMO_ASSERT( (u(0,j)>knots[deg]-T(1e-4) ) && (u(0,j) < *(knots.end()-deg-1)+T(1e-4) ), 
@@ -54,18 +87,11 @@ void gsDeboor(
     ind = (knots.iFind( u(0,j) ) - knots.begin()) - deg;
     
     //int s= knots.multiplicity( u(0,j) ) ; // TO DO: improve using multiplicity s
-    points = coefs.middleRows( ind, deg+1 );
-    
-    for ( int r=0; r< deg; r++ ) // triangle step
-      //for ( int r=s; r< deg; r++ ) // TO DO: improve using multiplicity s
-      for ( int i=deg; i>r; i-- ) // recursive computation
-        {
-          k= ind + i;
-          tmp= ( u(0,j) -  knots[k] ) / (knots[k+deg-r]-knots[k]);
-          points.row(i) = (T(1)-tmp)*points.row(i-1) + tmp* points.row(i) ;
-        }        
-    result.col(j)= points.row(deg);
+    points.noalias() = coefs.middleRows( ind, deg+1 ).transpose();
+    bspline::deboorTriangle(u(0,j), knots, ind, deg, points);
+    result.col(j) = points.col(deg);
   }
+}//omp parallel
 }
 
 /// Executes deBoor's algorithm on the absissae (row vector) u, for
@@ -86,12 +112,17 @@ void gsDeboorDeriv(
 
   deg--;// Derivative has degree reduced by one
 
-  result.resize( coefs.cols(), u.cols() ) ;
+  const index_t npts = u.cols();
+  result.resize( coefs.cols(), npts ) ;
+
+#pragma omp parallel if (npts > 512)
+{
   int ind, k;
   gsMatrix<T> points(deg+1, coefs.cols() );
   T tmp;
 
-  for ( index_t j=0; j< u.cols(); j++ ) // for all points (entries of u)
+#pragma omp for schedule(static)
+  for ( index_t j=0; j< npts; j++ ) // for all points (entries of u)
   {
       //De Boor's algorithm for parameter u(0,j)
       GISMO_ASSERT( (u(0,j)>knots[deg]-T(1e-4) ) && (u(0,j) < *(knots.end()-deg-2)+T(1e-4) ), 
@@ -117,8 +148,103 @@ void gsDeboorDeriv(
           }        
       result.col(j)= points.row(deg);
   }
+}//omp parallel
+}
+
+
+/// Evaluates the tensor-product B-spline with basis \a base and
+/// coefficients \a coefs at the columns of \a u by tensor de Boor.
+///
+/// For every point the local \f$\prod_k (p_k+1)\f$ control net is
+/// gathered into a workspace (one control point per column) which
+/// is collapsed one parametric direction at a time by the de Boor
+/// triangle, direction 0 first since it is the fastest running
+/// index. The points are distributed among the threads (if OpenMP is
+/// enabled) and each thread re-uses one workspace, so no memory is
+/// allocated per point. Points outside the parameter domain evaluate
+/// to zero.
+template<short_t d, typename T>
+void gsTensorDeboorBatch(const gsMatrix<T> & u,
+                         const gsTensorBSplineBasis<d,T> & base,
+                         const gsMatrix<T> & coefs,
+                         gsMatrix<T> & result)
+{
+    typedef typename gsTensorBSplineBasis<d,T>::KnotVectorType KnotVectorType;
+    GISMO_ASSERT( u.rows() == d, "Waiting for "<<d<<"D values" );
+    GISMO_ASSERT( coefs.rows() == base.size(), "coefs.rows(): " << coefs.rows()
+                  << ", basis size: " << base.size() );
+
+    const index_t npts = u.cols();
+    const index_t tdim = coefs.cols();
+    result.resize(tdim, npts);
+
+    gsVector<index_t,d> deg, str;
+    index_t nloc = 1;
+    for (short_t k = 0; k < d; ++k)
+    {
+        deg[k] = base.degree(k);
+        nloc  *= deg[k] + 1;
+    }
+    base.stride_cwise(str);
+
+#pragma omp parallel if (npts > 256)
+{
+    // Thread-local workspace holding the local control net
+    gsMatrix<T> W(tdim, nloc);
+    gsVector<index_t,d> first, loc;
+    index_t offset, nfib, n;
+    bool inside;
+
+#pragma omp for schedule(static)
+    for (index_t j = 0; j < npts; ++j) // for all points (columns of u)
+    {
+        inside = true;
+        offset = 0;
+        for (short_t k = 0; k < d; ++k)
+        {
+            const KnotVectorType & kv = base.knots(k);
+            if ( ! kv.inDomain( u(k,j) ) ) { inside = false; break; }
+            first[k] = (kv.iFind( u(k,j) ) - kv.begin()) - deg[k];
+            offset  += first[k] * str[k];
+        }
+
+        if ( ! inside )
+        {
+            result.col(j).setZero();
+            continue;
+        }
+
+        // Gather the active coefficients, direction 0 running fastest
+        loc.setZero();
+        for (index_t l = 0; l < nloc; ++l)
+        {
+            W.col(l) = coefs.row(offset).transpose();
+            for (short_t k = 0; k < d; ++k)
+            {
+                if ( ++loc[k] <= deg[k] ) { offset += str[k]; break; }
+                loc[k]  = 0;
+                offset -= deg[k] * str[k];
+            }
+        }
+
+        // Collapse the fibers of one direction at a time, storing
+        // the results at the front of the workspace
+        nfib = nloc;
+        for (short_t k = 0; k < d; ++k)
+        {
+            n     = deg[k] + 1;
+            nfib /= n;
+            for (index_t f = 0; f < nfib; ++f)
+            {
+                bspline::deboorTriangle(u(k,j), base.knots(k), first[k], deg[k], W, f*n);
+                W.col(f) = W.col(f*n + deg[k]);
+            }
+        }
+
+        result.col(j) = W.col(0);
+    }
+}//omp parallel
 }
-    
 
 // =============================================================================
 // ===== temporal version of gsTensorDeboor
@@ -19,6 +19,7 @@
 #include <gsNurbs/gsNurbsBasis.h>
 #include <gsNurbs/gsKnotVector.h>
 #include <gsNurbs/gsBoehm.h>
+#include <gsNurbs/gsBSplineAlgorithms.h>
 
 
 namespace gismo
@@ -214,15 +215,18 @@ public:
         basis().setFromProjectiveCoefs(tmp, m_coefs, basis().weights());
     }
     
-    /*
-    void degreeElevate(int const i, int const dir = -1)
+    /// Elevates the degree by \a i, by elevating the B-spline in
+    /// projective coordinates.
+    void degreeElevate(short_t const i = 1, short_t const dir = -1)
     {
+        GISMO_UNUSED(dir);
         GISMO_ASSERT( (dir == -1) || (dir == 0),
                       "Invalid basis component "<< dir <<" requested for degree elevation" );
-        
-        bspline::degreeElevateBSpline(this->basis(), this->m_coefs, i);
+
+        gsMatrix<T> tmp = basis().projectiveCoefs(m_coefs);
+        bspline::degreeElevateBSpline(basis().source(), tmp, i);
+        basis().setFromProjectiveCoefs(tmp, m_coefs, basis().weights());
     }
-    */
 
     //void toProjective() { m_weights=w; } ;
     
@@ -290,9 +290,32 @@ void gsTensorBSpline<d,T>::degreeElevate(short_t const i, short_t const dir)
     swapTensorDirection(0, dir, sz, this->m_coefs);
     this->m_coefs.resize( sz[0], n * sz.template tail<static_cast<short_t>(d-1)>().prod() );
 
-    bspline::degreeElevateBSpline(this->basis().component(dir), this->m_coefs, i);
-    sz[0] = this->m_coefs.rows();
+    const KnotVectorType knots = this->basis().knots(dir);
+    this->basis().component(dir).degreeElevate(i);
+    const KnotVectorType & eknots = this->basis().knots(dir);
+    sz[0] = this->basis().size(dir);
+
+    // Every column is a 1D B-spline in direction dir; the columns are
+    // elevated in blocks which are distributed among the threads
+    const index_t ncols = this->m_coefs.cols();
+    const index_t bs = 64;
+    const index_t nblocks = (ncols + bs - 1) / bs;
+    gsMatrix<T> result(sz[0], ncols);
+
+#   pragma omp parallel
+    {
+        gsMatrix<T> block;
+#       pragma omp for schedule(static)
+        for (index_t b = 0; b < nblocks; ++b)
+        {
+            const index_t nc = math::min(bs, ncols - b * bs);
+            block = this->m_coefs.middleCols(b * bs, nc);
+            bspline::degreeElevateCoefs(knots, eknots, block, i);
+            result.middleCols(b * bs, nc) = block;
+        }
+    }
 
+    this->m_coefs.swap(result);
     this->m_coefs.resize( sz.prod(), n );
     swapTensorDirection(0, dir, sz, this->m_coefs);
 }
@@ -217,6 +217,10 @@ public:
     // Look at gsBasis class for a description
     void active_into(const gsMatrix<T> & u, gsMatrix<index_t>& result) const;
 
+    /// \brief Evaluates the function given by \a coefs by tensor de
+    /// Boor (see gsTensorDeboorBatch), without forming the basis values
+    void evalFunc_into(const gsMatrix<T> & u, const gsMatrix<T> & coefs, gsMatrix<T>& result) const;
+
     /// Returns a box with the coordinate-wise active functions
     /// \param u evaluation points
     /// \param low lower left corner of the box
@@ -292,6 +296,10 @@ public:
      */
     void refine_withCoefs(gsMatrix<T> & coefs,const std::vector< std::vector<T> >& refineKnots);
 
+    /// \brief Uniform h-refinement by knot insertion, updating the
+    /// coefficients \a coefs (see refine_withCoefs)
+    void uniformRefine_withCoefs(gsMatrix<T>& coefs, int numKnots = 1, int mul = 1);
+
     /// Inserts the knot \em knot with multiplicity \em mult in the knot
     /// vector of direction \a dir.
     void insertKnot(T knot, index_t dir, int mult=1)
@@ -479,6 +487,17 @@ private:
         }
     }
 
+    /// Tells whether the basis or one of its components is periodic;
+    /// such bases do not store the ghost coefficients and take the
+    /// generic evaluation and refinement paths
+    bool hasPeriodicComponent() const
+    {
+        bool periodic = isPeriodic();
+        for (short_t i = 0; i < d; ++i)
+            periodic = periodic || Self_t::component(i).isPeriodic();
+        return periodic;
+    }
+
 protected:
 
     /// Coordinate direction, where the basis is periodic (when equal
@@ -18,6 +18,7 @@
 #include <gsNurbs/gsTensorBSplineBasis.h>
 #include <gsNurbs/gsKnotVector.h>
 #include <gsNurbs/gsBoehm.h>
+#include <gsNurbs/gsDeboor.hpp>
 
 #include <gsIO/gsXml.h>
 #include <gsIO/gsXmlGenericUtils.hpp>
@@ -43,6 +44,18 @@ active_cwise(const gsMatrix<T> & u,
     }
 }
 
+template<short_t d, class T>
+void gsTensorBSplineBasis<d,T>::
+evalFunc_into(const gsMatrix<T> & u,
+              const gsMatrix<T> & coefs,
+              gsMatrix<T>& result) const
+{
+    if ( hasPeriodicComponent() ) // ghost coefficients are not stored
+        Base::evalFunc_into(u, coefs, result);
+    else
+        gsTensorDeboorBatch<d,T>(u, *this, coefs, result);
+}
+
 template<short_t d, class T>
 void gsTensorBSplineBasis<d,T>::
 refine_withTransfer(gsSparseMatrix<T,RowMajor> & transfer, 
@@ -70,17 +83,56 @@ refine_withCoefs(gsMatrix<T> & coefs,const std::vector< std::vector<T> >& refine
     {
         strides[j]=this->stride(j);
     }
+
+    // The directions are refined in turns between coefs and a single
+    // buffer, both having the size of the refined coefficients
+    index_t nref = 1;
+    for (unsigned i = 0; i < d; ++i)
+        nref *= this->size(i) + refineKnots[i].size();
+    gsMatrix<T> buffer;
+    gsMatrix<T> * src = &coefs, * dst = &buffer;
+    index_t npts = coefs.rows();
+    std::vector<T> nknots;
+
     for (unsigned i = 0; i < d; ++i)
     {
         if(refineKnots[i].size()>0)
         {
-            gsTensorBoehmRefine(this->component(i).knots(), coefs, i, strides,
-                                refineKnots[i].begin(), refineKnots[i].end(), true);
-            
+            if ( dst->rows() != nref )
+                dst->resize(nref, coefs.cols());
+
+            KnotVectorType & kv = this->component(i).knots();
+            gsTensorBoehmRefineInto(kv, *src, npts, *dst, i, strides,
+                                    refineKnots[i].begin(), refineKnots[i].end(),
+                                    nknots);
+            npts = (npts / this->size(i)) * (this->size(i) + refineKnots[i].size());
+            kv = KnotVectorType(kv.degree(), nknots.begin(), nknots.end());
+            std::swap(src, dst);
+
             for (index_t j = i+1; j<strides.rows(); ++j)
                 strides[j]=this->stride(j); //new stride for this direction
         }
     }
+
+    if ( src != &coefs )
+        coefs.swap(buffer);
+}
+
+
+template<short_t d, class T>
+void gsTensorBSplineBasis<d,T>::
+uniformRefine_withCoefs(gsMatrix<T>& coefs, int numKnots, int mul)
+{
+    if ( hasPeriodicComponent() ) // see remark about periodic basis in gsBSplineBasis
+    {
+        Base::uniformRefine_withCoefs(coefs, numKnots, mul);
+        return;
+    }
+
+    std::vector< std::vector<T> > refineKnots(d);
+    for (short_t i = 0; i < d; ++i)
+        this->knots(i).getUniformRefinementKnots(numKnots, refineKnots[i], mul);
+    this->refine_withCoefs(coefs, refineKnots);
 }
 
 
@@ -255,6 +255,20 @@ public:
         swapTensorDirection(0, dir, sz, weights());
     }
 
+    /// \brief Elevates the degree by \a i in direction \a dir (all
+    /// directions if \a dir is -1).
+    ///
+    /// The B-spline in projective coordinates is elevated directly,
+    /// without interpolation.
+    void degreeElevate(short_t const i = 1, short_t const dir = -1)
+    {
+        typename TBasis::GeometryType
+            tmp(this->basis().source(), this->basis().projectiveCoefs(m_coefs));
+        tmp.degreeElevate(i, dir);
+        Basis::setFromProjectiveCoefs(tmp.coefs(), m_coefs, weights());
+        std::swap(this->basis().source(), tmp.basis());
+    }
+
     /// Access to i-th weight
     T & weight(int i) const { return this->basis().weight(i); }
 
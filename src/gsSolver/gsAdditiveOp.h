@@ -44,6 +44,15 @@ namespace gismo
 ///
 /// but much faster.
 ///
+/// If OpenMP is enabled and setConcurrent() has been called, the
+/// subspace corrections are computed in parallel. In this case, the
+/// apply functions of all local operators have to be thread-safe,
+/// i.e., they may be called concurrently for the same or for
+/// different operators. This is not the case, e.g., for operators that
+/// keep workspaces as members, like gsMultiGridOp. See
+/// gsMultiPatchPreconditionersCreator for additive Schwarz
+/// preconditioners on multipatch domains, which use this.
+///
 /// @ingroup Solvers
 
 template<class T>
@@ -63,7 +72,7 @@ public:
     typedef memory::unique_ptr<gsAdditiveOp> uPtr;
 
     /// Default Constructor
-    gsAdditiveOp() : m_transfers(), m_ops() {}
+    gsAdditiveOp() : m_transfers(), m_ops(), m_concurrent(false) {}
 
     /// @brief Constructor
     ///
@@ -72,7 +81,7 @@ public:
     /// @param transfers  transfer matrices \f$ T_i \f$
     /// @param ops        local operators \f$ A_i \f$
     gsAdditiveOp(TransferContainer transfers, OpContainer ops)
-    : m_transfers(give(transfers)), m_ops(give(ops))
+    : m_transfers(give(transfers)), m_ops(give(ops)), m_concurrent(false)
     {
 #ifndef NDEBUG
         GISMO_ASSERT( m_transfers.size() == m_ops.size(), "Sizes do not agree" );
@@ -110,6 +119,15 @@ public:
                        "Dimensions of the operators do not fit." );
     }
 
+    /// @brief Computes the subspace corrections in parallel (if OpenMP is enabled)
+    ///
+    /// Only allowed if the apply functions of all local operators are
+    /// thread-safe. The default is false.
+    void setConcurrent(bool concurrent = true) { m_concurrent = concurrent; }
+
+    /// Returns true if the subspace corrections are computed in parallel
+    bool isConcurrent() const { return m_concurrent; }
+
     void apply(const gsMatrix<T>& input, gsMatrix<T>& x) const;
 
     index_t rows() const
@@ -127,6 +145,7 @@ public:
 protected:
     TransferContainer m_transfers;   ///< Transfer matrices
     OpContainer m_ops;               ///< Operators to be applied in the subspaces
+    bool m_concurrent;               ///< Compute the subspace corrections in parallel
 
 };
 
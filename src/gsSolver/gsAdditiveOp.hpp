@@ -22,13 +22,57 @@ void gsAdditiveOp<T>::apply(const gsMatrix<T>& input, gsMatrix<T>& x) const
     x.setZero( input.rows(), input.cols() );
 
     const index_t n = m_ops.size();
-    gsMatrix<T> res_local, corr_local;
+#ifdef _OPENMP
+    const index_t nt = m_concurrent ? omp_get_max_threads() : 1;
+#else
+    const index_t nt = 1;
+#endif
 
-    for (index_t i=0; i<n; ++i)
+    if (nt < 2 || n < 2)
     {
-        res_local.noalias() = m_transfers[i].transpose()*input;
-        m_ops[i]->apply(res_local, corr_local);
-        x.noalias() += m_transfers[i]*corr_local;
+        gsMatrix<T> res_local, corr_local;
+        for (index_t i=0; i<n; ++i)
+        {
+            res_local.noalias() = m_transfers[i].transpose()*input;
+            m_ops[i]->apply(res_local, corr_local);
+            x.noalias() += m_transfers[i]*corr_local;
+        }
+        return;
+    }
+
+    // The subspaces are processed in chunks of one subspace per
+    // thread, so only the local corrections of one chunk are kept
+    std::vector< gsMatrix<T> > corr_local(nt);
+
+    // Every thread accumulates the corrections for its own block of
+    // rows, always in the same order, so the result does not depend
+    // on the number of threads
+    const index_t blockSize = 1024;
+    const index_t numBlocks = (x.rows() + blockSize - 1) / blockSize;
+
+#   pragma omp parallel num_threads(nt)
+    {
+        gsMatrix<T> res_local;
+
+        for (index_t i0=0; i0<n; i0+=nt)
+        {
+            const index_t nc = std::min(nt, n-i0);
+
+#           pragma omp for schedule(dynamic, 1)
+            for (index_t k=0; k<nc; ++k)
+            {
+                res_local.noalias() = m_transfers[i0+k].transpose()*input;
+                m_ops[i0+k]->apply(res_local, corr_local[k]);
+            }
+
+#           pragma omp for schedule(static)
+            for (index_t b=0; b<numBlocks; ++b)
+            {
+                const index_t r0 = b*blockSize, nr = std::min(blockSize, x.rows()-r0);
+                for (index_t k=0; k<nc; ++k)
+                    x.middleRows(r0, nr).noalias() += m_transfers[i0+k].middleRows(r0, nr)*corr_local[k];
+            }
+        }
     }
 }
 
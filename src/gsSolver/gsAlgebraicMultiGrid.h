@@ -0,0 +1,186 @@
+/** @file gsAlgebraicMultiGrid.h
+
+    @brief Algebraic multigrid preconditioner based on smoothed aggregation
+
+    This file is part of the G+Smo library.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include <gsSolver/gsPreconditioner.h>
+#include <gsMultiGrid/gsMultiGrid.h>
+#include <gsIO/gsOptionList.h>
+
+namespace gismo
+{
+
+/** @brief
+    Algebraic multigrid preconditioner based on smoothed aggregation.
+
+    The grid hierarchy is constructed from the (symmetric positive
+    definite) matrix alone, so no geometric information is needed.
+    On every level, the degrees of freedom are grouped into nodes, and
+    the nodes are aggregated based on the strength of their
+    connections in the matrix. The tentative prolongation interpolates
+    the near-nullspace vectors exactly on every aggregate. It is then
+    smoothed by one damped Jacobi step, and the coarse matrices are
+    Galerkin products. The cycles are performed by gsMultiGridOp.
+
+    For scalar problems, the near-nullspace consists of the constant
+    vector. For systems like linear elasticity, the near-nullspace
+    (e.g. the rigid body modes, see rigidBodyModes()) has to be
+    provided together with the number of components. Then the degrees
+    of freedom of the fine matrix are expected to be ordered by
+    components, as done by the assemblers of G+Smo: all degrees of
+    freedom of the first component, then the ones of the second
+    component, and so on. The degrees of freedom with the same index
+    in all components form a node.
+
+    The strength of connection, the tentative prolongation, the
+    prolongation smoothing and the Galerkin products are computed in
+    parallel if OpenMP is enabled. The aggregation itself is a greedy,
+    sequential algorithm. The cycles use multi-threaded smoothers and
+    transfer operators.
+
+    \par Setup options
+
+    The options that control the construction of the hierarchy have
+    to be provided to the constructor, see defaultOptions(). The
+    options of the cycle (number of smoothing steps, V- or W-cycles)
+    can also be changed later by setOptions().
+
+    \ingroup Solver
+*/
+template<class T = real_t>
+class gsAlgebraicMultiGridOp : public gsPreconditionerOp<T>
+{
+public:
+
+    /// Shared pointer for gsAlgebraicMultiGridOp
+    typedef memory::shared_ptr<gsAlgebraicMultiGridOp> Ptr;
+
+    /// Unique pointer for gsAlgebraicMultiGridOp
+    typedef memory::unique_ptr<gsAlgebraicMultiGridOp> uPtr;
+
+    /// Direct base class
+    typedef gsPreconditionerOp<T> Base;
+
+    /// Matrix type
+    typedef gsSparseMatrix<T> SpMatrix;
+
+    /// Matrix type
+    typedef gsSparseMatrix<T, RowMajor> SpMatrixRowMajor;
+
+    /// Smart pointer to matrix type
+    typedef memory::shared_ptr<SpMatrix> SpMatrixPtr;
+
+    /// Smart pointer to matrix type
+    typedef memory::shared_ptr<SpMatrixRowMajor> SpMatrixRowMajorPtr;
+
+    /// @brief Constructor
+    ///
+    /// @param mat                       The (symmetric positive definite) system matrix
+    /// @param nearNullspace             The vectors which are (nearly) in the kernel of the matrix, as columns,
+    ///                                  defaulted to the constants of every component
+    /// @param numComponents             Number of components (i.e. of degrees of freedom per node)
+    /// @param opt                       The options for the setup and the cycle, see defaultOptions()
+    gsAlgebraicMultiGridOp( SpMatrixPtr mat, const gsMatrix<T> & nearNullspace = gsMatrix<T>(),
+                            index_t numComponents = 1, const gsOptionList & opt = defaultOptions() );
+
+    /// Make function returning smart pointer
+    ///
+    /// @param mat                       The (symmetric positive definite) system matrix, which is copied
+    /// @param nearNullspace             The vectors which are (nearly) in the kernel of the matrix, as columns,
+    ///                                  defaulted to the constants of every component
+    /// @param numComponents             Number of components (i.e. of degrees of freedom per node)
+    /// @param opt                       The options for the setup and the cycle, see defaultOptions()
+    static uPtr make( const SpMatrix & mat, const gsMatrix<T> & nearNullspace = gsMatrix<T>(),
+                      index_t numComponents = 1, const gsOptionList & opt = defaultOptions() )
+    { return uPtr( new gsAlgebraicMultiGridOp( SpMatrix(mat).moveToPtr(), nearNullspace, numComponents, opt ) ); }
+
+    /// Make function returning smart pointer
+    ///
+    /// @param mat                       The (symmetric positive definite) system matrix (as smart pointer)
+    /// @param nearNullspace             The vectors which are (nearly) in the kernel of the matrix, as columns,
+    ///                                  defaulted to the constants of every component
+    /// @param numComponents             Number of components (i.e. of degrees of freedom per node)
+    /// @param opt                       The options for the setup and the cycle, see defaultOptions()
+    static uPtr make( SpMatrixPtr mat, const gsMatrix<T> & nearNullspace = gsMatrix<T>(),
+                      index_t numComponents = 1, const gsOptionList & opt = defaultOptions() )
+    { return uPtr( new gsAlgebraicMultiGridOp( give(mat), nearNullspace, numComponents, opt ) ); }
+
+    void step(const gsMatrix<T>& rhs, gsMatrix<T>& x) const
+    {
+        if (m_mg->numLevels() > 1)
+            m_mg->step(rhs, x);
+        else
+            m_mg->solveCoarse(rhs, x);
+    }
+
+    void stepT(const gsMatrix<T>& rhs, gsMatrix<T>& x) const
+    {
+        if (m_mg->numLevels() > 1)
+            m_mg->stepT(rhs, x);
+        else
+            m_mg->solveCoarse(rhs, x);
+    }
+
+    typename gsLinearOperator<T>::Ptr underlyingOp() const { return m_mg->underlyingOp(); }
+
+    index_t rows() const { return m_mg->rows(); }
+    index_t cols() const { return m_mg->cols(); }
+
+    /// Number of levels of the constructed hierarchy
+    index_t numLevels() const { return m_mg->numLevels(); }
+
+    /// @brief The operator complexity of the hierarchy
+    ///
+    /// This is the number of non-zeros of the matrices on all levels,
+    /// divided by the number of non-zeros of the fine matrix.
+    T operatorComplexity() const;
+
+    /// @brief The underlying multigrid solver
+    ///
+    /// It provides the matrices on all levels and the timings of the
+    /// cycles, see gsMultiGridOp.
+    const typename gsMultiGridOp<T>::Ptr & multiGrid() const { return m_mg; }
+
+    /// @brief The rigid body modes of linear elasticity
+    ///
+    /// @param points                    The coordinates of the nodes as columns, e.g. the
+    ///                                  Greville points or the control points of the basis
+    ///
+    /// The modes are ordered by components, like the degrees of
+    /// freedom, so they can be used as near-nullspace with as many
+    /// components as the rows of \a points (2 or 3).
+    static gsMatrix<T> rigidBodyModes(const gsMatrix<T> & points);
+
+    static gsOptionList defaultOptions();                       ///< Returns a list of default options
+    virtual void setOptions(const gsOptionList & opt);          ///< Set the options of the cycle based on a gsOptionList
+
+private:
+
+    // Constructs the hierarchy
+    void init( SpMatrixPtr mat, gsMatrix<T> nullspace, index_t numComponents, const gsOptionList & opt );
+
+    // Groups the nodes of a level into aggregates based on the
+    // strength of their connections; returns the number of aggregates
+    static index_t aggregate( const SpMatrix & mat, const std::vector<index_t> & nodeOfDof,
+                              index_t numNodes, T threshold, std::vector<index_t> & aggregates );
+
+private:
+
+    // The multigrid solver working on the hierarchy
+    typename gsMultiGridOp<T>::Ptr m_mg;
+
+}; // class gsAlgebraicMultiGridOp
+
+}  // namespace gismo
+
+#ifndef GISMO_BUILD_LIB
+#include GISMO_HPP_HEADER(gsAlgebraicMultiGrid.hpp)
+#endif
@@ -0,0 +1,434 @@
+/** @file gsAlgebraicMultiGrid.hpp
+
+    @brief Algebraic multigrid preconditioner based on smoothed aggregation
+
+    This file is part of the G+Smo library.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include <gsSolver/gsAlgebraicMultiGrid.h>
+#include <gsSolver/gsSimplePreconditioners.h>
+
+namespace gismo
+{
+
+namespace internal
+{
+
+/// @brief Computes the row-major product C = A * B row by row, in
+/// parallel if OpenMP is enabled.
+///
+/// The matrices are traversed along their outer dimension, so for a
+/// column-major matrix its columns are used as rows. This is correct
+/// for symmetric matrices only.
+template <class MatrixA, class MatrixB, class T>
+void amgProduct(const MatrixA & A, const MatrixB & B, gsSparseMatrix<T,RowMajor> & C)
+{
+    const index_t n  = A.outerSize();
+    const index_t nc = B.innerSize();
+
+    // Number of non-zeros of every row
+    std::vector<index_t> ptr(n + 1, 0);
+#   pragma omp parallel
+    {
+        std::vector<index_t> mark(nc, -1);
+#       pragma omp for schedule(dynamic, 64)
+        for (index_t i = 0; i < n; ++i)
+        {
+            index_t cnt = 0;
+            for (typename MatrixA::InnerIterator a(A, i); a; ++a)
+                for (typename MatrixB::InnerIterator b(B, a.index()); b; ++b)
+                    if (mark[b.index()] != i)
+                    {
+                        mark[b.index()] = i;
+                        ++cnt;
+                    }
+            ptr[i+1] = cnt;
+        }
+    }
+    std::partial_sum(ptr.begin(), ptr.end(), ptr.begin());
+
+    C.resize(n, nc);
+    C.resizeNonZeros(ptr[n]);
+    std::copy(ptr.begin(), ptr.end(), C.outerIndexPtr());
+
+#   pragma omp parallel
+    {
+        std::vector<index_t> mark(nc, -1);
+        std::vector<T> acc(nc);
+#       pragma omp for schedule(dynamic, 64)
+        for (index_t i = 0; i < n; ++i)
+        {
+            index_t * idx = C.innerIndexPtr() + ptr[i];
+            index_t cnt = 0;
+            for (typename MatrixA::InnerIterator a(A, i); a; ++a)
+                for (typename MatrixB::InnerIterator b(B, a.index()); b; ++b)
+                {
+                    const index_t j = b.index();
+                    if (mark[j] != i)
+                    {
+                        mark[j] = i;
+                        acc[j]  = 0;
+                        idx[cnt++] = j;
+                    }
+                    acc[j] += a.value() * b.value();
+                }
+            std::sort(idx, idx + cnt);
+            T * val = C.valuePtr() + ptr[i];
+            for (index_t k = 0; k < cnt; ++k)
+                val[k] = acc[idx[k]];
+        }
+    }
+}
+
+} // namespace internal
+
+template<class T>
+gsAlgebraicMultiGridOp<T>::gsAlgebraicMultiGridOp( SpMatrixPtr mat, const gsMatrix<T> & nearNullspace,
+                                                   index_t numComponents, const gsOptionList & opt )
+{
+    init( give(mat), nearNullspace, numComponents, opt );
+}
+
+template<class T>
+void gsAlgebraicMultiGridOp<T>::init( SpMatrixPtr mat, gsMatrix<T> nullspace, index_t numComponents,
+                                      const gsOptionList & opt )
+{
+    GISMO_ASSERT ( mat->rows() == mat->cols(), "gsAlgebraicMultiGridOp needs a quadratic matrix." );
+    GISMO_ASSERT ( numComponents > 0 && mat->rows() % numComponents == 0,
+                   "The size of the matrix is not a multiple of the number of components." );
+
+    const T           threshold  = opt.askReal  ("StrengthThreshold"  , (T)(0.08)  );
+    const index_t     coarseSize = opt.askInt   ("CoarseSize"         , 500        );
+    const index_t     maxLevels  = opt.askInt   ("MaxLevels"          , 10         );
+    const T           damping    = opt.askReal  ("ProlongationDamping", (T)(4)/3   );
+    const std::string smoother   = opt.askString("Smoother"           , "Chebyshev");
+
+    // On the fine level, a node consists of the degrees of freedom with
+    // the same index in all components
+    index_t numNodes = mat->rows() / numComponents;
+    std::vector<index_t> nodeOfDof(mat->rows());
+    for (index_t i = 0; i < mat->rows(); ++i)
+        nodeOfDof[i] = i % numNodes;
+
+    if (0 == nullspace.size())
+    {
+        nullspace.setZero(mat->rows(), numComponents);
+        for (index_t c = 0; c < numComponents; ++c)
+            nullspace.col(c).segment(c * numNodes, numNodes).setOnes();
+    }
+    GISMO_ASSERT ( nullspace.rows() == mat->rows(), "The near-nullspace does not fit to the matrix." );
+
+    std::vector< SpMatrixPtr >         matrices(1, mat);
+    std::vector< SpMatrixRowMajorPtr > transfer;
+    std::vector< T >                   bounds;
+
+    while ( (index_t)matrices.size() < maxLevels && matrices.back()->rows() > coarseSize )
+    {
+        const SpMatrix & A = *matrices.back();
+        const index_t n = A.rows();
+        const index_t m = nullspace.cols();
+
+        std::vector<index_t> agg;
+        const index_t na = aggregate(A, nodeOfDof, numNodes, threshold, agg);
+
+        // Degrees of freedom of every aggregate and their local indices
+        std::vector<index_t> aggPtr(na + 1, 0), aggDofs(n), local(n);
+        for (index_t i = 0; i < n; ++i)
+            ++aggPtr[ agg[nodeOfDof[i]] + 1 ];
+        std::partial_sum(aggPtr.begin(), aggPtr.end(), aggPtr.begin());
+        std::vector<index_t> pos(aggPtr.begin(), aggPtr.end() - 1);
+        for (index_t i = 0; i < n; ++i)
+        {
+            const index_t a = agg[nodeOfDof[i]];
+            local[i] = pos[a] - aggPtr[a];
+            aggDofs[pos[a]++] = i;
+        }
+
+        // The tentative prolongation maps the coarse near-nullspace to
+        // the fine one on every aggregate: B_a = Q_a R_a
+        std::vector< gsMatrix<T> > Q(na), R(na);
+        std::vector<index_t> coarsePtr(na + 1, 0);
+#       pragma omp parallel for schedule(dynamic, 64)
+        for (index_t a = 0; a < na; ++a)
+        {
+            const index_t s = aggPtr[a+1] - aggPtr[a];
+            gsMatrix<T> Ba(s, m);
+            for (index_t k = 0; k < s; ++k)
+                Ba.row(k) = nullspace.row(aggDofs[aggPtr[a] + k]);
+
+            Eigen::ColPivHouseholderQR<typename gsMatrix<T>::Base> qr(Ba);
+            const index_t r = qr.rank();
+            Q[a].setIdentity(s, r);
+            Q[a].applyOnTheLeft(qr.householderQ());
+            R[a] = qr.matrixQR().topRows(r).template triangularView<Eigen::Upper>();
+            R[a].applyOnTheRight(qr.colsPermutation().transpose());
+            coarsePtr[a+1] = r;
+        }
+        std::partial_sum(coarsePtr.begin(), coarsePtr.end(), coarsePtr.begin());
+        const index_t nc = coarsePtr[na];
+        if (nc >= n) // no coarsening possible
+            break;
+
+        SpMatrixRowMajor Pt(n, nc);
+        index_t * outer = Pt.outerIndexPtr();
+        for (index_t i = 0; i < n; ++i)
+        {
+            const index_t a = agg[nodeOfDof[i]];
+            outer[i+1] = outer[i] + coarsePtr[a+1] - coarsePtr[a];
+        }
+        Pt.resizeNonZeros(outer[n]);
+#       pragma omp parallel for schedule(static)
+        for (index_t i = 0; i < n; ++i)
+        {
+            const index_t a = agg[nodeOfDof[i]];
+            for (index_t k = 0; k < coarsePtr[a+1] - coarsePtr[a]; ++k)
+            {
+                Pt.innerIndexPtr()[outer[i] + k] = coarsePtr[a] + k;
+                Pt.valuePtr()     [outer[i] + k] = Q[a](local[i], k);
+            }
+        }
+
+        // Smoothed prolongation P = (I - omega D^{-1} A) Pt, with omega
+        // scaled by the largest eigenvalue of D^{-1} A
+        const T lambda = gsChebyshevOp<SpMatrix>(matrices.back()).eigenvalueBound();
+        const T omega  = damping / lambda;
+        bounds.push_back(lambda);
+
+        SpMatrixRowMajorPtr P(new SpMatrixRowMajor);
+        internal::amgProduct(A, Pt, *P);
+        const gsVector<T> diag = A.diagonal();
+#       pragma omp parallel for schedule(static)
+        for (index_t i = 0; i < n; ++i)
+        {
+            // The pattern of A Pt contains the one of Pt
+            const index_t * idx = P->innerIndexPtr() + P->outerIndexPtr()[i];
+            const index_t   len = P->outerIndexPtr()[i+1] - P->outerIndexPtr()[i];
+            T * val = P->valuePtr() + P->outerIndexPtr()[i];
+            for (index_t k = 0; k < len; ++k)
+                val[k] *= -omega / diag[i];
+            for (typename SpMatrixRowMajor::InnerIterator it(Pt, i); it; ++it)
+                val[ std::lower_bound(idx, idx + len, it.index()) - idx ] += it.value();
+        }
+
+        // Galerkin product
+        const SpMatrixRowMajor Rt = P->transpose();
+        SpMatrixRowMajor RA, RAP;
+        internal::amgProduct(Rt, A, RA);
+        internal::amgProduct(RA, *P, RAP);
+        matrices.push_back( SpMatrixPtr(new SpMatrix(RAP)) );
+        transfer.push_back( P );
+
+        // The nodes of the coarse level are the aggregates
+        gsMatrix<T> coarseNullspace(nc, m);
+        nodeOfDof.resize(nc);
+        for (index_t a = 0; a < na; ++a)
+        {
+            coarseNullspace.middleRows(coarsePtr[a], coarsePtr[a+1] - coarsePtr[a]) = R[a];
+            std::fill(nodeOfDof.begin() + coarsePtr[a], nodeOfDof.begin() + coarsePtr[a+1], a);
+        }
+        nullspace.swap(coarseNullspace);
+        numNodes = na;
+    }
+
+    // gsMultiGridOp starts with the coarsest level
+    std::reverse(matrices.begin(), matrices.end());
+    std::reverse(transfer.begin(), transfer.end());
+    const index_t nl = matrices.size();
+
+    // If the matrix is too small for coarsening, it is solved directly
+    m_mg = gsMultiGridOp<T>::make(matrices, give(transfer),
+                                  1 == nl ? makeSparseLUSolver(mat) : typename gsLinearOperator<T>::Ptr());
+    m_mg->setOptions(opt);
+    Base::setOptions(opt);
+
+    for (index_t i = 1; i < nl; ++i)
+    {
+        const T lambda = bounds[nl - 1 - i];
+        typename gsPreconditionerOp<T>::Ptr sm;
+        if (smoother == "Chebyshev")
+            sm = makeChebyshevOp(matrices[i], 2, lambda);
+        else if (smoother == "Jacobi")
+            sm = makeJacobiOp(matrices[i], damping / lambda);
+        else if (smoother == "GaussSeidel")
+            sm = makeGaussSeidelOp(matrices[i]);
+        else if (smoother == "MultiColorGaussSeidel")
+            sm = makeMultiColorGaussSeidelOp(matrices[i]);
+        else
+            GISMO_ERROR("gsAlgebraicMultiGridOp: The chosen smoother is unknown. Known are Chebyshev, "
+                        "Jacobi, GaussSeidel and MultiColorGaussSeidel.");
+        m_mg->setSmoother(i, sm);
+    }
+}
+
+template<class T>
+index_t gsAlgebraicMultiGridOp<T>::aggregate( const SpMatrix & mat, const std::vector<index_t> & nodeOfDof,
+                                              index_t numNodes, T threshold, std::vector<index_t> & agg )
+{
+    // Degrees of freedom of every node
+    std::vector<index_t> nodePtr(numNodes + 1, 0), nodeDofs(nodeOfDof.size());
+    for (size_t i = 0; i < nodeOfDof.size(); ++i)
+        ++nodePtr[ nodeOfDof[i] + 1 ];
+    std::partial_sum(nodePtr.begin(), nodePtr.end(), nodePtr.begin());
+    std::vector<index_t> pos(nodePtr.begin(), nodePtr.end() - 1);
+    for (size_t i = 0; i < nodeOfDof.size(); ++i)
+        nodeDofs[ pos[nodeOfDof[i]]++ ] = i;
+
+    // Squared Frobenius norms of the blocks of the matrix that couple
+    // two nodes. The matrix is symmetric, so columns are used as rows.
+    std::vector<T> diag(numNodes, 0);
+#   pragma omp parallel for schedule(static)
+    for (index_t k = 0; k < numNodes; ++k)
+        for (index_t d = nodePtr[k]; d < nodePtr[k+1]; ++d)
+            for (typename SpMatrix::InnerIterator it(mat, nodeDofs[d]); it; ++it)
+                if (nodeOfDof[it.index()] == k)
+                    diag[k] += it.value() * it.value();
+
+    // Strongly connected neighbors of every node:
+    // |A_kl| > threshold * sqrt( |A_kk| |A_ll| )
+    std::vector< std::vector<index_t> > strong(numNodes);
+    const T theta2 = threshold * threshold;
+#   pragma omp parallel
+    {
+        std::vector<index_t> mark(numNodes, -1), nb;
+        std::vector<T> acc(numNodes);
+#       pragma omp for schedule(dynamic, 64)
+        for (index_t k = 0; k < numNodes; ++k)
+        {
+            nb.clear();
+            for (index_t d = nodePtr[k]; d < nodePtr[k+1]; ++d)
+                for (typename SpMatrix::InnerIterator it(mat, nodeDofs[d]); it; ++it)
+                {
+                    const index_t l = nodeOfDof[it.index()];
+                    if (l == k)
+                        continue;
+                    if (mark[l] != k)
+                    {
+                        mark[l] = k;
+                        acc[l]  = 0;
+                        nb.push_back(l);
+                    }
+                    acc[l] += it.value() * it.value();
+                }
+            for (size_t j = 0; j < nb.size(); ++j)
+                if ( acc[nb[j]] > theta2 * math::sqrt(diag[k] * diag[nb[j]]) )
+                    strong[k].push_back(nb[j]);
+        }
+    }
+
+    agg.assign(numNodes, -1);
+    index_t na = 0;
+
+    // 1. Nodes whose strong neighbors are all free form an aggregate
+    // with them
+    for (index_t k = 0; k < numNodes; ++k)
+    {
+        if (agg[k] != -1)
+            continue;
+        bool isFree = true;
+        for (size_t j = 0; isFree && j < strong[k].size(); ++j)
+            isFree = (agg[strong[k][j]] == -1);
+        if (!isFree)
+            continue;
+        agg[k] = na;
+        for (size_t j = 0; j < strong[k].size(); ++j)
+            agg[strong[k][j]] = na;
+        ++na;
+    }
+
+    // 2. The remaining nodes join an aggregate of a strong neighbor
+    const std::vector<index_t> agg1 = agg;
+    for (index_t k = 0; k < numNodes; ++k)
+    {
+        if (agg[k] != -1)
+            continue;
+        for (size_t j = 0; j < strong[k].size(); ++j)
+            if (agg1[strong[k][j]] != -1)
+            {
+                agg[k] = agg1[strong[k][j]];
+                break;
+            }
+    }
+
+    // 3. Nodes which are still left form aggregates with their free
+    // strong neighbors
+    for (index_t k = 0; k < numNodes; ++k)
+    {
+        if (agg[k] != -1)
+            continue;
+        agg[k] = na;
+        for (size_t j = 0; j < strong[k].size(); ++j)
+            if (agg[strong[k][j]] == -1)
+                agg[strong[k][j]] = na;
+        ++na;
+    }
+
+    return na;
+}
+
+template<class T>
+T gsAlgebraicMultiGridOp<T>::operatorComplexity() const
+{
+    T nnz = 0;
+    for (index_t i = 0; i < m_mg->numLevels(); ++i)
+        nnz += m_mg->matrix(i).nonZeros();
+    return nnz / m_mg->matrix().nonZeros();
+}
+
+template<class T>
+gsMatrix<T> gsAlgebraicMultiGridOp<T>::rigidBodyModes(const gsMatrix<T> & points)
+{
+    const index_t d  = points.rows();
+    const index_t nn = points.cols();
+    GISMO_ASSERT ( d == 2 || d == 3, "Rigid body modes are only available in 2D and 3D." );
+
+    // Rotations around the center for a better conditioning
+    const gsMatrix<T> pts = points.colwise() - points.rowwise().mean();
+
+    gsMatrix<T> modes;
+    modes.setZero(d * nn, d * (d + 1) / 2);
+    for (index_t c = 0; c < d; ++c)
+        modes.col(c).segment(c * nn, nn).setOnes();
+
+    if (d == 2)
+    {
+        modes.col(2).head(nn) = -pts.row(1).transpose();
+        modes.col(2).tail(nn) =  pts.row(0).transpose();
+    }
+    else
+    {
+        // Rotation around the axis c
+        for (index_t c = 0; c < 3; ++c)
+        {
+            const index_t c1 = (c + 1) % 3, c2 = (c + 2) % 3;
+            modes.col(3 + c).segment(c1 * nn, nn) = -pts.row(c2).transpose();
+            modes.col(3 + c).segment(c2 * nn, nn) =  pts.row(c1).transpose();
+        }
+    }
+    return modes;
+}
+
+template<class T>
+gsOptionList gsAlgebraicMultiGridOp<T>::defaultOptions()
+{
+    gsOptionList opt = gsMultiGridOp<T>::defaultOptions();
+    opt.addReal  ("StrengthThreshold"  , "Threshold for strong connections between nodes",                         0.08        );
+    opt.addInt   ("CoarseSize"         , "Maximal number of degrees of freedom on the coarsest level",             500         );
+    opt.addInt   ("MaxLevels"          , "Maximal number of levels",                                               10          );
+    opt.addReal  ("ProlongationDamping", "Damping of the prolongation smoother, times the inverse of the largest "
+                                         "eigenvalue of the Jacobi preconditioned matrix",                         4./3        );
+    opt.addString("Smoother"           , "Smoother (Chebyshev, Jacobi, GaussSeidel or MultiColorGaussSeidel)",     "Chebyshev" );
+    return opt;
+}
+
+template<class T>
+void gsAlgebraicMultiGridOp<T>::setOptions(const gsOptionList & opt)
+{
+    Base::setOptions(opt);
+    m_mg->setOptions(opt);
+}
+
+} // namespace gismo
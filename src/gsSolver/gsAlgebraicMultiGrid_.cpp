@@ -0,0 +1,9 @@
+#include <gsSolver/gsAlgebraicMultiGrid.h>
+#include <gsSolver/gsAlgebraicMultiGrid.hpp>
+
+namespace gismo
+{
+
+CLASS_TEMPLATE_INST gsAlgebraicMultiGridOp<real_t>;
+
+} // namespace gismo
@@ -0,0 +1,128 @@
+/** @file gsBlockConjugateGradient.h
+
+    @brief Block conjugate gradient solver for several right-hand sides
+
+    This file is part of the G+Smo library.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include <gsSolver/gsIterativeSolver.h>
+
+namespace gismo
+{
+
+/// @brief The block conjugate gradient method.
+///
+/// Solves a symmetric positive definite system for several right-hand
+/// sides (the columns of \a rhs) at once. The operator and the
+/// preconditioner are applied to blocks of vectors, and the step
+/// lengths are computed from small dense systems of block inner
+/// products. Each iterate minimizes the energy norm of the error over
+/// the sum of the Krylov spaces of all columns.
+///
+/// Search directions that become (numerically) linearly dependent are
+/// removed from the block (breakdown-free variant). Columns that
+/// reached the tolerance are deflated: they are no longer updated and
+/// the preconditioner is not applied to them any more. Since the
+/// recurrence for the search directions only holds for the full block,
+/// the search directions are restarted from the remaining residuals
+/// after a deflation.
+///
+/// The error is the largest relative residual error of all columns.
+/// The errors of the individual columns are available with
+/// columnErrors() and errorHistory().
+///
+/// \ingroup Solver
+template<class T = real_t>
+class gsBlockConjugateGradient : public gsIterativeSolver<T>
+{
+public:
+    typedef gsIterativeSolver<T> Base;
+
+    typedef gsMatrix<T>  VectorType;
+
+    typedef typename Base::LinOpPtr LinOpPtr;
+
+    typedef memory::shared_ptr<gsBlockConjugateGradient> Ptr;
+    typedef memory::unique_ptr<gsBlockConjugateGradient> uPtr;
+
+    /// @brief Constructor using a matrix (operator) and optionally a preconditionner
+    ///
+    /// @param mat     The operator to be solved for, see gsIterativeSolver for details
+    /// @param precond The preconditioner, defaulted to the identity
+    template< typename OperatorType >
+    explicit gsBlockConjugateGradient( const OperatorType& mat,
+                                       const LinOpPtr& precond = LinOpPtr() )
+    : Base(mat, precond) {}
+
+    /// @brief Make function using a matrix (operator) and optionally a preconditionner
+    ///
+    /// @param mat     The operator to be solved for, see gsIterativeSolver for details
+    /// @param precond The preconditioner, defaulted to the identity
+    template< typename OperatorType >
+    static uPtr make( const OperatorType& mat, const LinOpPtr& precond = LinOpPtr() )
+    { return uPtr( new gsBlockConjugateGradient(mat, precond) ); }
+
+    bool initIteration( const VectorType& rhs, VectorType& x );
+    bool step( VectorType& x );
+
+    /// The relative residual errors of the individual columns
+    const gsVector<T> & columnErrors() const { return m_colErrors; }
+
+    /// @brief The relative residual errors of the individual columns
+    /// in every iteration
+    ///
+    /// Row \a i of \a hist holds the errors after iteration \a i, row
+    /// zero the initial errors. Deflated columns keep their last error.
+    void errorHistory( gsMatrix<T> & hist ) const
+    {
+        hist = gsAsConstMatrix<T>(m_history, m_colErrors.size(),
+                                  m_history.size() / m_colErrors.size()).transpose();
+    }
+
+    /// Prints the object as a string.
+    std::ostream &print(std::ostream &os) const
+    {
+        os << "gsBlockConjugateGradient\n";
+        return os;
+    }
+
+private:
+    /// Records the errors of the active columns and deflates the
+    /// converged ones. Returns true if all columns converged.
+    bool updateErrors();
+
+    /// Overwrites \a dir by an orthonormal basis of its range,
+    /// dropping linearly dependent columns
+    static void orthonormalize(VectorType & dir);
+
+private:
+    using Base::m_mat;
+    using Base::m_precond;
+    using Base::m_max_iters;
+    using Base::m_tol;
+    using Base::m_num_iter;
+    using Base::m_rhs_norm;
+    using Base::m_error;
+
+    VectorType m_res;    ///< Residuals of the active columns
+    VectorType m_update; ///< Block of search directions
+    VectorType m_tmp;    ///< Operator applied to the search directions
+    VectorType m_precRes;///< Preconditioned residuals
+
+    std::vector<index_t> m_active; ///< Columns that are not converged
+    gsVector<T> m_rhsNorms;        ///< Norms of the right-hand sides
+    gsVector<T> m_colErrors;       ///< Current errors of all columns
+    std::vector<T> m_history;      ///< Errors of all columns, per iteration
+};
+
+} // namespace gismo
+
+#ifndef GISMO_BUILD_LIB
+#include GISMO_HPP_HEADER(gsBlockConjugateGradient.hpp)
+#endif
@@ -0,0 +1,139 @@
+/** @file gsBlockConjugateGradient.hpp
+
+    @brief Block conjugate gradient solver for several right-hand sides
+
+    This file is part of the G+Smo library.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+namespace gismo
+{
+
+template<class T>
+bool gsBlockConjugateGradient<T>::initIteration( const typename gsBlockConjugateGradient<T>::VectorType& rhs,
+                                                 typename gsBlockConjugateGradient<T>::VectorType& x )
+{
+    GISMO_ASSERT( rhs.rows() == m_mat->rows(),
+                  "The right-hand side does not match the matrix: "
+                  << rhs.rows() <<"!="<< m_mat->rows() );
+
+    GISMO_ASSERT( rhs.cols() > 0, "The right-hand side is empty." );
+
+    const index_t n = rhs.rows(), m = rhs.cols();
+    m_num_iter = 0;
+    m_rhs_norm = rhs.norm();
+    m_rhsNorms = rhs.colwise().norm().transpose();
+
+    if ( 0 == x.size() ) // if no initial solution, start with zeros
+        x.setZero(n, m);
+    else
+    {
+        GISMO_ASSERT( x.rows() == m_mat->cols() && x.cols() == m,
+                      "The initial guess does not match the right-hand side." );
+    }
+
+    m_active.clear();
+    for (index_t j = 0; j != m; ++j)
+    {
+        if (0 == m_rhsNorms[j]) // special case of zero rhs
+            x.col(j).setZero();
+        else
+            m_active.push_back(j);
+    }
+
+    m_mat->apply(x, m_tmp);
+    m_res.resize(n, m_active.size());
+    for (size_t k = 0; k != m_active.size(); ++k)                       // initial residuals
+        m_res.col(k) = rhs.col(m_active[k]) - m_tmp.col(m_active[k]);
+    m_colErrors.setZero(m);
+    m_history.clear();
+    m_history.reserve(m * m_max_iters / 3);
+
+    if (updateErrors())
+        return true;
+
+    m_precond->apply(m_res, m_update);                                  // initial search directions
+    orthonormalize(m_update);
+    return 0 == m_update.cols();
+}
+
+template<class T>
+bool gsBlockConjugateGradient<T>::step( typename gsBlockConjugateGradient<T>::VectorType& x )
+{
+    m_mat->apply(m_update, m_tmp);                                      // apply system matrix
+
+    // Step lengths minimizing the energy norm of the errors
+    const typename gsMatrix<T>::Base PtAP = m_update.transpose() * m_tmp;
+    const Eigen::LDLT<typename gsMatrix<T>::Base> ldlt(PtAP);
+    const gsMatrix<T> alpha = ldlt.solve(m_update.transpose() * m_res);
+
+    m_precRes.noalias() = m_update * alpha;
+    for (size_t k = 0; k != m_active.size(); ++k)
+        x.col(m_active[k]) += m_precRes.col(k);                         // update solutions
+    m_res.noalias() -= m_tmp * alpha;                                   // update residuals
+
+    const size_t na = m_active.size();
+    if (updateErrors())
+        return true;
+
+    m_precond->apply(m_res, m_precRes);
+
+    // New search directions, conjugate to the previous ones. The
+    // recurrence only holds for the full block, so the directions
+    // are restarted if columns were deflated.
+    if (na == m_active.size())
+    {
+        const gsMatrix<T> beta = ldlt.solve(m_tmp.transpose() * m_precRes);
+        m_precRes.noalias() -= m_update * beta;
+    }
+    m_update.swap(m_precRes);
+    orthonormalize(m_update);
+    return 0 == m_update.cols();
+}
+
+template<class T>
+bool gsBlockConjugateGradient<T>::updateErrors()
+{
+    size_t na = 0;
+    for (size_t k = 0; k != m_active.size(); ++k)
+    {
+        const index_t j = m_active[k];
+        m_colErrors[j] = m_res.col(k).norm() / m_rhsNorms[j];
+        if (m_colErrors[j] >= m_tol) // keep column j
+        {
+            if (na != k)
+                m_res.col(na) = m_res.col(k);
+            m_active[na++] = j;
+        }
+    }
+    m_active.resize(na);
+    m_res.conservativeResize(Eigen::NoChange, na);
+
+    m_history.insert(m_history.end(), m_colErrors.data(),
+                     m_colErrors.data() + m_colErrors.size());
+    m_error = m_colErrors.size() ? m_colErrors.maxCoeff() : T(0);
+    return 0 == na;
+}
+
+template<class T>
+void gsBlockConjugateGradient<T>::orthonormalize( typename gsBlockConjugateGradient<T>::VectorType& dir )
+{
+    // Normalize first, such that the rank decision does not depend
+    // on the scaling of the columns
+    for (index_t k = 0; k != dir.cols(); ++k)
+    {
+        const T nrm = dir.col(k).norm();
+        if (0 != nrm)
+            dir.col(k) /= nrm;
+    }
+
+    Eigen::ColPivHouseholderQR<typename gsMatrix<T>::Base> qr(dir);
+    qr.setThreshold( math::sqrt(std::numeric_limits<T>::epsilon()) );
+    dir.setIdentity(dir.rows(), qr.rank());
+    dir.applyOnTheLeft(qr.householderQ());
+}
+
+} // end namespace gismo
@@ -0,0 +1,138 @@
+/** @file gsBlockGMRes.h
+
+    @brief Block GMRES solver for several right-hand sides
+
+    This file is part of the G+Smo library.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+
+#include <gsSolver/gsIterativeSolver.h>
+
+namespace gismo
+{
+
+/// @brief The block generalized minimal residual (GMRES) method.
+///
+/// Solves a system for several right-hand sides (the columns of \a
+/// rhs) at once. A block Arnoldi process builds an orthonormal basis
+/// of the sum of the Krylov spaces of all columns, applying the
+/// operator and the preconditioner to blocks of vectors. The small
+/// block Hessenberg least-squares problem is updated by Householder
+/// reflections in every step. As in gsGMRes, the preconditioner is
+/// applied from the left.
+///
+/// Linearly dependent directions are removed from the Arnoldi blocks.
+/// When some columns reach the tolerance, the current iterate is
+/// formed and the Arnoldi process is restarted on the remaining
+/// columns (deflation).
+///
+/// The error is the largest relative residual error of all columns.
+/// The errors of the individual columns are available with
+/// columnErrors() and errorHistory().
+///
+/// \ingroup Solver
+template<class T = real_t>
+class gsBlockGMRes : public gsIterativeSolver<T>
+{
+public:
+    typedef gsIterativeSolver<T> Base;
+
+    typedef gsMatrix<T>  VectorType;
+
+    typedef typename Base::LinOpPtr LinOpPtr;
+
+    typedef memory::shared_ptr<gsBlockGMRes> Ptr;
+    typedef memory::unique_ptr<gsBlockGMRes> uPtr;
+
+    /// @brief Constructor using a matrix (operator) and optionally a preconditionner
+    ///
+    /// @param mat     The operator to be solved for, see gsIterativeSolver for details
+    /// @param precond The preconditioner, defaulted to the identity
+    template< typename OperatorType >
+    explicit gsBlockGMRes( const OperatorType& mat, const LinOpPtr& precond = LinOpPtr() )
+    : Base(mat, precond) {}
+
+    /// @brief Make function using a matrix (operator) and optionally a preconditionner
+    ///
+    /// @param mat     The operator to be solved for, see gsIterativeSolver for details
+    /// @param precond The preconditioner, defaulted to the identity
+    template< typename OperatorType >
+    static uPtr make( const OperatorType& mat, const LinOpPtr& precond = LinOpPtr() )
+    { return uPtr( new gsBlockGMRes(mat, precond) ); }
+
+    bool initIteration( const VectorType& rhs, VectorType& x );
+    bool step( VectorType& x );
+    void finalizeIteration( VectorType& x );
+
+    /// The relative residual errors of the individual columns
+    const gsVector<T> & columnErrors() const { return m_colErrors; }
+
+    /// @brief The relative residual errors of the individual columns
+    /// in every iteration
+    ///
+    /// Row \a i of \a hist holds the errors after iteration \a i, row
+    /// zero the initial errors. Deflated columns keep their last error.
+    void errorHistory( gsMatrix<T> & hist ) const
+    {
+        hist = gsAsConstMatrix<T>(m_history, m_colErrors.size(),
+                                  m_history.size() / m_colErrors.size()).transpose();
+    }
+
+    /// Prints the object as a string.
+    std::ostream &print(std::ostream &os) const
+    {
+        os << "gsBlockGMRes\n";
+        return os;
+    }
+
+private:
+    /// Starts the Arnoldi process for the active columns at \a x.
+    /// The errors replace the last ones in the history, unless \a
+    /// append is true. Returns true if all columns converged.
+    bool startCycle( const VectorType& x, bool append );
+
+    /// Adds the update of the current Arnoldi process to \a x
+    void finishCycle( VectorType& x );
+
+    /// Records the current errors, see errorHistory()
+    void recordErrors( bool append );
+
+    /// Overwrites \a w by an orthonormal basis of its range, dropping
+    /// linearly dependent columns, and \a coef by the coefficients of
+    /// \a w with respect to this basis
+    static void orthonormalize( VectorType & w, VectorType & coef );
+
+private:
+    using Base::m_mat;
+    using Base::m_precond;
+    using Base::m_max_iters;
+    using Base::m_tol;
+    using Base::m_num_iter;
+    using Base::m_rhs_norm;
+    using Base::m_error;
+
+    typedef Eigen::HouseholderQR<typename gsMatrix<T>::Base> Reflection;
+
+    VectorType m_rhs;                ///< The right-hand sides
+    std::vector<index_t> m_active;   ///< Columns that are not converged
+    gsVector<T> m_rhsNorms;          ///< Norms of the right-hand sides
+    gsVector<T> m_colErrors;         ///< Current errors of all columns
+    std::vector<T> m_history;        ///< Errors of all columns, per iteration
+
+    std::vector<VectorType> m_V;     ///< Blocks of the Arnoldi basis
+    std::vector<index_t>    m_off;   ///< First column of every block
+    std::vector<Reflection> m_refl;  ///< Reflections applied to the Hessenberg matrix
+    VectorType m_R;                  ///< Triangular factor of the Hessenberg matrix
+    VectorType m_G;                  ///< Right-hand side of the least-squares problem
+    VectorType m_tmp, m_w;
+};
+
+} // namespace gismo
+
+#ifndef GISMO_BUILD_LIB
+#include GISMO_HPP_HEADER(gsBlockGMRes.hpp)
+#endif
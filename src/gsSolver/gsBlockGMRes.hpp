@@ -0,0 +1,224 @@
+/** @file gsBlockGMRes.hpp
+
+    @brief Block GMRES solver for several right-hand sides
+
+    This file is part of the G+Smo library.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+namespace gismo
+{
+
+template<class T>
+bool gsBlockGMRes<T>::initIteration( const typename gsBlockGMRes<T>::VectorType& rhs,
+                                     typename gsBlockGMRes<T>::VectorType& x )
+{
+    GISMO_ASSERT( rhs.cols() > 0, "The right-hand side is empty." );
+    GISMO_ASSERT( rhs.rows() == m_mat->rows(),
+                  "The right-hand side does not match the matrix: "
+                  << rhs.rows() <<"!="<< m_mat->rows() );
+
+    const index_t m = rhs.cols();
+    m_num_iter = 0;
+    m_rhs      = rhs;
+    m_rhs_norm = rhs.norm();
+    m_rhsNorms = rhs.colwise().norm().transpose();
+
+    if ( 0 == x.size() ) // if no initial solution, start with zeros
+        x.setZero(rhs.rows(), m);
+    else
+    {
+        GISMO_ASSERT( x.rows() == m_mat->cols() && x.cols() == m,
+                      "The initial guess does not match the right-hand side." );
+    }
+
+    m_active.clear();
+    for (index_t j = 0; j != m; ++j)
+    {
+        if (0 == m_rhsNorms[j]) // special case of zero rhs
+            x.col(j).setZero();
+        else
+            m_active.push_back(j);
+    }
+    m_colErrors.setZero(m);
+    m_history.clear();
+    m_history.reserve(m * m_max_iters / 3);
+
+    return startCycle(x, true);
+}
+
+template<class T>
+bool gsBlockGMRes<T>::startCycle( const typename gsBlockGMRes<T>::VectorType& x, bool append )
+{
+    m_V.clear();
+    m_off.clear();
+    m_refl.clear();
+    m_R.resize(0, 0);
+
+    // Preconditioned residuals of the active columns
+    const index_t na = m_active.size();
+    m_w.resize(x.rows(), na);
+    for (index_t k = 0; k != na; ++k)
+        m_w.col(k) = x.col(m_active[k]);
+    m_mat->apply(m_w, m_tmp);
+    for (index_t k = 0; k != na; ++k)
+        m_tmp.col(k) = m_rhs.col(m_active[k]) - m_tmp.col(k);
+    m_precond->apply(m_tmp, m_w);
+
+    // Deflate the converged columns
+    index_t nc = 0;
+    for (index_t k = 0; k != na; ++k)
+    {
+        const index_t j = m_active[k];
+        m_colErrors[j] = m_w.col(k).norm() / m_rhsNorms[j];
+        if (m_colErrors[j] >= m_tol)
+        {
+            if (nc != k)
+                m_w.col(nc) = m_w.col(k);
+            m_active[nc++] = j;
+        }
+    }
+    m_active.resize(nc);
+    m_w.conservativeResize(Eigen::NoChange, nc);
+    recordErrors(append);
+    if (0 == nc)
+        return true;
+
+    orthonormalize(m_w, m_G);
+    m_V.push_back(m_w);
+    m_off.push_back(0);
+    m_off.push_back(m_w.cols());
+    return false;
+}
+
+template<class T>
+bool gsBlockGMRes<T>::step( typename gsBlockGMRes<T>::VectorType& x )
+{
+    const index_t k    = m_V.size() - 1;
+    const index_t nk   = m_V[k].cols();
+    const index_t off  = m_off[k];
+    const index_t rows = m_off.back();
+
+    m_mat->apply(m_V[k], m_tmp);
+    m_precond->apply(m_tmp, m_w);
+    const T wnorm = m_w.norm();
+
+    // Block modified Gram-Schmidt
+    gsMatrix<T> col(rows, nk), coef;
+    for (index_t i = 0; i <= k; ++i)
+    {
+        col.middleRows(m_off[i], m_V[i].cols()).noalias() = m_V[i].transpose() * m_w;
+        m_w.noalias() -= m_V[i] * col.middleRows(m_off[i], m_V[i].cols());
+    }
+
+    // Next block of the basis; it is empty on breakdown
+    if ( m_w.norm() <= 100 * std::numeric_limits<T>::epsilon() * wnorm )
+        coef.resize(0, nk);
+    else
+        orthonormalize(m_w, coef);
+    const index_t r = coef.rows();
+    col.conservativeResize(rows + r, Eigen::NoChange);
+    col.bottomRows(r) = coef;
+
+    // Apply the previous reflections to the new block column of the
+    // Hessenberg matrix, and eliminate its subdiagonal block
+    for (index_t i = 0; i < k; ++i)
+        col.middleRows(m_off[i], m_refl[i].rows()).applyOnTheLeft(
+            m_refl[i].householderQ().adjoint());
+    m_refl.push_back( Reflection(col.bottomRows(nk + r)) );
+
+    m_R.conservativeResize(off + nk, off + nk);
+    m_R.bottomRows(nk).setZero();
+    m_R.rightCols(nk) = col.topRows(off + nk);
+    m_R.bottomRightCorner(nk, nk) =
+        m_refl[k].matrixQR().topRows(nk).template triangularView<Eigen::Upper>();
+
+    m_G.conservativeResize(rows + r, Eigen::NoChange);
+    m_G.bottomRows(r).setZero();
+    m_G.bottomRows(nk + r).applyOnTheLeft(m_refl[k].householderQ().adjoint());
+
+    // The residuals of the least-squares problem are the residuals of
+    // the (preconditioned) system
+    bool deflate = (0 == r);
+    for (size_t c = 0; c != m_active.size(); ++c)
+    {
+        const index_t j = m_active[c];
+        m_colErrors[j] = m_G.col(c).bottomRows(r).norm() / m_rhsNorms[j];
+        deflate = deflate || m_colErrors[j] < m_tol;
+    }
+    recordErrors(true);
+    if (m_error < m_tol)
+        return true;
+
+    if (deflate)
+    {
+        finishCycle(x);
+        return startCycle(x, false);
+    }
+
+    m_V.push_back(m_w);
+    m_off.push_back(rows + r);
+    return false;
+}
+
+template<class T>
+void gsBlockGMRes<T>::finalizeIteration( typename gsBlockGMRes<T>::VectorType& x )
+{
+    finishCycle(x);
+
+    // cleanup temporaries
+    m_rhs.clear();
+    m_V.clear();
+    m_off.clear();
+    m_refl.clear();
+    m_R.clear();
+    m_G.clear();
+    m_tmp.clear();
+    m_w.clear();
+}
+
+template<class T>
+void gsBlockGMRes<T>::finishCycle( typename gsBlockGMRes<T>::VectorType& x )
+{
+    const index_t n = m_R.cols();
+    if (0 == n)
+        return;
+
+    const gsMatrix<T> y = m_R.template triangularView<Eigen::Upper>().solve(m_G.topRows(n));
+    m_tmp.noalias() = m_V[0] * y.topRows(m_V[0].cols());
+    for (size_t i = 1; i != m_refl.size(); ++i)
+        m_tmp.noalias() += m_V[i] * y.middleRows(m_off[i], m_V[i].cols());
+    for (size_t c = 0; c != m_active.size(); ++c)
+        x.col(m_active[c]) += m_tmp.col(c);
+
+    m_R.resize(0, 0);
+}
+
+template<class T>
+void gsBlockGMRes<T>::recordErrors( bool append )
+{
+    if (append)
+        m_history.insert(m_history.end(), m_colErrors.data(),
+                         m_colErrors.data() + m_colErrors.size());
+    else
+        std::copy(m_colErrors.data(), m_colErrors.data() + m_colErrors.size(),
+                  m_history.end() - m_colErrors.size());
+    m_error = m_colErrors.maxCoeff();
+}
+
+template<class T>
+void gsBlockGMRes<T>::orthonormalize( typename gsBlockGMRes<T>::VectorType& w,
+                                      typename gsBlockGMRes<T>::VectorType& coef )
+{
+    Eigen::ColPivHouseholderQR<typename gsMatrix<T>::Base> qr(w);
+    qr.setThreshold( math::sqrt(std::numeric_limits<T>::epsilon()) );
+    coef.swap(w);
+    w.setIdentity(coef.rows(), qr.rank());
+    w.applyOnTheLeft(qr.householderQ());
+    coef = w.transpose() * coef;
+}
+
+} // end namespace gismo
@@ -0,0 +1,217 @@
+/** @file gsIetiDpSolver.h
+
+    @brief Dual-primal isogeometric tearing and interconnecting (IETI-DP) solver
+
+    This file is part of the G+Smo library.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+
+#include <gsSolver/gsLinearOperator.h>
+#include <gsCore/gsDofMapper.h>
+#include <gsIO/gsOptionList.h>
+#include <gsMpi/gsMpi.h>
+
+namespace gismo
+{
+
+namespace internal
+{
+
+/// @brief Applies an operator and sums up the results of all
+/// processes of a communicator
+///
+/// Every process applies its part of the operator, the sum is
+/// available on all processes.
+template<class T>
+class gsAllReduceOp GISMO_FINAL : public gsLinearOperator<T>
+{
+    typedef typename gsLinearOperator<T>::Ptr BasePtr;
+public:
+
+    /// Shared pointer for gsAllReduceOp
+    typedef memory::shared_ptr<gsAllReduceOp> Ptr;
+
+    /// Unique pointer for gsAllReduceOp
+    typedef memory::unique_ptr<gsAllReduceOp> uPtr;
+
+    /// Constructor taking the local part of the operator and the communicator
+    gsAllReduceOp(BasePtr op, const gsMpiComm & comm)
+    : m_op(give(op)), m_comm(comm) {}
+
+    /// Make function returning a smart pointer
+    static uPtr make(BasePtr op, const gsMpiComm & comm)
+    { return uPtr( new gsAllReduceOp(give(op), comm) ); }
+
+    void apply(const gsMatrix<T> & input, gsMatrix<T> & x) const
+    {
+        m_op->apply(input, x);
+        if (m_comm.size() > 1)
+            m_comm.sum(x.data(), x.size());
+    }
+
+    index_t rows() const { return m_op->rows(); }
+    index_t cols() const { return m_op->cols(); }
+
+private:
+    BasePtr   m_op;
+    gsMpiComm m_comm;
+};
+
+} // namespace internal
+
+/** @brief
+    Dual-primal isogeometric tearing and interconnecting (IETI-DP)
+    solver for the Poisson problem on multipatch domains.
+
+    The patches are the subdomains. On every patch, the Poisson
+    problem is assembled separately, where the interfaces are treated
+    like Neumann boundaries. The continuity across the interfaces is
+    enforced by Lagrange multipliers, where the jump matrices are
+    derived from the interface matching done by the \a gsDofMapper of
+    the whole domain (one multiplier for every pair of patches
+    sharing a degree of freedom).
+
+    The primal degrees of freedom are the values at the corners of
+    the patches (the vertices of the \a gsBoxTopology) and optionally
+    the averages over the interfaces and, in 3D, over the edges, see
+    defaultOptions(). In 2D, corners and interface averages are the
+    usual robust choice. In 3D, corners and face averages alone are
+    not robust with respect to the size of the patches, so the edge
+    averages should be added. On every patch, the primal constraints
+    are incorporated into the local problems, which are factorized
+    once. The resulting system for the Lagrange multipliers is solved
+    by a conjugate gradient method, preconditioned by the scaled
+    Dirichlet preconditioner.
+
+    The local problems are assembled and factorized in parallel, if
+    OpenMP is enabled. If a communicator with several processes is
+    given, the patches are distributed over the processes (round
+    robin), and the results of the local solves are summed up over
+    all processes. The primal problem and the Lagrange multipliers
+    are kept on all processes.
+
+    \code{.cpp}
+        gsIetiDpSolver<> ieti(mp, mb, bc, f);
+        gsMatrix<> x;
+        ieti.solve(x);
+    \endcode
+
+    The solution vector \a x refers to the degrees of freedom of
+    mapper(), which are the same as the ones of a \a gsPoissonAssembler
+    with Dirichlet elimination and glued interfaces.
+
+    \ingroup Solver
+*/
+template<class T>
+class gsIetiDpSolver
+{
+    typedef typename gsLinearOperator<T>::Ptr OpPtr;
+    typedef gsSparseMatrix<T,RowMajor> Transfer;
+
+public:
+
+    /// @brief Constructor, does the whole setup
+    ///
+    /// @param mp      The multipatch domain
+    /// @param mb      The bases on the patches
+    /// @param bc      The boundary conditions
+    /// @param rhs     The right-hand side of the Poisson problem
+    /// @param opt     The options, see defaultOptions()
+    /// @param comm    The communicator
+    gsIetiDpSolver( const gsMultiPatch<T> & mp,
+                    const gsMultiBasis<T> & mb,
+                    const gsBoundaryConditions<T> & bc,
+                    const gsFunction<T> & rhs,
+                    const gsOptionList & opt = defaultOptions(),
+                    const gsMpiComm & comm = gsSerialComm() );
+
+    /// Returns a list of default options
+    static gsOptionList defaultOptions();
+
+    /// @brief Solves the problem
+    ///
+    /// @param x       The solution vector w.r.t. mapper(), available on all processes
+    void solve( gsMatrix<T> & x );
+
+    /// The dof mapper of the whole domain
+    const gsDofMapper & mapper() const { return m_mapper; }
+
+    /// The number of Lagrange multipliers
+    index_t numMultipliers() const { return m_numMultipliers; }
+
+    /// The number of primal degrees of freedom
+    index_t numPrimals() const { return m_numPrimals; }
+
+    /// The operator of the system for the Lagrange multipliers
+    const OpPtr & systemOp() const { return m_system; }
+
+    /// The scaled Dirichlet preconditioner for the Lagrange multipliers
+    const OpPtr & preconditionerOp() const { return m_precond; }
+
+    /// The number of iterations of the last call of solve()
+    index_t iterations() const { return m_iterations; }
+
+    /// The relative residual of the last call of solve()
+    T error() const { return m_error; }
+
+private:
+
+    // The data of a patch (subdomain)
+    struct Subdomain
+    {
+        index_t patch;                   // Index of the patch
+        std::vector<index_t> global;     // Global index of every local degree of freedom
+        gsSparseMatrix<T> matrix;        // Local stiffness matrix
+        gsMatrix<T> rhs;                 // Local right-hand side
+        Transfer jump;                   // Jump matrix, extended by zeros for the constraints
+        OpPtr solver;                    // Solver for the local problem with constraints
+        std::vector<index_t> primals;    // Primal degrees of freedom of the patch
+        gsMatrix<T> primalBasis;         // Energy-minimizing basis for the primals
+        Transfer scaledJump;             // Scaled jump matrix on the interface dofs
+        OpPtr schur;                     // Schur complement on the interface dofs
+    };
+
+    // Sets up the local problem of a patch
+    void setupSubdomain( Subdomain & sd,
+                         const gsMultiPatch<T> & mp,
+                         const gsMultiBasis<T> & mb,
+                         const gsBoundaryConditions<T> & bc,
+                         const gsFunction<T> & rhs,
+                         const gsSparseEntries<T> & jumps,
+                         const gsSparseMatrix<T> & constraints,
+                         const std::vector<index_t> & multiplicity );
+
+    // Solves the local problem of a subdomain with constraints
+    void solveLocal( const Subdomain & sd, const gsMatrix<T> & lambda, gsMatrix<T> & u ) const;
+
+private:
+
+    gsMpiComm   m_comm;
+    gsOptionList m_opt;
+    gsDofMapper m_mapper;
+    index_t     m_numMultipliers;
+    index_t     m_numPrimals;
+
+    std::vector<Subdomain> m_subdomains;   // The patches of this process
+    std::vector<index_t>   m_owner;        // The patch providing the solution for every dof
+
+    memory::shared_ptr<Transfer> m_primalJump; // Jumps of the primal basis of the patches of this process
+    OpPtr       m_primalSolver;
+    gsMatrix<T> m_primalRhs;
+
+    OpPtr m_system;
+    OpPtr m_precond;
+
+    index_t m_iterations;
+    T       m_error;
+};
+
+} // namespace gismo
+
+#ifndef GISMO_BUILD_LIB
+#include GISMO_HPP_HEADER(gsIetiDpSolver.hpp)
+#endif
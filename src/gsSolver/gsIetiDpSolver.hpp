@@ -0,0 +1,514 @@
+/** @file gsIetiDpSolver.hpp
+
+    @brief Dual-primal isogeometric tearing and interconnecting (IETI-DP) solver
+
+    This file is part of the G+Smo library.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+
+#include <gsSolver/gsAdditiveOp.h>
+#include <gsSolver/gsSumOp.h>
+#include <gsSolver/gsProductOp.h>
+#include <gsSolver/gsMatrixOp.h>
+#include <gsSolver/gsConjugateGradient.h>
+#include <gsAssembler/gsPoissonAssembler.h>
+
+namespace gismo
+{
+
+template<class T>
+gsOptionList gsIetiDpSolver<T>::defaultOptions()
+{
+    gsOptionList opt;
+    opt.addReal  ("Tolerance",         "Relative tolerance of the conjugate gradient method", 1e-8);
+    opt.addInt   ("MaxIterations",     "Maximum number of iterations of the conjugate gradient method", 200);
+    opt.addSwitch("InterfaceAverages", "Use the averages over the interfaces as additional primal degrees of freedom", false);
+    opt.addSwitch("EdgeAverages",      "Use the averages over the edges as additional primal degrees of freedom (only in 3D)", false);
+    return opt;
+}
+
+template<class T>
+gsIetiDpSolver<T>::gsIetiDpSolver( const gsMultiPatch<T> & mp,
+                                   const gsMultiBasis<T> & mb,
+                                   const gsBoundaryConditions<T> & bc,
+                                   const gsFunction<T> & rhs,
+                                   const gsOptionList & opt,
+                                   const gsMpiComm & comm )
+: m_comm(comm), m_opt(opt), m_numMultipliers(0), m_numPrimals(0), m_iterations(0), m_error(0)
+{
+    mb.getMapper(dirichlet::elimination, iFace::glue, bc, m_mapper, 0);
+
+    const index_t n = m_mapper.freeSize();
+    const index_t nPatches = mp.nPatches();
+    const index_t nProcs = m_comm.size();
+    GISMO_ENSURE( nPatches >= nProcs, "gsIetiDpSolver needs at least one patch per process." );
+
+    // All free (global dof, patch, basis function) triples, ordered by
+    // the global dofs and then by the patches
+    typedef std::pair<index_t, std::pair<index_t,index_t> > Triple;
+    std::vector<Triple> dofs;
+    for (index_t k=0; k<nPatches; ++k)
+    {
+        const index_t sz = mb.basis(k).size();
+        for (index_t i=0; i<sz; ++i)
+        {
+            const index_t g = m_mapper.index(i,k);
+            if (m_mapper.is_free_index(g))
+                dofs.push_back( Triple(g, std::make_pair(k,i)) );
+        }
+    }
+    std::sort(dofs.begin(), dofs.end());
+
+    // Number of patches sharing every dof, the first of them provides the solution
+    std::vector<index_t> multiplicity(n, 0);
+    m_owner.assign(n, -1);
+    for (size_t j=0; j<dofs.size(); ++j)
+    {
+        const index_t g = dofs[j].first;
+        if (0 == multiplicity[g]++)
+            m_owner[g] = dofs[j].second.first;
+    }
+
+    // Primal dofs: the values at the corners of the patches
+    std::vector<index_t> corners;
+    const index_t nCorners = 1 << mp.parDim();
+    for (index_t k=0; k<nPatches; ++k)
+        for (index_t c=1; c<=nCorners; ++c)
+        {
+            const index_t g = m_mapper.index(mb.basis(k).functionAtCorner(boxCorner(c)), k);
+            if (m_mapper.is_free_index(g) && multiplicity[g] > 1)
+                corners.push_back(g);
+        }
+    std::sort(corners.begin(), corners.end());
+    corners.erase(std::unique(corners.begin(), corners.end()), corners.end());
+
+    std::vector<bool> isCorner(n, false);
+    gsSparseEntries<T> constraints;
+    for (size_t j=0; j<corners.size(); ++j)
+    {
+        isCorner[corners[j]] = true;
+        constraints.add(m_numPrimals++, corners[j], (T)1);
+    }
+
+    // Primal dofs: the averages over the edges shared by several
+    // patches (in 3D). They are excluded from the interface averages,
+    // which keeps the constraints linearly independent.
+    std::vector<bool> isEdge(n, false);
+    if (3 == mp.parDim() && m_opt.askSwitch("EdgeAverages", false))
+    {
+        std::vector< std::vector<index_t> > edges;
+        for (index_t k=0; k<nPatches; ++k)
+            for (index_t b=0; b<27; ++b)
+            {
+                const boxComponent comp(b, 3);
+                if (1 != comp.dim())
+                    continue;
+                gsMatrix<index_t> idx;
+                mb.basis(k).componentBasis_withIndices(comp, idx, true);
+                std::vector<index_t> edge;
+                for (index_t j=0; j<idx.rows(); ++j)
+                {
+                    const index_t g = m_mapper.index(idx(j,0), k);
+                    if (m_mapper.is_free_index(g) && multiplicity[g] > 1 && !isCorner[g])
+                        edge.push_back(g);
+                }
+                if (edge.empty())
+                    continue;
+                std::sort(edge.begin(), edge.end());
+                edges.push_back(give(edge));
+            }
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        for (size_t e=0; e<edges.size(); ++e)
+        {
+            for (size_t j=0; j<edges[e].size(); ++j)
+            {
+                isEdge[edges[e][j]] = true;
+                constraints.add(m_numPrimals, edges[e][j], (T)1/(T)edges[e].size());
+            }
+            ++m_numPrimals;
+        }
+    }
+
+    // Primal dofs: the averages over the interfaces, taken over the
+    // dofs shared by exactly the two patches of the interface (in 3D,
+    // the edges shared by more patches belong to several interfaces)
+    if (m_opt.askSwitch("InterfaceAverages", false))
+    {
+        for (typename gsMultiPatch<T>::const_iiterator it = mp.iBegin(); it != mp.iEnd(); ++it)
+        {
+            const patchSide & ps = it->first();
+            const gsMatrix<index_t> idx = mb.basis(ps.patch).boundary(ps.side());
+            std::vector<index_t> face;
+            for (index_t j=0; j<idx.rows(); ++j)
+            {
+                const index_t g = m_mapper.index(idx(j,0), ps.patch);
+                if (m_mapper.is_free_index(g) && 2 == multiplicity[g] && !isCorner[g] && !isEdge[g])
+                    face.push_back(g);
+            }
+            if (face.empty())
+                continue;
+            for (size_t j=0; j<face.size(); ++j)
+                constraints.add(m_numPrimals, face[j], (T)1/(T)face.size());
+            ++m_numPrimals;
+        }
+    }
+
+    gsSparseMatrix<T> constraintMat(m_numPrimals, n);
+    constraintMat.setFrom(constraints);
+    constraintMat.makeCompressed();
+
+    // Jump matrices: one Lagrange multiplier for every pair of patches
+    // that share a dof, except for the corners. The multipliers are
+    // fully redundant, which the multiplicity scaling of the
+    // preconditioner relies on for dofs shared by more than two patches.
+    std::vector< gsSparseEntries<T> > jumps(nPatches);
+    for (size_t j=0; j<dofs.size(); ++j)
+    {
+        if (isCorner[dofs[j].first])
+            continue;
+        for (size_t i=j+1; i<dofs.size() && dofs[i].first == dofs[j].first; ++i)
+        {
+            jumps[dofs[j].second.first].add(m_numMultipliers, dofs[j].second.second, (T) 1);
+            jumps[dofs[i].second.first].add(m_numMultipliers, dofs[i].second.second, (T)-1);
+            ++m_numMultipliers;
+        }
+    }
+
+    // Set up the local problems of the patches of this process
+    for (index_t k=m_comm.rank(); k<nPatches; k+=nProcs)
+    {
+        m_subdomains.push_back(Subdomain());
+        m_subdomains.back().patch = k;
+    }
+    const index_t nSub = m_subdomains.size();
+
+#   pragma omp parallel for schedule(dynamic, 1)
+    for (index_t s=0; s<nSub; ++s)
+        setupSubdomain(m_subdomains[s], mp, mb, bc, rhs, jumps[m_subdomains[s].patch],
+                       constraintMat, multiplicity);
+
+    // Primal problem, which is sparse since only the primals of the
+    // same patch are coupled. The primal jump is computed from the
+    // nonzeros of the jump matrices.
+    gsSparseEntries<T> primalEntries, primalJump;
+    m_primalRhs.setZero(m_numPrimals, m_subdomains.front().rhs.cols());
+    for (index_t s=0; s<nSub; ++s)
+    {
+        const Subdomain & sd = m_subdomains[s];
+        const gsMatrix<T> & psi = sd.primalBasis;
+        const index_t nl = psi.rows(), c = psi.cols();
+
+        const gsMatrix<T> mat  = psi.transpose() * (sd.matrix * psi);
+        const gsMatrix<T> vec  = psi.transpose() * sd.rhs;
+        for (index_t a=0; a<c; ++a)
+        {
+            for (index_t b=0; b<c; ++b)
+                primalEntries.add(sd.primals[a], sd.primals[b], mat(a,b));
+            m_primalRhs.row(sd.primals[a]) += vec.row(a);
+        }
+        for (index_t r=0; r<sd.jump.outerSize(); ++r)
+            for (typename Transfer::InnerIterator it(sd.jump, r); it; ++it)
+            {
+                if (it.col() >= nl)
+                    continue;
+                for (index_t a=0; a<c; ++a)
+                    if (psi(it.col(),a) != 0)
+                        primalJump.add(r, sd.primals[a], it.value() * psi(it.col(),a));
+            }
+    }
+    if (nProcs > 1)
+    {
+        // The pattern is made the same on all processes by adding
+        // zeros for the primals of the patches of the other processes
+        for (index_t k=0; k<nPatches; ++k)
+        {
+            if (k % nProcs == m_comm.rank())
+                continue;
+            std::vector<index_t> primals;
+            const index_t sz = mb.basis(k).size();
+            for (index_t i=0; i<sz; ++i)
+            {
+                const index_t g = m_mapper.index(i,k);
+                if (m_mapper.is_free_index(g))
+                    for (typename gsSparseMatrix<T>::InnerIterator it(constraintMat, g); it; ++it)
+                        primals.push_back(it.row());
+            }
+            std::sort(primals.begin(), primals.end());
+            primals.erase(std::unique(primals.begin(), primals.end()), primals.end());
+            for (size_t a=0; a<primals.size(); ++a)
+                for (size_t b=0; b<primals.size(); ++b)
+                    primalEntries.add(primals[a], primals[b], (T)0);
+        }
+    }
+    gsSparseMatrix<T> primalMat(m_numPrimals, m_numPrimals);
+    primalMat.setFrom(primalEntries);
+    primalMat.makeCompressed();
+    if (nProcs > 1)
+    {
+        m_comm.sum(primalMat.valuePtr(), primalMat.nonZeros());
+        m_comm.sum(m_primalRhs.data(), m_primalRhs.size());
+    }
+    m_primalJump = memory::make_shared( new Transfer(m_numMultipliers, m_numPrimals) );
+    m_primalJump->setFrom(primalJump);
+    m_primalJump->makeCompressed();
+
+    // Operators for the Lagrange multipliers
+    std::vector<Transfer> localJumps(nSub), scaledJumps(nSub);
+    std::vector<OpPtr> localSolvers(nSub), schurs(nSub);
+    for (index_t s=0; s<nSub; ++s)
+    {
+        localJumps[s]   = m_subdomains[s].jump;
+        localSolvers[s] = m_subdomains[s].solver;
+        scaledJumps[s]  = m_subdomains[s].scaledJump;
+        schurs[s]       = m_subdomains[s].schur;
+    }
+
+    OpPtr system = gsAdditiveOp<T>::make(give(localJumps), give(localSolvers));
+    if (m_numPrimals > 0)
+    {
+        m_primalSolver = makeSparseCholeskySolver(primalMat);
+        // Here we are safe as long as the product holds m_primalJump
+        system = gsSumOp<T>::make( give(system), gsProductOp<T>::make(
+                     internal::gsAllReduceOp<T>::make( makeMatrixOp(m_primalJump->transpose()), m_comm ),
+                     m_primalSolver,
+                     makeMatrixOp(m_primalJump) ) );
+    }
+    m_system  = internal::gsAllReduceOp<T>::make( give(system), m_comm );
+    m_precond = internal::gsAllReduceOp<T>::make(
+                    gsAdditiveOp<T>::make(give(scaledJumps), give(schurs)), m_comm );
+}
+
+template<class T>
+void gsIetiDpSolver<T>::setupSubdomain( Subdomain & sd,
+                                        const gsMultiPatch<T> & mp,
+                                        const gsMultiBasis<T> & mb,
+                                        const gsBoundaryConditions<T> & bc,
+                                        const gsFunction<T> & rhs,
+                                        const gsSparseEntries<T> & jumps,
+                                        const gsSparseMatrix<T> & constraints,
+                                        const std::vector<index_t> & multiplicity )
+{
+    typedef typename gsBoundaryConditions<T>::bcContainer bcContainer;
+    const index_t k = sd.patch;
+
+    // The boundary conditions of the patch, the interfaces are Neumann boundaries
+    gsBoundaryConditions<T> localBc;
+    const bcContainer * conds[3] = { &bc.dirichletSides(), &bc.neumannSides(), &bc.robinSides() };
+    for (index_t l=0; l<3; ++l)
+        for (typename bcContainer::const_iterator it = conds[l]->begin(); it != conds[l]->end(); ++it)
+            if (it->patch() == k)
+                localBc.addCondition(0, it->side(), it->type(), it->function(), it->unknown(), it->parametric());
+
+    // Assemble the local problem
+    gsMultiPatch<T> localMp(mp.patch(k));
+    gsMultiBasis<T> localMb(mb.basis(k));
+    gsPoissonAssembler<T> assembler(localMp, localMb, localBc, rhs, dirichlet::elimination, iFace::glue);
+    assembler.assemble();
+    sd.matrix = assembler.matrix();
+    sd.rhs    = assembler.rhs();
+
+    const gsDofMapper & localMapper = assembler.system().colMapper(0);
+    const index_t nb = mb.basis(k).size();
+    const index_t nl = localMapper.freeSize();
+    std::vector<index_t> local(nb, -1);
+    sd.global.resize(nl);
+    for (index_t i=0; i<nb; ++i)
+    {
+        const index_t li = localMapper.index(i,0);
+        if (!localMapper.is_free_index(li))
+            continue;
+        const index_t g = m_mapper.index(i,k);
+        GISMO_ENSURE( m_mapper.is_free_index(g), "gsIetiDpSolver: Patches that touch the "
+                      "Dirichlet boundary only at a vertex are not supported." );
+        sd.global[li] = g;
+        local[i] = li;
+    }
+
+    // Primal constraints of the patch
+    gsSparseEntries<T> localConstraints;
+    for (index_t l=0; l<nl; ++l)
+        for (typename gsSparseMatrix<T>::InnerIterator it(constraints, sd.global[l]); it; ++it)
+        {
+            sd.primals.push_back(it.row());
+            localConstraints.add(it.row(), l, it.value());
+        }
+    std::sort(sd.primals.begin(), sd.primals.end());
+    sd.primals.erase(std::unique(sd.primals.begin(), sd.primals.end()), sd.primals.end());
+    const index_t c = sd.primals.size();
+
+    // The local saddle point problem, the primal constraints are incorporated by Lagrange multipliers
+    gsSparseEntries<T> saddle;
+    saddle.reserve(sd.matrix.nonZeros() + 2*localConstraints.size());
+    for (index_t j=0; j<sd.matrix.outerSize(); ++j)
+        for (typename gsSparseMatrix<T>::InnerIterator it(sd.matrix, j); it; ++it)
+            saddle.add(it.row(), it.col(), it.value());
+    for (size_t j=0; j<localConstraints.size(); ++j)
+    {
+        const index_t row = nl + ( std::lower_bound(sd.primals.begin(), sd.primals.end(),
+                                   localConstraints[j].row()) - sd.primals.begin() );
+        saddle.add(row, localConstraints[j].col(), localConstraints[j].value());
+        saddle.add(localConstraints[j].col(), row, localConstraints[j].value());
+    }
+    gsSparseMatrix<T> saddleMat(nl+c, nl+c);
+    saddleMat.setFrom(saddle);
+    saddleMat.makeCompressed();
+    sd.solver = makeSparseLUSolver(saddleMat);
+
+    // The energy-minimizing basis for the primal dofs
+    gsMatrix<T> unit, psi;
+    unit.setZero(nl+c, c);
+    unit.bottomRows(c).setIdentity();
+    sd.solver->apply(unit, psi);
+    sd.primalBasis = psi.topRows(nl);
+
+    // The jump matrix, extended by zeros for the constraints
+    gsSparseEntries<T> jumpEntries;
+    for (size_t j=0; j<jumps.size(); ++j)
+        jumpEntries.add(jumps[j].row(), local[jumps[j].col()], jumps[j].value());
+    sd.jump.resize(m_numMultipliers, nl+c);
+    sd.jump.setFrom(jumpEntries);
+    sd.jump.makeCompressed();
+
+    // The Schur complement on the dofs shared with other patches. The
+    // corners have no Lagrange multipliers, but they are not eliminated
+    // either; they get zero columns in the scaled jump matrix.
+    std::vector<index_t> iface, inner;
+    for (index_t l=0; l<nl; ++l)
+        (multiplicity[sd.global[l]] > 1 ? iface : inner).push_back(l);
+    const index_t ng = iface.size(), ni = inner.size();
+
+    gsSparseEntries<T> selGamma, selInner, scaled;
+    std::vector<index_t> gammaIndex(nl, -1);
+    for (index_t j=0; j<ng; ++j)
+    {
+        selGamma.add(iface[j], j, (T)1);
+        gammaIndex[iface[j]] = j;
+    }
+    for (index_t j=0; j<ni; ++j)
+        selInner.add(inner[j], j, (T)1);
+    gsSparseMatrix<T> SG(nl, ng), SI(nl, ni);
+    SG.setFrom(selGamma);
+    SI.setFrom(selInner);
+
+    // Multiplicity scaling
+    for (size_t j=0; j<jumpEntries.size(); ++j)
+    {
+        const index_t l = jumpEntries[j].col();
+        scaled.add(jumpEntries[j].row(), gammaIndex[l], jumpEntries[j].value() / (T)multiplicity[sd.global[l]]);
+    }
+    sd.scaledJump.resize(m_numMultipliers, ng);
+    sd.scaledJump.setFrom(scaled);
+    sd.scaledJump.makeCompressed();
+
+    gsSparseMatrix<T> Kgg = SG.transpose() * sd.matrix * SG;
+    if (0 == ni || 0 == ng)
+        sd.schur = makeMatrixOp(Kgg.moveToPtr());
+    else
+    {
+        gsSparseMatrix<T> Kgi = SG.transpose() * sd.matrix * SI;
+        gsSparseMatrix<T> Kig = SI.transpose() * sd.matrix * SG;
+        gsSparseMatrix<T> Kii = SI.transpose() * sd.matrix * SI;
+        sd.schur = gsSumOp<T>::make(
+            makeMatrixOp(Kgg.moveToPtr()),
+            gsScaledOp<T>::make(
+                gsProductOp<T>::make(
+                    makeMatrixOp(Kig.moveToPtr()),
+                    makeSparseCholeskySolver(Kii),
+                    makeMatrixOp(Kgi.moveToPtr())
+                ),
+                (T)-1
+            )
+        );
+    }
+}
+
+template<class T>
+void gsIetiDpSolver<T>::solveLocal( const Subdomain & sd, const gsMatrix<T> & lambda, gsMatrix<T> & u ) const
+{
+    gsMatrix<T> r = - ( sd.jump.transpose() * lambda );
+    r.topRows(sd.rhs.rows()) += sd.rhs;
+    sd.solver->apply(r, u);
+}
+
+template<class T>
+void gsIetiDpSolver<T>::solve( gsMatrix<T> & x )
+{
+    const index_t nSub = m_subdomains.size();
+    const index_t nRhs = m_primalRhs.cols();
+    std::vector< gsMatrix<T> > u(nSub);
+
+    // Right-hand side for the Lagrange multipliers
+    gsMatrix<T> lambda, up, d;
+    lambda.setZero(m_numMultipliers, nRhs);
+
+#   pragma omp parallel for schedule(dynamic, 1)
+    for (index_t s=0; s<nSub; ++s)
+        solveLocal(m_subdomains[s], lambda, u[s]);
+
+    d.setZero(m_numMultipliers, nRhs);
+    for (index_t s=0; s<nSub; ++s)
+        d.noalias() += m_subdomains[s].jump * u[s];
+    if (m_numPrimals > 0)
+    {
+        m_primalSolver->apply(m_primalRhs, up);
+        d.noalias() += *m_primalJump * up;
+    }
+    if (m_comm.size() > 1)
+        m_comm.sum(d.data(), d.size());
+
+    // Solve for the Lagrange multipliers
+    m_iterations = 0;
+    m_error = 0;
+    if (m_numMultipliers > 0)
+    {
+        gsConjugateGradient<T> solver(m_system, m_precond);
+        solver.setTolerance( m_opt.askReal("Tolerance", 1e-8) );
+        solver.setMaxIterations( m_opt.askInt("MaxIterations", 200) );
+        solver.solve(d, lambda);
+        m_iterations = solver.iterations();
+        m_error = solver.error();
+    }
+
+    // Primal solution
+    if (m_numPrimals > 0)
+    {
+        gsMatrix<T> r = m_primalJump->transpose() * lambda;
+        if (m_comm.size() > 1)
+            m_comm.sum(r.data(), r.size());
+        r = m_primalRhs - r;
+        m_primalSolver->apply(r, up);
+    }
+
+    // Local solutions, every dof is provided by one patch
+    x.setZero(m_mapper.freeSize(), nRhs);
+
+#   pragma omp parallel for schedule(dynamic, 1)
+    for (index_t s=0; s<nSub; ++s)
+    {
+        const Subdomain & sd = m_subdomains[s];
+        const index_t nl = sd.global.size(), c = sd.primals.size();
+        solveLocal(sd, lambda, u[s]);
+
+        gsMatrix<T> sol = u[s].topRows(nl);
+        if (c > 0)
+        {
+            gsMatrix<T> localPrimals(c, nRhs);
+            for (index_t j=0; j<c; ++j)
+                localPrimals.row(j) = up.row(sd.primals[j]);
+            sol.noalias() += sd.primalBasis * localPrimals;
+        }
+        for (index_t l=0; l<nl; ++l)
+            if (m_owner[sd.global[l]] == sd.patch)
+                x.row(sd.global[l]) = sol.row(l);
+    }
+    if (m_comm.size() > 1)
+        m_comm.sum(x.data(), x.size());
+}
+
+} // namespace gismo
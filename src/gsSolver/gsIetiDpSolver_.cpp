@@ -0,0 +1,9 @@
+#include <gsSolver/gsIetiDpSolver.h>
+#include <gsSolver/gsIetiDpSolver.hpp>
+
+namespace gismo
+{
+
+CLASS_TEMPLATE_INST gsIetiDpSolver<real_t>;
+
+} // namespace gismo
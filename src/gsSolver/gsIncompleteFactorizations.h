@@ -0,0 +1,339 @@
+/** @file gsIncompleteFactorizations.h
+
+    @brief Incomplete LU and Cholesky factorizations as preconditioners
+
+    This file is part of the G+Smo library.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+
+#include <gsCore/gsLinearAlgebra.h>
+#include <gsSolver/gsPreconditioner.h>
+#include <gsSolver/gsMatrixOp.h>
+
+namespace gismo
+{
+
+namespace internal
+{
+/// Computes the level schedule of the triangular solve with the lower
+/// (or upper) triangular part of \a M: the rows of one level only depend
+/// on rows of previous levels. \a order contains the rows sorted by level,
+/// the rows of level \a l are order[levelPtr[l]], ..., order[levelPtr[l+1]-1].
+template<typename T>
+void levelSchedule(const gsSparseMatrix<T,RowMajor> & M, bool lower,
+                   std::vector<index_t>& order, std::vector<index_t>& levelPtr);
+/// Solves with the lower triangular part of \a M in place, level by level
+template<typename T>
+void lowerTriangularSolve(const gsSparseMatrix<T,RowMajor> & M, const std::vector<index_t>& diagPos, bool unitDiagonal,
+                          const std::vector<index_t>& order, const std::vector<index_t>& levelPtr, gsMatrix<T>& x);
+/// Solves with the upper triangular part of \a M in place, level by level
+template<typename T>
+void upperTriangularSolve(const gsSparseMatrix<T,RowMajor> & M, const std::vector<index_t>& diagPos,
+                          const std::vector<index_t>& order, const std::vector<index_t>& levelPtr, gsMatrix<T>& x);
+/// Computes the ILU(0) factorization in place of the values of \a LU;
+/// returns the number of vanishing pivots
+template<typename T>
+index_t iluFactorize(gsSparseMatrix<T,RowMajor> & LU, const std::vector<index_t>& diagPos,
+                     const std::vector<index_t>& order, const std::vector<index_t>& levelPtr);
+/// Computes the IC(0) factorization in place of the values of \a L,
+/// which contains the lower triangular part of the matrix; returns the
+/// number of non-positive pivots
+template<typename T>
+index_t icFactorize(gsSparseMatrix<T,RowMajor> & L, const std::vector<index_t>& order,
+                    const std::vector<index_t>& levelPtr);
+} // namespace internal
+
+/// @brief Incomplete LU factorization without fill-in, ILU(0)
+///
+/// The factors \f$ L \f$ and \f$ U \f$ have the sparsity pattern of the
+/// matrix \f$ A \f$, and \f$ LU \f$ coincides with \f$ A \f$ on this
+/// pattern. One step of the preconditioner is
+/// \f$ x_{new} = x_{old} + (LU)^{-1} (f - A x_{old}) \f$, so apply()
+/// computes \f$ (LU)^{-1} f \f$.
+///
+/// The triangular solves are parallelized by level scheduling: the rows
+/// are grouped into levels such that the rows of one level only depend
+/// on the rows of the previous levels, and the rows of one level are
+/// solved in parallel. The same schedule is used for the factorization.
+/// Unlike a multi-color reordering, the result is the same as for the
+/// sequential algorithm. The number of levels depends on the ordering
+/// and the bandwidth of the matrix; if there are only few rows per
+/// level, the solves are done sequentially.
+///
+/// The symbolic part (the pattern, the levels) is only computed in the
+/// constructor. If the values of the matrix change, but not its
+/// pattern, like in a Newton iteration, refactorize() only recomputes
+/// the values of the factors.
+///
+/// If a pivot vanishes, the factorization is repeated for the matrix
+/// with the diagonal scaled by \f$ 1+\sigma \f$, where the shift
+/// \f$ \sigma \f$ is increased until the factorization succeeds. Every
+/// factorization starts again from the shift given to the constructor.
+///
+/// \ingroup Solver
+template<class T = real_t>
+class gsIncompleteLUOp : public gsPreconditionerOp<T>
+{
+public:
+
+    /// Shared pointer for gsIncompleteLUOp
+    typedef memory::shared_ptr<gsIncompleteLUOp> Ptr;
+
+    /// Unique pointer for gsIncompleteLUOp
+    typedef memory::unique_ptr<gsIncompleteLUOp> uPtr;
+
+    /// Base class
+    typedef gsPreconditionerOp<T> Base;
+
+    /// Matrix type
+    typedef gsSparseMatrix<T> SpMatrix;
+
+    /// Smart pointer to matrix type
+    typedef memory::shared_ptr<SpMatrix> SpMatrixPtr;
+
+    /// @brief Constructor with given matrix
+    ///
+    /// @param mat                       The (compressed) system matrix
+    /// @param shift                     The initial shift \f$ \sigma \f$ of the diagonal
+    explicit gsIncompleteLUOp(const SpMatrix & mat, T shift = 0)
+    : m_mat(), m_expr(mat), m_shift(shift), m_usedShift(shift) { init(); }
+
+    /// @brief Constructor with shared pointer to matrix
+    ///
+    /// @param mat                       The (compressed) system matrix
+    /// @param shift                     The initial shift \f$ \sigma \f$ of the diagonal
+    explicit gsIncompleteLUOp(const SpMatrixPtr & mat, T shift = 0)
+    : m_mat(mat), m_expr(*m_mat), m_shift(shift), m_usedShift(shift) { init(); }
+
+    static uPtr make(const SpMatrix & mat, T shift = 0)
+    { return memory::make_unique( new gsIncompleteLUOp(mat, shift) ); }
+
+    static uPtr make(const SpMatrixPtr & mat, T shift = 0)
+    { return memory::make_unique( new gsIncompleteLUOp(mat, shift) ); }
+
+    /// @brief Recomputes the factors from the current values of the matrix
+    ///
+    /// The sparsity pattern of the matrix must not have changed since
+    /// the construction.
+    void refactorize();
+
+    void step(const gsMatrix<T> & rhs, gsMatrix<T> & x) const;
+
+    void stepT(const gsMatrix<T> & rhs, gsMatrix<T> & x) const;
+
+    void apply(const gsMatrix<T> & input, gsMatrix<T> & x) const;
+
+    index_t rows() const {return m_expr.rows();}
+    index_t cols() const {return m_expr.cols();}
+
+    /// Returns the initial shift \f$ \sigma \f$ given to the constructor
+    T shift() const { return m_shift; }
+
+    /// Returns the shift \f$ \sigma \f$ used for the last factorization
+    T usedShift() const { return m_usedShift; }
+
+    /// Returns the number of levels of the triangular solves
+    index_t numLevels() const
+    { return math::max(m_lowerLevelPtr.size(), m_upperLevelPtr.size()) - 1; }
+
+    /// @brief Returns the factors
+    ///
+    /// The strictly lower triangular part contains \f$ L \f$ (with
+    /// unit diagonal), the upper triangular part contains \f$ U \f$.
+    const gsSparseMatrix<T,RowMajor> & factors() const { return m_LU; }
+
+    /// Returns the matrix
+    const SpMatrix & matrix() const { return m_expr; }
+
+    typename gsLinearOperator<T>::Ptr underlyingOp() const
+    {
+        if (m_mat)
+            return makeMatrixOp(m_mat);
+        return makeMatrixOp(m_expr);
+    }
+
+private:
+
+    // Computes the pattern, the levels and the factors
+    void init();
+
+    // Copies the values of the matrix into the factors and factorizes
+    void factorize();
+
+    // Solves with the transposed factors, sequentially
+    void solveTransposed(gsMatrix<T> & x) const;
+
+private:
+    const SpMatrixPtr m_mat;   ///< Shared pointer to matrix (if needed)
+    const SpMatrix &  m_expr;  ///< The matrix
+    T m_shift;                 ///< Initial shift of the diagonal
+    T m_usedShift;             ///< Shift of the last factorization
+
+    gsSparseMatrix<T,RowMajor> m_LU;    ///< The factors
+    std::vector<index_t> m_valueMap;    ///< Position in m_LU of the entries of the matrix
+    std::vector<index_t> m_diagPos;     ///< Position of the diagonal entries in m_LU
+    std::vector<index_t> m_lowerOrder, m_lowerLevelPtr; ///< Levels of the solve with L
+    std::vector<index_t> m_upperOrder, m_upperLevelPtr; ///< Levels of the solve with U
+
+    mutable gsMatrix<T> m_res; ///< Workspace for the residual
+};
+
+/// @brief Incomplete Cholesky factorization without fill-in, IC(0)
+///
+/// The factor \f$ L \f$ has the sparsity pattern of the lower
+/// triangular part of the symmetric positive definite matrix
+/// \f$ A \f$, and \f$ LL^T \f$ coincides with \f$ A \f$ on this
+/// pattern. It needs half of the memory and of the work of
+/// gsIncompleteLUOp, and the preconditioner is symmetric, so it can be
+/// used for gsConjugateGradient.
+///
+/// As for gsIncompleteLUOp, the factorization and the triangular
+/// solves are parallelized by level scheduling, and refactorize()
+/// reuses the symbolic part. If a pivot is not positive (IC(0) may
+/// break down for matrices that are not M-matrices, like the stiffness
+/// matrices of splines of higher degree), the factorization is
+/// repeated with an increasing shift of the diagonal, starting from the
+/// shift given to the constructor.
+///
+/// Only the lower triangular part of the matrix is read.
+///
+/// \ingroup Solver
+template<class T = real_t>
+class gsIncompleteCholeskyOp : public gsPreconditionerOp<T>
+{
+public:
+
+    /// Shared pointer for gsIncompleteCholeskyOp
+    typedef memory::shared_ptr<gsIncompleteCholeskyOp> Ptr;
+
+    /// Unique pointer for gsIncompleteCholeskyOp
+    typedef memory::unique_ptr<gsIncompleteCholeskyOp> uPtr;
+
+    /// Base class
+    typedef gsPreconditionerOp<T> Base;
+
+    /// Matrix type
+    typedef gsSparseMatrix<T> SpMatrix;
+
+    /// Smart pointer to matrix type
+    typedef memory::shared_ptr<SpMatrix> SpMatrixPtr;
+
+    /// @brief Constructor with given matrix
+    ///
+    /// @param mat                       The (compressed, symmetric positive definite) system matrix
+    /// @param shift                     The initial shift \f$ \sigma \f$ of the diagonal
+    explicit gsIncompleteCholeskyOp(const SpMatrix & mat, T shift = 0)
+    : m_mat(), m_expr(mat), m_shift(shift), m_usedShift(shift) { init(); }
+
+    /// @brief Constructor with shared pointer to matrix
+    ///
+    /// @param mat                       The (compressed, symmetric positive definite) system matrix
+    /// @param shift                     The initial shift \f$ \sigma \f$ of the diagonal
+    explicit gsIncompleteCholeskyOp(const SpMatrixPtr & mat, T shift = 0)
+    : m_mat(mat), m_expr(*m_mat), m_shift(shift), m_usedShift(shift) { init(); }
+
+    static uPtr make(const SpMatrix & mat, T shift = 0)
+    { return memory::make_unique( new gsIncompleteCholeskyOp(mat, shift) ); }
+
+    static uPtr make(const SpMatrixPtr & mat, T shift = 0)
+    { return memory::make_unique( new gsIncompleteCholeskyOp(mat, shift) ); }
+
+    /// @brief Recomputes the factor from the current values of the matrix
+    ///
+    /// The sparsity pattern of the matrix must not have changed since
+    /// the construction.
+    void refactorize();
+
+    void step(const gsMatrix<T> & rhs, gsMatrix<T> & x) const;
+
+    void apply(const gsMatrix<T> & input, gsMatrix<T> & x) const;
+
+    index_t rows() const {return m_expr.rows();}
+    index_t cols() const {return m_expr.cols();}
+
+    /// Returns the initial shift \f$ \sigma \f$ given to the constructor
+    T shift() const { return m_shift; }
+
+    /// Returns the shift \f$ \sigma \f$ used for the last factorization
+    T usedShift() const { return m_usedShift; }
+
+    /// Returns the number of levels of the triangular solves
+    index_t numLevels() const
+    { return math::max(m_lowerLevelPtr.size(), m_upperLevelPtr.size()) - 1; }
+
+    /// Returns the factor \f$ L \f$
+    const gsSparseMatrix<T,RowMajor> & factor() const { return m_L; }
+
+    /// Returns the matrix
+    const SpMatrix & matrix() const { return m_expr; }
+
+    typename gsLinearOperator<T>::Ptr underlyingOp() const
+    {
+        if (m_mat)
+            return makeMatrixOp(m_mat);
+        return makeMatrixOp(m_expr);
+    }
+
+private:
+
+    // Computes the pattern, the levels and the factor
+    void init();
+
+    // Copies the values of the matrix into the factor and factorizes
+    void factorize();
+
+private:
+    const SpMatrixPtr m_mat;   ///< Shared pointer to matrix (if needed)
+    const SpMatrix &  m_expr;  ///< The matrix
+    T m_shift;                 ///< Initial shift of the diagonal
+    T m_usedShift;             ///< Shift of the last factorization
+
+    gsSparseMatrix<T,RowMajor> m_L;     ///< The factor L
+    gsSparseMatrix<T,RowMajor> m_Lt;    ///< The transpose of L
+    std::vector<index_t> m_valueMap;    ///< Position in m_L of the entries of the matrix (or -1)
+    std::vector<index_t> m_transposeMap;///< Position in m_Lt of the entries of m_L
+    std::vector<index_t> m_diagPos;     ///< Position of the diagonal entries in m_L
+    std::vector<index_t> m_diagPosT;    ///< Position of the diagonal entries in m_Lt
+    std::vector<index_t> m_lowerOrder, m_lowerLevelPtr; ///< Levels of the solve with L
+    std::vector<index_t> m_upperOrder, m_upperLevelPtr; ///< Levels of the solve with L^T
+
+    mutable gsMatrix<T> m_res; ///< Workspace for the residual
+};
+
+/**
+   \brief Returns a smart pointer to an ILU(0) preconditioner referring on \a mat
+*/
+template <class T>
+typename gsIncompleteLUOp<T>::uPtr makeIncompleteLUOp(const gsSparseMatrix<T> & mat, T shift = 0)
+{ return gsIncompleteLUOp<T>::make(mat, shift); }
+
+/**
+   \brief Returns a smart pointer to an ILU(0) preconditioner referring on \a mat
+*/
+template <class T>
+typename gsIncompleteLUOp<T>::uPtr makeIncompleteLUOp(const memory::shared_ptr< gsSparseMatrix<T> > & mat, T shift = 0)
+{ return gsIncompleteLUOp<T>::make(mat, shift); }
+
+/**
+   \brief Returns a smart pointer to an IC(0) preconditioner referring on \a mat
+*/
+template <class T>
+typename gsIncompleteCholeskyOp<T>::uPtr makeIncompleteCholeskyOp(const gsSparseMatrix<T> & mat, T shift = 0)
+{ return gsIncompleteCholeskyOp<T>::make(mat, shift); }
+
+/**
+   \brief Returns a smart pointer to an IC(0) preconditioner referring on \a mat
+*/
+template <class T>
+typename gsIncompleteCholeskyOp<T>::uPtr makeIncompleteCholeskyOp(const memory::shared_ptr< gsSparseMatrix<T> > & mat, T shift = 0)
+{ return gsIncompleteCholeskyOp<T>::make(mat, shift); }
+
+} // namespace gismo
+
+#ifndef GISMO_BUILD_LIB
+#include GISMO_HPP_HEADER(gsIncompleteFactorizations.hpp)
+#endif
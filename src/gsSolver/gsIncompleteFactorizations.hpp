@@ -0,0 +1,472 @@
+/** @file gsIncompleteFactorizations.hpp
+
+    @brief Incomplete LU and Cholesky factorizations as preconditioners
+
+    This file is part of the G+Smo library.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+namespace gismo
+{
+
+namespace internal
+{
+
+// The levels are only solved in parallel if they contain enough rows
+// on average; otherwise the synchronization after every level costs
+// more than it saves.
+inline bool parallelLevels(index_t numRows, index_t numLevels)
+{ return numRows > 20000 && numRows >= 64 * numLevels; }
+
+// Position of the diagonal entry in every row of a row-major matrix
+// with sorted inner indices
+template<typename T>
+void diagonalPositions(const gsSparseMatrix<T,RowMajor> & M, std::vector<index_t>& diagPos)
+{
+    const index_t n = M.rows();
+    const index_t * outer = M.outerIndexPtr();
+    const index_t * idx   = M.innerIndexPtr();
+
+    diagPos.resize(n);
+    for (index_t i = 0; i < n; ++i)
+    {
+        const index_t * p = std::lower_bound(idx + outer[i], idx + outer[i+1], i);
+        GISMO_ENSURE( p != idx + outer[i+1] && *p == i,
+                      "The incomplete factorization requires all diagonal entries in the sparsity pattern." );
+        diagPos[i] = p - idx;
+    }
+}
+
+template<typename T>
+void levelSchedule(const gsSparseMatrix<T,RowMajor> & M, bool lower,
+                   std::vector<index_t>& order, std::vector<index_t>& levelPtr)
+{
+    GISMO_ASSERT( M.cols() == M.rows(), "The matrix is not square." );
+
+    const index_t n = M.rows();
+    std::vector<index_t> level(n, 0), pos;
+    index_t numLevels = 0;
+
+    // Every row is one level after the last row it depends on
+    for (index_t k = 0; k < n; ++k)
+    {
+        const index_t i = lower ? k : n - 1 - k;
+        index_t l = 0;
+        for (typename gsSparseMatrix<T,RowMajor>::InnerIterator it(M,i); it; ++it)
+            if ( lower ? it.index() < i : it.index() > i )
+                l = math::max(l, level[it.index()] + 1);
+        level[i] = l;
+        numLevels = math::max(numLevels, l + 1);
+    }
+
+    // Sort the rows by level, keeping their order within every level
+    levelPtr.assign(numLevels + 1, 0);
+    for (index_t i = 0; i < n; ++i)
+        ++levelPtr[level[i] + 1];
+    for (index_t l = 0; l < numLevels; ++l)
+        levelPtr[l + 1] += levelPtr[l];
+
+    order.resize(n);
+    pos.assign(levelPtr.begin(), levelPtr.end() - 1);
+    for (index_t i = 0; i < n; ++i)
+        order[pos[level[i]]++] = i;
+}
+
+template<typename T>
+void lowerTriangularSolve(const gsSparseMatrix<T,RowMajor> & M, const std::vector<index_t>& diagPos, bool unitDiagonal,
+                          const std::vector<index_t>& order, const std::vector<index_t>& levelPtr, gsMatrix<T>& x)
+{
+    GISMO_ASSERT( M.rows() == x.rows(), "Dimensions do not match." );
+
+    const index_t numLevels = levelPtr.size() - 1;
+    const index_t nrhs = x.cols();
+    const index_t * outer = M.outerIndexPtr();
+    const index_t * idx   = M.innerIndexPtr();
+    const T       * val   = M.valuePtr();
+
+    // The rows of one level do not depend on each other, so they are solved in parallel
+#   pragma omp parallel if ( parallelLevels(M.rows(), numLevels) )
+    for (index_t l = 0; l < numLevels; ++l)
+    {
+#       pragma omp for schedule(static)
+        for (index_t k = levelPtr[l]; k < levelPtr[l+1]; ++k)
+        {
+            const index_t i = order[k];
+            for (index_t c = 0; c < nrhs; ++c)
+            {
+                T sum = x(i,c);
+                for (index_t p = outer[i]; p < diagPos[i]; ++p)
+                    sum -= val[p] * x(idx[p],c);
+                x(i,c) = unitDiagonal ? sum : sum / val[diagPos[i]];
+            }
+        }
+    }
+}
+
+template<typename T>
+void upperTriangularSolve(const gsSparseMatrix<T,RowMajor> & M, const std::vector<index_t>& diagPos,
+                          const std::vector<index_t>& order, const std::vector<index_t>& levelPtr, gsMatrix<T>& x)
+{
+    GISMO_ASSERT( M.rows() == x.rows(), "Dimensions do not match." );
+
+    const index_t numLevels = levelPtr.size() - 1;
+    const index_t nrhs = x.cols();
+    const index_t * outer = M.outerIndexPtr();
+    const index_t * idx   = M.innerIndexPtr();
+    const T       * val   = M.valuePtr();
+
+    // The rows of one level do not depend on each other, so they are solved in parallel
+#   pragma omp parallel if ( parallelLevels(M.rows(), numLevels) )
+    for (index_t l = 0; l < numLevels; ++l)
+    {
+#       pragma omp for schedule(static)
+        for (index_t k = levelPtr[l]; k < levelPtr[l+1]; ++k)
+        {
+            const index_t i = order[k];
+            for (index_t c = 0; c < nrhs; ++c)
+            {
+                T sum = x(i,c);
+                for (index_t p = diagPos[i] + 1; p < outer[i+1]; ++p)
+                    sum -= val[p] * x(idx[p],c);
+                x(i,c) = sum / val[diagPos[i]];
+            }
+        }
+    }
+}
+
+template<typename T>
+index_t iluFactorize(gsSparseMatrix<T,RowMajor> & LU, const std::vector<index_t>& diagPos,
+                     const std::vector<index_t>& order, const std::vector<index_t>& levelPtr)
+{
+    const index_t n = LU.rows();
+    const index_t numLevels = levelPtr.size() - 1;
+    const index_t * outer = LU.outerIndexPtr();
+    const index_t * idx   = LU.innerIndexPtr();
+    T             * val   = LU.valuePtr();
+    index_t fails = 0;
+
+    // Row i only depends on the rows of its lower triangular part, so
+    // the levels of the solve with L apply to the factorization as well
+#   pragma omp parallel if ( parallelLevels(n, numLevels) ) reduction(+:fails)
+    {
+        // Position of the entries of the current row
+        std::vector<index_t> pos(n, -1);
+
+        for (index_t l = 0; l < numLevels; ++l)
+        {
+#           pragma omp for schedule(static)
+            for (index_t k = levelPtr[l]; k < levelPtr[l+1]; ++k)
+            {
+                const index_t i = order[k];
+                for (index_t p = outer[i]; p < outer[i+1]; ++p)
+                    pos[idx[p]] = p;
+
+                // Eliminate the entries left of the diagonal, dropping the fill-in
+                for (index_t p = outer[i]; p < diagPos[i]; ++p)
+                {
+                    const index_t r = idx[p];
+                    val[p] /= val[diagPos[r]];
+                    for (index_t q = diagPos[r] + 1; q < outer[r+1]; ++q)
+                        if (pos[idx[q]] >= 0)
+                            val[pos[idx[q]]] -= val[p] * val[q];
+                }
+
+                if ( 0 == val[diagPos[i]] || !math::isfinite(val[diagPos[i]]) )
+                    ++fails;
+
+                for (index_t p = outer[i]; p < outer[i+1]; ++p)
+                    pos[idx[p]] = -1;
+            }
+        }
+    }
+    return fails;
+}
+
+template<typename T>
+index_t icFactorize(gsSparseMatrix<T,RowMajor> & L, const std::vector<index_t>& order,
+                    const std::vector<index_t>& levelPtr)
+{
+    const index_t numLevels = levelPtr.size() - 1;
+    const index_t * outer = L.outerIndexPtr();
+    const index_t * idx   = L.innerIndexPtr();
+    T             * val   = L.valuePtr();
+    index_t fails = 0;
+
+    // The diagonal entry is the last one of every row
+#   pragma omp parallel if ( parallelLevels(L.rows(), numLevels) ) reduction(+:fails)
+    for (index_t l = 0; l < numLevels; ++l)
+    {
+#       pragma omp for schedule(static)
+        for (index_t k = levelPtr[l]; k < levelPtr[l+1]; ++k)
+        {
+            const index_t i = order[k], di = outer[i+1] - 1;
+            T diag = val[di];
+            for (index_t p = outer[i]; p < di; ++p)
+            {
+                // Subtract the product of the rows i and r left of column r
+                const index_t r = idx[p], dr = outer[r+1] - 1;
+                T sum = val[p];
+                index_t a = outer[i], b = outer[r];
+                while (a < p && b < dr)
+                {
+                    if (idx[a] == idx[b])
+                        sum -= val[a++] * val[b++];
+                    else if (idx[a] < idx[b])
+                        ++a;
+                    else
+                        ++b;
+                }
+                val[p] = sum / val[dr];
+                diag  -= val[p] * val[p];
+            }
+
+            if ( diag > 0 )
+                val[di] = math::sqrt(diag);
+            else
+            {
+                ++fails;
+                val[di] = 1;
+            }
+        }
+    }
+    return fails;
+}
+
+} // namespace internal
+
+template<class T>
+void gsIncompleteLUOp<T>::init()
+{
+    GISMO_ENSURE( m_expr.rows() == m_expr.cols(), "The matrix is not square." );
+    GISMO_ENSURE( m_expr.isCompressed(), "The incomplete factorization requires a compressed matrix." );
+
+    m_LU = m_expr;
+    internal::diagonalPositions<T>(m_LU, m_diagPos);
+    internal::levelSchedule<T>(m_LU, true , m_lowerOrder, m_lowerLevelPtr);
+    internal::levelSchedule<T>(m_LU, false, m_upperOrder, m_upperLevelPtr);
+
+    // Position of every entry of the matrix in the factors
+    const index_t * outer = m_LU.outerIndexPtr();
+    const index_t * idx   = m_LU.innerIndexPtr();
+    m_valueMap.resize(m_expr.nonZeros());
+    const index_t * outerA = m_expr.outerIndexPtr();
+    const index_t * idxA   = m_expr.innerIndexPtr();
+    for (index_t j = 0; j < m_expr.cols(); ++j)
+        for (index_t k = outerA[j]; k < outerA[j+1]; ++k)
+        {
+            const index_t i = idxA[k];
+            m_valueMap[k] =
+                std::lower_bound(idx + outer[i], idx + outer[i+1], j) - idx;
+        }
+
+    factorize();
+}
+
+template<class T>
+void gsIncompleteLUOp<T>::factorize()
+{
+    const index_t nnz = m_valueMap.size(), n = m_LU.rows();
+    const T * a = m_expr.valuePtr();
+    T * v = m_LU.valuePtr();
+
+    T shift = m_shift;
+    for (;;)
+    {
+#       pragma omp parallel for schedule(static) if (nnz > 20000)
+        for (index_t k = 0; k < nnz; ++k)
+            v[m_valueMap[k]] = a[k];
+        if (0 != shift)
+            for (index_t i = 0; i < n; ++i)
+                v[m_diagPos[i]] *= 1 + shift;
+
+        if ( 0 == internal::iluFactorize<T>(m_LU, m_diagPos, m_lowerOrder, m_lowerLevelPtr) )
+        {
+            m_usedShift = shift;
+            return;
+        }
+
+        shift = (0 == shift) ? (T)(1e-3) : 2 * shift;
+        GISMO_ENSURE( shift <= 1, "The ILU(0) factorization breaks down, even for a shifted diagonal." );
+    }
+}
+
+template<class T>
+void gsIncompleteLUOp<T>::refactorize()
+{
+    GISMO_ENSURE( m_expr.isCompressed() && (size_t)m_expr.nonZeros() == m_valueMap.size(),
+                  "The sparsity pattern of the matrix has changed." );
+    factorize();
+}
+
+template<class T>
+void gsIncompleteLUOp<T>::apply(const gsMatrix<T> & input, gsMatrix<T> & x) const
+{
+    GISMO_ASSERT( m_LU.rows() == input.rows(), "Dimensions do not match." );
+
+    x = input;
+    internal::lowerTriangularSolve<T>(m_LU, m_diagPos, true, m_lowerOrder, m_lowerLevelPtr, x);
+    internal::upperTriangularSolve<T>(m_LU, m_diagPos, m_upperOrder, m_upperLevelPtr, x);
+    for ( index_t i = 1; i < this->m_num_of_sweeps; ++i )
+        step(input, x);
+}
+
+template<class T>
+void gsIncompleteLUOp<T>::step(const gsMatrix<T> & rhs, gsMatrix<T> & x) const
+{
+    GISMO_ASSERT( m_expr.rows() == x.rows() && x.rows() == rhs.rows() && x.cols() == rhs.cols(),
+                  "Dimensions do not match." );
+
+    m_res.noalias() = rhs - m_expr * x;
+    internal::lowerTriangularSolve<T>(m_LU, m_diagPos, true, m_lowerOrder, m_lowerLevelPtr, m_res);
+    internal::upperTriangularSolve<T>(m_LU, m_diagPos, m_upperOrder, m_upperLevelPtr, m_res);
+    x += m_res;
+}
+
+template<class T>
+void gsIncompleteLUOp<T>::stepT(const gsMatrix<T> & rhs, gsMatrix<T> & x) const
+{
+    GISMO_ASSERT( m_expr.rows() == x.rows() && x.rows() == rhs.rows() && x.cols() == rhs.cols(),
+                  "Dimensions do not match." );
+
+    m_res.noalias() = rhs - m_expr.transpose() * x;
+    solveTransposed(m_res);
+    x += m_res;
+}
+
+template<class T>
+void gsIncompleteLUOp<T>::solveTransposed(gsMatrix<T> & x) const
+{
+    const index_t n = m_LU.rows(), nrhs = x.cols();
+    const index_t * outer = m_LU.outerIndexPtr();
+    const index_t * idx   = m_LU.innerIndexPtr();
+    const T       * val   = m_LU.valuePtr();
+
+    // The rows of the factors are the columns of the transposed factors
+    for (index_t i = 0; i < n; ++i)
+        for (index_t c = 0; c < nrhs; ++c)
+        {
+            const T xi = x(i,c) /= val[m_diagPos[i]];
+            for (index_t p = m_diagPos[i] + 1; p < outer[i+1]; ++p)
+                x(idx[p],c) -= val[p] * xi;
+        }
+
+    for (index_t i = n - 1; i >= 0; --i)
+        for (index_t c = 0; c < nrhs; ++c)
+        {
+            const T xi = x(i,c);
+            for (index_t p = outer[i]; p < m_diagPos[i]; ++p)
+                x(idx[p],c) -= val[p] * xi;
+        }
+}
+
+template<class T>
+void gsIncompleteCholeskyOp<T>::init()
+{
+    GISMO_ENSURE( m_expr.rows() == m_expr.cols(), "The matrix is not square." );
+    GISMO_ENSURE( m_expr.isCompressed(), "The incomplete factorization requires a compressed matrix." );
+
+    m_L  = m_expr.template triangularView<Lower>();
+    m_Lt = m_L.transpose();
+    internal::diagonalPositions<T>(m_L , m_diagPos );
+    internal::diagonalPositions<T>(m_Lt, m_diagPosT);
+    internal::levelSchedule<T>(m_L , true , m_lowerOrder, m_lowerLevelPtr);
+    internal::levelSchedule<T>(m_Lt, false, m_upperOrder, m_upperLevelPtr);
+
+    // Position of every entry of the lower triangular part of the matrix in L
+    const index_t * outer = m_L.outerIndexPtr();
+    const index_t * idx   = m_L.innerIndexPtr();
+    m_valueMap.resize(m_expr.nonZeros());
+    const index_t * outerA = m_expr.outerIndexPtr();
+    const index_t * idxA   = m_expr.innerIndexPtr();
+    for (index_t j = 0; j < m_expr.cols(); ++j)
+        for (index_t k = outerA[j]; k < outerA[j+1]; ++k)
+        {
+            const index_t i = idxA[k];
+            m_valueMap[k] = i < j ? -1 :
+                std::lower_bound(idx + outer[i], idx + outer[i+1], j) - idx;
+        }
+
+    // Position of every entry of L in its transpose
+    const index_t * outerT = m_Lt.outerIndexPtr();
+    const index_t * idxT   = m_Lt.innerIndexPtr();
+    m_transposeMap.resize(m_L.nonZeros());
+    for (index_t i = 0; i < m_L.rows(); ++i)
+        for (index_t p = outer[i]; p < outer[i+1]; ++p)
+        {
+            const index_t j = idx[p];
+            m_transposeMap[p] = std::lower_bound(idxT + outerT[j], idxT + outerT[j+1], i) - idxT;
+        }
+
+    factorize();
+}
+
+template<class T>
+void gsIncompleteCholeskyOp<T>::factorize()
+{
+    const index_t nnz = m_valueMap.size(), nnzL = m_transposeMap.size(), n = m_L.rows();
+    const T * a = m_expr.valuePtr();
+    T * v  = m_L.valuePtr();
+    T * vt = m_Lt.valuePtr();
+
+    T shift = m_shift;
+    for (;;)
+    {
+#       pragma omp parallel for schedule(static) if (nnz > 20000)
+        for (index_t k = 0; k < nnz; ++k)
+            if (m_valueMap[k] >= 0)
+                v[m_valueMap[k]] = a[k];
+        if (0 != shift)
+            for (index_t i = 0; i < n; ++i)
+                v[m_diagPos[i]] *= 1 + shift;
+
+        if ( 0 == internal::icFactorize<T>(m_L, m_lowerOrder, m_lowerLevelPtr) )
+        {
+            m_usedShift = shift;
+            break;
+        }
+
+        shift = (0 == shift) ? (T)(1e-3) : 2 * shift;
+        GISMO_ENSURE( shift <= 1, "The IC(0) factorization breaks down, even for a shifted diagonal." );
+    }
+
+#   pragma omp parallel for schedule(static) if (nnzL > 20000)
+    for (index_t p = 0; p < nnzL; ++p)
+        vt[m_transposeMap[p]] = v[p];
+}
+
+template<class T>
+void gsIncompleteCholeskyOp<T>::refactorize()
+{
+    GISMO_ENSURE( m_expr.isCompressed() && (size_t)m_expr.nonZeros() == m_valueMap.size(),
+                  "The sparsity pattern of the matrix has changed." );
+    factorize();
+}
+
+template<class T>
+void gsIncompleteCholeskyOp<T>::apply(const gsMatrix<T> & input, gsMatrix<T> & x) const
+{
+    GISMO_ASSERT( m_L.rows() == input.rows(), "Dimensions do not match." );
+
+    x = input;
+    internal::lowerTriangularSolve<T>(m_L, m_diagPos, false, m_lowerOrder, m_lowerLevelPtr, x);
+    internal::upperTriangularSolve<T>(m_Lt, m_diagPosT, m_upperOrder, m_upperLevelPtr, x);
+    for ( index_t i = 1; i < this->m_num_of_sweeps; ++i )
+        step(input, x);
+}
+
+template<class T>
+void gsIncompleteCholeskyOp<T>::step(const gsMatrix<T> & rhs, gsMatrix<T> & x) const
+{
+    GISMO_ASSERT( m_expr.rows() == x.rows() && x.rows() == rhs.rows() && x.cols() == rhs.cols(),
+                  "Dimensions do not match." );
+
+    m_res.noalias() = rhs - m_expr * x;
+    internal::lowerTriangularSolve<T>(m_L, m_diagPos, false, m_lowerOrder, m_lowerLevelPtr, m_res);
+    internal::upperTriangularSolve<T>(m_Lt, m_diagPosT, m_upperOrder, m_upperLevelPtr, m_res);
+    x += m_res;
+}
+
+} // namespace gismo
@@ -0,0 +1,26 @@
+#include <gsSolver/gsIncompleteFactorizations.h>
+#include <gsSolver/gsIncompleteFactorizations.hpp>
+
+namespace gismo
+{
+
+CLASS_TEMPLATE_INST gsIncompleteLUOp<real_t>;
+CLASS_TEMPLATE_INST gsIncompleteCholeskyOp<real_t>;
+
+namespace internal
+{
+
+TEMPLATE_INST void levelSchedule(const gsSparseMatrix<real_t,RowMajor> & M, bool lower,
+                                 std::vector<index_t>& order, std::vector<index_t>& levelPtr);
+TEMPLATE_INST void lowerTriangularSolve(const gsSparseMatrix<real_t,RowMajor> & M, const std::vector<index_t>& diagPos, bool unitDiagonal,
+                                        const std::vector<index_t>& order, const std::vector<index_t>& levelPtr, gsMatrix<real_t>& x);
+TEMPLATE_INST void upperTriangularSolve(const gsSparseMatrix<real_t,RowMajor> & M, const std::vector<index_t>& diagPos,
+                                        const std::vector<index_t>& order, const std::vector<index_t>& levelPtr, gsMatrix<real_t>& x);
+TEMPLATE_INST index_t iluFactorize(gsSparseMatrix<real_t,RowMajor> & LU, const std::vector<index_t>& diagPos,
+                                   const std::vector<index_t>& order, const std::vector<index_t>& levelPtr);
+TEMPLATE_INST index_t icFactorize(gsSparseMatrix<real_t,RowMajor> & L, const std::vector<index_t>& order,
+                                  const std::vector<index_t>& levelPtr);
+
+} // namespace internal
+
+} // namespace gismo
@@ -23,6 +23,15 @@ namespace gismo
 ///
 /// where \f$ A \otimes B = ( a_{11} B \  a_{12} B \ ... ;  a_{21} B \  a_{22} B \ ... ; ... ) \f$.
 ///
+/// The input vector is seen as a tensor, and every operator is applied
+/// to its own mode. If an operator is a gsMatrixOp of a dense or a
+/// sparse matrix, the mode product is computed directly on the tensor,
+/// without reordering it, in blocks of rows which are distributed over
+/// the threads. Other operators are applied to the fibers of their
+/// mode, which are gathered into the columns of a workspace. The
+/// workspaces are local to every call of apply(), so the operator can
+/// be applied by several threads at once (if its factors can).
+///
 /// \ingroup Solver
 template <class T>
 class gsKroneckerOp GISMO_FINAL : public gsLinearOperator<T>
@@ -81,6 +90,16 @@ public:
     /// Apply provided linear operators without the need of creating an object
     static void apply(const std::vector<BasePtr> & ops, const gsMatrix<T> & input, gsMatrix<T> & x);
 
+private:
+
+    // Applies the operators using the given workspaces
+    static void apply(const std::vector<BasePtr> & ops, const gsMatrix<T> & input, gsMatrix<T> & x,
+                      gsMatrix<T> & q0, gsMatrix<T> & q1, gsMatrix<T> & temp);
+
+    // Applies op to the middle mode of the tensor x of size a x op->cols() x b
+    static void applyMode(const BasePtr & op, const gsMatrix<T> & x, index_t a, index_t b,
+                          gsMatrix<T> & y, gsMatrix<T> & temp);
+
 private:
     std::vector<BasePtr> m_ops;
 };
@@ -11,12 +11,132 @@
     Author(s): C. Hofreither, S. Takacs
 */
 
+#include <gsSolver/gsMatrixOp.h>
+
 namespace gismo
 {
 
+namespace internal
+{
+
+/// @brief Block of rows of a tensor of size a x n x b, seen as matrix
+/// of size nr x n with outer stride a
+template <typename T>
+struct gsKroneckerBlock
+{
+    typedef Eigen::Map<const Eigen::Matrix<T,Dynamic,Dynamic>, 0, Eigen::OuterStride<> > ConstType;
+    typedef Eigen::Map<      Eigen::Matrix<T,Dynamic,Dynamic>, 0, Eigen::OuterStride<> > Type;
+};
+
+// Mode product of a block with a dense matrix
+template <typename T, typename Derived>
+inline void kroneckerModeBlock(const Eigen::MatrixBase<Derived> & A,
+                               const typename gsKroneckerBlock<T>::ConstType & x,
+                               typename gsKroneckerBlock<T>::Type y)
+{ y.noalias() = x * A.transpose(); }
+
+// Mode product of a block with a sparse matrix: every entry of the
+// matrix adds a multiple of a column of x to a column of y
+template <typename T, typename Derived>
+inline void kroneckerModeBlock(const Eigen::SparseMatrixBase<Derived> & A,
+                               const typename gsKroneckerBlock<T>::ConstType & x,
+                               typename gsKroneckerBlock<T>::Type y)
+{
+    const Derived & mat = A.derived();
+    y.setZero();
+    for (index_t k = 0; k < mat.outerSize(); ++k)
+        for (typename Derived::InnerIterator it(mat,k); it; ++it)
+            y.col(it.row()) += it.value() * x.col(it.col());
+}
+
+// Number of rows of the blocks of the mode products
+const index_t kroneckerBlockRows = 128;
+
+/// Applies the matrix A to the middle mode of the tensor x of size
+/// a x A.cols() x b. The blocks of rows of all slices are
+/// distributed over the threads.
+template <typename T, typename MatrixType>
+void kroneckerModeProduct(const MatrixType & A, const T * x, index_t a, index_t b, T * y)
+{
+    typedef typename gsKroneckerBlock<T>::ConstType ConstBlock;
+    typedef typename gsKroneckerBlock<T>::Type      Block;
+
+    const index_t n = A.cols(), m = A.rows();
+    const index_t nb = (a + kroneckerBlockRows - 1) / kroneckerBlockRows;
+
+#   pragma omp parallel for schedule(static) if (a * b * n > 20000)
+    for (index_t k = 0; k < nb * b; ++k)
+    {
+        const index_t s  = k / nb;
+        const index_t r0 = (k % nb) * kroneckerBlockRows;
+        const index_t nr = math::min(kroneckerBlockRows, a - r0);
+        kroneckerModeBlock<T>(A, ConstBlock(x + s * a * n + r0, nr, n, Eigen::OuterStride<>(a)),
+                              Block(y + s * a * m + r0, nr, m, Eigen::OuterStride<>(a)));
+    }
+}
+
+} // namespace internal
+
 /// @cond
 template <typename T>
-void gsKroneckerOp<T>::apply(const std::vector<typename gsLinearOperator<T>::Ptr> & ops, const gsMatrix<T> & input, gsMatrix<T> & x)
+void gsKroneckerOp<T>::applyMode(const BasePtr & op, const gsMatrix<T> & x, index_t a, index_t b,
+                                 gsMatrix<T> & y, gsMatrix<T> & temp)
+{
+    typedef Eigen::Matrix<T,Dynamic,Dynamic> Dense;
+    typedef Eigen::SparseMatrix<T,ColMajor,index_t> Sparse;
+    typedef Eigen::SparseMatrix<T,RowMajor,index_t> SparseRowMajor;
+
+    const index_t n = op->cols(), m = op->rows();
+    GISMO_ASSERT( a * n * b == x.size(), "The input matrix has wrong size." );
+    y.resize(a * m, b);
+
+    // Matrices are applied directly to the tensor
+    const gsLinearOperator<T> * ptr = op.get();
+    if ( const gsMatrixOp< gsMatrix<T> > * A = dynamic_cast< const gsMatrixOp< gsMatrix<T> > * >(ptr) )
+        return internal::kroneckerModeProduct<T>(A->matrix(), x.data(), a, b, y.data());
+    if ( const gsMatrixOp<Dense> * A = dynamic_cast< const gsMatrixOp<Dense> * >(ptr) )
+        return internal::kroneckerModeProduct<T>(A->matrix(), x.data(), a, b, y.data());
+    if ( const gsMatrixOp< Eigen::Transpose<const Dense> > * A = dynamic_cast< const gsMatrixOp< Eigen::Transpose<const Dense> > * >(ptr) )
+        return internal::kroneckerModeProduct<T>(A->matrix(), x.data(), a, b, y.data());
+    if ( const gsMatrixOp< gsSparseMatrix<T> > * A = dynamic_cast< const gsMatrixOp< gsSparseMatrix<T> > * >(ptr) )
+        return internal::kroneckerModeProduct<T>(A->matrix(), x.data(), a, b, y.data());
+    if ( const gsMatrixOp<Sparse> * A = dynamic_cast< const gsMatrixOp<Sparse> * >(ptr) )
+        return internal::kroneckerModeProduct<T>(A->matrix(), x.data(), a, b, y.data());
+    if ( const gsMatrixOp< gsSparseMatrix<T,RowMajor> > * A = dynamic_cast< const gsMatrixOp< gsSparseMatrix<T,RowMajor> > * >(ptr) )
+        return internal::kroneckerModeProduct<T>(A->matrix(), x.data(), a, b, y.data());
+    if ( const gsMatrixOp<SparseRowMajor> * A = dynamic_cast< const gsMatrixOp<SparseRowMajor> * >(ptr) )
+        return internal::kroneckerModeProduct<T>(A->matrix(), x.data(), a, b, y.data());
+
+    // Other operators are applied to the fibers of their mode, which
+    // are gathered in the columns of y
+    typedef typename internal::gsKroneckerBlock<T>::ConstType ConstBlock;
+    typedef typename internal::gsKroneckerBlock<T>::Type      Block;
+    const index_t bs = internal::kroneckerBlockRows;
+    const index_t nb = (a + bs - 1) / bs;
+
+    y.resize(n, a * b);
+#   pragma omp parallel for schedule(static) if (a * b * n > 20000)
+    for (index_t k = 0; k < nb * b; ++k)
+    {
+        const index_t s = k / nb, r0 = (k % nb) * bs, nr = math::min(bs, a - r0);
+        y.middleCols(s * a + r0, nr) = ConstBlock(x.data() + s * a * n + r0, nr, n, Eigen::OuterStride<>(a)).transpose();
+    }
+
+    op->apply(y, temp);
+    GISMO_ASSERT (temp.rows() == m && temp.cols() == a * b, "The linear operator returned a matrix with unexpected size.");
+
+    y.resize(a * m, b);
+#   pragma omp parallel for schedule(static) if (a * b * m > 20000)
+    for (index_t k = 0; k < nb * b; ++k)
+    {
+        const index_t s = k / nb, r0 = (k % nb) * bs, nr = math::min(bs, a - r0);
+        Block(y.data() + s * a * m + r0, nr, m, Eigen::OuterStride<>(a)) = temp.middleCols(s * a + r0, nr).transpose();
+    }
+}
+
+template <typename T>
+void gsKroneckerOp<T>::apply(const std::vector<BasePtr> & ops, const gsMatrix<T> & input, gsMatrix<T> & x,
+                             gsMatrix<T> & q0, gsMatrix<T> & q1, gsMatrix<T> & temp)
 {
     GISMO_ASSERT( !ops.empty(), "Zero-term Kronecker product" );
     const index_t nrOps = ops.size();
@@ -27,58 +147,41 @@ void gsKroneckerOp<T>::apply(const std::vector<typename gsLinearOperator<T>::Ptr
         return;
     }
 
-    //index_t rows = 1; // we don't compute rows as we do not need it
     index_t sz = 1;
-
     for (index_t i = 0; i < nrOps; ++i)
-    {
-        //rows *= ops[i]->rows();
         sz *= ops[i]->cols();
-    }
 
     GISMO_ASSERT (sz == input.rows(), "The input matrix has wrong size.");
     const index_t n = input.cols();
 
-    // Note: algorithm relies on col-major matrices
-    gsMatrix<T, Dynamic, Dynamic, ColMajor> q0, q1;
-    gsMatrix<T> temp;
-
-    // size: sz x n
-    q0 = input;
-
-    for (index_t i = nrOps - 1; i >= 0; --i)
+    // The input is a tensor with the modes of the operators, the last
+    // one running fastest, and the columns as additional mode. The
+    // modes are processed from the first one on, so the last operator
+    // is applied to contiguous fibers and writes to x.
+    index_t a = sz / ops[0]->cols(), b = n;
+    applyMode(ops[0], input, a, b, q0, temp);
+    for (index_t i = 1; i < nrOps - 1; ++i)
     {
-
-        const index_t cols_i = ops[i]->cols();
-        const index_t rows_i = ops[i]->rows();
-        const index_t r_i  = sz / cols_i;
-
-        // Re-order right-hand sides
-        q0.resize(cols_i, n * r_i);
-
-        // Apply operator
-        ops[i]->apply(q0, temp);
-        GISMO_ASSERT (temp.rows() == rows_i && temp.cols() == n * r_i, "The linear operator returned a matrix with unexpected size.");
-
-        // Transpose solution component-wise
-        if (n == 1)
-            q1 = temp.transpose();
-        else
-        {
-            q1.resize(r_i, n * rows_i);
-            for (index_t k = 0; k != n; ++k)
-                q1.middleCols(k*rows_i, rows_i) = temp.middleCols(k*r_i, r_i).transpose();
-        }
-
-        q1.swap( q0 ); // move solution as next right-hand side
-        sz = ( sz / cols_i) * rows_i; // update now the dimensionality such that in the end sz = rows
-        //sz % cols_i == 0, since sz *= ops[i]->cols();
+        b *= ops[i-1]->rows();
+        a /= ops[i]->cols();
+        applyMode(ops[i], q0, a, b, q1, temp);
+        q0.swap(q1);
     }
+    b *= ops[nrOps-2]->rows();
+
+    // Now the fibers of the last mode are the columns of q0
+    q0.resize(ops[nrOps-1]->cols(), b);
+    ops[nrOps-1]->apply(q0, x);
+    GISMO_ASSERT (x.rows() == ops[nrOps-1]->rows() && x.cols() == b,
+                  "The linear operator returned a matrix with unexpected size.");
+    x.resize(x.size() / n, n);
+}
 
-    //GISMO_ASSERT (sz == rows, "Internal error."); // see one above
-
-    q0.resize(sz, n);
-    x.swap( q0 );
+template <typename T>
+void gsKroneckerOp<T>::apply(const std::vector<BasePtr> & ops, const gsMatrix<T> & input, gsMatrix<T> & x)
+{
+    gsMatrix<T> q0, q1, temp;
+    apply(ops, input, x, q0, q1, temp);
 }
 /// @endcond
 
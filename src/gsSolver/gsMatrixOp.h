@@ -18,6 +18,188 @@
 namespace gismo
 {
 
+namespace internal
+{
+
+/// @brief Computes the product of a matrix with a block of vectors
+/// for gsMatrixOp. The general case leaves it to Eigen.
+template <class MatrixType>
+class gsMatrixOpProduct
+{
+public:
+    explicit gsMatrixOpProduct(const MatrixType &) { }
+
+    template <class Nested, class T>
+    void apply(const Nested & mat, const gsMatrix<T> & input, gsMatrix<T> & x) const
+    { x.noalias() = mat * input; }
+};
+
+#ifdef _OPENMP
+
+/// @brief Multi-threaded product of a compressed sparse matrix with a
+/// block of vectors.
+///
+/// The outer indices (rows or columns) are split into one part per
+/// thread, with roughly the same number of non-zeros in every part.
+/// For row-major matrices, each part writes only to its own rows of
+/// the result, so no reduction is needed. For column-major matrices,
+/// each thread multiplies its columns into a private buffer, which
+/// covers only the rows of the entries of these columns (a band for
+/// the usual finite element numberings). Then every thread sums the
+/// buffers in its own range of rows of the result.
+///
+/// The partition is computed from the matrix in every product, so
+/// nothing is stored and the matrix may be changed at any time. The
+/// product is reentrant.
+template <typename T, int _Opt, typename _Index>
+class gsMatrixOpProduct< Eigen::SparseMatrix<T,_Opt,_Index> >
+{
+    typedef Eigen::SparseMatrix<T,_Opt,_Index> MatrixType;
+
+public:
+    explicit gsMatrixOpProduct(const MatrixType &) { }
+
+    void apply(const MatrixType & mat, const gsMatrix<T> & input, gsMatrix<T> & x) const
+    {
+        const index_t nt = omp_get_max_threads();
+        // Small matrices are not worth the overhead
+        if ( nt < 2 || !mat.isCompressed() || mat.nonZeros() < 20000 )
+        {
+            x.noalias() = mat * input;
+            return;
+        }
+
+        GISMO_ASSERT( mat.cols() == input.rows(), "Dimensions do not match.");
+        x.resize(mat.rows(), input.cols());
+        const _Index * outer = mat.outerIndexPtr();
+        const index_t nnz = mat.nonZeros();
+
+        if ( MatrixType::IsRowMajor )
+        {
+            const index_t n = mat.rows();
+#           pragma omp parallel for schedule(static, 1)
+            for (index_t i = 0; i < nt; ++i)
+            {
+                const index_t r0 = firstOuter(outer, n, nnz, nt, i);
+                const index_t r1 = firstOuter(outer, n, nnz, nt, i+1);
+                x.middleRows(r0, r1 - r0).noalias() = mat.middleRows(r0, r1 - r0) * input;
+            }
+            return;
+        }
+
+        const _Index * inner = mat.innerIndexPtr();
+        const T * val = mat.valuePtr();
+        const index_t n = mat.rows(), nc = mat.cols(), nrhs = input.cols();
+        // Buffer of every part, and the first row it covers
+        std::vector< gsMatrix<T> > buf(nt);
+        std::vector<index_t> low(nt, 0);
+
+#       pragma omp parallel
+        {
+            const index_t nth = omp_get_num_threads();
+            const index_t i   = omp_get_thread_num();
+            const index_t c0  = firstOuter(outer, nc, nnz, nth, i);
+            const index_t c1  = firstOuter(outer, nc, nnz, nth, i+1);
+
+            // Rows of the entries of the columns of the part
+            index_t r0 = n, r1 = 0;
+            for (index_t j = c0; j != c1; ++j)
+                if ( outer[j] != outer[j+1] )
+                {
+                    r0 = math::min<index_t>(r0, inner[outer[j]]);
+                    r1 = math::max<index_t>(r1, inner[outer[j+1]-1] + 1);
+                }
+            if ( r1 < r0 )
+                r0 = r1 = 0;
+
+            // The buffer is allocated (first touched) by its thread
+            gsMatrix<T> & y = buf[i];
+            y.setZero(r1 - r0, nrhs);
+            low[i] = r0;
+            for (index_t c = 0; c != nrhs; ++c)
+            {
+                T * yc = y.col(c).data();
+                const T * in = input.col(c).data();
+                for (index_t j = c0; j != c1; ++j)
+                {
+                    const T v = in[j];
+                    for (index_t k = outer[j]; k != outer[j+1]; ++k)
+                        yc[inner[k] - r0] += val[k] * v;
+                }
+            }
+
+#           pragma omp barrier
+
+            const index_t s0 = n * i / nth, s1 = n * (i+1) / nth;
+            x.middleRows(s0, s1 - s0).setZero();
+            for (index_t p = 0; p != nth; ++p)
+            {
+                const index_t a = math::max(s0, low[p]);
+                const index_t b = math::min<index_t>(s1, low[p] + buf[p].rows());
+                if ( a < b )
+                    x.middleRows(a, b - a) += buf[p].middleRows(a - low[p], b - a);
+            }
+        }
+    }
+
+private:
+    // First outer index of part i of nt parts with equal number of
+    // non-zeros
+    static index_t firstOuter(const _Index * outer, index_t n, index_t nnz,
+                              index_t nt, index_t i)
+    {
+        return i == nt ? n : std::lower_bound(outer, outer + n, i * nnz / nt) - outer;
+    }
+};
+
+/// @brief The same for gsSparseMatrix. Note that makeMatrixOp deduces
+/// the Eigen base class for a gsSparseMatrix.
+template <typename T, int _Opt, typename _Index>
+class gsMatrixOpProduct< gsSparseMatrix<T,_Opt,_Index> >
+: public gsMatrixOpProduct< Eigen::SparseMatrix<T,_Opt,_Index> >
+{
+public:
+    explicit gsMatrixOpProduct(const gsSparseMatrix<T,_Opt,_Index> & mat)
+    : gsMatrixOpProduct< Eigen::SparseMatrix<T,_Opt,_Index> >(mat) { }
+};
+
+/// @brief Multi-threaded product of a diagonal matrix with a block of
+/// vectors. Every thread scales its own range of rows.
+template <typename T, int _Size, int _MaxSize>
+class gsMatrixOpProduct< Eigen::DiagonalMatrix<T,_Size,_MaxSize> >
+{
+    typedef Eigen::DiagonalMatrix<T,_Size,_MaxSize> MatrixType;
+
+public:
+    explicit gsMatrixOpProduct(const MatrixType &) { }
+
+    void apply(const MatrixType & mat, const gsMatrix<T> & input, gsMatrix<T> & x) const
+    {
+        const index_t n = input.rows(), nrhs = input.cols();
+        GISMO_ASSERT( mat.cols() == n, "Dimensions do not match.");
+        if ( n * nrhs < 20000 )
+        {
+            x.noalias() = mat * input;
+            return;
+        }
+
+        x.resize(n, nrhs); // keeps the data if x and input are the same
+        const index_t nt = omp_get_max_threads();
+
+#       pragma omp parallel for schedule(static, 1)
+        for (index_t i = 0; i < nt; ++i)
+        {
+            const index_t r0 = n * i / nt, nr = n * (i+1) / nt - r0;
+            x.middleRows(r0, nr) = mat.diagonal().segment(r0, nr).asDiagonal()
+                * input.middleRows(r0, nr);
+        }
+    }
+};
+
+#endif // _OPENMP
+
+} // namespace internal
+
 // left here for debugging purposes
 // template<typename T> struct is_ref { static const bool value = false; };
 // template<typename T> struct is_ref<T&> { static const bool value = true; };
@@ -27,6 +209,10 @@ namespace gismo
   * object) as a linear operator. Needed for the iterative method
   * classes.
   *
+  * If OpenMP is enabled, the product with a (compressed) sparse
+  * matrix or a diagonal matrix is computed in parallel, see
+  * internal::gsMatrixOpProduct.
+  *
   * \ingroup Solver
   */
 template <class MatrixType>
@@ -50,14 +236,14 @@ public:
     /// is not deleted too early (alternatively use constructor by
     /// shared pointer)
     gsMatrixOp(const MatrixType& mat)
-    : m_mat(), m_expr(mat.derived())
+    : m_mat(), m_expr(mat.derived()), m_prod(mat.derived())
     {
         //gsDebug<<typeid(m_expr).name()<<" Ref: "<<is_ref<NestedMatrix>::value<<"\n";
     }
 
     /// @brief Constructor taking a shared pointer
     gsMatrixOp(MatrixPtr mat)
-    : m_mat(give(mat)), m_expr(m_mat->derived())
+    : m_mat(give(mat)), m_expr(m_mat->derived()), m_prod(m_mat->derived())
     { }
 
     /// @brief Make function returning a smart pointer
@@ -72,7 +258,7 @@ public:
     { return uPtr( new gsMatrixOp(give(mat)) ); }
 
     void apply(const gsMatrix<T> & input, gsMatrix<T> & x) const
-    { x.noalias() = m_expr * input; }
+    { m_prod.apply(m_expr, input, x); }
 
     index_t rows() const
     { return m_expr.rows(); }
@@ -93,6 +279,7 @@ public:
 private:
     const MatrixPtr m_mat; ///< Shared pointer to matrix (if needed)
     NestedMatrix   m_expr; ///< Nested Eigen expression
+    internal::gsMatrixOpProduct<MatrixType> m_prod; ///< Computes the product
 };
 
 /** @brief This essentially just calls the gsMatrixOp constructor, but
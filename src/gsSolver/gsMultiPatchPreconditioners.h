@@ -0,0 +1,107 @@
+/** @file gsMultiPatchPreconditioners.h
+
+    @brief Provides preconditioners for multipatch geometries.
+
+    This file is part of the G+Smo library.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+
+#include <gsCore/gsDofMapper.h>
+#include <gsSolver/gsAdditiveOp.h>
+
+namespace gismo
+{
+
+/// @brief Provides preconditioners for multipatch geometries.
+///
+/// This class provides patch-wise additive Schwarz preconditioners
+///
+/// \f$ \sum_{k} T_k A_k^{-1} T_k^T \f$,
+///
+/// where the \f$ T_k \f$ are the transfer matrices of the degrees of
+/// freedom of the patches (as given by a \a gsDofMapper) and the
+/// \f$ A_k = T_k^T A T_k \f$ are the corresponding blocks of the
+/// system matrix. The degrees of freedom on the interfaces belong to
+/// all patches that share them.
+///
+/// The subspaces can be extended by a number of layers of basis
+/// functions, which gives an overlapping Schwarz method. A layer
+/// consists of all basis functions that are coupled to the subspace
+/// by the system matrix, i.e., whose supports overlap with the
+/// supports of the basis functions of the subspace.
+///
+/// If OpenMP is enabled, the local problems are factorized in
+/// parallel, and the corrections are computed concurrently, see
+/// gsAdditiveOp::setConcurrent().
+///
+/// \code{.cpp}
+///    gsLinearOperator<>::Ptr pc = gsMultiPatchPreconditionersCreator<>::additiveSchwarzOp(
+///        assembler.matrix(), assembler.system().colMapper(0), 2 );
+///    gsConjugateGradient<> solver( assembler.matrix(), pc );
+/// \endcode
+///
+/// @ingroup Solver
+template<typename T>
+class gsMultiPatchPreconditionersCreator
+{
+    typedef gsSparseMatrix<T,RowMajor> Transfer;
+public:
+
+    /// Provides the (free) degrees of freedom of every patch
+    ///
+    /// \param mapper  The dof mapper for the system matrix (all components are taken)
+    /// \return The sorted global indices of the degrees of freedom for every patch
+    static std::vector< std::vector<index_t> > patchDofs( const gsDofMapper& mapper );
+
+    /// Extends the given subspaces by layers of basis functions
+    ///
+    /// \param mat      The system matrix, defining which degrees of freedom are coupled
+    /// \param dofs     The sorted global indices of the degrees of freedom of every subspace
+    /// \param overlap  The number of layers to be added
+    static void extendByOverlap( const gsSparseMatrix<T>& mat,
+                                 std::vector< std::vector<index_t> >& dofs,
+                                 index_t overlap );
+
+    /// Provides the transfer matrix for a subspace
+    ///
+    /// \param size  The number of global degrees of freedom
+    /// \param dofs  The global indices of the degrees of freedom of the subspace
+    static Transfer transferMatrix( index_t size, const std::vector<index_t>& dofs );
+
+    /// Provides the additive Schwarz preconditioner with exact local solvers
+    ///
+    /// \param mat        The system matrix
+    /// \param dofs       The global indices of the degrees of freedom of every subspace
+    /// \param symmetric  If true, the local problems are solved with sparse Cholesky
+    ///                   factorizations, otherwise with sparse LU factorizations
+    static typename gsAdditiveOp<T>::uPtr additiveSchwarzOp(
+        const gsSparseMatrix<T>& mat,
+        const std::vector< std::vector<index_t> >& dofs,
+        bool symmetric = true
+    );
+
+    /// Provides the patch-wise additive Schwarz preconditioner with exact local solvers
+    ///
+    /// \param mat        The system matrix
+    /// \param mapper     The dof mapper for the system matrix
+    /// \param overlap    The number of layers of basis functions the patches are extended by
+    /// \param symmetric  If true, the local problems are solved with sparse Cholesky
+    ///                   factorizations, otherwise with sparse LU factorizations
+    static typename gsAdditiveOp<T>::uPtr additiveSchwarzOp(
+        const gsSparseMatrix<T>& mat,
+        const gsDofMapper& mapper,
+        index_t overlap = 0,
+        bool symmetric = true
+    );
+
+};
+
+} // namespace gismo
+
+#ifndef GISMO_BUILD_LIB
+#include GISMO_HPP_HEADER(gsMultiPatchPreconditioners.hpp)
+#endif
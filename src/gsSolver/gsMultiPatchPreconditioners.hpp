@@ -0,0 +1,177 @@
+/** @file gsMultiPatchPreconditioners.hpp
+
+    @brief Provides preconditioners for multipatch geometries.
+
+    This file is part of the G+Smo library.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#pragma once
+
+#include <gsSolver/gsMatrixOp.h>
+
+namespace gismo
+{
+
+template<typename T>
+std::vector< std::vector<index_t> > gsMultiPatchPreconditionersCreator<T>::patchDofs( const gsDofMapper& mapper )
+{
+    const index_t nPatches = mapper.numPatches();
+    const index_t nComps   = mapper.componentsSize();
+
+    std::vector< std::vector<index_t> > result(nPatches);
+    for (index_t k=0; k<nPatches; ++k)
+    {
+        std::vector<index_t> & dofs = result[k];
+        for (index_t c=0; c<nComps; ++c)
+        {
+            const index_t sz = mapper.patchSize(k,c);
+            for (index_t i=0; i<sz; ++i)
+            {
+                const index_t idx = mapper.index(i,k,c);
+                if ( mapper.is_free_index(idx) )
+                    dofs.push_back(idx);
+            }
+        }
+        // The basis functions on the corners and interfaces might be glued
+        std::sort(dofs.begin(), dofs.end());
+        dofs.erase(std::unique(dofs.begin(), dofs.end()), dofs.end());
+    }
+    return result;
+}
+
+template<typename T>
+void gsMultiPatchPreconditionersCreator<T>::extendByOverlap( const gsSparseMatrix<T>& mat,
+                                                             std::vector< std::vector<index_t> >& dofs,
+                                                             index_t overlap )
+{
+    GISMO_ASSERT( mat.rows() == mat.cols(), "The matrix has to be square." );
+    if (overlap <= 0)
+        return;
+
+    const index_t n = mat.rows();
+    const index_t nSub = dofs.size();
+
+#   pragma omp parallel
+    {
+        std::vector<bool> marked(n, false);
+
+#       pragma omp for schedule(dynamic, 1)
+        for (index_t k=0; k<nSub; ++k)
+        {
+            std::vector<index_t> & sub = dofs[k];
+            for (size_t j=0; j<sub.size(); ++j)
+                marked[sub[j]] = true;
+
+            // Every layer adds the neighbours of the previous layer
+            size_t begin = 0;
+            for (index_t l=0; l<overlap; ++l)
+            {
+                const size_t end = sub.size();
+                for (size_t j=begin; j<end; ++j)
+                    for (typename gsSparseMatrix<T>::InnerIterator it(mat, sub[j]); it; ++it)
+                        if (!marked[it.row()])
+                        {
+                            marked[it.row()] = true;
+                            sub.push_back(it.row());
+                        }
+                begin = end;
+            }
+
+            for (size_t j=0; j<sub.size(); ++j)
+                marked[sub[j]] = false;
+            std::sort(sub.begin(), sub.end());
+        }
+    }
+}
+
+template<typename T>
+typename gsMultiPatchPreconditionersCreator<T>::Transfer gsMultiPatchPreconditionersCreator<T>::transferMatrix(
+    index_t size,
+    const std::vector<index_t>& dofs
+    )
+{
+    const index_t sz = dofs.size();
+    gsSparseEntries<T> entries;
+    entries.reserve(sz);
+    for (index_t j=0; j<sz; ++j)
+        entries.add(dofs[j], j, (T)1);
+
+    Transfer result(size, sz);
+    result.setFrom(entries);
+    result.makeCompressed();
+    return result;
+}
+
+template<typename T>
+typename gsAdditiveOp<T>::uPtr gsMultiPatchPreconditionersCreator<T>::additiveSchwarzOp(
+    const gsSparseMatrix<T>& mat,
+    const std::vector< std::vector<index_t> >& dofs,
+    bool symmetric
+    )
+{
+    GISMO_ASSERT( mat.rows() == mat.cols(), "The matrix has to be square." );
+
+    const index_t n = mat.rows();
+    const index_t nSub = dofs.size();
+
+    std::vector<Transfer> transfers(nSub);
+    std::vector< typename gsLinearOperator<T>::Ptr > ops(nSub);
+
+    // The local problems are extracted and factorized in parallel
+#   pragma omp parallel
+    {
+        std::vector<index_t> local(n, -1);
+
+#       pragma omp for schedule(dynamic, 1)
+        for (index_t k=0; k<nSub; ++k)
+        {
+            const std::vector<index_t> & sub = dofs[k];
+            const index_t sz = sub.size();
+            for (index_t j=0; j<sz; ++j)
+                local[sub[j]] = j;
+
+            gsSparseEntries<T> entries;
+            for (index_t j=0; j<sz; ++j)
+                for (typename gsSparseMatrix<T>::InnerIterator it(mat, sub[j]); it; ++it)
+                    if (local[it.row()] >= 0)
+                        entries.add(local[it.row()], j, it.value());
+
+            gsSparseMatrix<T> localMat(sz, sz);
+            localMat.setFrom(entries);
+            localMat.makeCompressed();
+
+            if (symmetric)
+                ops[k] = makeSparseCholeskySolver(localMat);
+            else
+                ops[k] = makeSparseLUSolver(localMat);
+            transfers[k] = transferMatrix(n, sub);
+
+            for (index_t j=0; j<sz; ++j)
+                local[sub[j]] = -1;
+        }
+    }
+
+    // The sparse direct solvers can be applied concurrently
+    typename gsAdditiveOp<T>::uPtr result = gsAdditiveOp<T>::make(give(transfers), give(ops));
+    result->setConcurrent();
+    return result;
+}
+
+template<typename T>
+typename gsAdditiveOp<T>::uPtr gsMultiPatchPreconditionersCreator<T>::additiveSchwarzOp(
+    const gsSparseMatrix<T>& mat,
+    const gsDofMapper& mapper,
+    index_t overlap,
+    bool symmetric
+    )
+{
+    GISMO_ASSERT( mapper.freeSize() == mat.rows(), "The mapper does not fit to the matrix." );
+    std::vector< std::vector<index_t> > dofs = patchDofs(mapper);
+    extendByOverlap(mat, dofs, overlap);
+    return additiveSchwarzOp(mat, dofs, symmetric);
+}
+
+} // namespace gismo
@@ -0,0 +1,9 @@
+#include <gsSolver/gsMultiPatchPreconditioners.h>
+#include <gsSolver/gsMultiPatchPreconditioners.hpp>
+
+namespace gismo
+{
+
+CLASS_TEMPLATE_INST gsMultiPatchPreconditionersCreator<real_t>;
+
+} // namespace gismo
@@ -104,6 +104,9 @@ public:
     ///
     /// The stiffness matrix represents \f$ -\Delta u + \alpha u \f$
     ///
+    /// The univariate eigendecompositions are cached (see clearCache())
+    /// and the operator is applied in parallel if OpenMP is enabled.
+    ///
     /// \param basis  A tensor basis
     /// \param bc     Boundary conditions
     /// \param opt    Assembler options
@@ -154,6 +157,26 @@ public:
         const gsOptionList& opt = gsAssembler<T>::defaultOptions()
     );
 
+    /// Clears the cache of the univariate mass and stiffness matrices
+    /// and of their generalized eigendecompositions
+    ///
+    /// The univariate matrices of B-spline bases are cached, keyed by
+    /// the knot vector, the degree and the boundary conditions, so that
+    /// they are shared between the patches and the grid levels with the
+    /// same univariate bases. The cache holds at most cacheCapacity()
+    /// entries, the least recently used ones are dropped first.
+    static void clearCache();
+
+    /// Sets the maximum number of univariate bases kept in the cache
+    /// (default: 32); 0 disables the cache
+    static void setCacheCapacity(index_t n);
+
+    /// Returns the maximum number of univariate bases kept in the cache
+    static index_t cacheCapacity();
+
+    /// Returns the number of univariate bases currently in the cache
+    static index_t cacheSize();
+
 };
 
 } // namespace gismo
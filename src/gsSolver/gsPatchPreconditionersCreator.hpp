@@ -22,6 +22,124 @@
 namespace gismo
 {
 
+namespace internal {
+
+/// @brief Cache for the univariate mass and stiffness matrices and
+/// their generalized eigendecompositions, as used by
+/// gsPatchPreconditionersCreator.
+///
+/// The entries are never changed after they have been inserted, so
+/// they can be shared between all operators. The cache holds at most
+/// capacity() entries; if it is full, the entry that has not been used
+/// for the longest time is dropped. Accessing the cache is thread-safe.
+template<typename T>
+class gsUnivariatePatchCache
+{
+public:
+    struct Entry
+    {
+        gsSparseMatrix<T> mass, stiff;
+        gsMatrix<T>       eigenvalues;  ///< Only if the eigenvectors are available
+        memory::shared_ptr< gsMatrix<T> > eigenvectors;
+    };
+
+    typedef memory::shared_ptr<const Entry> EntryPtr;
+
+    /// Flags (degree, periodicity, boundary conditions) and knots
+    typedef std::pair< std::vector<index_t>, std::vector<T> > Key;
+
+    static EntryPtr find(const Key & key)
+    {
+        EntryPtr result;
+#       pragma omp critical (gsUnivariatePatchCache)
+        {
+            typename Map::iterator it = data().entries.find(key);
+            if (it != data().entries.end())
+            {
+                it->second.second = ++data().clock;
+                result = it->second.first;
+            }
+        }
+        return result;
+    }
+
+    static void insert(const Key & key, const EntryPtr & entry)
+    {
+#       pragma omp critical (gsUnivariatePatchCache)
+        {
+            Data & d = data();
+            d.entries[key] = std::make_pair(entry, ++d.clock);
+            shrink(d);
+        }
+    }
+
+    static void clear()
+    {
+#       pragma omp critical (gsUnivariatePatchCache)
+        data().entries.clear();
+    }
+
+    static index_t size()
+    {
+        index_t result;
+#       pragma omp critical (gsUnivariatePatchCache)
+        result = data().entries.size();
+        return result;
+    }
+
+    static index_t capacity()
+    {
+        index_t result;
+#       pragma omp critical (gsUnivariatePatchCache)
+        result = data().capacity;
+        return result;
+    }
+
+    static void setCapacity(index_t n)
+    {
+        GISMO_ENSURE( n >= 0, "The capacity of the cache cannot be negative." );
+#       pragma omp critical (gsUnivariatePatchCache)
+        {
+            Data & d = data();
+            d.capacity = n;
+            shrink(d);
+        }
+    }
+
+private:
+    // The entries together with the time of their last use
+    typedef std::map<Key, std::pair<EntryPtr, unsigned long> > Map;
+
+    struct Data
+    {
+        Data() : capacity(32), clock(0) { }
+        Map           entries;
+        index_t       capacity;
+        unsigned long clock;
+    };
+
+    static Data & data()
+    {
+        static Data d;
+        return d;
+    }
+
+    // Drops the least recently used entries until the capacity is met
+    static void shrink(Data & d)
+    {
+        while ( (index_t)d.entries.size() > d.capacity )
+        {
+            typename Map::iterator oldest = d.entries.begin();
+            for (typename Map::iterator it = d.entries.begin(); it != d.entries.end(); ++it)
+                if (it->second.second < oldest->second.second)
+                    oldest = it;
+            d.entries.erase(oldest);
+        }
+    }
+};
+
+} // namespace internal
+
 namespace {
 
 template<typename T>
@@ -92,6 +210,80 @@ gsSparseMatrix<T> assembleStiffness(const gsBasis<T>& basis)
     return result;
 }
 
+// Determines the key of a univariate basis for the cache; returns
+// false if the basis is not a B-spline basis (e.g., NURBS)
+template<typename T>
+bool univariateKey(const gsBasis<T>& basis,
+                   const gsBoundaryConditions<T>& bc,
+                   const gsOptionList& opt,
+                   typename internal::gsUnivariatePatchCache<T>::Key & key)
+{
+    const gsBSplineBasis<T>* bbasis = dynamic_cast<const gsBSplineBasis<T>*>(&basis);
+    if (!bbasis)
+        return false;
+
+    patchSide west(0,boundary::west), east(0,boundary::east);
+    key.first.resize(5);
+    key.first[0] = bbasis->degree();
+    key.first[1] = bbasis->isPeriodic();
+    key.first[2] = opt.askInt("DirichletStrategy",dirichlet::elimination);
+    key.first[3] = bc.getConditionFromSide( west ) && bc.getConditionFromSide( west )->type() == condition_type::dirichlet;
+    key.first[4] = bc.getConditionFromSide( east ) && bc.getConditionFromSide( east )->type() == condition_type::dirichlet;
+    key.second.assign(bbasis->knots().begin(), bbasis->knots().end());
+    return true;
+}
+
+// Provides the univariate mass and stiffness matrix and, if requested,
+// the generalized eigendecomposition, taken from the cache if possible
+template<typename T>
+typename internal::gsUnivariatePatchCache<T>::EntryPtr univariateData(
+    const gsBasis<T>& basis,
+    const gsBoundaryConditions<T>& bc,
+    const gsOptionList& opt,
+    bool eigen
+    )
+{
+    typedef internal::gsUnivariatePatchCache<T> Cache;
+
+    typename Cache::Key key;
+    const bool cacheable = univariateKey(basis, bc, opt, key);
+
+    typename Cache::EntryPtr cached;
+    if (cacheable)
+    {
+        cached = Cache::find(key);
+        if (cached && (!eigen || cached->eigenvectors))
+            return cached;
+    }
+
+    memory::shared_ptr<typename Cache::Entry> result(new typename Cache::Entry);
+    if (cached)
+    {
+        result->mass  = cached->mass;
+        result->stiff = cached->stiff;
+    }
+    else
+    {
+        result->mass  = assembleMass(basis);
+        eliminateDirichlet1D(bc, opt, result->mass);
+        result->stiff = assembleStiffness(basis);
+        eliminateDirichlet1D(bc, opt, result->stiff);
+    }
+
+    if (eigen)
+    {
+        // Q^T M Q = I, or M = Q^{-T} Q^{-1}
+        // Q^T K Q = D, or K = Q^{-T} D Q^{-1}
+        typename gsMatrix<T>::GenSelfAdjEigenSolver ges;
+        ges.compute(result->stiff, result->mass, Eigen::ComputeEigenvectors);
+        result->eigenvalues = ges.eigenvalues();
+        result->eigenvectors = gsMatrix<T>(ges.eigenvectors()).moveToPtr();
+    }
+
+    if (cacheable)
+        Cache::insert(key, result);
+    return result;
+}
 
 template<typename T>
 std::vector< gsSparseMatrix<T> > assembleTensorMass(
@@ -104,8 +296,7 @@ std::vector< gsSparseMatrix<T> > assembleTensorMass(
     std::vector< gsSparseMatrix<T> > result(d);
     for ( index_t i=0; i!=d; ++i )
     {
-        result[i] = assembleMass(basis.component(d-1-i));
-        eliminateDirichlet1D(boundaryConditionsForDirection(bc,d-1-i), opt, result[i]);
+        result[i] = univariateData(basis.component(d-1-i), boundaryConditionsForDirection(bc,d-1-i), opt, false)->mass;
     }
     return result;
 }
@@ -121,8 +312,7 @@ std::vector< gsSparseMatrix<T> > assembleTensorStiffness(
     std::vector< gsSparseMatrix<T> > result(d);
     for ( index_t i=0; i!=d; ++i )
     {
-        result[i] = assembleStiffness(basis.component(d-1-i));
-        eliminateDirichlet1D(boundaryConditionsForDirection(bc,d-1-i), opt, result[i]);
+        result[i] = univariateData(basis.component(d-1-i), boundaryConditionsForDirection(bc,d-1-i), opt, false)->stiff;
     }
     return result;
 }
@@ -261,14 +451,15 @@ typename gsPatchPreconditionersCreator<T>::OpUPtr gsPatchPreconditionersCreator<
 
     const index_t d = basis.dim();
 
-    // Assemble univariate
-    std::vector< gsSparseMatrix<T> > local_stiff = assembleTensorStiffness(basis, bc, opt);
-    std::vector< gsSparseMatrix<T> > local_mass  = assembleTensorMass(basis, bc, opt);
+    // Univariate eigendecompositions (from the cache if possible)
+    std::vector< typename internal::gsUnivariatePatchCache<T>::EntryPtr > local(d);
+    for ( index_t i=0; i<d; ++i )
+        local[i] = univariateData(basis.component(d-1-i), boundaryConditionsForDirection(bc,d-1-i), opt, true);
 
     // Determine overall size
     index_t sz = 1;
     for ( index_t i=0; i<d; ++i )
-        sz *= local_stiff[i].rows();
+        sz *= local[i]->eigenvalues.rows();
 
     // Initialize the diagonal with 1
     gsMatrix<T> diag;
@@ -276,25 +467,14 @@ typename gsPatchPreconditionersCreator<T>::OpUPtr gsPatchPreconditionersCreator<
 
     index_t glob = sz; // Indexing value for setting up the Kronecker product
 
-    typedef typename gsMatrix<T>::GenSelfAdjEigenSolver EVSolver;
-    typedef typename EVSolver::EigenvectorsType evMatrix;
-    typedef typename EVSolver::RealVectorType evVector;
-    EVSolver ges;
-
     std::vector<OpPtr> Qop(d);
     std::vector<OpPtr> QTop(d);
-    gsMatrix<T> ev;
 
     // Now, setup the Q's and update the D's
     for ( index_t i=0; i<d; ++i )
     {
-        // Solve generalized eigenvalue problem
-        ges.compute(local_stiff[i], local_mass[i], Eigen::ComputeEigenvectors);
-        // Q^T M Q = I, or M = Q^{-T} Q^{-1}
-        // Q^T K Q = D, or K = Q^{-T} D Q^{-1}
-
         // From the eigenvalues, we setup the matrix D already in an Kroneckerized way.
-        const evVector & D = ges.eigenvalues();
+        const gsMatrix<T> & D = local[i]->eigenvalues;
 
         const index_t loc = D.rows();
         glob /= loc;
@@ -305,11 +485,9 @@ typename gsPatchPreconditionersCreator<T>::OpUPtr gsPatchPreconditionersCreator<
                 for ( index_t n=0; n<glob2; ++n )
                     diag( m + l*glob + n*loc*glob, 0 ) += D(l,0);
 
-        // Finally, we store the eigenvectors
-        ev.swap(const_cast<evMatrix&>(ges.eigenvectors()));
-
-        // These are the operators representing the eigenvectors
-        typename gsMatrixOp< gsMatrix<T> >::Ptr matrOp = makeMatrixOp( ev.moveToPtr() );
+        // These are the operators representing the eigenvectors, which
+        // are shared with the cache
+        typename gsMatrixOp< gsMatrix<T> >::Ptr matrOp = makeMatrixOp( local[i]->eigenvectors );
         Qop [i] = matrOp;
         // Here we are safe as long as we do not want to apply QTop after Qop got destroyed.
         QTop[i] = makeMatrixOp( matrOp->matrix().transpose() );
@@ -717,4 +895,28 @@ typename gsPatchPreconditionersCreator<T>::OpUPtr gsPatchPreconditionersCreator<
 
 }
 
+template<typename T>
+void gsPatchPreconditionersCreator<T>::clearCache()
+{
+    internal::gsUnivariatePatchCache<T>::clear();
+}
+
+template<typename T>
+void gsPatchPreconditionersCreator<T>::setCacheCapacity(index_t n)
+{
+    internal::gsUnivariatePatchCache<T>::setCapacity(n);
+}
+
+template<typename T>
+index_t gsPatchPreconditionersCreator<T>::cacheCapacity()
+{
+    return internal::gsUnivariatePatchCache<T>::capacity();
+}
+
+template<typename T>
+index_t gsPatchPreconditionersCreator<T>::cacheSize()
+{
+    return internal::gsUnivariatePatchCache<T>::size();
+}
+
 } // namespace gismo
@@ -0,0 +1,164 @@
+/** @file gsPipelinedConjugateGradient.h
+
+    @brief Pipelined (communication hiding) conjugate gradient solver
+
+    This file is part of the G+Smo library.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include <gsSolver/gsIterativeSolver.h>
+#include <gsMpi/gsMpi.h>
+
+namespace gismo
+{
+
+/// @brief The pipelined conjugate gradient method.
+///
+/// A reformulation of the preconditioned conjugate gradient method
+/// due to Ghysels and Vanroose, which needs only one global reduction
+/// per iteration. The three inner products of an iteration are
+/// computed in one sweep over the vectors and summed in one
+/// (non-blocking) reduction. While the reduction is in flight, the
+/// preconditioner and the operator are applied to the next auxiliary
+/// vector, so the latency of the reduction is hidden behind this work.
+/// The price are four additional vectors, more axpy operations per
+/// iteration, and one application of the preconditioner and of the
+/// operator that is wasted when the tolerance is reached.
+///
+/// In exact arithmetic, the iterates coincide with the ones of
+/// gsConjugateGradient. In floating point arithmetic, the recursively
+/// updated residual drifts away from the true residual faster, since
+/// it is updated by a longer recurrence. Therefore, the residual and
+/// the auxiliary vectors are recomputed periodically (option
+/// ReplacementPeriod) and before the iteration stops.
+///
+/// For distributed runs, set the communicator with setComm(). Then
+/// the operator, the preconditioner and all vectors are expected to be
+/// distributed, every process holding its own rows, and the inner
+/// products are summed over the communicator. Locally, the inner
+/// products are computed by all OpenMP threads.
+///
+/// \ingroup Solver
+template<class T = real_t>
+class gsPipelinedConjugateGradient : public gsIterativeSolver<T>
+{
+public:
+    typedef gsIterativeSolver<T> Base;
+
+    typedef gsMatrix<T>  VectorType;
+
+    typedef typename Base::LinOpPtr LinOpPtr;
+
+    typedef memory::shared_ptr<gsPipelinedConjugateGradient> Ptr;
+    typedef memory::unique_ptr<gsPipelinedConjugateGradient> uPtr;
+
+    /// @brief Constructor using a matrix (operator) and optionally a preconditionner
+    ///
+    /// @param mat     The operator to be solved for, see gsIterativeSolver for details
+    /// @param precond The preconditioner, defaulted to the identity
+    template< typename OperatorType >
+    explicit gsPipelinedConjugateGradient( const OperatorType& mat,
+                                           const LinOpPtr& precond = LinOpPtr() )
+    : Base(mat, precond), m_distributed(false), m_replace(50) {}
+
+    /// @brief Make function using a matrix (operator) and optionally a preconditionner
+    ///
+    /// @param mat     The operator to be solved for, see gsIterativeSolver for details
+    /// @param precond The preconditioner, defaulted to the identity
+    template< typename OperatorType >
+    static uPtr make( const OperatorType& mat, const LinOpPtr& precond = LinOpPtr() )
+    { return uPtr( new gsPipelinedConjugateGradient(mat, precond) ); }
+
+    /// @brief Returns a list of default options
+    static gsOptionList defaultOptions()
+    {
+        gsOptionList opt = Base::defaultOptions();
+        opt.addInt("ReplacementPeriod", "The residual and the auxiliary vectors are"
+                   " recomputed every ReplacementPeriod iterations (0: never)", 50 );
+        return opt;
+    }
+
+    /// @brief Set the options based on a gsOptionList
+    gsPipelinedConjugateGradient& setOptions(const gsOptionList& opt)
+    {
+        Base::setOptions(opt);
+        m_replace = opt.askInt("ReplacementPeriod", m_replace);
+        return *this;
+    }
+
+    /// @brief Sets the communicator for distributed runs
+    ///
+    /// The inner products are summed over \a comm, see the class
+    /// description.
+    void setComm( const gsMpiComm & comm )
+    {
+        m_comm = comm;
+        m_distributed = true;
+    }
+
+    bool initIteration( const VectorType& rhs, VectorType& x );
+    bool step( VectorType& x );
+    void finalizeIteration( VectorType& x );
+
+    /// Prints the object as a string.
+    std::ostream &print(std::ostream &os) const
+    {
+        os << "gsPipelinedConjugateGradient\n";
+        return os;
+    }
+
+private:
+    /// Updates the iterate and all vectors of the recurrence, and
+    /// computes the local parts of (r,u), (w,u) and (r,r) in the same
+    /// sweep over the vectors
+    void update( VectorType& x, T alpha, T beta );
+
+    /// Recomputes the residual from \a x, and all vectors of the
+    /// recurrence from the residual and the search direction
+    void replaceResidual( const VectorType& x );
+
+    /// Sums the inner products over all processes and applies the
+    /// preconditioner and the operator to w meanwhile. Returns true if
+    /// the residual reached the tolerance.
+    bool reduce();
+
+private:
+    using Base::m_mat;
+    using Base::m_precond;
+    using Base::m_max_iters;
+    using Base::m_tol;
+    using Base::m_num_iter;
+    using Base::m_rhs_norm;
+    using Base::m_error;
+
+    gsMpiComm m_comm;    ///< Communicator for the inner products
+    bool m_distributed;  ///< True if the inner products are summed over m_comm
+
+    index_t m_replace;   ///< Period of the residual replacement
+
+    VectorType m_rhs;    ///< The right-hand side
+    VectorType m_res;    ///< Residual r
+    VectorType m_u;      ///< Preconditioned residual u = M r
+    VectorType m_w;      ///< w = A u
+    VectorType m_m;      ///< m = M w
+    VectorType m_n;      ///< n = A m
+    VectorType m_update; ///< Search direction p
+    VectorType m_s;      ///< s = A p
+    VectorType m_q;      ///< q = M s
+    VectorType m_z;      ///< z = A q
+
+    T m_dots[3];         ///< The inner products (r,u), (w,u) and (r,r)
+    T m_gamma;           ///< Previous value of (r,u)
+    T m_alpha;           ///< Previous step length
+};
+
+} // namespace gismo
+
+#ifndef GISMO_BUILD_LIB
+#include GISMO_HPP_HEADER(gsPipelinedConjugateGradient.hpp)
+#endif
@@ -0,0 +1,178 @@
+/** @file gsPipelinedConjugateGradient.hpp
+
+    @brief Pipelined (communication hiding) conjugate gradient solver
+
+    This file is part of the G+Smo library.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+namespace gismo
+{
+
+template<class T>
+bool gsPipelinedConjugateGradient<T>::initIteration( const typename gsPipelinedConjugateGradient<T>::VectorType& rhs,
+                                                     typename gsPipelinedConjugateGradient<T>::VectorType& x )
+{
+    GISMO_ASSERT( rhs.cols() == 1,
+                  "Iterative solvers only work for single column right-hand side." );
+    GISMO_ASSERT( rhs.rows() == m_mat->rows(),
+                  "The right-hand side does not match the matrix: "
+                  << rhs.rows() <<"!="<< m_mat->rows() );
+
+    m_num_iter = 0;
+
+    // The local parts of the vectors are summed over all processes
+    T rhsNorm2 = rhs.squaredNorm();
+    if (m_distributed)
+        rhsNorm2 = m_comm.sum(rhsNorm2);
+    m_rhs_norm = math::sqrt(rhsNorm2);
+
+    if (0 == m_rhs_norm) // special case of zero rhs
+    {
+        x.setZero(rhs.rows(),rhs.cols()); // for sure zero is a solution
+        m_error = 0.;
+        return true;
+    }
+
+    const index_t n = m_mat->cols();
+    if ( 0 == x.size() ) // if no initial solution, start with zeros
+        x.setZero(n,1);
+    else
+    {
+        GISMO_ASSERT( x.rows() == n && x.cols() == 1,
+                      "The initial guess does not match the right-hand side." );
+    }
+
+    m_rhs = rhs;
+    m_update.setZero(n,1);
+    m_s.setZero(n,1);
+    m_q.setZero(n,1);
+    m_z.setZero(n,1);
+
+    replaceResidual(x);
+    return reduce();
+}
+
+template<class T>
+bool gsPipelinedConjugateGradient<T>::step( typename gsPipelinedConjugateGradient<T>::VectorType& x )
+{
+    T beta = 0, alpha = m_dots[0] / m_dots[1];
+    if (1 != m_num_iter)
+    {
+        beta  = m_dots[0] / m_gamma;
+        alpha = m_dots[0] / (m_dots[1] - beta * m_dots[0] / m_alpha);
+    }
+    m_gamma = m_dots[0];
+    m_alpha = alpha;
+
+    update(x, alpha, beta);
+
+    if ( 0 < m_replace && 0 == m_num_iter % m_replace )
+        replaceResidual(x);
+    if ( !reduce() )
+        return false;
+
+    // The recursively updated residual can be much smaller than the
+    // true one, so check the latter before stopping
+    replaceResidual(x);
+    return reduce();
+}
+
+template<class T>
+void gsPipelinedConjugateGradient<T>::finalizeIteration( typename gsPipelinedConjugateGradient<T>::VectorType& )
+{
+    // cleanup temporaries
+    m_rhs.clear();
+    m_res.clear();
+    m_u.clear();
+    m_w.clear();
+    m_m.clear();
+    m_n.clear();
+    m_update.clear();
+    m_s.clear();
+    m_q.clear();
+    m_z.clear();
+}
+
+template<class T>
+void gsPipelinedConjugateGradient<T>::update( typename gsPipelinedConjugateGradient<T>::VectorType& x,
+                                              T alpha, T beta )
+{
+    const index_t n = x.rows();
+    T * xp = x.data(), * r = m_res.data(), * u = m_u.data(), * w = m_w.data(),
+      * p = m_update.data(), * s = m_s.data(), * q = m_q.data(), * z = m_z.data();
+    const T * mp = m_m.data(), * np = m_n.data();
+
+    m_dots[0] = m_dots[1] = m_dots[2] = 0;
+#   pragma omp parallel
+    {
+        T ru = 0, wu = 0, rr = 0;
+#       pragma omp for schedule(static) nowait
+        for (index_t i = 0; i < n; ++i)
+        {
+            z[i] = np[i] + beta * z[i];
+            q[i] = mp[i] + beta * q[i];
+            s[i] = w[i]  + beta * s[i];
+            p[i] = u[i]  + beta * p[i];
+
+            xp[i] += alpha * p[i];
+            r[i]  -= alpha * s[i];
+            u[i]  -= alpha * q[i];
+            w[i]  -= alpha * z[i];
+
+            ru += r[i] * u[i];
+            wu += w[i] * u[i];
+            rr += r[i] * r[i];
+        }
+
+#       pragma omp critical (gsPipelinedConjugateGradient_dots)
+        {
+            m_dots[0] += ru;
+            m_dots[1] += wu;
+            m_dots[2] += rr;
+        }
+    }
+}
+
+template<class T>
+void gsPipelinedConjugateGradient<T>::replaceResidual( const typename gsPipelinedConjugateGradient<T>::VectorType& x )
+{
+    m_mat->apply(x,m_n);
+    m_res = m_rhs - m_n;
+    m_precond->apply(m_res,m_u);
+    m_mat->apply(m_u,m_w);
+
+    if (0 < m_num_iter) // the initial search direction is zero
+    {
+        m_mat->apply(m_update,m_s);
+        m_precond->apply(m_s,m_q);
+        m_mat->apply(m_q,m_z);
+    }
+
+    m_dots[0] = m_res.col(0).dot(m_u.col(0));
+    m_dots[1] = m_w.col(0).dot(m_u.col(0));
+    m_dots[2] = m_res.col(0).squaredNorm();
+}
+
+template<class T>
+bool gsPipelinedConjugateGradient<T>::reduce()
+{
+    gsMpiRequest req;
+    if (m_distributed)
+        m_comm.isum(m_dots, 3, &req);
+
+    // Overlap the reduction with the work for the next iteration
+    m_precond->apply(m_w,m_m);
+    m_mat->apply(m_m,m_n);
+
+    if (m_distributed)
+        req.wait();
+
+    m_error = math::sqrt(m_dots[2]) / m_rhs_norm;
+    return m_error < m_tol;
+}
+
+} // end namespace gismo
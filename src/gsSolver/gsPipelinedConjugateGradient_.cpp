@@ -0,0 +1,9 @@
+#include <gsSolver/gsPipelinedConjugateGradient.h>
+#include <gsSolver/gsPipelinedConjugateGradient.hpp>
+
+namespace gismo
+{
+
+CLASS_TEMPLATE_INST gsPipelinedConjugateGradient<real_t>;
+
+} // namespace gismo
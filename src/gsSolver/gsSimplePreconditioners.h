@@ -14,6 +14,8 @@
 
 #include <gsCore/gsLinearAlgebra.h>
 #include <gsSolver/gsPreconditioner.h>
+#include <gsSolver/gsMatrixOp.h>
+#include <gsSolver/gsLanczosMatrix.h>
 
 namespace gismo
 {
@@ -24,6 +26,17 @@ template<typename T>
 void gaussSeidelSweep(const gsSparseMatrix<T> & A, gsMatrix<T>& x, const gsMatrix<T>& f);
 template<typename T>
 void reverseGaussSeidelSweep(const gsSparseMatrix<T> & A, gsMatrix<T>& x, const gsMatrix<T>& f);
+/// Colors the rows of \a A such that rows of the same color do not
+/// couple. \a order contains the rows sorted by color, the rows of color
+/// \a c are order[colorPtr[c]], ..., order[colorPtr[c+1]-1].
+template<typename T>
+void multiColoring(const gsSparseMatrix<T> & A, std::vector<index_t>& order, std::vector<index_t>& colorPtr);
+template<typename T>
+void multiColorGaussSeidelSweep(const gsSparseMatrix<T> & A, const std::vector<index_t>& order,
+                                const std::vector<index_t>& colorPtr, gsMatrix<T>& x, const gsMatrix<T>& f);
+template<typename T>
+void reverseMultiColorGaussSeidelSweep(const gsSparseMatrix<T> & A, const std::vector<index_t>& order,
+                                       const std::vector<index_t>& colorPtr, gsMatrix<T>& x, const gsMatrix<T>& f);
 } // namespace internal
 
 /// @brief Richardson preconditioner
@@ -402,6 +415,388 @@ template <class Derived>
 typename gsGaussSeidelOp<Derived,gsGaussSeidel::symmetric>::uPtr makeSymmetricGaussSeidelOp(const memory::shared_ptr<Derived>& mat)
 { return gsGaussSeidelOp<Derived,gsGaussSeidel::symmetric>::make(mat); }
 
+/// @brief Multi-color Gauss-Seidel preconditioner
+///
+/// The unknowns are colored once, in the constructor, such that the
+/// unknowns of one color do not couple. Then, the Gauss-Seidel sweep
+/// runs over the colors, and the unknowns of one color are updated in
+/// parallel. Besides the ordering of the unknowns, the iteration is
+/// the same as for gsGaussSeidelOp, so the symmetric variant can be
+/// used as a smoother for gsMultiGridOp in the same way.
+///
+/// Requires a positive definite matrix.
+///
+/// \ingroup Solver
+template <typename MatrixType, gsGaussSeidel::ordering ordering = gsGaussSeidel::forward>
+class gsMultiColorGaussSeidelOp GISMO_FINAL : public gsPreconditionerOp<typename MatrixType::Scalar>
+{
+    typedef memory::shared_ptr<MatrixType>          MatrixPtr;
+    typedef typename MatrixType::Nested             NestedMatrix;
+
+public:
+    /// Scalar type
+    typedef typename MatrixType::Scalar T;
+
+    /// Shared pointer for gsMultiColorGaussSeidelOp
+    typedef memory::shared_ptr< gsMultiColorGaussSeidelOp > Ptr;
+
+    /// Unique pointer for gsMultiColorGaussSeidelOp
+    typedef memory::unique_ptr< gsMultiColorGaussSeidelOp > uPtr;
+
+    /// Base class
+    typedef gsPreconditionerOp<T> Base;
+
+    /// @brief Constructor with given matrix
+    explicit gsMultiColorGaussSeidelOp(const MatrixType& _mat)
+    : m_mat(), m_expr(_mat.derived())
+    { internal::multiColoring<T>(m_expr, m_order, m_colorPtr); }
+
+    /// @brief Constructor with shared pointer to matrix
+    explicit gsMultiColorGaussSeidelOp(const MatrixPtr& _mat)
+    : m_mat(_mat), m_expr(m_mat->derived())
+    { internal::multiColoring<T>(m_expr, m_order, m_colorPtr); }
+
+    static uPtr make(const MatrixType& _mat)
+    { return memory::make_unique( new gsMultiColorGaussSeidelOp(_mat) ); }
+
+    static uPtr make(const MatrixPtr& _mat)
+    { return memory::make_unique( new gsMultiColorGaussSeidelOp(_mat) ); }
+
+    void step(const gsMatrix<T> & rhs, gsMatrix<T> & x) const
+    {
+        if (ordering == gsGaussSeidel::forward )
+            internal::multiColorGaussSeidelSweep<T>(m_expr,m_order,m_colorPtr,x,rhs);
+        if (ordering == gsGaussSeidel::reverse )
+            internal::reverseMultiColorGaussSeidelSweep<T>(m_expr,m_order,m_colorPtr,x,rhs);
+        if (ordering == gsGaussSeidel::symmetric )
+        {
+            internal::multiColorGaussSeidelSweep<T>(m_expr,m_order,m_colorPtr,x,rhs);
+            internal::reverseMultiColorGaussSeidelSweep<T>(m_expr,m_order,m_colorPtr,x,rhs);
+        }
+    }
+
+    void stepT(const gsMatrix<T> & rhs, gsMatrix<T> & x) const
+    {
+        if ( ordering == gsGaussSeidel::forward )
+            internal::reverseMultiColorGaussSeidelSweep<T>(m_expr,m_order,m_colorPtr,x,rhs);
+        if ( ordering == gsGaussSeidel::reverse )
+            internal::multiColorGaussSeidelSweep<T>(m_expr,m_order,m_colorPtr,x,rhs);
+        if ( ordering == gsGaussSeidel::symmetric )
+        {
+            internal::multiColorGaussSeidelSweep<T>(m_expr,m_order,m_colorPtr,x,rhs);
+            internal::reverseMultiColorGaussSeidelSweep<T>(m_expr,m_order,m_colorPtr,x,rhs);
+        }
+    }
+
+    index_t rows() const {return m_expr.rows();}
+    index_t cols() const {return m_expr.cols();}
+
+    /// Returns the number of colors
+    index_t numColors() const { return m_colorPtr.size() - 1; }
+
+    /// Returns the matrix
+    NestedMatrix matrix() const { return m_expr; }
+
+    /// Returns a shared pinter to the matrix
+    MatrixPtr    matrixPtr() const {
+        GISMO_ENSURE( m_mat, "A shared pointer is only available if it was provided to gsMultiColorGaussSeidelOp." );
+        return m_mat;
+    }
+
+    typename gsLinearOperator<T>::Ptr underlyingOp() const { return makeMatrixOp(m_mat); }
+
+private:
+    const MatrixPtr m_mat;  ///< Shared pointer to matrix (if needed)
+    NestedMatrix    m_expr; ///< Nested Eigen expression
+
+    std::vector<index_t> m_order;    ///< The unknowns, sorted by color
+    std::vector<index_t> m_colorPtr; ///< Start of every color in m_order
+};
+
+/**
+   \brief Returns a smart pointer to a multi-color Gauss-Seidel operator referring on \a mat
+*/
+template <class Derived>
+typename gsMultiColorGaussSeidelOp<Derived>::uPtr makeMultiColorGaussSeidelOp(const Eigen::EigenBase<Derived>& mat)
+{ return gsMultiColorGaussSeidelOp<Derived>::make(mat.derived()); }
+
+/**
+   \brief Returns a smart pointer to a multi-color Gauss-Seidel operator referring on \a mat
+*/
+template <class Derived>
+typename gsMultiColorGaussSeidelOp<Derived>::uPtr makeMultiColorGaussSeidelOp(const memory::shared_ptr<Derived>& mat)
+{ return gsMultiColorGaussSeidelOp<Derived>::make(mat); }
+
+/**
+   \brief Returns a smart pointer to a symmetric multi-color Gauss-Seidel operator referring on \a mat
+*/
+template <class Derived>
+typename gsMultiColorGaussSeidelOp<Derived,gsGaussSeidel::symmetric>::uPtr makeSymmetricMultiColorGaussSeidelOp(const Eigen::EigenBase<Derived>& mat)
+{ return gsMultiColorGaussSeidelOp<Derived,gsGaussSeidel::symmetric>::make(mat.derived()); }
+
+/**
+   \brief Returns a smart pointer to a symmetric multi-color Gauss-Seidel operator referring on \a mat
+*/
+template <class Derived>
+typename gsMultiColorGaussSeidelOp<Derived,gsGaussSeidel::symmetric>::uPtr makeSymmetricMultiColorGaussSeidelOp(const memory::shared_ptr<Derived>& mat)
+{ return gsMultiColorGaussSeidelOp<Derived,gsGaussSeidel::symmetric>::make(mat); }
+
+/// @brief Chebyshev smoother
+///
+/// One step multiplies the error by the polynomial \f$ p(D^{-1}A) \f$,
+/// where \f$ D \f$ is the diagonal of \f$ A \f$ and \f$ p \f$ is the
+/// scaled Chebyshev polynomial of given degree with \f$ p(0)=1 \f$,
+/// which is smallest on the interval \f$ [\lambda/r, \lambda] \f$.
+/// Here, \f$ \lambda \f$ is an upper bound for the eigenvalues of
+/// \f$ D^{-1}A \f$ and \f$ r \f$ is the option EigenvalueRatio. So,
+/// the upper part of the spectrum is damped uniformly, and no damping
+/// parameter has to be tuned.
+///
+/// If not provided to the constructor or by setEigenvalueBound, the
+/// bound is 1.1 times an estimate for the largest eigenvalue, obtained
+/// from the gsLanczosMatrix of a few steps of the Jacobi preconditioned
+/// conjugate gradient method, started from a fixed vector. It is
+/// computed when the smoother is set up, so step and apply are
+/// reentrant and may be called concurrently. Besides that, one step
+/// needs as many matrix-vector products as the degree of the
+/// polynomial, and vector updates. The products are multi-threaded as
+/// for gsMatrixOp.
+///
+/// Requires a positive definite matrix.
+///
+/// \ingroup Solver
+template <typename MatrixType>
+class gsChebyshevOp GISMO_FINAL : public gsPreconditionerOp<typename MatrixType::Scalar>
+{
+    typedef memory::shared_ptr<MatrixType>          MatrixPtr;
+    typedef typename MatrixType::Nested             NestedMatrix;
+
+public:
+    /// Scalar type
+    typedef typename MatrixType::Scalar T;
+
+    /// Shared pointer for gsChebyshevOp
+    typedef memory::shared_ptr< gsChebyshevOp > Ptr;
+
+    /// Unique pointer for gsChebyshevOp
+    typedef memory::unique_ptr< gsChebyshevOp > uPtr;
+
+    /// Base class
+    typedef gsPreconditionerOp<T> Base;
+
+    /// @brief Constructor with given matrix
+    ///
+    /// If \a _lambda is not positive, the eigenvalue bound is estimated.
+    explicit gsChebyshevOp(const MatrixType& _mat, index_t _degree = 2, T _lambda = 0)
+    : m_mat(), m_expr(_mat.derived()), m_prod(m_expr), m_degree(_degree),
+      m_ratio(30), m_steps(10), m_lambda(_lambda)
+    { init(); }
+
+    /// @brief Constructor with shared pointer to matrix
+    ///
+    /// If \a _lambda is not positive, the eigenvalue bound is estimated.
+    explicit gsChebyshevOp(const MatrixPtr& _mat, index_t _degree = 2, T _lambda = 0)
+    : m_mat(_mat), m_expr(m_mat->derived()), m_prod(m_expr), m_degree(_degree),
+      m_ratio(30), m_steps(10), m_lambda(_lambda)
+    { init(); }
+
+    static uPtr make(const MatrixType& _mat, index_t _degree = 2, T _lambda = 0)
+    { return memory::make_unique( new gsChebyshevOp(_mat, _degree, _lambda) ); }
+
+    static uPtr make(const MatrixPtr& _mat, index_t _degree = 2, T _lambda = 0)
+    { return memory::make_unique( new gsChebyshevOp(_mat, _degree, _lambda) ); }
+
+    void step(const gsMatrix<T> & rhs, gsMatrix<T> & x) const
+    {
+        GISMO_ASSERT( m_expr.rows() == rhs.rows() && m_expr.cols() == m_expr.rows(),
+                      "Dimensions do not match.");
+
+        gsMatrix<T> res, dir, tmp;
+        m_prod.apply(m_expr, x, tmp);
+        res.noalias() = m_diagInv.asDiagonal() * (rhs - tmp);
+        iterate(x, res, dir, tmp);
+    }
+
+    // We use our own apply implementation as we can save one multiplication in the first sweep.
+    void apply(const gsMatrix<T> & input, gsMatrix<T> & x) const
+    {
+        GISMO_ASSERT( m_expr.rows() == input.rows() && m_expr.cols() == m_expr.rows(),
+                      "Dimensions do not match.");
+
+        gsMatrix<T> res, dir, tmp;
+        x.setZero(input.rows(), input.cols());
+        res.noalias() = m_diagInv.asDiagonal() * input;
+        iterate(x, res, dir, tmp);
+
+        for (index_t k = 1; k < m_num_of_sweeps; ++k)
+        {
+            m_prod.apply(m_expr, x, tmp);
+            res.noalias() = m_diagInv.asDiagonal() * (input - tmp);
+            iterate(x, res, dir, tmp);
+        }
+    }
+
+    index_t rows() const {return m_expr.rows();}
+    index_t cols() const {return m_expr.cols();}
+
+    /// Set the degree of the polynomial
+    void setDegree(const index_t degree) { m_degree = degree; }
+
+    /// Get the degree of the polynomial
+    index_t degree() const { return m_degree; }
+
+    /// @brief Set the upper bound for the eigenvalues of \f$ D^{-1}A \f$
+    ///
+    /// If the bound is not positive, it is estimated.
+    void setEigenvalueBound(const T lambda)
+    { m_lambda = lambda > 0 ? lambda : (T)(1.1) * estimateEigenvalue(); }
+
+    /// @brief Get the upper bound for the eigenvalues of \f$ D^{-1}A \f$
+    T eigenvalueBound() const { return m_lambda; }
+
+    /// Get the default options as gsOptionList object
+    static gsOptionList defaultOptions()
+    {
+        gsOptionList opt = Base::defaultOptions();
+        opt.addInt ( "Degree", "Degree of the Chebyshev polynomial", 2 );
+        opt.addReal( "EigenvalueRatio", "Ratio of the upper and the lower end of the smoothed part of the spectrum", 30 );
+        opt.addInt ( "EigenvalueSteps", "Number of conjugate gradient steps for estimating the largest eigenvalue", 10 );
+        return opt;
+    }
+
+    /// @brief Set options based on a gsOptionList object
+    ///
+    /// If the number of steps for the estimate changes, the eigenvalue
+    /// bound is estimated again.
+    virtual void setOptions(const gsOptionList & opt)
+    {
+        Base::setOptions(opt);
+        m_degree = opt.askInt ( "Degree", m_degree );
+        m_ratio  = opt.askReal( "EigenvalueRatio", m_ratio );
+        const index_t steps = opt.askInt( "EigenvalueSteps", m_steps );
+        if (steps != m_steps)
+        {
+            m_steps = steps;
+            setEigenvalueBound(0);
+        }
+    }
+
+    /// Returns the matrix
+    NestedMatrix matrix() const { return m_expr; }
+
+    /// Returns a shared pinter to the matrix
+    MatrixPtr    matrixPtr() const {
+        GISMO_ENSURE( m_mat, "A shared pointer is only available if it was provided to gsChebyshevOp." );
+        return m_mat;
+    }
+
+    typename gsLinearOperator<T>::Ptr underlyingOp() const { return makeMatrixOp(m_mat); }
+
+private:
+    void init()
+    {
+        GISMO_ASSERT( m_expr.rows() == m_expr.cols(), "The matrix is not square." );
+        m_diagInv = m_expr.diagonal().cwiseInverse();
+        setEigenvalueBound(m_lambda);
+    }
+
+    // Applies the Chebyshev iteration to x, where res contains the
+    // residual, scaled by the inverse diagonal. The arguments dir and
+    // tmp are workspaces.
+    void iterate(gsMatrix<T> & x, gsMatrix<T> & res, gsMatrix<T> & dir,
+                 gsMatrix<T> & tmp) const
+    {
+        const T upper = m_lambda;
+        const T lower = upper / m_ratio;
+        const T theta = (upper + lower) / 2;
+        const T delta = (upper - lower) / 2;
+        const T sigma = theta / delta;
+
+        T rho = 1 / sigma;
+        dir = res / theta;
+        x += dir;
+        for (index_t i = 1; i < m_degree; ++i)
+        {
+            m_prod.apply(m_expr, dir, tmp);
+            res.noalias() -= m_diagInv.asDiagonal() * tmp;
+
+            const T rhoNew = 1 / (2 * sigma - rho);
+            dir *= rhoNew * rho;
+            dir.noalias() += (2 * rhoNew / delta) * res;
+            rho = rhoNew;
+            x += dir;
+        }
+    }
+
+    // Estimates the largest eigenvalue of D^{-1}A by the Lanczos
+    // matrix of the Jacobi preconditioned conjugate gradient method
+    T estimateEigenvalue() const
+    {
+        // Fixed pseudo-random start vector, generated locally so that
+        // the estimate is reproducible and rand() is not affected
+        gsMatrix<T> res(rows(), 1), dir, tmp, precRes;
+        unsigned seed = 1;
+        for (index_t i = 0; i < res.rows(); ++i)
+        {
+            seed = seed * 1103515245u + 12345u;
+            res(i,0) = (T)((seed >> 16) & 0x7fff) / 0x7fff - (T)(0.5);
+        }
+        precRes.noalias() = m_diagInv.asDiagonal() * res;
+        dir = precRes;
+        T absNew = res.col(0).dot(precRes.col(0));
+
+        std::vector<T> delta(1, 0), gamma;
+        for (index_t i = 0; i < m_steps; ++i)
+        {
+            m_prod.apply(m_expr, dir, tmp);
+            const T alpha = absNew / dir.col(0).dot(tmp.col(0));
+            delta.back() += 1 / alpha;
+
+            res -= alpha * tmp;
+            precRes.noalias() = m_diagInv.asDiagonal() * res;
+            const T absOld = absNew;
+            absNew = res.col(0).dot(precRes.col(0));
+            if ( i + 1 == m_steps || absNew <= std::numeric_limits<T>::epsilon() * absOld )
+                break;
+
+            const T beta = absNew / absOld;
+            gamma.push_back( -math::sqrt(beta) / alpha );
+            delta.push_back( beta / alpha );
+            dir = precRes + beta * dir;
+        }
+
+        return gsLanczosMatrix<T>(gamma, delta).maxEigenvalue();
+    }
+
+private:
+    const MatrixPtr m_mat;  ///< Shared pointer to matrix (if needed)
+    NestedMatrix    m_expr; ///< Nested Eigen expression
+    internal::gsMatrixOpProduct<MatrixType> m_prod; ///< Computes the matrix-vector products
+    gsVector<T>     m_diagInv; ///< Inverse of the diagonal
+
+    using Base::m_num_of_sweeps;
+    index_t m_degree;
+    T m_ratio;
+    index_t m_steps;
+    T m_lambda;
+};
+
+/**
+   \brief Returns a smart pointer to a Chebyshev smoother referring on \a mat
+*/
+template <class Derived>
+typename gsChebyshevOp<Derived>::uPtr makeChebyshevOp(const Eigen::EigenBase<Derived>& mat, index_t degree = 2,
+                                                     typename Derived::Scalar lambda = 0)
+{ return gsChebyshevOp<Derived>::make(mat.derived(), degree, lambda); }
+
+/**
+   \brief Returns a smart pointer to a Chebyshev smoother referring on \a mat
+*/
+template <class Derived>
+typename gsChebyshevOp<Derived>::uPtr makeChebyshevOp(const memory::shared_ptr<Derived>& mat, index_t degree = 2,
+                                                     typename Derived::Scalar lambda = 0)
+{ return gsChebyshevOp<Derived>::make(mat, degree, lambda); }
+
 } // namespace gismo
 
 #ifndef GISMO_BUILD_LIB
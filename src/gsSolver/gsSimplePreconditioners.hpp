@@ -17,6 +17,24 @@ namespace gismo
 namespace internal
 {
 
+// Gauss-Seidel update of the unknown i
+template<typename T>
+inline void gaussSeidelRow(const gsSparseMatrix<T> & A, const index_t i, gsMatrix<T>& x, const gsMatrix<T>& f)
+{
+    T diag = 0;
+    T sum  = 0;
+
+    // A is supposed to be symmetric, so it doesn't matter if it's stored in row- or column-major order
+    for (typename gsSparseMatrix<T>::InnerIterator it(A,i); it; ++it)
+    {
+        sum += it.value() * x( it.index() );        // compute A.x
+        if (it.index() == i)
+            diag = it.value();
+    }
+
+    x(i) += (f(i) - sum) / diag;
+}
+
 template<typename T>
 void gaussSeidelSweep(const gsSparseMatrix<T> & A, gsMatrix<T>& x, const gsMatrix<T>& f)
 {
@@ -25,45 +43,107 @@ void gaussSeidelSweep(const gsSparseMatrix<T> & A, gsMatrix<T>& x, const gsMatri
 
     GISMO_ASSERT( f.cols() == 1, "This operator is only implemented for a single right-hand side." );
 
-    // A is supposed to be symmetric, so it doesn't matter if it's stored in row- or column-major order
-    for (int i = 0; i < A.outerSize(); ++i)
-    {
-        T diag = 0;
-        T sum  = 0;
+    for (index_t i = 0; i < A.outerSize(); ++i)
+        gaussSeidelRow(A, i, x, f);
+}
+
+template<typename T>
+void reverseGaussSeidelSweep(const gsSparseMatrix<T> & A, gsMatrix<T>& x, const gsMatrix<T>& f)
+{
+    GISMO_ASSERT( A.rows() == x.rows() && x.rows() == f.rows() && A.cols() == A.rows() && x.cols() == f.cols(),
+        "Dimensions do not match.");
+
+    GISMO_ASSERT( f.cols() == 1, "This operator is only implemented for a single right-hand side." );
+
+    for (index_t i = A.outerSize() - 1; i >= 0; --i)
+        gaussSeidelRow(A, i, x, f);
+}
+
+template<typename T>
+void multiColoring(const gsSparseMatrix<T> & A, std::vector<index_t>& order, std::vector<index_t>& colorPtr)
+{
+    GISMO_ASSERT( A.cols() == A.rows(), "The matrix is not square." );
+
+    const index_t n = A.outerSize();
+    std::vector<index_t> color(n, -1), stamp;
+    index_t numColors = 0;
 
+    // Greedy coloring: every row gets the smallest color that is not
+    // used by one of its (already colored) neighbors. A is supposed to
+    // be structurally symmetric, so the neighbors are the entries of
+    // the row or column.
+    for (index_t i = 0; i < n; ++i)
+    {
         for (typename gsSparseMatrix<T>::InnerIterator it(A,i); it; ++it)
         {
-            sum += it.value() * x( it.index() );        // compute A.x
-            if (it.index() == i)
-                diag = it.value();
+            const index_t c = color[it.index()];
+            if (c >= 0)
+                stamp[c] = i;
         }
 
-        x(i) += (f(i) - sum) / diag;
+        index_t c = 0;
+        while (c < numColors && stamp[c] == i)
+            ++c;
+        if (c == numColors)
+        {
+            stamp.push_back(-1);
+            ++numColors;
+        }
+        color[i] = c;
     }
+
+    // Sort the rows by color, keeping their order within every color
+    colorPtr.assign(numColors + 1, 0);
+    for (index_t i = 0; i < n; ++i)
+        ++colorPtr[color[i] + 1];
+    for (index_t c = 0; c < numColors; ++c)
+        colorPtr[c + 1] += colorPtr[c];
+
+    order.resize(n);
+    stamp.assign(colorPtr.begin(), colorPtr.end() - 1);
+    for (index_t i = 0; i < n; ++i)
+        order[stamp[color[i]]++] = i;
 }
 
 template<typename T>
-void reverseGaussSeidelSweep(const gsSparseMatrix<T> & A, gsMatrix<T>& x, const gsMatrix<T>& f)
+void multiColorGaussSeidelSweep(const gsSparseMatrix<T> & A, const std::vector<index_t>& order,
+                                const std::vector<index_t>& colorPtr, gsMatrix<T>& x, const gsMatrix<T>& f)
 {
     GISMO_ASSERT( A.rows() == x.rows() && x.rows() == f.rows() && A.cols() == A.rows() && x.cols() == f.cols(),
         "Dimensions do not match.");
 
     GISMO_ASSERT( f.cols() == 1, "This operator is only implemented for a single right-hand side." );
 
-    // A is supposed to be symmetric, so it doesn't matter if it's stored in row- or column-major order
-    for (int i = A.outerSize() - 1; i >= 0; --i)
+    const index_t numColors = colorPtr.size() - 1;
+
+    // The rows of one color do not couple, so they are updated in parallel
+#   pragma omp parallel
+    for (index_t c = 0; c < numColors; ++c)
     {
-        T diag = 0;
-        T sum = 0;
+#       pragma omp for schedule(static)
+        for (index_t k = colorPtr[c]; k < colorPtr[c+1]; ++k)
+            gaussSeidelRow<T>(A, order[k], x, f);
+    }
+}
 
-        for (typename gsSparseMatrix<T>::InnerIterator it(A,i); it; ++it)
-        {
-            sum += it.value() * x( it.index() );        // compute A.x
-            if (it.index() == i)
-                diag = it.value();
-        }
+template<typename T>
+void reverseMultiColorGaussSeidelSweep(const gsSparseMatrix<T> & A, const std::vector<index_t>& order,
+                                       const std::vector<index_t>& colorPtr, gsMatrix<T>& x, const gsMatrix<T>& f)
+{
+    GISMO_ASSERT( A.rows() == x.rows() && x.rows() == f.rows() && A.cols() == A.rows() && x.cols() == f.cols(),
+        "Dimensions do not match.");
+
+    GISMO_ASSERT( f.cols() == 1, "This operator is only implemented for a single right-hand side." );
 
-        x(i) += (f(i) - sum) / diag;
+    const index_t numColors = colorPtr.size() - 1;
+
+    // The rows of one color do not couple, so they are updated in parallel
+#   pragma omp parallel
+    for (index_t c = numColors - 1; c >= 0; --c)
+    {
+#       pragma omp for schedule(static)
+        for (index_t k = colorPtr[c]; k < colorPtr[c+1]; ++k)
+            gaussSeidelRow<T>(A, order[k], x, f);
     }
 }
 
@@ -9,6 +9,11 @@ namespace internal
 
 TEMPLATE_INST void gaussSeidelSweep(const gsSparseMatrix<real_t> & A, gsMatrix<real_t>& x, const gsMatrix<real_t>& f);
 TEMPLATE_INST void reverseGaussSeidelSweep(const gsSparseMatrix<real_t> & A, gsMatrix<real_t>& x, const gsMatrix<real_t>& f);
+TEMPLATE_INST void multiColoring(const gsSparseMatrix<real_t> & A, std::vector<index_t>& order, std::vector<index_t>& colorPtr);
+TEMPLATE_INST void multiColorGaussSeidelSweep(const gsSparseMatrix<real_t> & A, const std::vector<index_t>& order,
+                                              const std::vector<index_t>& colorPtr, gsMatrix<real_t>& x, const gsMatrix<real_t>& f);
+TEMPLATE_INST void reverseMultiColorGaussSeidelSweep(const gsSparseMatrix<real_t> & A, const std::vector<index_t>& order,
+                                                     const std::vector<index_t>& colorPtr, gsMatrix<real_t>& x, const gsMatrix<real_t>& f);
 
 } // namespace internal
 
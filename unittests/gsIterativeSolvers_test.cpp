@@ -249,6 +249,35 @@ SUITE(gsIterativeSolvers_test)
         CHECK( (mat*x-rhs).norm()/rhs.norm() <= tol );
     }
 
+    TEST(CG_MultiColorSGS_test)
+    {
+        index_t          N = 100;
+        real_t           tol = std::pow(10.0, - REAL_DIG * 0.75);
+
+        gsSparseMatrix<> mat;
+        gsMatrix<>       rhs;
+        gsMatrix<>       x;
+
+        poissonDiscretization(mat, rhs, N);
+
+        gsOptionList opt = gsConjugateGradient<>::defaultOptions();
+        opt.setInt ("MaxIterations", N  );
+        opt.setReal("Tolerance"    , tol);
+
+        // The tridiagonal matrix has a red-black coloring
+        typedef gsMultiColorGaussSeidelOp< gsSparseMatrix<>, gsGaussSeidel::symmetric > Smoother;
+        Smoother::Ptr precon = Smoother::make(mat);
+        CHECK_EQUAL( 2, precon->numColors() );
+
+        gsConjugateGradient<> solver(mat,precon);
+        solver.setOptions(opt);
+
+        x.setZero(N,1);
+        solver.solve(rhs,x);
+
+        CHECK( (mat*x-rhs).norm()/rhs.norm() <= tol );
+    }
+
     TEST(GMRES_GS_test)
     {
         index_t          N = 100;
@@ -327,4 +356,97 @@ SUITE(gsIterativeSolvers_test)
         CHECK( (mat*x-rhs).norm()/rhs.norm() <= tol );
     }
 
+    TEST(PipelinedCG_Jacobi_test)
+    {
+        index_t          N = 100;
+        real_t           tol = std::pow(10.0, - REAL_DIG * 0.75);
+
+        gsSparseMatrix<> mat;
+        gsMatrix<>       rhs;
+        gsMatrix<>       x, y;
+
+        poissonDiscretization(mat, rhs, N);
+
+        gsLinearOperator<>::Ptr preConMat = makeJacobiOp(mat);
+        gsPipelinedConjugateGradient<> solver(mat,preConMat);
+        solver.setMaxIterations(N);
+        solver.setTolerance(tol);
+        solver.solve(rhs,x);
+
+        CHECK( (mat*x-rhs).norm()/rhs.norm() <= tol );
+
+        // Same iterates as the standard conjugate gradient method
+        gsConjugateGradient<> cg(mat,preConMat);
+        cg.setMaxIterations(N);
+        cg.setTolerance(tol);
+        cg.solve(rhs,y);
+
+        CHECK( math::abs(solver.iterations() - cg.iterations()) <= 1 );
+        CHECK( (x-y).norm() <= tol * y.norm() );
+    }
+
+    // Several right-hand sides: the solution of the 1D Poisson problem,
+    // a random one, a zero one and a linear combination of the others
+    void multipleRhs(const gsMatrix<> & rhs, gsMatrix<> & rhs4)
+    {
+        const index_t N = rhs.rows();
+        rhs4.resize(N, 4);
+        rhs4.col(0) = rhs;
+        rhs4.col(1).setRandom();
+        rhs4.col(2).setZero();
+        rhs4.col(3) = rhs4.col(0) - 2 * rhs4.col(1);
+    }
+
+    TEST(BlockCG_test)
+    {
+        index_t          N = 100;
+        real_t           tol = std::pow(10.0, - REAL_DIG * 0.75);
+
+        gsSparseMatrix<> mat;
+        gsMatrix<>       rhs, rhs4;
+        gsMatrix<>       x, hist;
+
+        poissonDiscretization(mat, rhs, N);
+        multipleRhs(rhs, rhs4);
+
+        gsBlockConjugateGradient<> solver(mat);
+        solver.setMaxIterations(N);
+        solver.setTolerance(tol);
+        solver.solve(rhs4,x);
+
+        for (index_t j = 0; j < 4; ++j)
+            CHECK( (mat*x.col(j)-rhs4.col(j)).norm() <= tol * rhs4.col(j).norm() );
+        CHECK( solver.columnErrors().maxCoeff() <= tol );
+
+        solver.errorHistory(hist);
+        CHECK_EQUAL( solver.iterations() + 1, hist.rows() );
+        CHECK_EQUAL( 4, hist.cols() );
+    }
+
+    TEST(BlockGMRes_test)
+    {
+        index_t          N = 100;
+        real_t           tol = std::pow(10.0, - REAL_DIG * 0.75);
+
+        gsSparseMatrix<> mat;
+        gsMatrix<>       rhs, rhs4;
+        gsMatrix<>       x, hist;
+
+        poissonDiscretization(mat, rhs, N);
+        multipleRhs(rhs, rhs4);
+
+        gsBlockGMRes<> solver(mat);
+        solver.setMaxIterations(N);
+        solver.setTolerance(tol);
+        solver.solve(rhs4,x);
+
+        for (index_t j = 0; j < 4; ++j)
+            CHECK( (mat*x.col(j)-rhs4.col(j)).norm() <= tol * rhs4.col(j).norm() );
+        CHECK( solver.columnErrors().maxCoeff() <= tol );
+
+        solver.errorHistory(hist);
+        CHECK_EQUAL( solver.iterations() + 1, hist.rows() );
+        CHECK_EQUAL( 4, hist.cols() );
+    }
+
 }
@@ -61,6 +61,35 @@ SUITE(gsKronecker_test)
         CHECK_EQUAL ( y, KP * x );
     }
 
+    TEST(gsKroneckerOpMixed)
+    {
+        // Dense, sparse and general operators, several right-hand sides
+        gsMatrix<> C = (gsMatrix<>(2,2) << 1, -2, 3, 4).finished();
+        gsSparseMatrix<> sB = B.sparseView();
+        gsKroneckerOp<> kron( makeMatrixOp(A), makeMatrixOp(sB),
+                              gsScaledOp<>::make(makeMatrixOp(C), 2) );
+        gsMatrix<> y, x = gsMatrix<>::Random(18,3);
+        kron.apply(x, y);
+        CHECK ( (y - KP.kron(2*C) * x).norm() < 1e-10 * y.norm() );
+
+        // The same operator, applied by several threads at once
+        gsMatrix<> z(18,3);
+#       pragma omp parallel for
+        for (index_t j = 0; j < 3; ++j)
+        {
+            gsMatrix<> yj;
+            kron.apply(x.col(j), yj);
+            z.col(j) = yj;
+        }
+        CHECK ( (z - y).norm() < 1e-10 * y.norm() );
+
+        // Transposed dense matrix
+        const gsMatrix<> & cA = A;
+        gsKroneckerOp<> kronT( makeMatrixOp(cA.transpose()), makeMatrixOp(B) );
+        kronT.apply(x.topRows(9), y);
+        CHECK ( (y - gsMatrix<>(A.transpose()).kron(B) * x.topRows(9)).norm() < 1e-10 * y.norm() );
+    }
+
     TEST(DenseKronecker)
     {        
         gsMatrix<> C = A.kron(B);
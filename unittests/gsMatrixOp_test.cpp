@@ -46,4 +46,90 @@ SUITE(gsMatrixOp_test)
         CHECK( ( A.transpose() - C ).norm() <= 1.e-10 );
     }
 
+    template <class MatrixType>
+    void checkSparseProduct(MatrixType & A)
+    {
+        gsLinearOperator<>::Ptr Aop = makeMatrixOp(A);
+
+        A.coeffs() *= 2; // check that gsMatrixOp holds no copy
+
+        gsMatrix<> x(A.cols(), 3), y, ref;
+        x.setRandom();
+        Aop->apply(x, y);
+        ref = A.toDense() * x;
+        CHECK( ( y - ref ).norm() <= 1.e-10 * ref.norm() );
+
+        Aop->apply(x.col(0), y);
+        CHECK( ( y - ref.col(0) ).norm() <= 1.e-10 * ref.norm() );
+    }
+
+    TEST(SparseMatrix)
+    {
+        // Large enough for the multi-threaded product
+        const index_t n = 1000;
+        gsSparseMatrix<> A(n, n);
+        A.reservePerColumn(30);
+        for (index_t j = 0; j < n; ++j)
+            for (index_t k = 0; k < 30; ++k)
+                A.coeffRef((j * 37 + k * 101) % n, j) += j + k + 1;
+        A.makeCompressed();
+        checkSparseProduct(A);
+
+        gsSparseMatrix<real_t, RowMajor> B = A.transpose();
+        checkSparseProduct(B);
+
+        // Rectangular, with the entries of every column in a band
+        gsSparseMatrix<> C(n, 3 * n);
+        C.reservePerColumn(10);
+        for (index_t j = 0; j < 3 * n; ++j)
+            for (index_t k = 0; k < 10; ++k)
+                C.coeffRef((j / 3 + k) % n, j) += j + k + 1;
+        C.makeCompressed();
+        checkSparseProduct(C);
+    }
+
+    // Replaces every inner index i by n-1-i, in place
+    template <class MatrixType>
+    void mirrorInnerIndices(MatrixType & A)
+    {
+        const index_t n = A.innerSize();
+        for (index_t j = 0; j < A.outerSize(); ++j)
+        {
+            typename MatrixType::StorageIndex * beg = A.innerIndexPtr() + A.outerIndexPtr()[j];
+            typename MatrixType::StorageIndex * end = A.innerIndexPtr() + A.outerIndexPtr()[j+1];
+            std::reverse(beg, end);
+            for (; beg != end; ++beg)
+                *beg = n - 1 - *beg;
+        }
+    }
+
+    TEST(SparseMatrixPatternChange)
+    {
+        // The sparsity pattern changes in place, keeping the storage
+        // and the number of non-zeros
+        const index_t n = 1000;
+        gsSparseMatrix<> A(n, n);
+        A.reservePerColumn(30);
+        for (index_t j = 0; j < n; ++j)
+            for (index_t k = 0; k < 30; ++k)
+                A.insert((j + k) % n, j) = j + k + 1;
+        A.makeCompressed();
+        gsSparseMatrix<real_t, RowMajor> B = A.transpose();
+
+        gsLinearOperator<>::Ptr Aop = makeMatrixOp(A);
+        gsLinearOperator<>::Ptr Bop = makeMatrixOp(B);
+        gsMatrix<> x(n, 2), y;
+        x.setRandom();
+        Aop->apply(x, y);
+        Bop->apply(x, y);
+
+        mirrorInnerIndices(A);
+        mirrorInnerIndices(B);
+
+        Aop->apply(x, y);
+        CHECK( ( y - A.toDense() * x ).norm() <= 1.e-10 * y.norm() );
+        Bop->apply(x, y);
+        CHECK( ( y - B.toDense() * x ).norm() <= 1.e-10 * y.norm() );
+    }
+
 }
@@ -0,0 +1,136 @@
+/** @file gsMultiPatch_test.cpp
+
+    @brief Tests for gsMultiPatch
+
+    This file is part of the G+Smo library.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+**/
+
+#include "gismo_unittest.h"
+
+// Returns the lowest index of a patch of the square grid \a mp that
+// contains \a pt, skipping patch \a skip
+index_t lowestPatchContaining(const gsMultiPatch<> & mp, const gsVector<> & pt, index_t skip)
+{
+    for (size_t k = 0; k != mp.nPatches(); ++k)
+    {
+        if ((index_t)k == skip) continue;
+        const gsMatrix<> & cf = mp.patch(k).coefs();
+        if ( (pt.transpose().array() >= cf.colwise().minCoeff().array() - 1e-12).all() &&
+             (pt.transpose().array() <= cf.colwise().maxCoeff().array() + 1e-12).all() )
+            return k;
+    }
+    return -1;
+}
+
+// Returns true if the sides \a s1 and \a s2 have the same corners in
+// the physical domain
+bool sameSideCorners(const gsMultiPatch<> & mp, const patchSide & s1, const patchSide & s2)
+{
+    const short_t d = mp.parDim();
+    std::vector<boxCorner> c1, c2;
+    s1.getContainedCorners(d, c1);
+    s2.getContainedCorners(d, c2);
+    for (size_t i = 0; i != c1.size(); ++i)
+    {
+        const gsMatrix<> x = mp.patch(s1.patch).coef(mp.basis(s1.patch).functionAtCorner(c1[i]));
+        bool found = false;
+        for (size_t j = 0; j != c2.size() && !found; ++j)
+            found = (x - mp.patch(s2.patch).coef(mp.basis(s2.patch).functionAtCorner(c2[j]))).norm() < 1e-10;
+        if (!found) return false;
+    }
+    return true;
+}
+
+SUITE(gsMultiPatch_test)
+{
+    TEST(locatePoints)
+    {
+        gsMultiPatch<> mp = gsNurbsCreator<>::BSplineSquareGrid(3, 3, 1.0);
+        mp.uniformRefine(2);
+
+        // points on interfaces and corners, in the interior of a
+        // patch, on the boundary and outside of the domain
+        gsMatrix<> pts(2, 9);
+        pts << 1.0, 1.0, 2.0, 1.5, 0.3, 0.0, 3.0, 2.0, 4.0,
+               0.5, 1.0, 2.0, 2.0, 2.7, 0.0, 1.0, 3.0, 1.0;
+
+        gsVector<index_t> pids;
+        gsMatrix<> preim, val;
+        mp.locatePoints(pts, pids, preim);
+        for (index_t i = 0; i != pts.cols(); ++i)
+        {
+            const gsVector<> pt = pts.col(i);
+            CHECK_EQUAL( lowestPatchContaining(mp, pt, -1), pids[i] );
+            if (-1 == pids[i]) continue;
+            mp.patch(pids[i]).eval_into(preim.col(i), val);
+            CHECK( (val - pt).norm() < 1e-6 );
+        }
+
+        // the same, skipping the patch found before
+        gsVector<index_t> pid2;
+        mp.locatePoints(pts, pids[1], pid2, preim);
+        for (index_t i = 0; i != pts.cols(); ++i)
+        {
+            const gsVector<> pt = pts.col(i);
+            CHECK_EQUAL( lowestPatchContaining(mp, pt, pids[1]), pid2[i] );
+            if (-1 == pid2[i]) continue;
+            mp.patch(pid2[i]).eval_into(preim.col(i), val);
+            CHECK( (val - pt).norm() < 1e-6 );
+        }
+    }
+
+    TEST(computeTopology)
+    {
+        // 3x3x2 grid of trilinear cubes with differently oriented
+        // parameterizations
+        gsMultiPatch<> mp;
+        for (index_t k = 0; k != 2; ++k)
+            for (index_t j = 0; j != 3; ++j)
+                for (index_t i = 0; i != 3; ++i)
+                {
+                    gsTensorBSpline<3>::uPtr cube = gsNurbsCreator<>::BSplineCube(1, i+0.5, j+0.5, k+0.5);
+                    const index_t t = mp.nPatches();
+                    if (1 == t % 3) cube->reverse(0);
+                    if (2 == t % 4) cube->swapDirections(0, 2);
+                    if (3 == t % 5) cube->reverse(2);
+                    mp.addPatch(give(*cube));
+                }
+        mp.computeTopology();
+
+        // Reference: compare every side with every other side
+        const index_t np = mp.nPatches();
+        std::set<std::pair<index_t,index_t> > ref;
+        for (index_t p = 0; p != np; ++p)
+            for (boxSide a = boxSide::getFirst(3); a < boxSide::getEnd(3); ++a)
+                for (index_t q = p + 1; q != np; ++q)
+                    for (boxSide b = boxSide::getFirst(3); b < boxSide::getEnd(3); ++b)
+                        if ( sameSideCorners(mp, patchSide(p,a), patchSide(q,b)) )
+                            ref.insert( std::make_pair(6*p+a-1, 6*q+b-1) );
+
+        CHECK_EQUAL( ref.size(), mp.nInterfaces() );
+        CHECK_EQUAL( 6*np - 2*ref.size(), mp.nBoundary() );
+
+        gsMatrix<> pts(3, 5), pts2, val1, val2;
+        for (gsMultiPatch<>::const_iiterator it = mp.iBegin(); it != mp.iEnd(); ++it)
+        {
+            const patchSide & s1 = it->first(), & s2 = it->second();
+            const index_t i1 = 6*s1.patch+s1-1, i2 = 6*s2.patch+s2-1;
+            CHECK( ref.count(std::make_pair(std::min(i1,i2), std::max(i1,i2))) );
+
+            // The interface map connects the same points
+            pts.setRandom();
+            pts = (pts.array() + 1) / 2;
+            pts.row(s1.direction()).setConstant(s1.parameter() ? 1 : 0);
+            mp.getMapForInterface(*it).eval_into(pts, pts2);
+            mp.patch(s1.patch).eval_into(pts , val1);
+            mp.patch(s2.patch).eval_into(pts2, val2);
+            CHECK( (val1 - val2).norm() < 1e-10 );
+        }
+
+        CHECK_THROW( mp.computeTopology(0), std::exception );
+    }
+}
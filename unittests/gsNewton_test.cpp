@@ -60,4 +60,30 @@ SUITE(gsNewton_test)
         CHECK( res <= 1e-5 );
     }
 
+    TEST(batched_inversion)
+    {
+        gsGeometry<>::Ptr f = gsNurbsCreator<>::NurbsQuarterAnnulus();
+        gsMatrix<> params(2,500), points, result;
+        params.setRandom();
+        params = (params.array() + 1) / 2;
+        f->eval_into(params, points);
+        points.col(0) << 5, 5; // not on the geometry
+
+        gsVector<index_t> flags;
+        f->invertPoints(points, result, flags, 1e-10);
+
+        CHECK( -1 == flags[0] );
+        CHECK( (flags.tail(499).array() >= 0).all() );
+        CHECK( (result.rightCols(499) - params.rightCols(499)).norm() <= 1e-8 );
+
+        // A point off a surface is projected to its foot point
+        gsGeometry<>::Ptr s = gsNurbsCreator<>::BSplineSquare(1.0, 0.0, 0.0);
+        s->embed(3);
+        points.resize(3,1);
+        points << 0.25, 0.75, 2;
+        s->closestPointsTo(points, result, flags, 1e-10);
+        CHECK( flags[0] >= 0 );
+        CHECK( (result.col(0) - gsVector<>::vec(0.25, 0.75)).norm() <= 1e-8 );
+    }
+
 }
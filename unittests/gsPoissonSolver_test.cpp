@@ -160,6 +160,89 @@ SUITE(gsPoissonSolver_test)
     {
         runPoissonSolverTest(dirichlet::nitsche, iFace::dg);
     }
-    
+
+    TEST(IetiDp_test)
+    {
+        // 3x3 patches, so that there are interior vertices
+        gsMultiPatch<> mp = gsNurbsCreator<>::BSplineSquareGrid(3, 3, 1./3);
+        gsMultiBasis<> mb(mp);
+        mb.setDegree(3);
+        for (index_t i = 0; i < 3; ++i)
+            mb.uniformRefine();
+
+        gsFunctionExpr<> f("2*pi^2*sin(pi*x)*sin(pi*y)",2);
+        gsFunctionExpr<> g("sin(pi*x)*sin(pi*y)+x*y",2);
+        gsFunctionExpr<> gEast("y-pi*sin(pi*y)",2);
+        gsBoundaryConditions<> bc;
+        for (gsMultiPatch<>::const_biterator it = mp.bBegin(); it < mp.bEnd(); ++it)
+        {
+            if (it->side() == boundary::east)
+                bc.addCondition(*it, condition_type::neumann, &gEast);
+            else
+                bc.addCondition(*it, condition_type::dirichlet, &g);
+        }
+
+        // Reference solution
+        gsPoissonAssembler<> assembler(mp, mb, bc, f, dirichlet::elimination, iFace::glue);
+        assembler.assemble();
+        gsSparseSolver<>::SimplicialLDLT direct(assembler.matrix());
+        const gsMatrix<> ref = direct.solve(assembler.rhs());
+
+        for (index_t averages = 0; averages < 2; ++averages)
+        {
+            gsOptionList opt = gsIetiDpSolver<>::defaultOptions();
+            opt.setSwitch("InterfaceAverages", averages == 1);
+            opt.setReal("Tolerance", 1e-10);
+            gsIetiDpSolver<> ieti(mp, mb, bc, f, opt);
+            // 4 interior vertices, 2 vertices on the Neumann boundary, 12 interfaces
+            CHECK_EQUAL( ieti.numPrimals(), 6 + 12 * averages );
+            CHECK_EQUAL( ieti.mapper().freeSize(), ref.rows() );
+
+            gsMatrix<> x;
+            ieti.solve(x);
+            CHECK( ieti.error() < 1e-10 );
+            CHECK( ieti.iterations() < 20 );
+            CHECK( (x - ref).norm() < 1e-6 * ref.norm() );
+        }
+    }
+
+    TEST(IetiDp3d_test)
+    {
+        // 2x2x2 patches, so that there are edges shared by four patches
+        gsMultiPatch<> mp = gsNurbsCreator<>::BSplineCubeGrid(2, 2, 2, 0.5);
+        gsMultiBasis<> mb(mp);
+        mb.setDegree(2);
+        for (index_t i = 0; i < 2; ++i)
+            mb.uniformRefine();
+
+        gsFunctionExpr<> f("3*pi^2*sin(pi*x)*sin(pi*y)*sin(pi*z)",3);
+        gsFunctionExpr<> g("sin(pi*x)*sin(pi*y)*sin(pi*z)+x*y*z",3);
+        gsBoundaryConditions<> bc;
+        for (gsMultiPatch<>::const_biterator it = mp.bBegin(); it < mp.bEnd(); ++it)
+            bc.addCondition(*it, condition_type::dirichlet, &g);
+
+        gsPoissonAssembler<> assembler(mp, mb, bc, f, dirichlet::elimination, iFace::glue);
+        assembler.assemble();
+        gsSparseSolver<>::SimplicialLDLT direct(assembler.matrix());
+        const gsMatrix<> ref = direct.solve(assembler.rhs());
+
+        for (index_t averages = 0; averages < 4; ++averages)
+        {
+            gsOptionList opt = gsIetiDpSolver<>::defaultOptions();
+            opt.setSwitch("InterfaceAverages", averages % 2 == 1);
+            opt.setSwitch("EdgeAverages", averages / 2 == 1);
+            opt.setReal("Tolerance", 1e-10);
+            gsIetiDpSolver<> ieti(mp, mb, bc, f, opt);
+            // 1 interior vertex, 12 interfaces, 6 interior edges
+            CHECK_EQUAL( ieti.numPrimals(), 1 + 12 * (averages % 2) + 6 * (averages / 2) );
+
+            gsMatrix<> x;
+            ieti.solve(x);
+            CHECK( ieti.error() < 1e-10 );
+            CHECK( ieti.iterations() < 15 );
+            CHECK( (x - ref).norm() < 1e-6 * ref.norm() );
+        }
+    }
+
 }
 
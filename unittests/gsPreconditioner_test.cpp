@@ -87,6 +87,113 @@ void runPreconditionerTest( index_t testcase )
         solver.solve(rhs,sol);
         CHECK ( solver.error() <= solver.tolerance() );
     }
+    else if (testcase==4)
+    {
+        gsChebyshevOp< gsSparseMatrix<> >::Ptr cheb = gsChebyshevOp< gsSparseMatrix<> >::make(mat, 3);
+        // The estimate is close to the largest eigenvalue of the Jacobi preconditioned matrix
+        const gsVector<> diag = mat.diagonal().cwiseInverse().cwiseSqrt();
+        const gsMatrix<> dad = diag.asDiagonal() * mat.toDense() * diag.asDiagonal();
+        const real_t lambda = dad.selfadjointView<Eigen::Lower>().eigenvalues().maxCoeff();
+        CHECK ( cheb->eigenvalueBound() >= lambda );
+        CHECK ( cheb->eigenvalueBound() <= (real_t)(1.2) * lambda );
+
+        // The estimate is reproducible and does not use rand()
+        std::srand(42);
+        const int r = std::rand();
+        std::srand(42);
+        CHECK_EQUAL( gsChebyshevOp< gsSparseMatrix<> >(mat, 3).eigenvalueBound(),
+                     cheb->eigenvalueBound() );
+        CHECK_EQUAL( std::rand(), r );
+
+        // The smoother may be applied by several threads at once
+        gsMatrix<> y, z(rhs.rows(), 4);
+        cheb->apply(rhs, y);
+#       pragma omp parallel for
+        for (index_t j = 0; j < 4; ++j)
+        {
+            gsMatrix<> zj;
+            cheb->apply(rhs, zj);
+            z.col(j) = zj;
+        }
+        for (index_t j = 0; j < 4; ++j)
+            CHECK( (z.col(j) - y).norm() <= 1e-12 * y.norm() );
+
+        gsConjugateGradient<> solver(mat, cheb);
+        solver.setTolerance( 1.e-8 );
+        solver.setMaxIterations( 50 );
+        solver.solve(rhs,sol);
+        CHECK ( solver.error() <= solver.tolerance() );
+    }
+    else if (testcase==5)
+    {
+        gsConjugateGradient<> solver(mat, makeIncompleteCholeskyOp(mat));
+        solver.setTolerance( 1.e-8 );
+        solver.setMaxIterations( 30 );
+        solver.solve(rhs,sol);
+        CHECK ( solver.error() <= solver.tolerance() );
+    }
+    else if (testcase==6)
+    {
+        gsGMRes<> solver(mat, makeIncompleteLUOp(mat));
+        solver.setTolerance( 1.e-8 );
+        solver.setMaxIterations( 30 );
+        solver.solve(rhs,sol);
+        CHECK ( solver.error() <= solver.tolerance() );
+    }
+}
+
+// Plane strain linear elasticity with bilinear elements on the unit
+// square, clamped at x=0. The degrees of freedom are ordered by
+// components; points holds the coordinates of the nodes.
+void elasticityMatrix( index_t N, gsSparseMatrix<> & K, gsMatrix<> & points )
+{
+    const real_t lambda = 1, mu = 1, h = (real_t)(1)/N;
+    const index_t nn = N * (N + 1);
+
+    points.resize(2, nn);
+    for (index_t i = 1; i <= N; ++i)
+        for (index_t j = 0; j <= N; ++j)
+            points.col((i-1)*(N+1)+j) << i*h, j*h;
+
+    gsMatrix<> D(3,3);
+    D << lambda+2*mu, lambda, 0,
+         lambda, lambda+2*mu, 0,
+         0, 0, mu;
+
+    // Element stiffness matrix, the local degrees of freedom are
+    // (node,component) -> 2*node+component
+    const index_t ox[4] = {0,1,1,0}, oy[4] = {0,0,1,1};
+    gsMatrix<> Ke; Ke.setZero(8,8);
+    for (index_t q = 0; q < 4; ++q)
+    {
+        const real_t gp[2] = { 0.5 - 0.5/math::sqrt(3.), 0.5 + 0.5/math::sqrt(3.) };
+        const real_t xi = gp[q%2], eta = gp[q/2];
+        gsMatrix<> B; B.setZero(3,8);
+        for (index_t k = 0; k < 4; ++k)
+        {
+            const real_t fx = ox[k] ? xi : 1-xi, fy = oy[k] ? eta : 1-eta;
+            const real_t dx = (ox[k] ? 1 : -1) * fy / h, dy = (oy[k] ? 1 : -1) * fx / h;
+            B(0,2*k) = dx; B(2,2*k) = dy;
+            B(1,2*k+1) = dy; B(2,2*k+1) = dx;
+        }
+        Ke += 0.25 * h * h * B.transpose() * D * B;
+    }
+
+    gsSparseEntries<> entries;
+    for (index_t ex = 0; ex < N; ++ex)
+        for (index_t ey = 0; ey < N; ++ey)
+            for (index_t k = 0; k < 8; ++k)
+                for (index_t l = 0; l < 8; ++l)
+                {
+                    const index_t ik = ex + ox[k/2], jk = ey + oy[k/2];
+                    const index_t il = ex + ox[l/2], jl = ey + oy[l/2];
+                    if (0 == ik || 0 == il) // clamped
+                        continue;
+                    entries.add( (k%2)*nn + (ik-1)*(N+1)+jk, (l%2)*nn + (il-1)*(N+1)+jl, Ke(k,l) );
+                }
+    K.resize(2*nn, 2*nn);
+    K.setFrom(entries);
+    K.makeCompressed();
 }
 
 
@@ -109,6 +216,76 @@ SUITE(gsPreconditioner_test)
     {
         runPreconditionerTest(3);
     }
+    TEST(gsChebyshevPreconditioner_test)
+    {
+        runPreconditionerTest(4);
+    }
+
+    TEST(gsIncompleteCholeskyPreconditioner_test)
+    {
+        runPreconditionerTest(5);
+    }
+
+    TEST(gsIncompleteLUPreconditioner_test)
+    {
+        runPreconditionerTest(6);
+    }
+
+    TEST(gsIncompleteFactorization_test)
+    {
+        // Nonsymmetric tridiagonal matrix: ILU(0) is the exact LU factorization
+        const index_t n = 50;
+        gsSparseMatrix<> mat(n,n);
+        for (index_t i = 0; i < n; ++i)
+        {
+            mat.insert(i,i) = 3;
+            if (i > 0)   mat.insert(i,i-1) = -1;
+            if (i < n-1) mat.insert(i,i+1) = -2;
+        }
+        mat.makeCompressed();
+
+        const gsMatrix<> rhs = gsMatrix<>::Random(n,2);
+        gsMatrix<> x;
+        gsIncompleteLUOp<>::uPtr ilu = makeIncompleteLUOp(mat);
+        ilu->apply(rhs,x);
+        CHECK( (mat*x - rhs).norm() < 1e-10 );
+
+        x.setZero(n,2);
+        ilu->stepT(rhs,x);
+        CHECK( (mat.transpose()*x - rhs).norm() < 1e-10 );
+
+        // Refactorization for changed values
+        mat *= 2;
+        ilu->refactorize();
+        ilu->apply(rhs,x);
+        CHECK( (mat*x - rhs).norm() < 1e-10 );
+
+        // For a symmetric matrix, IC(0) and ILU(0) give the same preconditioner
+        gsSparseMatrix<> sym = mat + gsSparseMatrix<>(mat.transpose());
+        sym.makeCompressed();
+        gsMatrix<> y;
+        makeIncompleteLUOp(sym)->apply(rhs,x);
+        makeIncompleteCholeskyOp(sym)->apply(rhs,y);
+        CHECK( (x - y).norm() < 1e-10 * x.norm() );
+
+        // A singular matrix needs a shift, but the refactorization of a
+        // regular matrix starts again from the initial shift
+        gsSparseMatrix<> sing(2,2);
+        sing.insert(0,0) = 1; sing.insert(0,1) = 1;
+        sing.insert(1,0) = 1; sing.insert(1,1) = 1;
+        sing.makeCompressed();
+        gsIncompleteLUOp<>::uPtr iluS = makeIncompleteLUOp(sing);
+        gsIncompleteCholeskyOp<>::uPtr icS = makeIncompleteCholeskyOp(sing);
+        CHECK( iluS->usedShift() > 0 );
+        CHECK( icS->usedShift() > 0 );
+        sing.coeffRef(0,0) = sing.coeffRef(1,1) = 2;
+        iluS->refactorize();
+        icS->refactorize();
+        CHECK_EQUAL( iluS->shift(), 0 );
+        CHECK_EQUAL( iluS->usedShift(), 0 );
+        CHECK_EQUAL( icS->shift(), 0 );
+        CHECK_EQUAL( icS->usedShift(), 0 );
+    }
 
     TEST(gsPatchPreconditioner_stiff_test)
     {
@@ -163,6 +340,58 @@ SUITE(gsPreconditioner_test)
         CHECK ( result.norm() < 1/real_t(10000) );
     }
 
+    TEST(gsPatchPreconditioner_cache_test)
+    {
+        // Same univariate basis in both directions, large enough for
+        // the diagonal scaling to be done in parallel
+        gsKnotVector<> kv(0, 1, 149, 4);
+        gsTensorBSplineBasis<2> basis(kv, kv);
+
+        gsConstantFunction<> one(1,2);
+        gsBoundaryConditions<> bc;
+        bc.addCondition( boundary::west,  condition_type::dirichlet, &one );
+        bc.addCondition( boundary::east,  condition_type::neumann,   &one );
+        bc.addCondition( boundary::south, condition_type::neumann,   &one );
+        bc.addCondition( boundary::north, condition_type::neumann,   &one );
+
+        gsOptionList opt = gsAssembler<>::defaultOptions();
+        gsPatchPreconditionersCreator<>::clearCache();
+
+        gsSparseMatrix<> K = gsPatchPreconditionersCreator<>::stiffnessMatrix(basis,bc,opt,1);
+        gsMatrix<> rhs, x1, x2;
+        rhs.setRandom(K.rows(), 2);
+
+        gsLinearOperator<>::Ptr op1 = gsPatchPreconditionersCreator<>::fastDiagonalizationOp(basis,bc,opt,1);
+        op1->apply(rhs,x1);
+        CHECK ( (K*x1-rhs).norm() < rhs.norm() / real_t(100000000) );
+
+        // Uses the cached eigendecompositions
+        gsLinearOperator<>::Ptr op2 = gsPatchPreconditionersCreator<>::fastDiagonalizationOp(basis,bc,opt,1);
+        op2->apply(rhs,x2);
+        CHECK ( x1 == x2 );
+
+        // The operators stay valid if the cache is cleared
+        gsPatchPreconditionersCreator<>::clearCache();
+        op1->apply(rhs,x2);
+        CHECK ( x1 == x2 );
+        gsPatchPreconditionersCreator<>::fastDiagonalizationOp(basis,bc,opt,1)->apply(rhs,x2);
+        CHECK ( (x1-x2).norm() < x1.norm() / real_t(100000000) );
+
+        // One entry for each of the two boundary conditions
+        CHECK_EQUAL ( 2, gsPatchPreconditionersCreator<>::cacheSize() );
+
+        // The size of the cache is bounded
+        const index_t capacity = gsPatchPreconditionersCreator<>::cacheCapacity();
+        gsPatchPreconditionersCreator<>::setCacheCapacity(1);
+        CHECK_EQUAL ( 1, gsPatchPreconditionersCreator<>::cacheSize() );
+        gsPatchPreconditionersCreator<>::setCacheCapacity(0);
+        CHECK_EQUAL ( 0, gsPatchPreconditionersCreator<>::cacheSize() );
+        gsPatchPreconditionersCreator<>::fastDiagonalizationOp(basis,bc,opt,1)->apply(rhs,x2);
+        CHECK ( (x1-x2).norm() < x1.norm() / real_t(100000000) );
+        CHECK_EQUAL ( 0, gsPatchPreconditionersCreator<>::cacheSize() );
+        gsPatchPreconditionersCreator<>::setCacheCapacity(capacity);
+    }
+
     TEST(gsPatchPreconditioner_mass_test)
     {
         // Define Geometry
@@ -263,8 +492,221 @@ SUITE(gsPreconditioner_test)
             gsMatrix<> res;
             a.apply( in, res );
             CHECK ( (res-out).norm() < 1/real_t(10000) );
+
+            // The dense matrix operators can be applied concurrently
+            CHECK ( !a.isConcurrent() );
+            a.setConcurrent();
+            a.apply( in, res );
+            CHECK ( (res-out).norm() < 1/real_t(10000) );
+        }
+    }
+
+    TEST(gsAdditiveSchwarz_test)
+    {
+        gsMultiPatch<> mp = gsNurbsCreator<>::BSplineSquareGrid(2, 2, 0.5);
+        mp.computeTopology();
+        gsMultiBasis<> mb(mp);
+        mb.setDegree(2);
+        for (index_t i = 0; i < 3; ++i)
+            mb.uniformRefine();
+
+        gsBoundaryConditions<> bc;
+        gsConstantFunction<> zero(0., 2), one(1., 2);
+        for (gsMultiPatch<>::const_biterator it = mp.bBegin(); it < mp.bEnd(); ++it)
+            bc.addCondition(*it, condition_type::dirichlet, &zero);
+
+        gsPoissonAssembler<> assembler(mp, mb, bc, one, dirichlet::elimination, iFace::glue);
+        assembler.assemble();
+        const gsSparseMatrix<> & mat = assembler.matrix();
+        const gsDofMapper & mapper = assembler.system().colMapper(0);
+
+        // The patches cover all degrees of freedom, the interfaces are shared
+        std::vector< std::vector<index_t> > dofs = gsMultiPatchPreconditionersCreator<>::patchDofs(mapper);
+        CHECK_EQUAL( dofs.size(), 4u );
+        std::vector<bool> covered(mat.rows(), false);
+        size_t total = 0;
+        for (size_t k = 0; k < dofs.size(); ++k)
+        {
+            total += dofs[k].size();
+            for (size_t j = 0; j < dofs[k].size(); ++j)
+                covered[dofs[k][j]] = true;
+        }
+        CHECK( std::find(covered.begin(), covered.end(), false) == covered.end() );
+        CHECK( total > (size_t)mat.rows() );
+
+        // A single subspace with all degrees of freedom is the exact inverse
+        gsMatrix<> x;
+        std::vector< std::vector<index_t> > all(1);
+        for (index_t i = 0; i < mat.rows(); ++i)
+            all[0].push_back(i);
+        gsMultiPatchPreconditionersCreator<>::additiveSchwarzOp(mat, all)->apply(assembler.rhs(), x);
+        CHECK( (mat*x - assembler.rhs()).norm() < 1e-8 * assembler.rhs().norm() );
+
+        // The overlap reduces the number of iterations
+        index_t iter[2];
+        for (index_t overlap = 0; overlap < 2; ++overlap)
+        {
+            gsConjugateGradient<> solver(mat,
+                gsMultiPatchPreconditionersCreator<>::additiveSchwarzOp(mat, mapper, 2*overlap));
+            solver.setTolerance(1e-8);
+            x.clear();
+            solver.solve(assembler.rhs(), x);
+            CHECK( solver.error() < 1e-8 );
+            iter[overlap] = solver.iterations();
+        }
+        CHECK( iter[1] < iter[0] );
+    }
+
+    TEST(gsMultiGrid_fused_test)
+    {
+        gsMultiPatch<> mp( *gsNurbsCreator<>::BSplineFatQuarterAnnulus() );
+        gsMultiBasis<> mb(mp);
+        mb.setDegree(2);
+        for (index_t i = 0; i < 4; ++i)
+            mb.uniformRefine();
+
+        gsBoundaryConditions<> bc;
+        gsConstantFunction<> zero(0., 2), one(1., 2);
+        for (gsMultiPatch<>::const_biterator it = mp.bBegin(); it < mp.bEnd(); ++it)
+            bc.addCondition(*it, condition_type::dirichlet, &zero);
+
+        gsPoissonAssembler<> assembler(mp, mb, bc, one, dirichlet::elimination, iFace::glue);
+        assembler.assemble();
+
+        gsOptionList opt = gsGridHierarchy<>::defaultOptions();
+        opt.setInt("DirichletStrategy", dirichlet::elimination);
+        opt.setInt("InterfaceStrategy", iFace::glue);
+        std::vector< gsSparseMatrix<real_t,RowMajor> > transfer;
+        gsGridHierarchy<>::buildByCoarsening(mb, bc, opt, 3)
+            .moveTransferMatricesTo(transfer);
+
+        // Computes the restricted residual and applies the correction
+        // in one sweep
+        gsMultiGridOp<>::Ptr fused = gsMultiGridOp<>::make( assembler.matrix(), transfer );
+        const index_t nl = fused->numLevels();
+        CHECK_EQUAL( 3, nl );
+
+        // The same method, but matrix-free, thus forming the residual
+        // on the fine grid
+        std::vector< gsLinearOperator<>::Ptr > ops(nl), prolong(nl-1), restrict(nl-1);
+        for (index_t i = 0; i < nl; ++i)
+            ops[i] = makeMatrixOp(fused->matrix(i));
+        for (index_t i = 0; i < nl-1; ++i)
+        {
+            prolong[i] = makeMatrixOp(transfer[i]);
+            gsSparseMatrix<real_t,RowMajor> r = transfer[i].transpose();
+            restrict[i] = makeMatrixOp(r.moveToPtr());
+        }
+        gsMultiGridOp<>::Ptr unfused = gsMultiGridOp<>::make( ops, prolong, restrict, fused->coarseSolver() );
+
+        // The smoother has to handle several right-hand sides
+        for (index_t i = 1; i < nl; ++i)
+        {
+            fused->setSmoother(i, makeChebyshevOp(fused->matrix(i)));
+            unfused->setSmoother(i, makeChebyshevOp(fused->matrix(i)));
+        }
+
+        gsMatrix<> rhs, x1, x2;
+        rhs.setRandom(fused->rows(), 2);
+        for (index_t cycles = 1; cycles <= 2; ++cycles)
+        {
+            fused->setNumCycles(cycles);
+            unfused->setNumCycles(cycles);
+            x1.setRandom(fused->rows(), 2);
+            x2 = x1;
+            for (index_t k = 0; k < 3; ++k)
+            {
+                fused->step(rhs, x1);
+                unfused->step(rhs, x2);
+            }
+            CHECK( (x1 - x2).norm() <= 1e-10 * x1.norm() );
         }
+
+        // Without smoothing, a two-grid step is the coarse-grid
+        // correction x - P Ac^{-1} P^T (A x - rhs), which checks the
+        // restricted residual and the correction of both variants
+        std::vector< gsSparseMatrix<real_t,RowMajor> > last(1, transfer.back());
+        gsMultiGridOp<>::Ptr fused2 = gsMultiGridOp<>::make( assembler.matrix(), last );
+        std::vector< gsLinearOperator<>::Ptr > ops2(2), prolong2(1), restrict2(1);
+        ops2[0] = makeMatrixOp(fused2->matrix(0));
+        ops2[1] = makeMatrixOp(fused2->matrix(1));
+        prolong2[0] = makeMatrixOp(last[0]);
+        gsSparseMatrix<real_t,RowMajor> r = last[0].transpose();
+        restrict2[0] = makeMatrixOp(r.moveToPtr());
+        gsMultiGridOp<>::Ptr unfused2 =
+            gsMultiGridOp<>::make( ops2, prolong2, restrict2, fused2->coarseSolver() );
+        fused2->setNumPreSmooth(0);
+        fused2->setNumPostSmooth(0);
+        unfused2->setNumPreSmooth(0);
+        unfused2->setNumPostSmooth(0);
+
+        const gsMatrix<> A  = fused2->matrix(1).toDense();
+        const gsMatrix<> P  = last[0].toDense();
+        const gsMatrix<> Ac = P.transpose() * A * P;
+        x1.setRandom(fused2->rows(), 2);
+        const gsMatrix<> ref = x1 - P * Ac.partialPivLu().solve( P.transpose() * (A * x1 - rhs) );
+        x2 = x1;
+        fused2->step(rhs, x1);
+        unfused2->step(rhs, x2);
+        CHECK( (x1 - ref).norm() <= 1e-10 * ref.norm() );
+        CHECK( (x2 - ref).norm() <= 1e-10 * ref.norm() );
     }
 
+    TEST(gsAlgebraicMultiGrid_Poisson_test)
+    {
+        gsMultiPatch<> mp( *gsNurbsCreator<>::BSplineFatQuarterAnnulus() );
+        gsMultiBasis<> mb(mp);
+        mb.setDegree(3);
+        for (index_t i = 0; i < 6; ++i)
+            mb.uniformRefine();
+
+        gsBoundaryConditions<> bc;
+        gsConstantFunction<> zero(0., 2), one(1., 2);
+        for (gsMultiPatch<>::const_biterator it = mp.bBegin(); it < mp.bEnd(); ++it)
+            bc.addCondition(*it, condition_type::dirichlet, &zero);
+
+        gsPoissonAssembler<> assembler(mp, mb, bc, one, dirichlet::elimination, iFace::glue);
+        assembler.assemble();
+        const gsSparseMatrix<> & mat = assembler.matrix();
+
+        gsOptionList opt = gsAlgebraicMultiGridOp<>::defaultOptions();
+        opt.setInt("CoarseSize", 100);
+        gsAlgebraicMultiGridOp<>::Ptr amg = gsAlgebraicMultiGridOp<>::make(mat, gsMatrix<>(), 1, opt);
+        CHECK( amg->numLevels() > 2 );
+        CHECK( amg->operatorComplexity() < 2 );
+
+        gsMatrix<> x;
+        gsConjugateGradient<> solver(mat, amg);
+        solver.setTolerance(1e-8);
+        solver.solve(assembler.rhs(), x);
+        CHECK( solver.error() < 1e-8 );
+        CHECK( solver.iterations() < 30 );
+    }
+
+    TEST(gsAlgebraicMultiGrid_elasticity_test)
+    {
+        gsSparseMatrix<> mat;
+        gsMatrix<> points, x;
+        elasticityMatrix(64, mat, points);
+        const gsMatrix<> rhs = gsMatrix<>::Ones(mat.rows(), 1);
+
+        // Only the translations
+        gsAlgebraicMultiGridOp<>::Ptr amg1 = gsAlgebraicMultiGridOp<>::make(mat, gsMatrix<>(), 2);
+        gsConjugateGradient<> solver1(mat, amg1);
+        solver1.setTolerance(1e-8);
+        solver1.solve(rhs, x);
+        CHECK( solver1.error() < 1e-8 );
+
+        // All rigid body modes
+        const gsMatrix<> modes = gsAlgebraicMultiGridOp<>::rigidBodyModes(points);
+        gsAlgebraicMultiGridOp<>::Ptr amg2 = gsAlgebraicMultiGridOp<>::make(mat, modes, 2);
+        CHECK( amg2->numLevels() > 1 );
+        gsConjugateGradient<> solver2(mat, amg2);
+        solver2.setTolerance(1e-8);
+        x.clear();
+        solver2.solve(rhs, x);
+        CHECK( solver2.error() < 1e-8 );
+        CHECK( solver2.iterations() < solver1.iterations() );
+    }
 
 }
@@ -57,6 +57,26 @@ T computeMaximumDistance(const gsFunction<T>& f1, const gsFunction<T>& f2, const
     return (values1 - values2).array().abs().maxCoeff();
 }
 
+// Checks that the NURBS \a elev equals \a orig and that the weight
+// functions of both agree
+template<class Nurbs>
+void testNurbsElevation_helper(const Nurbs& orig, const Nurbs& elev)
+{
+    gsMatrix<> paramRange = orig.parameterRange();
+    CHECK (computeMaximumDistance<real_t>(orig, elev, paramRange.col(0), paramRange.col(1), 500) <= 1e-12);
+
+    const gsBasis<>& b0 = orig.basis().source();
+    const gsBasis<>& b1 = elev.basis().source();
+    const gsMatrix<>& w0 = orig.basis().weights();
+    const gsMatrix<>& w1 = elev.basis().weights();
+    CHECK (w1.rows() == b1.size());
+    CHECK (w1.minCoeff() > 0);
+
+    gsGeometry<>::uPtr wf0 = b0.makeGeometry(w0);
+    gsGeometry<>::uPtr wf1 = b1.makeGeometry(w1);
+    CHECK (computeMaximumDistance<real_t>(*wf0, *wf1, paramRange.col(0), paramRange.col(1), 500) <= 1e-12);
+}
+
 SUITE(gsRefinement_test)
 {
     TEST(testBoehm)
@@ -120,6 +140,35 @@ SUITE(gsRefinement_test)
         testBoehm_helper(bsp, knots2);
     }
 
+    TEST(testNurbsDegreeElevate)
+    {
+        gsNurbs<>::uPtr circle = gsNurbsCreator<>::NurbsCircle();
+        gsNurbs<>::uPtr elev = circle->clone();
+        elev->degreeElevate(2);
+        CHECK_EQUAL (circle->degree() + 2, elev->degree());
+        CHECK_EQUAL (circle->basis().size() + 2*circle->knots().numElements(), elev->basis().size());
+        testNurbsElevation_helper(*circle, *elev);
+    }
+
+    TEST(testTensorNurbsDegreeElevate)
+    {
+        gsTensorNurbs<2>::uPtr annulus = gsNurbsCreator<>::NurbsQuarterAnnulus();
+        annulus->uniformRefine();
+
+        gsTensorNurbs<2>::uPtr elev = annulus->clone();
+        elev->degreeElevate(1);
+        CHECK_EQUAL (annulus->degree(0) + 1, elev->degree(0));
+        CHECK_EQUAL (annulus->degree(1) + 1, elev->degree(1));
+        testNurbsElevation_helper(*annulus, *elev);
+
+        // Elevation in one direction only
+        elev = annulus->clone();
+        elev->degreeElevate(2, 1);
+        CHECK_EQUAL (annulus->degree(0)    , elev->degree(0));
+        CHECK_EQUAL (annulus->degree(1) + 2, elev->degree(1));
+        testNurbsElevation_helper(*annulus, *elev);
+    }
+
     TEST(testCoarsening)
     {
         gsKnotVector<> kv(0.0,1.0, 7, 3,1);
@@ -131,6 +131,32 @@ std::vector<index_t> random_refinement(int lvl, int max_nb,
 }
 
 
+// Compares the evaluation through the per-element truncation cache
+// with the evaluation of the single THB-splines
+void check_element_cache(const gsTHBSplineBasis<2> & THB)
+{
+    gsMatrix<> pts(2, 50), val, der, single;
+    pts.setRandom();
+    pts = (pts.array() + 1) / 2;
+    gsMatrix<index_t> act;
+    THB.active_into(pts, act);
+    THB.eval_into(pts, val);
+    THB.deriv_into(pts, der);
+    for (index_t j = 0; j != pts.cols(); ++j)
+        for (index_t k = 0; k != act.rows(); ++k)
+        {
+            if (0 == act(k, j) && 0 != k) continue;
+            THB.evalSingle_into(act(k, j), pts.col(j), single);
+            CHECK_CLOSE(single(0, 0), val(k, j), (real_t)1e-10);
+            THB.derivSingle_into(act(k, j), pts.col(j), single);
+            CHECK_CLOSE(single(0, 0), der(2*k  , j), (real_t)1e-8);
+            CHECK_CLOSE(single(1, 0), der(2*k+1, j), (real_t)1e-8);
+        }
+
+    // The THB-splines form a partition of unity
+    CHECK( (val.colwise().sum().array() - 1).abs().maxCoeff() < 1e-10 );
+}
+
 SUITE(gsThbs_geometry_test)
 {
 
@@ -208,4 +234,187 @@ SUITE(gsThbs_geometry_test)
 
     }
 
+
+    TEST(element_cache)
+    {
+        // Evaluation through the per-element truncation cache agrees
+        // with the evaluation of the single THB-splines
+        gsKnotVector<> kv(0, 1, 3, 3, 1);
+        gsTensorBSplineBasis<2> tbasis(kv, kv);
+        gsTHBSplineBasis<2> TT(tbasis);
+        gsTHBSplineBasis<2> THB(tbasis, random_refinement(3, 5, &TT));
+        check_element_cache(THB);
+
+        // The levels are no longer related by inserting one knot per
+        // span
+        gsTHBSplineBasis<2> elevated = THB;
+        elevated.degreeElevate();
+        check_element_cache(elevated);
+
+        gsTHBSplineBasis<2> refined = THB;
+        refined.uniformRefine(1, 2);
+        check_element_cache(refined);
+    }
+
+    TEST(incremental_refinement)
+    {
+        // Refining box by box gives the same basis as inserting all
+        // boxes at once
+        gsKnotVector<> kv(0, 1, 3, 3, 1);
+        gsTensorBSplineBasis<2> tbasis(kv, kv);
+        gsTHBSplineBasis<2> TT(tbasis);
+        const std::vector<index_t> boxes = random_refinement(3, 5, &TT);
+        gsTHBSplineBasis<2> all(tbasis, boxes);
+
+        gsTHBSplineBasis<2> steps(tbasis);
+        for (size_t i = 0; i < boxes.size(); i += 5)
+            steps.refineElements(std::vector<index_t>(boxes.begin() + i,
+                                                      boxes.begin() + i + 5));
+
+        CHECK_EQUAL(all.size(), steps.size());
+        CHECK(all.getXmatrix() == steps.getXmatrix());
+    }
+
+    TEST(uniformRefine_withTransfer)
+    {
+        // The transfer expresses the coarse basis functions in terms
+        // of the refined ones
+        gsKnotVector<> kv(0, 1, 3, 3, 1);
+        gsTensorBSplineBasis<2> tbasis(kv, kv);
+        gsTHBSplineBasis<2> TT(tbasis);
+        gsTHBSplineBasis<2> fine(tbasis, random_refinement(3, 5, &TT));
+        const gsTHBSplineBasis<2> coarse = fine;
+
+        gsSparseMatrix<real_t,RowMajor> transfer;
+        fine.uniformRefine_withTransfer(transfer);
+        CHECK_EQUAL(fine.size()  , transfer.rows());
+        CHECK_EQUAL(coarse.size(), transfer.cols());
+
+        gsMatrix<> pts(2, 50), cval(coarse.size(), 50), fval(fine.size(), 50), val;
+        pts.setRandom();
+        pts = (pts.array() + 1) / 2;
+        for (index_t i = 0; i < coarse.size(); ++i)
+        {
+            coarse.evalSingle_into(i, pts, val);
+            cval.row(i) = val;
+        }
+        for (index_t i = 0; i < fine.size(); ++i)
+        {
+            fine.evalSingle_into(i, pts, val);
+            fval.row(i) = val;
+        }
+        CHECK( (transfer.transpose() * fval - cval).cwiseAbs().maxCoeff() < 1e-12 );
+
+        // Other refinements are rejected, leaving the basis unchanged
+        CHECK_THROW(fine.uniformRefine_withTransfer(transfer, 2), std::runtime_error);
+        CHECK_THROW(fine.uniformRefine_withTransfer(transfer, 1, 2), std::runtime_error);
+        CHECK_EQUAL(fine.size(), transfer.rows());
+    }
+
+    TEST(hierarchical_fitting)
+    {
+        // After refinement, the normal equations are updated only
+        // around the refined area; the fit must agree with a fit
+        // from scratch on the same basis
+        gsMatrix<> par(2, 2000), pts(3, 2000);
+        par.setRandom();
+        par = (par.array() + 1) / 2;
+        pts.topRows(2) = par;
+        pts.row(2) = (-50 * (par.array() - 0.3).square().colwise().sum()).exp();
+
+        gsKnotVector<> kv(0, 1, 7, 3);
+        gsTensorBSplineBasis<2> tbasis(kv, kv);
+        gsTHBSplineBasis<2> thb(tbasis);
+        std::vector<unsigned> ext(2, 1);
+        gsHFitting<2, real_t> fit(par, pts, thb, 0.05, ext);
+        fit.iterativeRefine(2, 0);
+        CHECK( thb.maxLevel() > 0 );
+
+        gsTHBSplineBasis<2> basis = thb;
+        gsFitting<> ref(par, pts, basis);
+        ref.compute();
+
+        gsMatrix<> val, rval;
+        fit.result()->eval_into(par, val);
+        ref.result()->eval_into(par, rval);
+        CHECK( (val - rval).cwiseAbs().maxCoeff() < 1e-6 );
+    }
+
+    TEST(hierarchical_fitting_update)
+    {
+        // The normal equations updated after each refinement step
+        // agree with the ones assembled from scratch. Only the
+        // summation order of the threads may differ.
+        gsMatrix<> par(2, 3000), pts(3, 3000);
+        par.setRandom();
+        par = (par.array() + 1) / 2;
+        pts.topRows(2) = par;
+        pts.row(2) = (-80 * (par.array() - 0.6).square().colwise().sum()).exp()
+            + (20 * par.row(0).array()).sin() * par.row(1).array();
+
+        gsKnotVector<> kv(0, 1, 5, 3);
+        gsTensorBSplineBasis<2> tbasis(kv, kv);
+        gsTHBSplineBasis<2> thb(tbasis);
+        std::vector<unsigned> ext(2, 0);
+        gsHFitting<2, real_t> fit(par, pts, thb, 0.1, ext);
+        fit.nextIteration(0, -1);
+
+        for (index_t it = 0; it != 4; ++it)
+        {
+            fit.nextIteration(0, -1);
+            const index_t n = thb.size();
+            gsSparseMatrix<> A(n, n), A0(n, n);
+            gsMatrix<> B, B0;
+            B.setZero(n, 3);
+            B0.setZero(n, 3);
+            fit.assembleSystem(A, B);
+            gsFitting<> ref(par, pts, thb);
+            ref.gsFitting<>::assembleSystem(A0, B0);
+
+            const gsMatrix<> dA = A.toDense() - A0.toDense();
+            CHECK( dA.cwiseAbs().maxCoeff() <= 1e-12 * A0.toDense().cwiseAbs().maxCoeff() );
+            CHECK( (B - B0).cwiseAbs().maxCoeff() <= 1e-12 * B0.cwiseAbs().maxCoeff() );
+        }
+        CHECK( thb.maxLevel() > 2 );
+    }
+
+    TEST(bspline_patches)
+    {
+        // The B-spline patches coincide with the THB-spline geometry
+        // on their boxes, and both exports give the same control points
+        gsKnotVector<> kv(0, 1, 3, 3, 1);
+        gsTensorBSplineBasis<2> tbasis(kv, kv);
+        gsTHBSplineBasis<2> TT(tbasis);
+        gsTHBSplineBasis<2> THB(tbasis, random_refinement(3, 5, &TT));
+        gsMatrix<> coefs(THB.size(), 3);
+        coefs.setRandom();
+        gsTHBSpline<2> geo(THB, coefs);
+
+        gsMultiPatch<> mp = THB.getBsplinePatchesToMultiPatch(coefs);
+        gsMatrix<> cp;
+        gsMatrix<index_t> b1, b2, nvertices;
+        gsVector<index_t> level;
+        THB.getBsplinePatches(coefs, cp, b1, b2, level, nvertices);
+        CHECK_EQUAL(level.size(), (index_t)mp.nPatches());
+
+        gsMatrix<> pts(2, 10), supp, val, ref;
+        index_t offset = 0;
+        for (size_t i = 0; i < mp.nPatches(); ++i)
+        {
+            const index_t n = nvertices.row(i).prod();
+            CHECK( cp.middleRows(offset, n) == mp.patch(i).coefs() );
+            offset += n;
+
+            supp = mp.patch(i).support();
+            pts.setRandom();
+            pts = (pts.array() + 1) / 2;
+            for (index_t k = 0; k < 2; ++k)
+                pts.row(k) = supp(k, 0) + (supp(k, 1) - supp(k, 0)) * pts.row(k).array();
+            mp.patch(i).eval_into(pts, val);
+            geo.eval_into(pts, ref);
+            CHECK( (val - ref).cwiseAbs().maxCoeff() < 1e-12 );
+        }
+        CHECK_EQUAL(cp.rows(), offset);
+    }
+
 }